@@ -0,0 +1,194 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+/*
+ * Monitor the online lower bound of the execution time of each iteration,
+ * estimated with STARPU_ONLINE_BOUND, through the starpu.bound performance
+ * counters. Each iteration submits chains of tasks, so that the critical
+ * path bound is known.
+ */
+
+#include <starpu.h>
+#include <math.h>
+#include <inttypes.h>
+
+#define FPRINTF(ofile, fmt, ...) do { if (!getenv("STARPU_SSILENT")) {fprintf(ofile, fmt, ## __VA_ARGS__); }} while(0)
+
+/* Duration of the tasks, in us */
+#define DURATION 1000.
+#define NCHAINS 2
+#ifdef STARPU_QUICK_CHECK
+#define CHAIN_LEN 4
+#define NITER 3
+#else
+#define CHAIN_LEN 10
+#define NITER 10
+#endif
+
+static int id_g_windows;
+static int id_g_critical_path_bound;
+static int id_g_bound_area;
+static int id_g_achieved;
+static int id_g_efficiency;
+
+static int64_t windows;
+static double critical_path_bound;
+static double area_bound;
+static double achieved;
+static double efficiency;
+
+void g_listener_cb(struct starpu_perf_counter_listener *listener, struct starpu_perf_counter_sample *sample, void *context)
+{
+	(void) listener;
+	(void) context;
+	windows = starpu_perf_counter_sample_get_int64_value(sample, id_g_windows);
+	critical_path_bound = starpu_perf_counter_sample_get_double_value(sample, id_g_critical_path_bound);
+	area_bound = starpu_perf_counter_sample_get_double_value(sample, id_g_bound_area);
+	achieved = starpu_perf_counter_sample_get_double_value(sample, id_g_achieved);
+	efficiency = starpu_perf_counter_sample_get_double_value(sample, id_g_efficiency);
+}
+
+void func(void *buffers[], void *cl_args)
+{
+	(void) buffers;
+	(void) cl_args;
+	double start = starpu_timing_now();
+	while (starpu_timing_now() - start < DURATION)
+		;
+}
+
+static double cost_function(struct starpu_task *t, struct starpu_perfmodel_arch *a, unsigned i)
+{
+	(void) t; (void) a; (void) i;
+	return DURATION;
+}
+
+static struct starpu_perfmodel perf_model =
+{
+	.type = STARPU_PER_ARCH,
+	.arch_cost_function = cost_function,
+};
+
+struct starpu_codelet cl =
+{
+	.cpu_funcs      = {func},
+	.cpu_funcs_name = {"func"},
+	.nbuffers       = 1,
+	.modes          = {STARPU_RW},
+	.model          = &perf_model,
+	.name           = "perf_counter_bound"
+};
+
+int main(int argc, char **argv)
+{
+	const enum starpu_perf_counter_scope g_scope = starpu_perf_counter_scope_global;
+	struct starpu_conf conf;
+	starpu_data_handle_t handles[NCHAINS];
+	int values[NCHAINS];
+	int ret, iter, c, i;
+
+	(void) argc;
+	(void) argv;
+
+	setenv("STARPU_ONLINE_BOUND", "1", 1);
+
+	starpu_conf_init(&conf);
+	/* Start collecting performance counter right after initialization */
+	conf.start_perf_counter_collection = 1;
+
+	ret = starpu_init(&conf);
+	if (ret == -ENODEV)
+		return 77;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	if (starpu_cpu_worker_get_count() == 0)
+	{
+		FPRINTF(stderr, "This example needs CPU workers\n");
+		starpu_shutdown();
+		return 77;
+	}
+
+	struct starpu_perf_counter_set *g_set = starpu_perf_counter_set_alloc(g_scope);
+	STARPU_ASSERT(g_set != NULL);
+
+	id_g_windows = starpu_perf_counter_name_to_id(g_scope, "starpu.bound.g_windows");
+	STARPU_ASSERT(id_g_windows != -1);
+	id_g_critical_path_bound = starpu_perf_counter_name_to_id(g_scope, "starpu.bound.g_critical_path_bound");
+	STARPU_ASSERT(id_g_critical_path_bound != -1);
+	id_g_bound_area = starpu_perf_counter_name_to_id(g_scope, "starpu.bound.g_area_bound");
+	STARPU_ASSERT(id_g_bound_area != -1);
+	id_g_achieved = starpu_perf_counter_name_to_id(g_scope, "starpu.bound.g_achieved");
+	STARPU_ASSERT(id_g_achieved != -1);
+	id_g_efficiency = starpu_perf_counter_name_to_id(g_scope, "starpu.bound.g_efficiency");
+	STARPU_ASSERT(id_g_efficiency != -1);
+
+	starpu_perf_counter_set_enable_id(g_set, id_g_windows);
+	starpu_perf_counter_set_enable_id(g_set, id_g_critical_path_bound);
+	starpu_perf_counter_set_enable_id(g_set, id_g_bound_area);
+	starpu_perf_counter_set_enable_id(g_set, id_g_achieved);
+	starpu_perf_counter_set_enable_id(g_set, id_g_efficiency);
+
+	struct starpu_perf_counter_listener *g_listener = starpu_perf_counter_listener_init(g_set, g_listener_cb, NULL);
+	starpu_perf_counter_set_global_listener(g_listener);
+
+	for (c = 0; c < NCHAINS; c++)
+		starpu_variable_data_register(&handles[c], STARPU_MAIN_RAM, (uintptr_t)&values[c], sizeof(values[c]));
+
+	for (iter = 0; iter < NITER; iter++)
+	{
+		double start = starpu_timing_now(), makespan;
+
+		starpu_iteration_push(iter);
+		for (i = 0; i < CHAIN_LEN; i++)
+			for (c = 0; c < NCHAINS; c++)
+			{
+				ret = starpu_task_insert(&cl, STARPU_RW, handles[c], 0);
+				STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+			}
+		starpu_iteration_pop();
+		starpu_task_wait_for_all();
+		makespan = starpu_timing_now() - start;
+
+		FPRINTF(stdout, "iteration %d: bound %.0f us (area %.0f us, critical path %.0f us), achieved %.0f us, efficiency %.2f, measured %.0f us\n",
+			iter, STARPU_MAX(area_bound, critical_path_bound), area_bound, critical_path_bound, achieved, efficiency, makespan);
+
+		/* All iterations are the same, whichever window the counters
+		 * are about, its bound can not be above what we measured */
+		STARPU_ASSERT_MSG(STARPU_MAX(area_bound, critical_path_bound) <= makespan, "bound %f above the measured makespan %f\n", STARPU_MAX(area_bound, critical_path_bound), makespan);
+		STARPU_ASSERT_MSG(critical_path_bound <= achieved, "critical path bound %f above the achieved time %f\n", critical_path_bound, achieved);
+	}
+
+	for (c = 0; c < NCHAINS; c++)
+		starpu_data_unregister(handles[c]);
+
+	starpu_perf_counter_unset_global_listener();
+	starpu_perf_counter_listener_exit(g_listener);
+	starpu_perf_counter_set_disable_id(g_set, id_g_efficiency);
+	starpu_perf_counter_set_disable_id(g_set, id_g_achieved);
+	starpu_perf_counter_set_disable_id(g_set, id_g_bound_area);
+	starpu_perf_counter_set_disable_id(g_set, id_g_critical_path_bound);
+	starpu_perf_counter_set_disable_id(g_set, id_g_windows);
+	starpu_perf_counter_set_free(g_set);
+
+	starpu_shutdown();
+
+	/* Each window is a chain of CHAIN_LEN tasks */
+	STARPU_ASSERT_MSG(windows == NITER, "%"PRId64" windows instead of %d\n", windows, NITER);
+	STARPU_ASSERT_MSG(fabs(critical_path_bound - CHAIN_LEN * DURATION) < 1., "critical path bound %f instead of %f\n", critical_path_bound, CHAIN_LEN * DURATION);
+	STARPU_ASSERT_MSG(efficiency > 0. && efficiency <= 1., "efficiency %f\n", efficiency);
+
+	return 0;
+}
@@ -0,0 +1,190 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+/*
+ * Scrape the performance counters exported with STARPU_PERF_COUNTER_EXPORT
+ * in the Prometheus text format, the way a monitoring agent would, once as
+ * a plain client and once as an HTTP client.
+ */
+
+#include <starpu.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(STARPU_SIMGRID) && !defined(STARPU_HAVE_WINDOWS)
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define FPRINTF(ofile, fmt, ...) do { if (!getenv("STARPU_SSILENT")) {fprintf(ofile, fmt, ## __VA_ARGS__); }} while(0)
+
+#ifdef STARPU_QUICK_CHECK
+#define NTASKS 10
+#else
+#define NTASKS 1000
+#endif
+
+void func(void *buffers[], void *cl_args)
+{
+	int *x = (int *)STARPU_VARIABLE_GET_PTR(buffers[0]);
+	(void) cl_args;
+	(*x)++;
+}
+
+struct starpu_codelet cl =
+{
+	.cpu_funcs      = {func},
+	.cpu_funcs_name = {"func"},
+	.nbuffers       = 1,
+	.modes          = {STARPU_RW},
+	.name           = "perf_counter_export"
+};
+
+void c_listener_cb(struct starpu_perf_counter_listener *listener, struct starpu_perf_counter_sample *sample, void *context)
+{
+	(void) listener;
+	(void) sample;
+	(void) context;
+}
+
+/* Connect to the exporter, send request if any, and read the whole answer */
+static char *scrape(const char *path, const char *request)
+{
+	struct sockaddr_un addr;
+	size_t size = 4096, len = 0;
+	char *answer;
+	ssize_t n;
+	int fd;
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	STARPU_ASSERT(fd >= 0);
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+	if (connect(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0)
+	{
+		perror("connect");
+		STARPU_ABORT();
+	}
+	if (request)
+		STARPU_ASSERT(write(fd, request, strlen(request)) == (ssize_t) strlen(request));
+
+	answer = malloc(size);
+	while ((n = read(fd, answer + len, size - len - 1)) > 0)
+	{
+		len += n;
+		if (len == size - 1)
+		{
+			size *= 2;
+			answer = realloc(answer, size);
+		}
+	}
+	answer[len] = 0;
+	close(fd);
+	return answer;
+}
+
+/* Return the value of the first sample of the given metric */
+static long long metric_value(const char *answer, const char *metric)
+{
+	const char *line = answer;
+	size_t len = strlen(metric);
+
+	while (line)
+	{
+		if (!strncmp(line, metric, len) && (line[len] == ' ' || line[len] == '{'))
+			return atoll(strchr(line + len, ' ') + 1);
+		line = strchr(line, '\n');
+		if (line)
+			line++;
+	}
+	return -1;
+}
+
+int main(int argc, char **argv)
+{
+	const enum starpu_perf_counter_scope c_scope = starpu_perf_counter_scope_per_codelet;
+	starpu_data_handle_t handle;
+	char path[64];
+	char *answer;
+	int value = 0;
+	int ret, i;
+
+	(void) argc;
+	(void) argv;
+
+	snprintf(path, sizeof(path), "/tmp/starpu_perf_counters_%d.sock", (int) getpid());
+	setenv("STARPU_PERF_COUNTER_EXPORT", path, 1);
+
+	ret = starpu_init(NULL);
+	if (ret == -ENODEV)
+		return 77;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	if (starpu_cpu_worker_get_count() == 0)
+	{
+		FPRINTF(stderr, "This example needs CPU workers\n");
+		starpu_shutdown();
+		return 77;
+	}
+
+	/* Per-codelet counters are only maintained for codelets with a listener */
+	struct starpu_perf_counter_set *c_set = starpu_perf_counter_set_alloc(c_scope);
+	STARPU_ASSERT(c_set != NULL);
+	struct starpu_perf_counter_listener *c_listener = starpu_perf_counter_listener_init(c_set, c_listener_cb, NULL);
+	starpu_perf_counter_set_per_codelet_listener(&cl, c_listener);
+
+	starpu_variable_data_register(&handle, STARPU_MAIN_RAM, (uintptr_t)&value, sizeof(value));
+	for (i = 0; i < NTASKS; i++)
+	{
+		ret = starpu_task_insert(&cl, STARPU_RW, handle, 0);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+	}
+	starpu_task_wait_for_all();
+
+	answer = scrape(path, NULL);
+	FPRINTF(stdout, "%s", answer);
+	STARPU_ASSERT_MSG(metric_value(answer, "starpu_task_g_total_submitted") == NTASKS, "unexpected answer:\n%s\n", answer);
+	STARPU_ASSERT_MSG(metric_value(answer, "starpu_task_g_current_ready") == 0, "unexpected answer:\n%s\n", answer);
+	STARPU_ASSERT_MSG(metric_value(answer, "starpu_task_c_total_executed{codelet=\"perf_counter_export\"}") == NTASKS, "unexpected answer:\n%s\n", answer);
+	STARPU_ASSERT_MSG(strstr(answer, "starpu_task_w_total_executed{worker=\"0\"") != NULL, "unexpected answer:\n%s\n", answer);
+	free(answer);
+
+	answer = scrape(path, "GET /metrics HTTP/1.1\r\nHost: localhost\r\n\r\n");
+	STARPU_ASSERT_MSG(!strncmp(answer, "HTTP/1.0 200 OK\r\n", 17), "unexpected answer:\n%s\n", answer);
+	STARPU_ASSERT_MSG(strstr(answer, "\r\n\r\n# HELP ") != NULL, "unexpected answer:\n%s\n", answer);
+	free(answer);
+
+	starpu_data_unregister(handle);
+
+	starpu_perf_counter_unset_per_codelet_listener(&cl);
+	starpu_perf_counter_listener_exit(c_listener);
+	starpu_perf_counter_set_free(c_set);
+
+	starpu_shutdown();
+
+	STARPU_ASSERT(value == NTASKS);
+	STARPU_ASSERT_MSG(access(path, F_OK) != 0, "%s was not removed\n", path);
+
+	return 0;
+}
+#else
+int main(void)
+{
+	return 77;
+}
+#endif
@@ -647,6 +647,19 @@ void starpu_data_set_ooc_flag(starpu_data_handle_t handle, unsigned flag);
 */
 unsigned starpu_data_get_ooc_flag(starpu_data_handle_t handle);
 
+/**
+   Set whether this data may be compressed (1) or not (0) when it is
+   evicted to a disk node which has a compression codec. The default is
+   1. This has to be set before the data gets evicted. See \ref DiskCompression for more details.
+*/
+void starpu_data_set_disk_compress_flag(starpu_data_handle_t handle, unsigned flag);
+
+/**
+   Get whether this data may be compressed (1) or not (0) when it is
+   evicted to a disk node. See \ref DiskCompression for more details.
+*/
+unsigned starpu_data_get_disk_compress_flag(starpu_data_handle_t handle);
+
 /**
    Query the status of \p handle on the specified \p memory_node.
 
@@ -499,6 +499,11 @@ struct starpu_data_interface_ops
 	   reuse_data_on_node should thus copy over pointers, and define fields
 	   that are usually set by allocate_data_on_node (e.g. ld).
 
+	   When \ref STARPU_MEMCHUNK_CACHE_SLACK is set, the cached buffer may
+	   be bigger than the allocation needed by \p dst_data_interface, so the
+	   allocation size which free_data_on_node will need should be copied
+	   over as well.
+
 	   See \ref VariableSizeDataInterface and \ref DefiningANewDataInterface_pointers for more details.
 	*/
 	void (*reuse_data_on_node)(void *dst_data_interface, const void *cached_interface, unsigned node);
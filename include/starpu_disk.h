@@ -163,19 +163,35 @@ extern struct starpu_disk_ops starpu_disk_hdf5_ops;
 /**
    Use the unistd library (write, read...) to read/write on disk.
 
-   <strong>Warning: It creates one file per allocation !</strong>
+   <strong>Warning: It creates one file per allocation, unless
+   \ref STARPU_DISK_UNISTD_SLAB is set !</strong>
 */
 extern struct starpu_disk_ops starpu_disk_unistd_ops;
 
 /**
    Use the unistd library (write, read...) to read/write on disk with the O_DIRECT flag.
 
-   <strong>Warning: It creates one file per allocation !</strong>
+   <strong>Warning: It creates one file per allocation, unless
+   \ref STARPU_DISK_UNISTD_SLAB is set !</strong>
 
    Only available on Linux systems.
 */
 extern struct starpu_disk_ops starpu_disk_unistd_o_direct_ops;
 
+/**
+   Use the unistd library to manage files on disk, but perform asynchronous
+   transfers through io_uring: requests are queued and submitted in batches
+   to the kernel when testing for their completion.
+
+   <strong>Warning: It creates one file per allocation, unless
+   \ref STARPU_DISK_UNISTD_SLAB is set !</strong>
+
+   Only available on Linux systems providing the io_uring header. If the
+   running kernel does not support io_uring, transfers are performed
+   synchronously.
+*/
+extern struct starpu_disk_ops starpu_disk_unistd_uring_ops;
+
 /**
    Use the leveldb created by Google. More information at https://code.google.com/p/leveldb/
    Do not support asynchronous transfers.
@@ -221,6 +237,48 @@ int starpu_disk_register(struct starpu_disk_ops *func, void *parameter, starpu_s
 */
 extern int starpu_disk_swap_node;
 
+/**
+   Compression codec used to store data on a disk node, see \ref DiskCompression
+*/
+struct starpu_disk_codec
+{
+	/** Name of the codec */
+	const char *name;
+	/** Return the maximum size of the compressed version of \p size bytes */
+	size_t (*bound)(size_t size);
+	/**
+	   Compress the \p size bytes at \p src into the \p dst_size bytes
+	   at \p dst. Return the compressed size, or 0 if the data does not
+	   fit in \p dst_size bytes.
+	*/
+	size_t (*compress)(const void *src, size_t size, void *dst, size_t dst_size);
+	/**
+	   Decompress the \p size bytes at \p src into the \p dst_size bytes
+	   at \p dst. Return the decompressed size, or 0 if the data is
+	   corrupted.
+	*/
+	size_t (*decompress)(const void *src, size_t size, void *dst, size_t dst_size);
+};
+
+/**
+   Fast LZ77 codec bundled with StarPU, using the LZ4 block format. This
+   is what \ref STARPU_DISK_COMPRESS enables.
+*/
+extern struct starpu_disk_codec starpu_disk_codec_lz;
+
+/**
+   Compress the data stored on the disk node \p node with \p codec, or
+   do not compress it if \p codec is \c NULL. This has to be called
+   before any data gets evicted to \p node. See \ref DiskCompression for
+   more details.
+*/
+void starpu_disk_set_codec(unsigned node, struct starpu_disk_codec *codec);
+
+/**
+   Return the codec used to compress the data stored on the disk node \p node, or \c NULL.
+*/
+struct starpu_disk_codec *starpu_disk_get_codec(unsigned node);
+
 /** @} */
 
 #ifdef __cplusplus
@@ -121,6 +121,12 @@ struct starpu_fxt_options
 	   of dumped codelets.
 	*/
 	long dumped_codelets_count;
+
+	/**
+	   Number of threads used to scan the trace files before converting
+	   them, 0 to use one per CPU.
+	*/
+	unsigned nthreads;
 };
 
 void starpu_fxt_options_init(struct starpu_fxt_options *options);
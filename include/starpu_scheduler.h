@@ -37,6 +37,7 @@ extern "C" {
 */
 
 struct starpu_task;
+struct starpu_task_list;
 
 /**
    Contain all the methods that implement a scheduling policy. An
@@ -100,6 +101,16 @@ struct starpu_sched_policy
 	*/
 	int (*push_task)(struct starpu_task *);
 
+	/**
+	   Optional field. Insert all the tasks of the list \p tasks into
+	   the scheduler at once. This is called instead of push_task
+	   for the tasks which are ready when they are submitted with
+	   starpu_task_submit_array(). All the tasks belong to the same
+	   context. This must remove the tasks from \p tasks, and call
+	   starpu_push_task_end() for each of them, like push_task.
+	*/
+	int (*push_tasks)(struct starpu_task_list *tasks);
+
 	double (*simulate_push_task)(struct starpu_task *);
 
 	/**
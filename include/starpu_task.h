@@ -1238,6 +1238,13 @@ struct starpu_task
 	*/
 	unsigned no_submitorder : 1;
 
+	/**
+	   @private
+	   Whether the task structure was taken from the task pool by
+	   starpu_task_create(). This should only be used by StarPU.
+	*/
+	unsigned pooled : 1;
+
 	/**
 	   @private
 	   This is only used for tasks that use multiformat handle.
@@ -1776,6 +1783,26 @@ struct starpu_task *starpu_task_create_sync(starpu_data_handle_t handle, enum st
 */
 void starpu_task_destroy(struct starpu_task *task);
 
+/**
+   Statistics of the pool which recycles the task and job structures,
+   see starpu_task_pool_get_stats().
+*/
+struct starpu_task_pool_stats
+{
+	unsigned long allocated;	/**< Number of blocks allocated from the system */
+	unsigned long reused;		/**< Number of blocks reused from the pool */
+	unsigned long remote_freed;	/**< Number of blocks released by another thread than the one which allocated them */
+	unsigned long released;	/**< Number of blocks given back to the system because the pool was full */
+	unsigned long cached;		/**< Number of blocks currently kept in the pool */
+};
+
+/**
+   Fill \p stats with the statistics of the pool which recycles the task
+   and job structures since starpu_init(). The size of the pool can be
+   set with the environment variable \ref STARPU_TASK_POOL_SIZE.
+*/
+void starpu_task_pool_get_stats(struct starpu_task_pool_stats *stats);
+
 /**
    Tell StarPU to free the resources associated with \p task when the task is
    over. This is equivalent to having set task->destroy = 1 before submission,
@@ -1815,6 +1842,23 @@ static inline int starpu_task_submit_line(struct starpu_task *task, const char *
 #define starpu_task_submit(task) starpu_task_submit_line((task), __FILE__, __LINE__)
 #endif
 
+/**
+   Submit the \p ntasks tasks of the array \p tasks to StarPU, in the
+   order of the array, as if starpu_task_submit() was called on each
+   of them. The accounting of submitted tasks is done once for the
+   whole array, and the tasks which are ready at submission time are
+   given all at once to the scheduler if it provides the
+   starpu_sched_policy::push_tasks method. The limit set by \ref
+   STARPU_LIMIT_MAX_SUBMITTED_TASKS is only checked before submitting
+   the array, and may thus be exceeded by up to \p ntasks tasks.
+   In case of success, this function returns 0. Otherwise it returns
+   the error of the first task which could not be submitted, the tasks
+   before it in the array were submitted, and the tasks after it were
+   not.
+   See \ref SubmittingATask for more details.
+*/
+int starpu_task_submit_array(struct starpu_task **tasks, unsigned ntasks) STARPU_WARN_UNUSED_RESULT;
+
 /**
    Submit \p task to StarPU with dependency bypass.
 
@@ -1932,6 +1976,59 @@ void starpu_iteration_push(unsigned long iteration);
 */
 void starpu_iteration_pop(void);
 
+/**
+   Opaque type of a task graph recorded by
+   starpu_task_graph_capture_begin() and
+   starpu_task_graph_capture_end().
+*/
+typedef struct _starpu_task_graph *starpu_task_graph_t;
+
+/**
+   Start capturing a task graph. The tasks submitted by the calling
+   thread between the next call to starpu_iteration_push() and the
+   matching call to starpu_iteration_pop() are recorded, along with
+   the dependencies that sequential consistency infers between them.
+   The tasks are still executed normally.
+
+   Tasks using tags, explicit task dependencies, transactions,
+   bundles, regeneration or automatically-freed callback arguments
+   can not be recorded, the capture then fails.
+*/
+void starpu_task_graph_capture_begin(void);
+
+/**
+   Stop capturing the task graph started by
+   starpu_task_graph_capture_begin(), and return it, or <c>NULL</c> if
+   some task could not be recorded.
+*/
+starpu_task_graph_t starpu_task_graph_capture_end(void);
+
+/**
+   Submit again the tasks recorded in \p graph, within an iteration
+   numbered \p iteration (see starpu_iteration_push()). Dependencies
+   between the tasks of the graph are not inferred again, only the
+   first and last accesses to each piece of data go through sequential
+   consistency, to order the graph with the tasks submitted before and
+   after it. If \p cl_args is not <c>NULL</c>, it must contain
+   starpu_task_graph_get_ntasks() entries, non-<c>NULL</c> entries
+   replace the starpu_task::cl_arg value of the corresponding task, in
+   submission order. The application keeps ownership of these
+   buffers. Return 0 on success, or <c>-ENODEV</c> if no worker can
+   execute some task of \p graph, in which case none of them is
+   submitted.
+*/
+int starpu_task_graph_replay(starpu_task_graph_t graph, unsigned long iteration, void **cl_args);
+
+/**
+   Return the number of tasks recorded in \p graph.
+*/
+unsigned starpu_task_graph_get_ntasks(starpu_task_graph_t graph);
+
+/**
+   Free \p graph. Tasks replayed from it do not need to be terminated.
+*/
+void starpu_task_graph_destroy(starpu_task_graph_t graph);
+
 /**
    See \ref GraphScheduling for more details.
 */
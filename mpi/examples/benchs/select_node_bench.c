@@ -0,0 +1,186 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+/*
+ * This benchmark compares the total volume of communications induced by the
+ * node selection policies. Each task writes two vectors owned by different
+ * nodes, and reads a large matrix owned by yet another node, but which was
+ * already sent to all nodes by previous tasks and is thus in their cache.
+ * The most_r_data policy executes the task on the owner of the matrix, while
+ * the min_cost policy executes it on the owner of one of the vectors.
+ */
+
+#include <starpu_mpi.h>
+#include "helper.h"
+
+#define VECTOR_SIZE	1024
+#define MATRIX_SIZE	(64*1024)
+#ifdef STARPU_QUICK_CHECK
+#  define NITER		4
+#else
+#  define NITER		32
+#endif
+
+static void dummy_func(void *descr[], void *args)
+{
+	(void) descr;
+	(void) args;
+}
+
+static struct starpu_codelet read_cl =
+{
+	.cpu_funcs = { dummy_func },
+	.cpu_funcs_name = { "dummy_func" },
+	.name = "read",
+	.nbuffers = 2,
+	.modes = { STARPU_RW, STARPU_R }
+};
+
+static struct starpu_codelet pair_cl =
+{
+	.cpu_funcs = { dummy_func },
+	.cpu_funcs_name = { "dummy_func" },
+	.name = "pair",
+	.nbuffers = 3,
+	.modes = { STARPU_RW, STARPU_RW, STARPU_R }
+};
+
+static int nb_nodes;
+static starpu_data_handle_t *vector_handles;
+static starpu_data_handle_t *matrix_handles;
+
+static size_t sent_bytes(void)
+{
+	size_t *comm_stats;
+	size_t total = 0, global_total;
+	int i;
+
+	comm_stats = calloc(nb_nodes, sizeof(size_t));
+	starpu_mpi_comm_stats_retrieve(comm_stats);
+	for (i = 0; i < nb_nodes; i++)
+		total += comm_stats[i];
+	free(comm_stats);
+
+	MPI_Allreduce(&total, &global_total, 1, MPI_UNSIGNED_LONG, MPI_SUM, MPI_COMM_WORLD);
+	return global_total;
+}
+
+static size_t run(int policy)
+{
+	int i, iter, node;
+	size_t before;
+
+	/* Start from empty caches, and send each matrix to all nodes */
+	starpu_mpi_cache_flush_all_data(MPI_COMM_WORLD);
+	for (node = 0; node < nb_nodes; node++)
+		for (i = 0; i < nb_nodes; i++)
+		{
+			int ret = starpu_mpi_task_insert(MPI_COMM_WORLD, &read_cl,
+							 STARPU_RW, vector_handles[node],
+							 STARPU_R, matrix_handles[i],
+							 0);
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_task_insert");
+		}
+	starpu_mpi_wait_for_all(MPI_COMM_WORLD);
+	starpu_mpi_barrier(MPI_COMM_WORLD);
+	before = sent_bytes();
+
+	for (iter = 0; iter < NITER; iter++)
+		for (node = 0; node < nb_nodes; node++)
+		{
+			int ret = starpu_mpi_task_insert(MPI_COMM_WORLD, &pair_cl,
+							 STARPU_RW, vector_handles[node],
+							 STARPU_RW, vector_handles[(node+1)%nb_nodes],
+							 STARPU_R, matrix_handles[(node+2)%nb_nodes],
+							 STARPU_NODE_SELECTION_POLICY, policy,
+							 0);
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_task_insert");
+		}
+	starpu_mpi_wait_for_all(MPI_COMM_WORLD);
+	starpu_mpi_barrier(MPI_COMM_WORLD);
+
+	return sent_bytes() - before;
+}
+
+int main(int argc, char **argv)
+{
+	int ret, rank, i;
+	int min_cost_policy;
+	size_t most_r_data_volume, min_cost_volume;
+	float *vectors, *matrices;
+
+	ret = starpu_mpi_init_conf(&argc, &argv, 1, MPI_COMM_WORLD, NULL);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_init_conf");
+
+	starpu_mpi_comm_rank(MPI_COMM_WORLD, &rank);
+	starpu_mpi_comm_size(MPI_COMM_WORLD, &nb_nodes);
+
+	if (starpu_cpu_worker_get_count() == 0 || !starpu_mpi_cache_is_enabled())
+	{
+		if (rank == 0)
+			FPRINTF(stderr, "We need at least 1 CPU worker and the MPI cache.\n");
+		starpu_mpi_shutdown();
+		return rank == 0 ? STARPU_TEST_SKIPPED : 0;
+	}
+
+	starpu_mpi_comm_stats_enable();
+	min_cost_policy = starpu_mpi_node_selection_register_policy(starpu_mpi_select_node_min_cost);
+
+	vectors = calloc(nb_nodes * VECTOR_SIZE, sizeof(float));
+	matrices = calloc(nb_nodes * MATRIX_SIZE, sizeof(float));
+	vector_handles = malloc(nb_nodes * sizeof(starpu_data_handle_t));
+	matrix_handles = malloc(nb_nodes * sizeof(starpu_data_handle_t));
+	for (i = 0; i < nb_nodes; i++)
+	{
+		if (i == rank)
+		{
+			starpu_vector_data_register(&vector_handles[i], STARPU_MAIN_RAM, (uintptr_t) &vectors[i*VECTOR_SIZE], VECTOR_SIZE, sizeof(float));
+			starpu_vector_data_register(&matrix_handles[i], STARPU_MAIN_RAM, (uintptr_t) &matrices[i*MATRIX_SIZE], MATRIX_SIZE, sizeof(float));
+		}
+		else
+		{
+			starpu_vector_data_register(&vector_handles[i], -1, (uintptr_t) NULL, VECTOR_SIZE, sizeof(float));
+			starpu_vector_data_register(&matrix_handles[i], -1, (uintptr_t) NULL, MATRIX_SIZE, sizeof(float));
+		}
+		starpu_mpi_data_register(vector_handles[i], i, i);
+		starpu_mpi_data_register(matrix_handles[i], nb_nodes + i, i);
+	}
+
+	most_r_data_volume = run(STARPU_MPI_NODE_SELECTION_MOST_R_DATA);
+	min_cost_volume = run(min_cost_policy);
+
+	if (rank == 0)
+	{
+		printf("# policy\tvolume (bytes)\n");
+		printf("most_r_data\t%zu\n", most_r_data_volume);
+		printf("min_cost\t%zu\n", min_cost_volume);
+	}
+
+	for (i = 0; i < nb_nodes; i++)
+	{
+		starpu_data_unregister(vector_handles[i]);
+		starpu_data_unregister(matrix_handles[i]);
+	}
+	free(vector_handles);
+	free(matrix_handles);
+	free(vectors);
+	free(matrices);
+
+	starpu_mpi_node_selection_unregister_policy(min_cost_policy);
+	starpu_mpi_shutdown();
+
+	return min_cost_volume > most_r_data_volume;
+}
@@ -846,6 +846,24 @@ int starpu_mpi_node_selection_get_current_policy(void);
 */
 int starpu_mpi_node_selection_set_current_policy(int policy);
 
+/**
+   Node selection policy which selects the node with the smallest
+   estimated cost, to be registered with
+   starpu_mpi_node_selection_register_policy(). The cost of executing
+   the codelet on a node is the time needed to transfer to it the data
+   in ::STARPU_R mode which it neither owns nor holds in its cache, plus
+   the time needed to transfer back the data in ::STARPU_W mode which it
+   does not own, according to a network model defined by
+   \ref STARPU_MPI_SELECT_NODE_BANDWIDTH and
+   \ref STARPU_MPI_SELECT_NODE_LATENCY. To balance the load, the cost
+   also includes \ref STARPU_MPI_SELECT_NODE_TASK_COST for each of the
+   last \ref STARPU_MPI_SELECT_NODE_WINDOW submitted tasks which were
+   given to the node. The policy can also be selected without code
+   changes by setting \ref STARPU_MPI_NODE_SELECTION_POLICY to
+   <c>min_cost</c>.
+*/
+int starpu_mpi_select_node_min_cost(int me, int nb_nodes, struct starpu_data_descr *descr, int nb_data);
+
 /** @} */
 
 /**
@@ -0,0 +1,305 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <stdlib.h>
+#include <starpu_mpi.h>
+#include <starpu_mpi_private.h>
+#include <starpu_mpi_stats.h>
+#include <mpi/starpu_mpi_aggregate.h>
+#include <common/list.h>
+#include <common/uthash.h>
+
+#ifdef STARPU_USE_MPI_MPI
+
+/** the data waiting to be sent to a given node */
+struct _starpu_mpi_aggregate
+{
+	UT_hash_handle hh;
+	struct _starpu_mpi_node node;
+	char *buffer;
+	size_t fill;
+	/** date at which the first entry was added */
+	double start;
+	/** the requests whose data are in the buffer */
+	struct _starpu_mpi_req_list reqs;
+};
+
+/** an aggregation buffer being sent */
+LIST_TYPE(_starpu_mpi_aggregate_send,
+	  char *buffer;
+	  MPI_Request request;
+);
+
+/** Largest payload to inline, 0 disables aggregation */
+static size_t aggregate_size;
+/** Size of the aggregation buffers */
+static size_t aggregate_buffer_size;
+/** Largest aggregation buffer size among all nodes */
+static size_t aggregate_recv_size;
+/** Time in us to wait for more data before sending a buffer */
+static double aggregate_delay;
+
+static starpu_pthread_mutex_t _starpu_mpi_aggregate_mutex;
+static struct _starpu_mpi_aggregate *_starpu_mpi_aggregate_hashmap;
+/** number of aggregation buffers which are not empty */
+static int _starpu_mpi_aggregate_nfilled;
+static struct _starpu_mpi_aggregate_send_list _starpu_mpi_aggregate_sends;
+
+void _starpu_mpi_aggregate_init(void)
+{
+	aggregate_size = starpu_getenv_number_default("STARPU_MPI_AGGREGATE_SIZE", 256);
+	aggregate_buffer_size = starpu_getenv_number_default("STARPU_MPI_AGGREGATE_BUFFER", 8192);
+	aggregate_delay = starpu_getenv_number_default("STARPU_MPI_AGGREGATE_DELAY", 50);
+
+	if (aggregate_buffer_size < sizeof(struct _starpu_mpi_envelope))
+		aggregate_buffer_size = sizeof(struct _starpu_mpi_envelope);
+	if (aggregate_size && _STARPU_MPI_AGGREGATE_ENTRY_SIZE(aggregate_size) > aggregate_buffer_size)
+	{
+		_STARPU_DISP("Warning: STARPU_MPI_AGGREGATE_BUFFER (%zu) is too small for STARPU_MPI_AGGREGATE_SIZE (%zu), disabling message aggregation\n", aggregate_buffer_size, aggregate_size);
+		aggregate_size = 0;
+	}
+	aggregate_recv_size = aggregate_buffer_size;
+#ifdef STARPU_SIMGRID
+	/* Completions would have to be waited for by simgrid threads, not worth it */
+	aggregate_size = 0;
+#endif
+
+	_starpu_mpi_aggregate_hashmap = NULL;
+	_starpu_mpi_aggregate_nfilled = 0;
+	_starpu_mpi_aggregate_send_list_init(&_starpu_mpi_aggregate_sends);
+	STARPU_PTHREAD_MUTEX_INIT(&_starpu_mpi_aggregate_mutex, NULL);
+}
+
+void _starpu_mpi_aggregate_check_termination(void)
+{
+	STARPU_ASSERT_MSG(_starpu_mpi_aggregate_nfilled == 0, "Some aggregated data were not sent");
+	STARPU_ASSERT_MSG(_starpu_mpi_aggregate_send_list_empty(&_starpu_mpi_aggregate_sends), "Some aggregated data are still being sent");
+}
+
+void _starpu_mpi_aggregate_shutdown(void)
+{
+	struct _starpu_mpi_aggregate *current=NULL, *tmp=NULL;
+	HASH_ITER(hh, _starpu_mpi_aggregate_hashmap, current, tmp)
+	{
+		STARPU_ASSERT(_starpu_mpi_req_list_empty(&current->reqs));
+		HASH_DEL(_starpu_mpi_aggregate_hashmap, current);
+		free(current->buffer);
+		free(current);
+	}
+	STARPU_PTHREAD_MUTEX_DESTROY(&_starpu_mpi_aggregate_mutex);
+}
+
+void _starpu_mpi_aggregate_comm_init(MPI_Comm comm)
+{
+	unsigned long size = aggregate_buffer_size, max_size;
+	int ret;
+
+	/* Other nodes may have set a bigger STARPU_MPI_AGGREGATE_BUFFER, we
+	 * have to be able to receive their buffers */
+	ret = MPI_Allreduce(&size, &max_size, 1, MPI_UNSIGNED_LONG, MPI_MAX, comm);
+	STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Allreduce returning %s", _starpu_mpi_get_mpi_error_code(ret));
+	if (max_size != size)
+		_STARPU_MPI_DEBUG(0, "STARPU_MPI_AGGREGATE_BUFFER is %zu here but %lu on some other node, using the latter to receive envelopes\n", aggregate_buffer_size, max_size);
+	aggregate_recv_size = max_size;
+}
+
+size_t _starpu_mpi_aggregate_recv_size(void)
+{
+	return aggregate_recv_size;
+}
+
+// We suppose _starpu_mpi_aggregate_mutex is locked
+static void _starpu_mpi_aggregate_flush(struct _starpu_mpi_aggregate *aggregate, struct _starpu_mpi_req_list *flushed)
+{
+	int ret;
+	struct _starpu_mpi_aggregate_send *send = _starpu_mpi_aggregate_send_new();
+
+	_STARPU_MPI_DEBUG(20, "Sending %zu bytes of aggregated data to node %d\n", aggregate->fill, aggregate->node.rank);
+	send->buffer = aggregate->buffer;
+	_STARPU_MPI_COMM_TO_DEBUG(send->buffer, aggregate->fill, MPI_BYTE, aggregate->node.rank, _STARPU_MPI_TAG_ENVELOPE, (int64_t)_STARPU_MPI_TAG_ENVELOPE, aggregate->node.comm);
+	ret = MPI_Isend(send->buffer, aggregate->fill, MPI_BYTE, aggregate->node.rank, _STARPU_MPI_TAG_ENVELOPE, aggregate->node.comm, &send->request);
+	STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "when sending aggregated data, MPI_Isend returning %s", _starpu_mpi_get_mpi_error_code(ret));
+	_starpu_mpi_aggregate_send_list_push_back(&_starpu_mpi_aggregate_sends, send);
+
+	_STARPU_MPI_MALLOC(aggregate->buffer, aggregate_buffer_size);
+	aggregate->fill = 0;
+	_starpu_mpi_aggregate_nfilled--;
+
+	/* The data are in the buffer now, the requests can be completed */
+	while (!_starpu_mpi_req_list_empty(&aggregate->reqs))
+		_starpu_mpi_req_list_push_back(flushed, _starpu_mpi_req_list_pop_front(&aggregate->reqs));
+}
+
+int _starpu_mpi_aggregate_add(struct _starpu_mpi_req *req, struct _starpu_mpi_req_list *flushed)
+{
+	starpu_ssize_t size;
+	struct _starpu_mpi_aggregate *aggregate;
+	struct _starpu_mpi_envelope *envelope;
+	struct _starpu_mpi_node node;
+
+	if (aggregate_size == 0 || req->sync)
+		return 0;
+	/* With GPUDirect, the receiver may expect to get the data directly
+	 * in device memory, which we can not just copy into */
+	if (_starpu_mpi_has_cuda || _starpu_mpi_has_hip || starpu_node_get_kind(req->node) != STARPU_CPU_RAM)
+		return 0;
+
+	if (req->registered_datatype == 1)
+	{
+		int psize;
+		MPI_Pack_size(1, req->datatype, req->node_tag.node.comm, &psize);
+		size = psize;
+	}
+	else
+		// Do not pack the data, just try to find out the size
+		starpu_data_pack_node(req->data_handle, req->node, NULL, &size);
+
+	if (size <= 0 || (size_t) size > aggregate_size)
+		return 0;
+
+	memset(&node, 0, sizeof(node));
+	node.comm = req->node_tag.node.comm;
+	node.rank = req->node_tag.node.rank;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&_starpu_mpi_aggregate_mutex);
+	HASH_FIND(hh, _starpu_mpi_aggregate_hashmap, &node, sizeof(node), aggregate);
+	if (aggregate == NULL)
+	{
+		_STARPU_MPI_CALLOC(aggregate, 1, sizeof(*aggregate));
+		aggregate->node = node;
+		_STARPU_MPI_MALLOC(aggregate->buffer, aggregate_buffer_size);
+		_starpu_mpi_req_list_init(&aggregate->reqs);
+		HASH_ADD(hh, _starpu_mpi_aggregate_hashmap, node, sizeof(aggregate->node), aggregate);
+	}
+
+	if (aggregate->fill + _STARPU_MPI_AGGREGATE_ENTRY_SIZE(size) > aggregate_buffer_size)
+		_starpu_mpi_aggregate_flush(aggregate, flushed);
+	if (aggregate->fill == 0)
+	{
+		aggregate->start = starpu_timing_now();
+		_starpu_mpi_aggregate_nfilled++;
+	}
+
+	_STARPU_MPI_TRACE_ISEND_SUBMIT_BEGIN(req->node_tag.node.rank, req->node_tag.data_tag, 0);
+
+	envelope = (struct _starpu_mpi_envelope *) (aggregate->buffer + aggregate->fill);
+	memset(envelope, 0, sizeof(*envelope));
+	envelope->mode = _STARPU_MPI_ENVELOPE_INLINE_DATA;
+	envelope->data_tag = req->node_tag.data_tag;
+	envelope->sync = 0;
+	envelope->size = size;
+
+	if (req->registered_datatype == 1)
+	{
+		int position = 0;
+		req->count = 1;
+		req->ptr = starpu_data_handle_to_pointer(req->data_handle, req->node);
+		MPI_Pack(req->ptr, 1, req->datatype, envelope+1, size, &position, req->node_tag.node.comm);
+		/* MPI_Pack_size only gave an upper bound */
+		size = position;
+		envelope->size = size;
+	}
+	else
+	{
+		/* req->ptr will be freed on request termination */
+		starpu_data_pack_node(req->data_handle, req->node, &req->ptr, &req->count);
+		STARPU_MPI_ASSERT_MSG(req->count == size, "Calls to pack_data returned different sizes %ld != %ld", req->count, size);
+		memcpy(envelope+1, req->ptr, size);
+	}
+	aggregate->fill += _STARPU_MPI_AGGREGATE_ENTRY_SIZE(size);
+
+	_starpu_mpi_comm_amounts_inc(req->node_tag.node.comm, req->node, req->node_tag.node.rank, req->datatype, req->count);
+	_STARPU_MPI_DEBUG(20, "Aggregated request %p with tag %"PRIi64" and size %ld for node %d\n", req, req->node_tag.data_tag, size, req->node_tag.node.rank);
+
+	/* Nothing to wait for on termination */
+	req->backend->size_req = MPI_REQUEST_NULL;
+	req->backend->data_request = MPI_REQUEST_NULL;
+	_starpu_mpi_req_list_push_back(&aggregate->reqs, req);
+
+	_STARPU_MPI_TRACE_ISEND_SUBMIT_END(_STARPU_MPI_FUT_POINT_TO_POINT_SEND, req, 0);
+
+	if (aggregate->fill + _STARPU_MPI_AGGREGATE_ENTRY_SIZE(1) > aggregate_buffer_size)
+		/* Nothing more will fit */
+		_starpu_mpi_aggregate_flush(aggregate, flushed);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&_starpu_mpi_aggregate_mutex);
+
+	return 1;
+}
+
+void _starpu_mpi_aggregate_flush_node(struct _starpu_mpi_node *node, struct _starpu_mpi_req_list *flushed)
+{
+	struct _starpu_mpi_aggregate *aggregate;
+	struct _starpu_mpi_node key;
+
+	if (aggregate_size == 0)
+		return;
+
+	memset(&key, 0, sizeof(key));
+	key.comm = node->comm;
+	key.rank = node->rank;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&_starpu_mpi_aggregate_mutex);
+	HASH_FIND(hh, _starpu_mpi_aggregate_hashmap, &key, sizeof(key), aggregate);
+	if (aggregate && aggregate->fill)
+		_starpu_mpi_aggregate_flush(aggregate, flushed);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&_starpu_mpi_aggregate_mutex);
+}
+
+void _starpu_mpi_aggregate_progress(int idle, struct _starpu_mpi_req_list *flushed)
+{
+	STARPU_PTHREAD_MUTEX_LOCK(&_starpu_mpi_aggregate_mutex);
+	if (_starpu_mpi_aggregate_nfilled)
+	{
+		double now = starpu_timing_now();
+		struct _starpu_mpi_aggregate *current=NULL, *tmp=NULL;
+		HASH_ITER(hh, _starpu_mpi_aggregate_hashmap, current, tmp)
+		{
+			/* When no other send is coming, there is no point in
+			 * waiting for more data */
+			if (current->fill && (idle || now - current->start >= aggregate_delay))
+				_starpu_mpi_aggregate_flush(current, flushed);
+		}
+	}
+
+	struct _starpu_mpi_aggregate_send *send, *next;
+	for (send = _starpu_mpi_aggregate_send_list_begin(&_starpu_mpi_aggregate_sends);
+	     send != _starpu_mpi_aggregate_send_list_end(&_starpu_mpi_aggregate_sends);
+	     send = next)
+	{
+		int flag, ret;
+		next = _starpu_mpi_aggregate_send_list_next(send);
+		ret = MPI_Test(&send->request, &flag, MPI_STATUS_IGNORE);
+		STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Test returning %s", _starpu_mpi_get_mpi_error_code(ret));
+		if (flag)
+		{
+			_starpu_mpi_aggregate_send_list_erase(&_starpu_mpi_aggregate_sends, send);
+			free(send->buffer);
+			_starpu_mpi_aggregate_send_delete(send);
+		}
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&_starpu_mpi_aggregate_mutex);
+}
+
+int _starpu_mpi_aggregate_pending(void)
+{
+	int pending;
+	STARPU_PTHREAD_MUTEX_LOCK(&_starpu_mpi_aggregate_mutex);
+	pending = _starpu_mpi_aggregate_nfilled || !_starpu_mpi_aggregate_send_list_empty(&_starpu_mpi_aggregate_sends);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&_starpu_mpi_aggregate_mutex);
+	return pending;
+}
+
+#endif // STARPU_USE_MPI_MPI
@@ -0,0 +1,97 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#ifndef __STARPU_MPI_AGGREGATE_H__
+#define __STARPU_MPI_AGGREGATE_H__
+
+#include <starpu.h>
+#include <stdlib.h>
+#include <mpi.h>
+#include <common/config.h>
+#include <starpu_mpi_private.h>
+#include <mpi/starpu_mpi_mpi_backend.h>
+
+/** @file */
+
+#ifdef STARPU_USE_MPI_MPI
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+   Small payloads sent to the same node are inlined right after their
+   envelope, several of them being packed in a single message sent on the
+   envelope tag. Each entry is an envelope with the mode
+   _STARPU_MPI_ENVELOPE_INLINE_DATA, followed by the envelope::size bytes of
+   the packed data, padded to keep the next envelope aligned.
+*/
+#define _STARPU_MPI_AGGREGATE_ENTRY_SIZE(size) (sizeof(struct _starpu_mpi_envelope) + (((size) + 7) & ~(size_t)7))
+
+void _starpu_mpi_aggregate_init(void);
+void _starpu_mpi_aggregate_check_termination(void);
+void _starpu_mpi_aggregate_shutdown(void);
+
+/**
+   Agree with the other nodes of \p comm on the size of the buffers used to
+   receive envelopes. This is collective, and has to be called before
+   registering the first communicator.
+*/
+void _starpu_mpi_aggregate_comm_init(MPI_Comm comm);
+
+/**
+   Size of the buffers used to receive envelopes, which have to be large
+   enough for a full aggregation buffer of any node
+*/
+size_t _starpu_mpi_aggregate_recv_size(void);
+
+/**
+   Try to copy the data of the send request \p req into the aggregation
+   buffer of its destination. Return 1 on success, in which case the request
+   will be pushed to the \p flushed list once the buffer gets sent. Requests
+   of buffers which had to be flushed to make room are pushed to \p flushed
+   too.
+*/
+int _starpu_mpi_aggregate_add(struct _starpu_mpi_req *req, struct _starpu_mpi_req_list *flushed);
+
+/**
+   Send the aggregation buffer of \p node if it is not empty, so that a
+   message sent directly to \p node does not overtake it. The requests whose
+   data were sent are pushed to \p flushed.
+*/
+void _starpu_mpi_aggregate_flush_node(struct _starpu_mpi_node *node, struct _starpu_mpi_req_list *flushed);
+
+/**
+   Send the aggregation buffers which have been waiting for longer than
+   STARPU_MPI_AGGREGATE_DELAY, or all of them if \p idle is set, i.e. when
+   no other send request is ready, and test the completion of the buffers
+   already sent. The requests whose data were sent are pushed to \p flushed.
+*/
+void _starpu_mpi_aggregate_progress(int idle, struct _starpu_mpi_req_list *flushed);
+
+/**
+   Return whether some data is waiting in an aggregation buffer, or some
+   aggregation buffer is still being sent
+*/
+int _starpu_mpi_aggregate_pending(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STARPU_USE_MPI_MPI */
+#endif /* __STARPU_MPI_AGGREGATE_H__ */
@@ -19,6 +19,7 @@
 #include <starpu_mpi.h>
 #include <starpu_mpi_private.h>
 #include <mpi/starpu_mpi_comm.h>
+#include <mpi/starpu_mpi_aggregate.h>
 #include <common/list.h>
 
 #ifdef STARPU_USE_MPI_MPI
@@ -51,6 +52,47 @@ int _starpu_mpi_comm_nb;
 int _starpu_mpi_comm_allocated;
 int _starpu_mpi_comm_tested;
 
+/* Host of each rank of the communicator given at initialization, identified
+ * by the smallest rank running on that host */
+static MPI_Comm _starpu_mpi_comm_hosts_comm;
+static int *_starpu_mpi_comm_hosts;
+static int _starpu_mpi_comm_hosts_size;
+
+static void _starpu_mpi_comm_hosts_init(MPI_Comm comm)
+{
+	int rank, size, host;
+	int fake_host_size = starpu_getenv_number_default("STARPU_MPI_FAKE_HOST_SIZE", 0);
+
+	MPI_Comm_rank(comm, &rank);
+	MPI_Comm_size(comm, &size);
+
+	if (fake_host_size > 0)
+		host = rank - rank % fake_host_size;
+	else
+	{
+#ifdef STARPU_SIMGRID
+		host = rank;
+#else
+		MPI_Comm shared;
+		MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, rank, MPI_INFO_NULL, &shared);
+		MPI_Allreduce(&rank, &host, 1, MPI_INT, MPI_MIN, shared);
+		MPI_Comm_free(&shared);
+#endif
+	}
+
+	_STARPU_MPI_MALLOC(_starpu_mpi_comm_hosts, size * sizeof(int));
+	MPI_Allgather(&host, 1, MPI_INT, _starpu_mpi_comm_hosts, 1, MPI_INT, comm);
+	_starpu_mpi_comm_hosts_comm = comm;
+	_starpu_mpi_comm_hosts_size = size;
+}
+
+int _starpu_mpi_comm_host(MPI_Comm comm, int rank)
+{
+	if (!_starpu_mpi_comm_hosts || comm != _starpu_mpi_comm_hosts_comm || rank < 0 || rank >= _starpu_mpi_comm_hosts_size)
+		return -1;
+	return _starpu_mpi_comm_hosts[rank];
+}
+
 void _starpu_mpi_comm_init(MPI_Comm comm)
 {
 	_STARPU_MPI_DEBUG(10, "allocating for %d communicators\n", _starpu_mpi_comm_allocated);
@@ -61,6 +103,7 @@ void _starpu_mpi_comm_init(MPI_Comm comm)
 	_starpu_mpi_comms_cache = NULL;
 	STARPU_PTHREAD_RWLOCK_INIT(&_starpu_mpi_comms_mutex, NULL);
 
+	_starpu_mpi_comm_hosts_init(comm);
 	_starpu_mpi_comm_register(comm);
 }
 
@@ -78,6 +121,8 @@ void _starpu_mpi_comm_shutdown()
 		free(_comm);
 	}
 	free(_starpu_mpi_comms);
+	free(_starpu_mpi_comm_hosts);
+	_starpu_mpi_comm_hosts = NULL;
 
 	struct _starpu_mpi_comm_hashtable *entry=NULL, *tmp=NULL;
 	HASH_ITER(hh, _starpu_mpi_comms_cache, entry, tmp)
@@ -120,7 +165,8 @@ void _starpu_mpi_comm_register(MPI_Comm comm)
 		struct _starpu_mpi_comm *_comm;
 		_STARPU_MPI_CALLOC(_comm, 1, sizeof(struct _starpu_mpi_comm));
 		_comm->comm = comm;
-		_STARPU_MPI_CALLOC(_comm->envelope, 1,sizeof(struct _starpu_mpi_envelope));
+		/* Envelopes may come along with aggregated data */
+		_STARPU_MPI_CALLOC(_comm->envelope, 1, _starpu_mpi_aggregate_recv_size());
 		_comm->posted = 0;
 		_starpu_mpi_comms[_starpu_mpi_comm_nb] = _comm;
 		_starpu_mpi_comm_nb++;
@@ -149,8 +195,8 @@ void _starpu_mpi_comm_post_recv()
 		if (_comm->posted == 0)
 		{
 			_STARPU_MPI_DEBUG(3, "Posting a receive to get a data envelop on comm %d %ld\n", i, (long int)_comm->comm);
-			_STARPU_MPI_COMM_FROM_DEBUG(_comm->envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, MPI_ANY_SOURCE, _STARPU_MPI_TAG_ENVELOPE, (int64_t)_STARPU_MPI_TAG_ENVELOPE, _comm->comm);
-			MPI_Irecv(_comm->envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, MPI_ANY_SOURCE, _STARPU_MPI_TAG_ENVELOPE, _comm->comm, &_comm->request);
+			_STARPU_MPI_COMM_FROM_DEBUG(_comm->envelope, _starpu_mpi_aggregate_recv_size(), MPI_BYTE, MPI_ANY_SOURCE, _STARPU_MPI_TAG_ENVELOPE, (int64_t)_STARPU_MPI_TAG_ENVELOPE, _comm->comm);
+			MPI_Irecv(_comm->envelope, _starpu_mpi_aggregate_recv_size(), MPI_BYTE, MPI_ANY_SOURCE, _STARPU_MPI_TAG_ENVELOPE, _comm->comm, &_comm->request);
 #ifdef STARPU_SIMGRID
 			_starpu_mpi_simgrid_wait_req(&_comm->request, &_comm->status, &_comm->queue, &_comm->done);
 #endif
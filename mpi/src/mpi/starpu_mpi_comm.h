@@ -39,6 +39,13 @@ void _starpu_mpi_comm_post_recv();
 int _starpu_mpi_comm_test_recv(MPI_Status *status, struct _starpu_mpi_envelope **envelope, MPI_Comm *comm);
 void _starpu_mpi_comm_cancel_recv();
 
+/**
+   Return an identifier of the host (shared memory node) which runs \p rank
+   in \p comm, or -1 if it is not known, which is the case for communicators
+   other than the one given at initialization
+*/
+int _starpu_mpi_comm_host(MPI_Comm comm, int rank);
+
 #ifdef __cplusplus
 }
 #endif
@@ -35,6 +35,7 @@ extern "C"
 #endif
 
 LIST_TYPE(_starpu_mpi_early_data_handle,
+	  /** NULL when the data was received inline with its envelope, it is then just kept in buffer */
 	  starpu_data_handle_t handle;
 	  struct _starpu_mpi_req *req;
 	  void *buffer;
@@ -0,0 +1,256 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <stdlib.h>
+#include <starpu_mpi.h>
+#include <starpu_mpi_private.h>
+#include <starpu_mpi_stats.h>
+#include <mpi/starpu_mpi_forward.h>
+#include <mpi/starpu_mpi_aggregate.h>
+#include <common/list.h>
+#include <common/uthash.h>
+
+#ifdef STARPU_USE_MPI_MPI
+
+/** the send requests waiting for the acknowledgement of a given node and tag */
+struct _starpu_mpi_forward_ack_hashlist
+{
+	struct _starpu_mpi_req_list list;
+	UT_hash_handle hh;
+	struct _starpu_mpi_node_tag node_tag;
+};
+
+/** a data being forwarded to the nodes of a host */
+LIST_TYPE(_starpu_mpi_forward_send,
+	  char *buffer;
+	  struct _starpu_mpi_envelope *envelopes;
+	  MPI_Request *requests;
+	  int nb_requests;
+);
+
+static starpu_pthread_mutex_t _starpu_mpi_forward_mutex;
+static struct _starpu_mpi_forward_ack_hashlist *_starpu_mpi_forward_ack_hashmap;
+static int _starpu_mpi_forward_ack_hashmap_count;
+static struct _starpu_mpi_forward_send_list _starpu_mpi_forward_sends;
+
+void _starpu_mpi_forward_init(void)
+{
+	_starpu_mpi_forward_ack_hashmap = NULL;
+	_starpu_mpi_forward_ack_hashmap_count = 0;
+	_starpu_mpi_forward_send_list_init(&_starpu_mpi_forward_sends);
+	STARPU_PTHREAD_MUTEX_INIT(&_starpu_mpi_forward_mutex, NULL);
+}
+
+void _starpu_mpi_forward_check_termination(void)
+{
+	STARPU_ASSERT_MSG(_starpu_mpi_forward_ack_hashmap_count == 0, "Some forwarded data were not acknowledged");
+	STARPU_ASSERT_MSG(_starpu_mpi_forward_send_list_empty(&_starpu_mpi_forward_sends), "Some forwarded data are still being sent");
+}
+
+void _starpu_mpi_forward_shutdown(void)
+{
+	struct _starpu_mpi_forward_ack_hashlist *current=NULL, *tmp=NULL;
+	HASH_ITER(hh, _starpu_mpi_forward_ack_hashmap, current, tmp)
+	{
+		STARPU_ASSERT(_starpu_mpi_req_list_empty(&current->list));
+		HASH_DEL(_starpu_mpi_forward_ack_hashmap, current);
+		free(current);
+	}
+	STARPU_PTHREAD_MUTEX_DESTROY(&_starpu_mpi_forward_mutex);
+}
+
+int _starpu_mpi_forward_max_dests(void)
+{
+	/* The envelope and its destinations are received in a single buffer */
+	return (_starpu_mpi_aggregate_recv_size() - sizeof(struct _starpu_mpi_envelope)) / sizeof(struct _starpu_mpi_forward_dest);
+}
+
+void _starpu_mpi_forward_wait_ack(struct _starpu_mpi_req *req)
+{
+	struct _starpu_mpi_forward_ack_hashlist *hashlist;
+
+	_STARPU_MPI_DEBUG(20, "Request %p with tag %"PRIi64" for node %d is forwarded by node %d, waiting for its acknowledgement\n", req, req->node_tag.data_tag, req->node_tag.node.rank, req->backend->data_source);
+
+	/* Nothing to wait for on termination */
+	req->backend->size_req = MPI_REQUEST_NULL;
+	req->backend->data_request = MPI_REQUEST_NULL;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&_starpu_mpi_forward_mutex);
+	HASH_FIND(hh, _starpu_mpi_forward_ack_hashmap, &req->node_tag, sizeof(struct _starpu_mpi_node_tag), hashlist);
+	if (hashlist == NULL)
+	{
+		_STARPU_MPI_MALLOC(hashlist, sizeof(struct _starpu_mpi_forward_ack_hashlist));
+		_starpu_mpi_req_list_init(&hashlist->list);
+		hashlist->node_tag = req->node_tag;
+		HASH_ADD(hh, _starpu_mpi_forward_ack_hashmap, node_tag, sizeof(hashlist->node_tag), hashlist);
+	}
+	_starpu_mpi_req_list_push_back(&hashlist->list, req);
+	_starpu_mpi_forward_ack_hashmap_count++;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&_starpu_mpi_forward_mutex);
+}
+
+struct _starpu_mpi_req *_starpu_mpi_forward_ack_find(starpu_mpi_tag_t data_tag, int source, MPI_Comm comm)
+{
+	struct _starpu_mpi_req *req = NULL;
+	struct _starpu_mpi_node_tag node_tag;
+	struct _starpu_mpi_forward_ack_hashlist *found;
+
+	memset(&node_tag, 0, sizeof(struct _starpu_mpi_node_tag));
+	node_tag.node.comm = comm;
+	node_tag.node.rank = source;
+	node_tag.data_tag = data_tag;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&_starpu_mpi_forward_mutex);
+	HASH_FIND(hh, _starpu_mpi_forward_ack_hashmap, &node_tag, sizeof(struct _starpu_mpi_node_tag), found);
+	if (found && !_starpu_mpi_req_list_empty(&found->list))
+	{
+		req = _starpu_mpi_req_list_pop_front(&found->list);
+		_starpu_mpi_forward_ack_hashmap_count--;
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&_starpu_mpi_forward_mutex);
+	_STARPU_MPI_DEBUG(20, "Found request %p acknowledged by node %d for tag %"PRIi64"\n", req, source, data_tag);
+	return req;
+}
+
+int _starpu_mpi_forward_ack_count(void)
+{
+	return _starpu_mpi_forward_ack_hashmap_count;
+}
+
+void _starpu_mpi_forward_set_dests(struct _starpu_mpi_req *req, struct _starpu_mpi_envelope *envelope)
+{
+	size_t size = envelope->nb_forwards * sizeof(struct _starpu_mpi_forward_dest);
+
+	if (envelope->nb_forwards == 0)
+		return;
+	_STARPU_MPI_MALLOC(req->backend->forward_dests, size);
+	memcpy(req->backend->forward_dests, envelope+1, size);
+	req->backend->nb_forward_dests = envelope->nb_forwards;
+}
+
+void _starpu_mpi_forward_ack(struct _starpu_mpi_envelope *envelope, MPI_Comm comm)
+{
+	struct _starpu_mpi_envelope ack;
+	int ret;
+
+	memset(&ack, 0, sizeof(ack));
+	ack.mode = _STARPU_MPI_ENVELOPE_FORWARD_ACK;
+	ack.data_tag = envelope->data_tag;
+	ack.source = envelope->source;
+
+	_STARPU_MPI_DEBUG(20, "Acknowledging forwarded data with tag %"PRIi64" to node %d\n", ack.data_tag, envelope->source);
+	_STARPU_MPI_COMM_TO_DEBUG(&ack, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, envelope->source, _STARPU_MPI_TAG_ENVELOPE, ack.data_tag, comm);
+	ret = MPI_Send(&ack, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, envelope->source, _STARPU_MPI_TAG_ENVELOPE, comm);
+	STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Send returning %s", _starpu_mpi_get_mpi_error_code(ret));
+}
+
+void _starpu_mpi_forward_send(struct _starpu_mpi_req *req, struct _starpu_mpi_req_list *flushed)
+{
+	struct _starpu_mpi_forward_send *send = _starpu_mpi_forward_send_new();
+	MPI_Comm comm = req->node_tag.node.comm;
+	MPI_Datatype datatype;
+	int size, i, ret;
+
+	/* Copy the data, so that it can be released right away */
+	if (req->registered_datatype == 1)
+	{
+		int position = 0;
+		MPI_Pack_size(req->count, req->datatype, comm, &size);
+		_STARPU_MPI_MALLOC(send->buffer, size);
+		MPI_Pack(req->ptr, req->count, req->datatype, send->buffer, size, &position, comm);
+		size = position;
+		datatype = MPI_PACKED;
+	}
+	else
+	{
+		size = req->count;
+		_STARPU_MPI_MALLOC(send->buffer, size);
+		memcpy(send->buffer, req->ptr, size);
+		datatype = MPI_BYTE;
+	}
+
+	_STARPU_MPI_CALLOC(send->envelopes, req->backend->nb_forward_dests, sizeof(struct _starpu_mpi_envelope));
+	_STARPU_MPI_MALLOC(send->requests, 2 * req->backend->nb_forward_dests * sizeof(MPI_Request));
+	send->nb_requests = 2 * req->backend->nb_forward_dests;
+
+	for (i = 0; i < req->backend->nb_forward_dests; i++)
+	{
+		struct _starpu_mpi_forward_dest *dest = &req->backend->forward_dests[i];
+		struct _starpu_mpi_envelope *envelope = &send->envelopes[i];
+		struct _starpu_mpi_node node;
+
+		/* Small data aggregated before for the same node have to arrive first */
+		memset(&node, 0, sizeof(node));
+		node.comm = comm;
+		node.rank = dest->rank;
+		_starpu_mpi_aggregate_flush_node(&node, flushed);
+
+		envelope->mode = _STARPU_MPI_ENVELOPE_FORWARDED_DATA;
+		envelope->data_tag = dest->data_tag;
+		envelope->size = size;
+		envelope->source = req->node_tag.node.rank;
+
+		_STARPU_MPI_DEBUG(20, "Forwarding %d bytes with tag %"PRIi64" from node %d to node %d\n", size, dest->data_tag, req->node_tag.node.rank, dest->rank);
+		_STARPU_MPI_COMM_TO_DEBUG(envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, dest->rank, _STARPU_MPI_TAG_ENVELOPE, envelope->data_tag, comm);
+		ret = MPI_Isend(envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, dest->rank, _STARPU_MPI_TAG_ENVELOPE, comm, &send->requests[2*i]);
+		STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "when forwarding envelope, MPI_Isend returning %s", _starpu_mpi_get_mpi_error_code(ret));
+		_STARPU_MPI_COMM_TO_DEBUG(send->buffer, size, datatype, dest->rank, _STARPU_MPI_TAG_DATA, envelope->data_tag, comm);
+		ret = MPI_Isend(send->buffer, size, datatype, dest->rank, _STARPU_MPI_TAG_DATA, comm, &send->requests[2*i+1]);
+		STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "when forwarding data, MPI_Isend returning %s", _starpu_mpi_get_mpi_error_code(ret));
+
+		_starpu_mpi_comm_amounts_inc(comm, req->node, dest->rank, datatype, size);
+	}
+
+	STARPU_PTHREAD_MUTEX_LOCK(&_starpu_mpi_forward_mutex);
+	_starpu_mpi_forward_send_list_push_back(&_starpu_mpi_forward_sends, send);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&_starpu_mpi_forward_mutex);
+}
+
+void _starpu_mpi_forward_progress(void)
+{
+	struct _starpu_mpi_forward_send *send, *next;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&_starpu_mpi_forward_mutex);
+	for (send = _starpu_mpi_forward_send_list_begin(&_starpu_mpi_forward_sends);
+	     send != _starpu_mpi_forward_send_list_end(&_starpu_mpi_forward_sends);
+	     send = next)
+	{
+		int flag, ret;
+		next = _starpu_mpi_forward_send_list_next(send);
+		ret = MPI_Testall(send->nb_requests, send->requests, &flag, MPI_STATUSES_IGNORE);
+		STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Testall returning %s", _starpu_mpi_get_mpi_error_code(ret));
+		if (flag)
+		{
+			_starpu_mpi_forward_send_list_erase(&_starpu_mpi_forward_sends, send);
+			free(send->buffer);
+			free(send->envelopes);
+			free(send->requests);
+			_starpu_mpi_forward_send_delete(send);
+		}
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&_starpu_mpi_forward_mutex);
+}
+
+int _starpu_mpi_forward_pending(void)
+{
+	int pending;
+	STARPU_PTHREAD_MUTEX_LOCK(&_starpu_mpi_forward_mutex);
+	pending = !_starpu_mpi_forward_send_list_empty(&_starpu_mpi_forward_sends);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&_starpu_mpi_forward_mutex);
+	return pending;
+}
+
+#endif // STARPU_USE_MPI_MPI
@@ -0,0 +1,106 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#ifndef __STARPU_MPI_FORWARD_H__
+#define __STARPU_MPI_FORWARD_H__
+
+#include <starpu.h>
+#include <stdlib.h>
+#include <mpi.h>
+#include <common/config.h>
+#include <starpu_mpi_private.h>
+#include <mpi/starpu_mpi_mpi_backend.h>
+
+/** @file */
+
+#ifdef STARPU_USE_MPI_MPI
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/**
+   When the destinations of a cooperative send share a host, the owner of
+   the data only sends it to one of them, which forwards it to the others.
+   The envelope sent to the forwarding node is followed by the
+   envelope::nb_forwards destinations, and the forwarded data is preceded by
+   an envelope with the mode _STARPU_MPI_ENVELOPE_FORWARDED_DATA. The final
+   destinations acknowledge the reception of the envelope to the owner, so
+   that a later send of the same data can not overtake the forwarded one.
+*/
+
+void _starpu_mpi_forward_init(void);
+void _starpu_mpi_forward_check_termination(void);
+void _starpu_mpi_forward_shutdown(void);
+
+/**
+   Largest number of destinations which fit in an envelope
+*/
+int _starpu_mpi_forward_max_dests(void);
+
+/**
+   Register the send request \p req, whose data will be forwarded by another
+   node, until the destination acknowledges it
+*/
+void _starpu_mpi_forward_wait_ack(struct _starpu_mpi_req *req);
+
+/**
+   Return the request waiting for the acknowledgement of \p source for the
+   tag \p data_tag, and stop waiting for it
+*/
+struct _starpu_mpi_req *_starpu_mpi_forward_ack_find(starpu_mpi_tag_t data_tag, int source, MPI_Comm comm);
+
+/**
+   Number of requests waiting for an acknowledgement
+*/
+int _starpu_mpi_forward_ack_count(void);
+
+/**
+   Record in the receive request \p req the destinations which follow
+   \p envelope, to which the data will have to be forwarded
+*/
+void _starpu_mpi_forward_set_dests(struct _starpu_mpi_req *req, struct _starpu_mpi_envelope *envelope);
+
+/**
+   Tell the owner of the data forwarded with \p envelope that it was
+   received
+*/
+void _starpu_mpi_forward_ack(struct _starpu_mpi_envelope *envelope, MPI_Comm comm);
+
+/**
+   Send the data received by the request \p req to the destinations given by
+   its sender. Requests of aggregation buffers which had to be flushed first
+   are pushed to \p flushed.
+*/
+void _starpu_mpi_forward_send(struct _starpu_mpi_req *req, struct _starpu_mpi_req_list *flushed);
+
+/**
+   Test the completion of the forwarded data being sent
+*/
+void _starpu_mpi_forward_progress(void);
+
+/**
+   Return whether some forwarded data is still being sent
+*/
+int _starpu_mpi_forward_pending(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STARPU_USE_MPI_MPI */
+#endif /* __STARPU_MPI_FORWARD_H__ */
@@ -32,6 +32,8 @@
 #include <mpi/starpu_mpi_sync_data.h>
 #include <mpi/starpu_mpi_early_data.h>
 #include <mpi/starpu_mpi_early_request.h>
+#include <mpi/starpu_mpi_aggregate.h>
+#include <mpi/starpu_mpi_forward.h>
 #include <starpu_mpi_select_node.h>
 #include <mpi/starpu_mpi_tag.h>
 #include <mpi/starpu_mpi_comm.h>
@@ -58,18 +60,33 @@ static unsigned nready_process;
 /* Force allocation of early data */
 static int early_data_force_allocate;
 
+/* Largest size of the messages in which large data are split, 0 to send data at once */
+static starpu_ssize_t pipeline_chunk_size;
+
 static void _starpu_mpi_handle_ready_request(struct _starpu_mpi_req *req);
 static void _starpu_mpi_handle_request_termination(struct _starpu_mpi_req *req);
 static void _starpu_mpi_handle_detached_request(struct _starpu_mpi_req *req);
+static void _starpu_mpi_complete_inline_request(struct _starpu_mpi_req *req);
+static void _starpu_mpi_complete_inline_requests(struct _starpu_mpi_req_list *list);
+static void _starpu_mpi_receive_inline(struct _starpu_mpi_req *req, void *payload, starpu_ssize_t size);
 static void _starpu_mpi_early_data_cb(void* arg);
 
 /* The list of ready requests */
 static struct _starpu_mpi_req_list ready_recv_requests;
 static struct _starpu_mpi_req_prio_list ready_send_requests;
 
-/* The list of detached requests that have already been submitted to MPI */
+/* The list of detached requests that have just been submitted to MPI */
 static struct _starpu_mpi_req_list detached_requests;
 
+/* The detached requests being tested, along with their MPI requests in a
+ * contiguous array for MPI_Testsome. These are only accessed by the progression
+ * thread, which moves the requests of detached_requests there before testing. */
+static struct _starpu_mpi_req **tested_requests;
+static MPI_Request *tested_mpi_requests;
+static int *tested_indices;
+static unsigned ntested_requests;
+static unsigned tested_requests_size;
+
 /* Number of send requests to submit to MPI at the same time */
 static unsigned ndetached_send_requests_max;
 static unsigned ndetached_send_requests = 0;
@@ -163,29 +180,95 @@ struct _starpu_mpi_early_data_cb_args
 	unsigned buffer_node;
 };
 
-#if 0
+/* Send the data only once to each other host: the first destination of a
+ * host, in priority order, forwards the data to the other destinations of the
+ * same host. */
 void _starpu_mpi_coop_sends_build_tree(struct _starpu_mpi_coop_sends *coop_sends)
 {
-	(void)coop_sends;
-	/* TODO: turn them into redirects & forwards */
-}
+	struct _starpu_mpi_req **reqs = coop_sends->reqs_array;
+	MPI_Comm comm = reqs[0]->node_tag.node.comm;
+	unsigned i, j, n = coop_sends->n;
+	int rank, host, max_dests;
+
+#ifdef STARPU_SIMGRID
+	/* Completions would have to be waited for by simgrid threads, not worth it */
+	return;
 #endif
+	/* With GPUDirect, the data may be received in device memory, which we
+	 * can not just forward from */
+	if (_starpu_mpi_has_cuda || _starpu_mpi_has_hip)
+		return;
+
+	starpu_mpi_comm_rank(comm, &rank);
+	host = _starpu_mpi_comm_host(comm, rank);
+	if (host == -1)
+		/* We do not know the topology of this communicator */
+		return;
+	max_dests = _starpu_mpi_forward_max_dests();
+
+	for (i = 0; i < n; i++)
+	{
+		struct _starpu_mpi_req *leader = reqs[i];
+		int leader_host = _starpu_mpi_comm_host(comm, leader->node_tag.node.rank);
+
+		if (leader->sync || leader->backend->forwarded || leader_host == host)
+			continue;
+
+		for (j = i+1; j < n && leader->backend->nb_forward_dests < max_dests; j++)
+		{
+			struct _starpu_mpi_req *req = reqs[j];
+			struct _starpu_mpi_forward_dest *dest;
+
+			if (req->sync || req->backend->forwarded || req->node_tag.node.rank == leader->node_tag.node.rank || _starpu_mpi_comm_host(comm, req->node_tag.node.rank) != leader_host)
+				continue;
+
+			if (!leader->backend->forward_dests)
+				_STARPU_MPI_MALLOC(leader->backend->forward_dests, STARPU_MIN(n-i-1, (unsigned) max_dests) * sizeof(struct _starpu_mpi_forward_dest));
+			dest = &leader->backend->forward_dests[leader->backend->nb_forward_dests++];
+			dest->rank = req->node_tag.node.rank;
+			dest->data_tag = req->node_tag.data_tag;
+
+			req->backend->forwarded = 1;
+			req->backend->data_source = leader->node_tag.node.rank;
+		}
+
+		if (leader->backend->nb_forward_dests)
+			_STARPU_MPI_DEBUG(0, "cooperative sends %p: node %d forwards to %d nodes of its host\n", coop_sends, leader->node_tag.node.rank, leader->backend->nb_forward_dests);
+	}
+}
 
 void _starpu_mpi_submit_coop_sends(struct _starpu_mpi_coop_sends *coop_sends, int submit_control, int submit_data)
 {
 	(void)submit_control;
 	unsigned i, n = coop_sends->n;
+	struct _starpu_mpi_req **reqs;
+
+	if (!submit_data)
+		return;
+
+	/* Note: coop_sends might disappear very very soon after last request
+	 * is submitted, and forwarded requests complete as soon as the
+	 * request which forwards them got its data through */
+	_STARPU_MPI_MALLOC(reqs, n * sizeof(*reqs));
+	memcpy(reqs, coop_sends->reqs_array, n * sizeof(*reqs));
+
+	/* Forwarded requests have to wait for their acknowledgement before
+	 * the forwarding one can be sent */
+	for (i = 0; i < n; i++)
+	{
+		if (reqs[i]->request_type == SEND_REQ && reqs[i]->backend->forwarded)
+			_starpu_mpi_forward_wait_ack(reqs[i]);
+	}
 
-	/* Note: coop_sends might disappear very very soon after last request is submitted */
 	for (i = 0; i < n; i++)
 	{
-		if (coop_sends->reqs_array[i]->request_type == SEND_REQ && submit_data)
+		if (reqs[i]->request_type == SEND_REQ && !reqs[i]->backend->forwarded)
 		{
-			_STARPU_MPI_DEBUG(0, "cooperative sends %p sending to %d\n", coop_sends, coop_sends->reqs_array[i]->node_tag.node.rank);
-			_starpu_mpi_submit_ready_request(coop_sends->reqs_array[i]);
+			_STARPU_MPI_DEBUG(0, "cooperative sends %p sending to %d\n", coop_sends, reqs[i]->node_tag.node.rank);
+			_starpu_mpi_submit_ready_request(reqs[i]);
 		}
-		/* TODO: handle redirect requests */
 	}
+	free(reqs);
 }
 
 void _starpu_mpi_submit_ready_request(void *arg)
@@ -240,7 +323,16 @@ void _starpu_mpi_submit_ready_request(void *arg)
 			/* test whether some data with the given tag and source have already been received by StarPU-MPI*/
 			struct _starpu_mpi_early_data_handle *early_data_handle = _starpu_mpi_early_data_find(&req->node_tag);
 
-			if (early_data_handle)
+			if (early_data_handle && !early_data_handle->handle)
+			{
+				/* Got inline data, which we can just copy */
+				STARPU_PTHREAD_MUTEX_UNLOCK(&early_data_mutex);
+				_starpu_mpi_receive_inline(req, early_data_handle->buffer, early_data_handle->size);
+				free(early_data_handle->buffer);
+				_starpu_mpi_early_data_delete(early_data_handle);
+				STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
+			}
+			else if (early_data_handle)
 			{
 				/* Got the early_data_handle */
 				STARPU_PTHREAD_MUTEX_UNLOCK(&early_data_mutex);
@@ -404,6 +496,92 @@ void _starpu_mpi_simgrid_wait_req(MPI_Request *request, MPI_Status *status, star
 }
 #endif
 
+/********************************************************/
+/*                                                      */
+/*  Chunked transfers                                   */
+/*                                                      */
+/********************************************************/
+
+/* Post one MPI request per chunk of the data, so that MPI can pack, transfer
+ * and unpack the different chunks at the same time. Chunks are received in
+ * the order they are sent since they use the same tag. The last chunk uses
+ * data_request, so that the progression engine only tests one MPI request
+ * per StarPU-MPI request, the other ones are completed along with it. */
+static int _starpu_mpi_post_chunks(struct _starpu_mpi_req *req, int send, int tag)
+{
+	starpu_ssize_t chunk_size = req->backend->chunk_size;
+	starpu_ssize_t size = req->count;
+	int nb_chunks = 0, i;
+
+	if (req->registered_datatype == 1)
+		nb_chunks = _starpu_mpi_datatype_chunk_allocate(req->data_handle, req->node, chunk_size, &req->backend->chunk_datatypes, &req->backend->chunk_displacements);
+	if (nb_chunks == 0)
+	{
+		/* Contiguous memory, e.g. raw early data or data to be unpacked later */
+		STARPU_MPI_ASSERT_MSG(req->registered_datatype == 0 || starpu_data_get_interface_id(req->data_handle) == STARPU_VARIABLE_INTERFACE_ID, "Cannot receive data with tag %"PRIi64" in chunks of %ld bytes, the data has to have the same shape on the sender and on the receiver", req->node_tag.data_tag, (long) chunk_size);
+		if (req->registered_datatype == 1)
+		{
+			int type_size;
+			MPI_Type_size(req->datatype, &type_size);
+			size = req->count * type_size;
+		}
+		nb_chunks = (size + chunk_size - 1) / chunk_size;
+	}
+
+	req->backend->nb_chunks = nb_chunks;
+	_STARPU_MPI_MALLOC(req->backend->chunk_requests, nb_chunks * sizeof(MPI_Request));
+
+	for (i = 0; i < nb_chunks; i++)
+	{
+		MPI_Request *request = i == nb_chunks-1 ? &req->backend->data_request : &req->backend->chunk_requests[i];
+		MPI_Datatype datatype;
+		char *ptr;
+		int count, ret;
+
+		if (req->backend->chunk_datatypes)
+		{
+			ptr = (char *) req->ptr + req->backend->chunk_displacements[i];
+			count = 1;
+			datatype = req->backend->chunk_datatypes[i];
+		}
+		else
+		{
+			ptr = (char *) req->ptr + i * chunk_size;
+			count = STARPU_MIN(chunk_size, size - i * chunk_size);
+			datatype = MPI_BYTE;
+		}
+
+		if (send)
+			ret = MPI_Isend(ptr, count, datatype, req->node_tag.node.rank, tag, req->node_tag.node.comm, request);
+		else
+			ret = MPI_Irecv(ptr, count, datatype, req->node_tag.node.rank, tag, req->node_tag.node.comm, request);
+		if (ret != MPI_SUCCESS)
+			return ret;
+	}
+
+	_STARPU_MPI_DEBUG(20, "Posted %d chunks of %ld bytes for request %p\n", nb_chunks, (long) chunk_size, req);
+	return MPI_SUCCESS;
+}
+
+/* Wait for the chunks which were transferred along with the last one */
+static void _starpu_mpi_complete_chunks(struct _starpu_mpi_req *req)
+{
+	int ret;
+
+	ret = MPI_Waitall(req->backend->nb_chunks-1, req->backend->chunk_requests, MPI_STATUSES_IGNORE);
+	STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Waitall returning %s", _starpu_mpi_get_mpi_error_code(ret));
+	free(req->backend->chunk_requests);
+	req->backend->chunk_requests = NULL;
+
+	if (req->backend->chunk_datatypes)
+	{
+		_starpu_mpi_datatype_chunk_free(req->backend->nb_chunks, req->backend->chunk_datatypes, req->backend->chunk_displacements);
+		req->backend->chunk_datatypes = NULL;
+		req->backend->chunk_displacements = NULL;
+	}
+	req->backend->nb_chunks = 0;
+}
+
 /********************************************************/
 /*                                                      */
 /*  Send functionalities                                */
@@ -420,7 +598,13 @@ static void _starpu_mpi_isend_data_func(struct _starpu_mpi_req *req)
 
 	_STARPU_MPI_TRACE_ISEND_SUBMIT_BEGIN(req->node_tag.node.rank, req->node_tag.data_tag, 0);
 
-	if (req->sync == 0)
+	if (req->backend->chunk_size)
+	{
+		_STARPU_MPI_COMM_TO_DEBUG(req, req->count, req->datatype, req->node_tag.node.rank, _STARPU_MPI_TAG_DATA, req->node_tag.data_tag, req->node_tag.node.comm);
+		req->ret = _starpu_mpi_post_chunks(req, 1, _STARPU_MPI_TAG_DATA);
+		STARPU_MPI_ASSERT_MSG(req->ret == MPI_SUCCESS, "MPI_Isend returning %s", _starpu_mpi_get_mpi_error_code(req->ret));
+	}
+	else if (req->sync == 0)
 	{
 		_STARPU_MPI_COMM_TO_DEBUG(req, req->count, req->datatype, req->node_tag.node.rank, _STARPU_MPI_TAG_DATA, req->node_tag.data_tag, req->node_tag.node.comm);
 		req->ret = MPI_Isend(req->ptr, req->count, req->datatype, req->node_tag.node.rank, _STARPU_MPI_TAG_DATA, req->node_tag.node.comm, &req->backend->data_request);
@@ -454,14 +638,37 @@ static void _starpu_mpi_isend_data_func(struct _starpu_mpi_req *req)
 
 void _starpu_mpi_isend_size_func(struct _starpu_mpi_req *req)
 {
+	struct _starpu_mpi_req_list flushed;
+	size_t envelope_size;
+	_starpu_mpi_req_list_init(&flushed);
+
 	_starpu_mpi_datatype_allocate(req->data_handle, req);
 
-	_STARPU_MPI_CALLOC(req->backend->envelope, 1,sizeof(struct _starpu_mpi_envelope));
+	STARPU_PTHREAD_MUTEX_LOCK(&send_mutex);
+
+	// Data to be forwarded need the destinations to come along the envelope
+	if (!req->backend->nb_forward_dests && _starpu_mpi_aggregate_add(req, &flushed))
+	{
+		// The data will be sent along with other small data, make sure
+		// the progression thread sends it in time
+		STARPU_PTHREAD_MUTEX_UNLOCK(&send_mutex);
+		_starpu_mpi_complete_inline_requests(&flushed);
+		STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
+		STARPU_PTHREAD_COND_SIGNAL(&progress_cond);
+		STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
+		return;
+	}
+	// Small data aggregated before for the same node have to arrive first
+	_starpu_mpi_aggregate_flush_node(&req->node_tag.node, &flushed);
+
+	envelope_size = sizeof(struct _starpu_mpi_envelope) + req->backend->nb_forward_dests * sizeof(struct _starpu_mpi_forward_dest);
+	_STARPU_MPI_CALLOC(req->backend->envelope, 1, envelope_size);
 	req->backend->envelope->mode = _STARPU_MPI_ENVELOPE_DATA;
 	req->backend->envelope->data_tag = req->node_tag.data_tag;
 	req->backend->envelope->sync = req->sync;
-
-	STARPU_PTHREAD_MUTEX_LOCK(&send_mutex);
+	req->backend->envelope->nb_forwards = req->backend->nb_forward_dests;
+	if (req->backend->nb_forward_dests)
+		memcpy(req->backend->envelope+1, req->backend->forward_dests, req->backend->nb_forward_dests * sizeof(struct _starpu_mpi_forward_dest));
 
 	if (req->registered_datatype == 1)
 	{
@@ -471,9 +678,17 @@ void _starpu_mpi_isend_size_func(struct _starpu_mpi_req *req)
 
 		MPI_Type_size(req->datatype, &size);
 		req->backend->envelope->size = (starpu_ssize_t)req->count * size;
+#ifndef STARPU_SIMGRID
+		if (pipeline_chunk_size > 0 && !req->sync && req->backend->envelope->size > pipeline_chunk_size)
+		{
+			// Let MPI pipeline the packing, transfer and unpacking of large data
+			req->backend->chunk_size = _starpu_mpi_datatype_chunk_size(req->data_handle, req->node, pipeline_chunk_size);
+			req->backend->envelope->chunk_size = req->backend->chunk_size;
+		}
+#endif
 		_STARPU_MPI_DEBUG(20, "Post MPI isend count (%ld) datatype_size %ld request to %d\n",req->count,starpu_data_get_size(req->data_handle), req->node_tag.node.rank);
-		_STARPU_MPI_COMM_TO_DEBUG(req->backend->envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, req->node_tag.node.rank, _STARPU_MPI_TAG_ENVELOPE, req->backend->envelope->data_tag, req->node_tag.node.comm);
-		ret = MPI_Isend(req->backend->envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, req->node_tag.node.rank, _STARPU_MPI_TAG_ENVELOPE, req->node_tag.node.comm, &req->backend->size_req);
+		_STARPU_MPI_COMM_TO_DEBUG(req->backend->envelope, envelope_size, MPI_BYTE, req->node_tag.node.rank, _STARPU_MPI_TAG_ENVELOPE, req->backend->envelope->data_tag, req->node_tag.node.comm);
+		ret = MPI_Isend(req->backend->envelope, envelope_size, MPI_BYTE, req->node_tag.node.rank, _STARPU_MPI_TAG_ENVELOPE, req->node_tag.node.comm, &req->backend->size_req);
 		STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "when sending envelope, MPI_Isend returning %s", _starpu_mpi_get_mpi_error_code(ret));
 	}
 	else
@@ -488,8 +703,8 @@ void _starpu_mpi_isend_size_func(struct _starpu_mpi_req *req)
 			// We already know the size of the data, let's send it to overlap with the packing of the data
 			_STARPU_MPI_DEBUG(20, "Sending size %ld (%ld %s) to node %d (first call to pack)\n", req->backend->envelope->size, sizeof(req->count), "MPI_BYTE", req->node_tag.node.rank);
 			req->count = req->backend->envelope->size;
-			_STARPU_MPI_COMM_TO_DEBUG(req->backend->envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, req->node_tag.node.rank, _STARPU_MPI_TAG_ENVELOPE, req->backend->envelope->data_tag, req->node_tag.node.comm);
-			ret = MPI_Isend(req->backend->envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, req->node_tag.node.rank, _STARPU_MPI_TAG_ENVELOPE, req->node_tag.node.comm, &req->backend->size_req);
+			_STARPU_MPI_COMM_TO_DEBUG(req->backend->envelope, envelope_size, MPI_BYTE, req->node_tag.node.rank, _STARPU_MPI_TAG_ENVELOPE, req->backend->envelope->data_tag, req->node_tag.node.comm);
+			ret = MPI_Isend(req->backend->envelope, envelope_size, MPI_BYTE, req->node_tag.node.rank, _STARPU_MPI_TAG_ENVELOPE, req->node_tag.node.comm, &req->backend->size_req);
 			STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "when sending size, MPI_Isend returning %s", _starpu_mpi_get_mpi_error_code(ret));
 		}
 
@@ -499,8 +714,8 @@ void _starpu_mpi_isend_size_func(struct _starpu_mpi_req *req)
 		{
 			// We know the size now, let's send it
 			_STARPU_MPI_DEBUG(20, "Sending size %ld (%ld %s) to node %d (second call to pack)\n", req->backend->envelope->size, sizeof(req->count), "MPI_BYTE", req->node_tag.node.rank);
-			_STARPU_MPI_COMM_TO_DEBUG(req->backend->envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, req->node_tag.node.rank, _STARPU_MPI_TAG_ENVELOPE, req->backend->envelope->data_tag, req->node_tag.node.comm);
-			ret = MPI_Isend(req->backend->envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, req->node_tag.node.rank, _STARPU_MPI_TAG_ENVELOPE, req->node_tag.node.comm, &req->backend->size_req);
+			_STARPU_MPI_COMM_TO_DEBUG(req->backend->envelope, envelope_size, MPI_BYTE, req->node_tag.node.rank, _STARPU_MPI_TAG_ENVELOPE, req->backend->envelope->data_tag, req->node_tag.node.comm);
+			ret = MPI_Isend(req->backend->envelope, envelope_size, MPI_BYTE, req->node_tag.node.rank, _STARPU_MPI_TAG_ENVELOPE, req->node_tag.node.comm, &req->backend->size_req);
 			STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "when sending size, MPI_Isend returning %s", _starpu_mpi_get_mpi_error_code(ret));
 		}
 		else
@@ -523,6 +738,8 @@ void _starpu_mpi_isend_size_func(struct _starpu_mpi_req *req)
 	}
 
 	STARPU_PTHREAD_MUTEX_UNLOCK(&send_mutex);
+
+	_starpu_mpi_complete_inline_requests(&flushed);
 }
 
 /********************************************************/
@@ -553,15 +770,22 @@ void _starpu_mpi_irecv_size_func(struct _starpu_mpi_req *req)
 		_envelope = NULL;
 	}
 
-	if (req->sync)
+	if (req->backend->chunk_size)
+	{
+		_STARPU_MPI_COMM_FROM_DEBUG(req, req->count, req->datatype, req->node_tag.node.rank, _STARPU_MPI_TAG_DATA, req->node_tag.data_tag, req->node_tag.node.comm);
+		req->ret = _starpu_mpi_post_chunks(req, 0, _STARPU_MPI_TAG_DATA);
+	}
+	else if (req->sync)
 	{
 		_STARPU_MPI_COMM_FROM_DEBUG(req, req->count, req->datatype, req->node_tag.node.rank, _STARPU_MPI_TAG_SYNC_DATA, req->node_tag.data_tag, req->node_tag.node.comm);
 		req->ret = MPI_Irecv(req->ptr, req->count, req->datatype, req->node_tag.node.rank, _STARPU_MPI_TAG_SYNC_DATA, req->node_tag.node.comm, &req->backend->data_request);
 	}
 	else
 	{
-		_STARPU_MPI_COMM_FROM_DEBUG(req, req->count, req->datatype, req->node_tag.node.rank, _STARPU_MPI_TAG_DATA, req->node_tag.data_tag, req->node_tag.node.comm);
-		req->ret = MPI_Irecv(req->ptr, req->count, req->datatype, req->node_tag.node.rank, _STARPU_MPI_TAG_DATA, req->node_tag.node.comm, &req->backend->data_request);
+		/* Forwarded data comes from the node which forwards it */
+		int source = req->backend->forwarded ? req->backend->data_source : req->node_tag.node.rank;
+		_STARPU_MPI_COMM_FROM_DEBUG(req, req->count, req->datatype, source, _STARPU_MPI_TAG_DATA, req->node_tag.data_tag, req->node_tag.node.comm);
+		req->ret = MPI_Irecv(req->ptr, req->count, req->datatype, source, _STARPU_MPI_TAG_DATA, req->node_tag.node.comm, &req->backend->data_request);
 	}
 #ifdef STARPU_SIMGRID
 	_starpu_mpi_simgrid_wait_req(&req->backend->data_request, &req->status_store, &req->queue, &req->done);
@@ -910,6 +1134,20 @@ static void _starpu_mpi_handle_request_termination(struct _starpu_mpi_req *req)
 			  req, _starpu_mpi_request_type(req->request_type), req->node_tag.data_tag, req->node_tag.node.rank, req->data_handle, req->ptr,
 			  req->datatype_name, (int)req->count, req->registered_datatype, req->backend->internal_req);
 
+	if (req->backend->nb_chunks)
+		_starpu_mpi_complete_chunks(req);
+
+	if (req->request_type == RECV_REQ && req->backend->nb_forward_dests)
+	{
+		/* Forward the data to the other nodes of our host */
+		struct _starpu_mpi_req_list flushed;
+		_starpu_mpi_req_list_init(&flushed);
+		STARPU_PTHREAD_MUTEX_LOCK(&send_mutex);
+		_starpu_mpi_forward_send(req, &flushed);
+		STARPU_PTHREAD_MUTEX_UNLOCK(&send_mutex);
+		_starpu_mpi_complete_inline_requests(&flushed);
+	}
+
 	if (req->backend->internal_req)
 	{
 		_starpu_mpi_early_data_delete(req->backend->early_data_handle);
@@ -948,7 +1186,7 @@ static void _starpu_mpi_handle_request_termination(struct _starpu_mpi_req *req)
 					starpu_memory_deallocate(req->node, req->count);
 				}
 			}
-			else
+			else if (req->registered_datatype == 1)
 			{
 				_starpu_mpi_datatype_free(req->data_handle, &req->datatype);
 			}
@@ -964,6 +1202,9 @@ static void _starpu_mpi_handle_request_termination(struct _starpu_mpi_req *req)
 		free(req->backend->envelope);
 		req->backend->envelope = NULL;
 	}
+	free(req->backend->forward_dests);
+	req->backend->forward_dests = NULL;
+	req->backend->nb_forward_dests = 0;
 
 	/* Execute the specified callback, if any */
 	if (req->callback)
@@ -1085,81 +1326,126 @@ static void _starpu_mpi_early_data_cb(void* arg)
 	args = NULL;
 }
 
+// We suppose progress_mutex is locked
+static void _starpu_mpi_add_tested_request(struct _starpu_mpi_req *req)
+{
+	if (ntested_requests == tested_requests_size)
+	{
+		tested_requests_size = tested_requests_size ? 2 * tested_requests_size : 64;
+		_STARPU_MPI_REALLOC(tested_requests, tested_requests_size * sizeof(*tested_requests));
+		_STARPU_MPI_REALLOC(tested_mpi_requests, tested_requests_size * sizeof(*tested_mpi_requests));
+		_STARPU_MPI_REALLOC(tested_indices, tested_requests_size * sizeof(*tested_indices));
+	}
+#ifndef STARPU_SIMGRID
+	STARPU_MPI_ASSERT_MSG(req->backend->data_request != MPI_REQUEST_NULL, "Cannot test completion of the request MPI_REQUEST_NULL");
+#endif
+	tested_requests[ntested_requests] = req;
+	tested_mpi_requests[ntested_requests] = req->backend->data_request;
+	ntested_requests++;
+}
+
 // We suppose progress_mutex is locked
 static void _starpu_mpi_test_detached_requests(void)
 {
 	//_STARPU_MPI_LOG_IN();
-	int flag;
-	struct _starpu_mpi_req *req;
+	int ncompleted = 0;
+	int ret = MPI_SUCCESS;
+	unsigned nsend_completed = 0;
+	unsigned ntested, i, j;
+	int k;
+
+	/* Take the newly submitted requests into account */
+	while (!_starpu_mpi_req_list_empty(&detached_requests))
+		_starpu_mpi_add_tested_request(_starpu_mpi_req_list_pop_front(&detached_requests));
 
-	if (_starpu_mpi_req_list_empty(&detached_requests))
+	if (ntested_requests == 0)
 	{
 		//_STARPU_MPI_LOG_OUT();
 		return;
 	}
 
 	_STARPU_MPI_TRACE_TESTING_DETACHED_BEGIN();
-	req = _starpu_mpi_req_list_begin(&detached_requests);
-	while (req != _starpu_mpi_req_list_end(&detached_requests))
-	{
-		STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
+	/* Requests may get submitted meanwhile, but they are only added to
+	 * the arrays by ourself */
+	ntested = ntested_requests;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
 
-		_STARPU_MPI_TRACE_TEST_BEGIN(req->node_tag.node.rank, req->node_tag.data_tag);
-		//_STARPU_MPI_DEBUG(3, "Test detached request %p - mpitag %"PRIi64" - TYPE %s %d\n", &req->backend->data_request, req->node_tag.data_tag, _starpu_mpi_request_type(req->request_type), req->node_tag.node.rank);
 #ifdef STARPU_SIMGRID
+	for (i = 0; i < ntested; i++)
+	{
+		int flag;
+		struct _starpu_mpi_req *req = tested_requests[i];
 		req->ret = _starpu_mpi_simgrid_mpi_test(&req->done, &flag);
+		if (flag)
+			tested_indices[ncompleted++] = i;
+	}
 #else
-		STARPU_MPI_ASSERT_MSG(req->backend->data_request != MPI_REQUEST_NULL, "Cannot test completion of the request MPI_REQUEST_NULL");
-		req->ret = MPI_Test(&req->backend->data_request, &flag, MPI_STATUS_IGNORE);
+	ret = MPI_Testsome(ntested, tested_mpi_requests, &ncompleted, tested_indices, MPI_STATUSES_IGNORE);
+	STARPU_MPI_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Testsome returning %s", _starpu_mpi_get_mpi_error_code(ret));
+	if (ncompleted == MPI_UNDEFINED)
+		ncompleted = 0;
+#endif
+
+	if (ncompleted > 0)
+		_STARPU_MPI_TRACE_POLLING_END();
+
+	for (k = 0; k < ncompleted; k++)
+	{
+		unsigned idx = tested_indices[k];
+		struct _starpu_mpi_req *req = tested_requests[idx];
+		tested_requests[idx] = NULL;
+
+#ifndef STARPU_SIMGRID
+		req->ret = ret;
+		/* MPI_Testsome has freed the request */
+		req->backend->data_request = tested_mpi_requests[idx];
 #endif
+		if (req->request_type == SEND_REQ)
+			nsend_completed++;
+
+		_STARPU_MPI_TRACE_COMPLETE_BEGIN(req->request_type, req->node_tag.node.rank, req->node_tag.data_tag);
+
+		_starpu_mpi_handle_request_termination(req);
 
-		STARPU_MPI_ASSERT_MSG(req->ret == MPI_SUCCESS, "MPI_Test returning %s", _starpu_mpi_get_mpi_error_code(req->ret));
-		_STARPU_MPI_TRACE_TEST_END(req->node_tag.node.rank, req->node_tag.data_tag);
+		_STARPU_MPI_TRACE_COMPLETE_END(req->request_type, req->node_tag.node.rank, req->node_tag.data_tag);
 
-		if (!flag)
+		STARPU_PTHREAD_MUTEX_LOCK(&req->backend->req_mutex);
+		/* We don't want to free internal non-detached
+		   requests, we need to get their MPI request before
+		   destroying them */
+		if (req->backend->is_internal_req && !req->backend->to_destroy)
 		{
-			req = _starpu_mpi_req_list_next(req);
+			/* We have completed the request, let the application request destroy it */
+			req->backend->to_destroy = 1;
+			STARPU_PTHREAD_MUTEX_UNLOCK(&req->backend->req_mutex);
 		}
 		else
 		{
-			_STARPU_MPI_TRACE_POLLING_END();
-			struct _starpu_mpi_req *next_req;
-			next_req = _starpu_mpi_req_list_next(req);
-
-			_STARPU_MPI_TRACE_COMPLETE_BEGIN(req->request_type, req->node_tag.node.rank, req->node_tag.data_tag);
-
-			_starpu_mpi_handle_request_termination(req);
-
-			STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
-			if (req->request_type == SEND_REQ && ndetached_send_requests_max > 0)
-				// if ndetached_send_requests_max == 0, we don't limit the number of concurrent MPI send requests
-				ndetached_send_requests--;
-			_starpu_mpi_req_list_erase(&detached_requests, req);
-			STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
+			STARPU_PTHREAD_MUTEX_UNLOCK(&req->backend->req_mutex);
+			_starpu_mpi_request_destroy(req);
+		}
+	}
 
-			_STARPU_MPI_TRACE_COMPLETE_END(req->request_type, req->node_tag.node.rank, req->node_tag.data_tag);
+	if (ncompleted > 0)
+		_STARPU_MPI_TRACE_POLLING_BEGIN();
 
-			STARPU_PTHREAD_MUTEX_LOCK(&req->backend->req_mutex);
-			/* We don't want to free internal non-detached
-			   requests, we need to get their MPI request before
-			   destroying them */
-			if (req->backend->is_internal_req && !req->backend->to_destroy)
-			{
-				/* We have completed the request, let the application request destroy it */
-				req->backend->to_destroy = 1;
-				STARPU_PTHREAD_MUTEX_UNLOCK(&req->backend->req_mutex);
-			}
-			else
-			{
-				STARPU_PTHREAD_MUTEX_UNLOCK(&req->backend->req_mutex);
-				_starpu_mpi_request_destroy(req);
-			}
+	STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
+	if (ncompleted > 0)
+	{
+		if (ndetached_send_requests_max > 0)
+			// if ndetached_send_requests_max == 0, we don't limit the number of concurrent MPI send requests
+			ndetached_send_requests -= nsend_completed;
 
-			req = next_req;
-			_STARPU_MPI_TRACE_POLLING_BEGIN();
+		/* Drop the completed requests from the arrays */
+		for (i = 0, j = 0; i < ntested_requests; i++)
+		{
+			if (!tested_requests[i])
+				continue;
+			tested_requests[j] = tested_requests[i];
+			tested_mpi_requests[j] = tested_mpi_requests[i];
+			j++;
 		}
-
-		STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
+		ntested_requests = j;
 	}
 	_STARPU_MPI_TRACE_TESTING_DETACHED_END();
 
@@ -1185,6 +1471,33 @@ static void _starpu_mpi_handle_detached_request(struct _starpu_mpi_req *req)
 	}
 }
 
+/* Complete a request whose data was transferred along with its envelope */
+static void _starpu_mpi_complete_inline_request(struct _starpu_mpi_req *req)
+{
+	if (req->detached)
+	{
+		_STARPU_MPI_TRACE_COMPLETE_BEGIN(req->request_type, req->node_tag.node.rank, req->node_tag.data_tag);
+		_starpu_mpi_handle_request_termination(req);
+		_STARPU_MPI_TRACE_COMPLETE_END(req->request_type, req->node_tag.node.rank, req->node_tag.data_tag);
+		_starpu_mpi_request_destroy(req);
+	}
+	else
+	{
+		/* starpu_mpi_wait or starpu_mpi_test will terminate it, there
+		 * is no MPI request to wait for */
+		STARPU_PTHREAD_MUTEX_LOCK(&req->backend->req_mutex);
+		req->submitted = 1;
+		STARPU_PTHREAD_COND_BROADCAST(&req->backend->req_cond);
+		STARPU_PTHREAD_MUTEX_UNLOCK(&req->backend->req_mutex);
+	}
+}
+
+static void _starpu_mpi_complete_inline_requests(struct _starpu_mpi_req_list *list)
+{
+	while (!_starpu_mpi_req_list_empty(list))
+		_starpu_mpi_complete_inline_request(_starpu_mpi_req_list_pop_front(list));
+}
+
 static void _starpu_mpi_handle_ready_request(struct _starpu_mpi_req *req)
 {
 	_STARPU_MPI_LOG_IN();
@@ -1233,10 +1546,13 @@ static void _starpu_mpi_handle_ready_request(struct _starpu_mpi_req *req)
 
 static void _starpu_mpi_receive_early_data(struct _starpu_mpi_envelope *envelope, MPI_Status status, MPI_Comm comm)
 {
-	_STARPU_MPI_DEBUG(20, "Request with tag %"PRIi64" and source %d not found, creating a early_data_handle to receive incoming data..\n", envelope->data_tag, status.MPI_SOURCE);
+	/* Forwarded data is matched as coming from its owner */
+	int source = envelope->mode == _STARPU_MPI_ENVELOPE_FORWARDED_DATA ? envelope->source : status.MPI_SOURCE;
+
+	_STARPU_MPI_DEBUG(20, "Request with tag %"PRIi64" and source %d not found, creating a early_data_handle to receive incoming data..\n", envelope->data_tag, source);
 	_STARPU_MPI_DEBUG(20, "Request sync %d\n", envelope->sync);
 
-	struct _starpu_mpi_early_data_handle* early_data_handle = _starpu_mpi_early_data_create(envelope, status.MPI_SOURCE, comm);
+	struct _starpu_mpi_early_data_handle* early_data_handle = _starpu_mpi_early_data_create(envelope, source, comm);
 	_starpu_mpi_early_data_add(early_data_handle);
 
 	starpu_data_handle_t data_handle;
@@ -1267,11 +1583,18 @@ static void _starpu_mpi_receive_early_data(struct _starpu_mpi_envelope *envelope
 	}
 
 	_STARPU_MPI_DEBUG(20, "Posting internal detached irecv on early_data_handle with tag %"PRIi64" from comm %ld src %d ..\n",
-			  early_data_handle->node_tag.data_tag, (long int)comm, status.MPI_SOURCE);
+			  early_data_handle->node_tag.data_tag, (long int)comm, source);
 	STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
-	early_data_handle->req = _starpu_mpi_irecv_common(early_data_handle->handle, status.MPI_SOURCE,
+	early_data_handle->req = _starpu_mpi_irecv_common(early_data_handle->handle, source,
 							  early_data_handle->node_tag.data_tag, comm, 1, 0,
 							  NULL, NULL, 1, 1, envelope->size, STARPU_DEFAULT_PRIO);
+	early_data_handle->req->backend->chunk_size = envelope->chunk_size;
+	if (envelope->mode == _STARPU_MPI_ENVELOPE_FORWARDED_DATA)
+	{
+		early_data_handle->req->backend->forwarded = 1;
+		early_data_handle->req->backend->data_source = status.MPI_SOURCE;
+	}
+	_starpu_mpi_forward_set_dests(early_data_handle->req, envelope);
 	/* The early data handle is ready, we can let _starpu_mpi_submit_ready_request
 	 * proceed with acquiring it */
 	STARPU_PTHREAD_MUTEX_UNLOCK(&early_data_mutex);
@@ -1290,6 +1613,91 @@ static void _starpu_mpi_receive_early_data(struct _starpu_mpi_envelope *envelope
 	STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
 }
 
+/* Copy data which came along with its envelope into the application request */
+static void _starpu_mpi_receive_inline(struct _starpu_mpi_req *req, void *payload, starpu_ssize_t size)
+{
+	_STARPU_MPI_DEBUG(20, "Copying %ld bytes of inline data with tag %"PRIi64" from source %d for request %p\n", size, req->node_tag.data_tag, req->node_tag.node.rank, req);
+	STARPU_MPI_ASSERT_MSG(starpu_node_get_kind(req->node) == STARPU_CPU_RAM, "Data aggregated by StarPU-MPI can not be received into device memory, STARPU_MPI_AGGREGATE_SIZE should be set to 0 on all nodes when using GPUDirect");
+
+	_STARPU_MPI_TRACE_IRECV_SUBMIT_BEGIN(req->node_tag.node.rank, req->node_tag.data_tag);
+	req->sync = 0;
+	_starpu_mpi_datatype_allocate(req->data_handle, req);
+	if (req->registered_datatype == 1)
+	{
+		int position = 0;
+		req->count = 1;
+		req->ptr = starpu_data_handle_to_pointer(req->data_handle, req->node);
+		MPI_Unpack(payload, size, &position, req->ptr, 1, req->datatype, req->node_tag.node.comm);
+	}
+	else
+	{
+		/* This will be unpacked on request termination */
+		req->count = size;
+		req->ptr = (void *)starpu_malloc_on_node_flags(req->node, req->count, 0);
+		starpu_memory_allocate(req->node, req->count, STARPU_MEMORY_OVERFLOW);
+		STARPU_MPI_ASSERT_MSG(req->ptr, "cannot allocate message of size %ld\n", req->count);
+		memcpy(req->ptr, payload, size);
+	}
+	req->backend->data_request = MPI_REQUEST_NULL;
+	_STARPU_MPI_TRACE_IRECV_SUBMIT_END(req->node_tag.node.rank, req->node_tag.data_tag);
+
+	_starpu_mpi_complete_inline_request(req);
+}
+
+// We suppose progress_mutex is locked
+static void _starpu_mpi_receive_inline_entry(struct _starpu_mpi_envelope *envelope, int source, MPI_Comm comm)
+{
+	STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
+	STARPU_PTHREAD_MUTEX_LOCK(&early_data_mutex);
+	STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
+	struct _starpu_mpi_req *early_request = _starpu_mpi_early_request_dequeue(envelope->data_tag, source, comm);
+
+	if (early_request == NULL)
+	{
+		/* Case: the application has not posted the receive yet. Just
+		 * keep a copy of the data as early data, without any handle,
+		 * _starpu_mpi_submit_ready_request will copy it from there. */
+		_STARPU_MPI_DEBUG(20, "Request with tag %"PRIi64" and source %d not found, keeping the %ld bytes of inline data as early data\n", envelope->data_tag, source, envelope->size);
+		struct _starpu_mpi_early_data_handle *early_data_handle = _starpu_mpi_early_data_create(envelope, source, comm);
+		_STARPU_MPI_MALLOC(early_data_handle->buffer, envelope->size);
+		memcpy(early_data_handle->buffer, envelope + 1, envelope->size);
+		early_data_handle->size = envelope->size;
+		early_data_handle->buffer_node = STARPU_MAIN_RAM;
+		_starpu_mpi_early_data_add(early_data_handle);
+		STARPU_PTHREAD_MUTEX_UNLOCK(&early_data_mutex);
+	}
+	else
+	{
+		/* Case: a matching application request has been found, the
+		 * data can be copied right away */
+		STARPU_PTHREAD_MUTEX_UNLOCK(&early_data_mutex);
+		STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
+		_starpu_mpi_receive_inline(early_request, envelope + 1, envelope->size);
+		STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
+	}
+}
+
+// We suppose progress_mutex is locked
+static void _starpu_mpi_receive_inline_data(struct _starpu_mpi_envelope *envelope, MPI_Status *status, MPI_Comm comm)
+{
+	int count;
+	char *cur = (char *) envelope;
+	char *end;
+
+	MPI_Get_count(status, MPI_BYTE, &count);
+	end = cur + count;
+	_STARPU_MPI_DEBUG(20, "Received %d bytes of aggregated data from node %d\n", count, status->MPI_SOURCE);
+
+	/* Several envelopes may have been aggregated along with their data */
+	while (cur < end)
+	{
+		envelope = (struct _starpu_mpi_envelope *) cur;
+		STARPU_MPI_ASSERT_MSG(envelope->mode == _STARPU_MPI_ENVELOPE_INLINE_DATA, "Unexpected envelope mode %d in aggregated data", envelope->mode);
+		_starpu_mpi_receive_inline_entry(envelope, status->MPI_SOURCE, comm);
+		cur += _STARPU_MPI_AGGREGATE_ENTRY_SIZE(envelope->size);
+	}
+}
+
 static void *_starpu_mpi_progress_thread_func(void *arg)
 {
 	struct _starpu_mpi_argc_argv *argc_argv = (struct _starpu_mpi_argc_argv *) arg;
@@ -1349,6 +1757,7 @@ static void *_starpu_mpi_progress_thread_func(void *arg)
 	_starpu_mpi_cache_init(argc_argv->comm);
 	_starpu_mpi_select_node_init();
 	_starpu_mpi_tag_init();
+	_starpu_mpi_aggregate_comm_init(argc_argv->comm);
 	_starpu_mpi_comm_init(argc_argv->comm);
 	_starpu_mpi_tags_init();
 
@@ -1380,13 +1789,13 @@ static void *_starpu_mpi_progress_thread_func(void *arg)
 	int mpi_driver_task_counter = 0;
 	_STARPU_MPI_TRACE_POLLING_BEGIN();
 
-	while (running || posted_requests || !(_starpu_mpi_req_list_empty(&ready_recv_requests)) || !(_starpu_mpi_req_prio_list_empty(&ready_send_requests)) || !(_starpu_mpi_req_list_empty(&detached_requests)))
+	while (running || posted_requests || !(_starpu_mpi_req_list_empty(&ready_recv_requests)) || !(_starpu_mpi_req_prio_list_empty(&ready_send_requests)) || !(_starpu_mpi_req_list_empty(&detached_requests)) || ntested_requests || _starpu_mpi_aggregate_pending() || _starpu_mpi_forward_pending())
 	{
 #ifdef STARPU_SIMGRID
 		starpu_pthread_wait_reset(&_starpu_mpi_thread_wait);
 #endif
 		/* shall we block ? */
-		unsigned block = _starpu_mpi_req_list_empty(&ready_recv_requests) && _starpu_mpi_req_prio_list_empty(&ready_send_requests) && _starpu_mpi_early_request_count() == 0 && _starpu_mpi_sync_data_count() == 0 && _starpu_mpi_req_list_empty(&detached_requests);
+		unsigned block = _starpu_mpi_req_list_empty(&ready_recv_requests) && _starpu_mpi_req_prio_list_empty(&ready_send_requests) && _starpu_mpi_early_request_count() == 0 && _starpu_mpi_sync_data_count() == 0 && _starpu_mpi_forward_ack_count() == 0 && _starpu_mpi_req_list_empty(&detached_requests) && ntested_requests == 0 && !_starpu_mpi_aggregate_pending() && !_starpu_mpi_forward_pending();
 
 		if (block)
 		{
@@ -1452,12 +1861,34 @@ static void *_starpu_mpi_progress_thread_func(void *arg)
 			STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
 		}
 
+		/* Send the aggregated data which have waited long enough, or
+		 * which nothing else will join, and release the aggregation
+		 * buffers which were sent */
+		if (_starpu_mpi_aggregate_pending())
+		{
+			struct _starpu_mpi_req_list flushed;
+			int idle = _starpu_mpi_req_prio_list_empty(&ready_send_requests);
+			_starpu_mpi_req_list_init(&flushed);
+			STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
+			_starpu_mpi_aggregate_progress(idle, &flushed);
+			_starpu_mpi_complete_inline_requests(&flushed);
+			STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
+		}
+
+		/* Release the forwarded data which were sent */
+		if (_starpu_mpi_forward_pending())
+		{
+			STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
+			_starpu_mpi_forward_progress();
+			STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
+		}
+
 		_STARPU_MPI_TRACE_POLLING_BEGIN();
 
 		/* If there is no currently submitted envelope_request submitted to
 		 * catch envelopes from senders, and there is some pending
 		 * receive requests on our side, we resubmit a header request. */
-		if (((_starpu_mpi_early_request_count() > 0) || (_starpu_mpi_sync_data_count() > 0)) && (envelope_request_submitted == 0))// && (HASH_COUNT(_starpu_mpi_early_data_handle_hashmap) == 0))
+		if (((_starpu_mpi_early_request_count() > 0) || (_starpu_mpi_sync_data_count() > 0) || (_starpu_mpi_forward_ack_count() > 0)) && (envelope_request_submitted == 0))// && (HASH_COUNT(_starpu_mpi_early_data_handle_hashmap) == 0))
 		{
 			_starpu_mpi_comm_post_recv();
 			envelope_request_submitted = 1;
@@ -1481,7 +1912,11 @@ static void *_starpu_mpi_progress_thread_func(void *arg)
 				_STARPU_MPI_TRACE_POLLING_END();
 				_STARPU_MPI_COMM_FROM_DEBUG(envelope, sizeof(struct _starpu_mpi_envelope), MPI_BYTE, envelope_status.MPI_SOURCE, _STARPU_MPI_TAG_ENVELOPE, envelope->data_tag, envelope_comm);
 				_STARPU_MPI_DEBUG(4, "Envelope received with mode %d\n", envelope->mode);
-				if (envelope->mode == _STARPU_MPI_ENVELOPE_SYNC_READY)
+				if (envelope->mode == _STARPU_MPI_ENVELOPE_INLINE_DATA)
+				{
+					_starpu_mpi_receive_inline_data(envelope, &envelope_status, envelope_comm);
+				}
+				else if (envelope->mode == _STARPU_MPI_ENVELOPE_SYNC_READY)
 				{
 					struct _starpu_mpi_req *_sync_req = _starpu_mpi_sync_data_find(envelope->data_tag, envelope_status.MPI_SOURCE, envelope_comm);
 					_STARPU_MPI_DEBUG(20, "Sending data with tag %"PRIi64" to node %d\n", _sync_req->node_tag.data_tag, envelope_status.MPI_SOURCE);
@@ -1491,14 +1926,31 @@ static void *_starpu_mpi_progress_thread_func(void *arg)
 					_starpu_mpi_isend_data_func(_sync_req);
 					STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
 				}
+				else if (envelope->mode == _STARPU_MPI_ENVELOPE_FORWARD_ACK)
+				{
+					struct _starpu_mpi_req *_forwarded_req = _starpu_mpi_forward_ack_find(envelope->data_tag, envelope_status.MPI_SOURCE, envelope_comm);
+					STARPU_MPI_ASSERT_MSG(_forwarded_req, "No forwarded request for the acknowledgement of node %d with tag %"PRIi64"\n", envelope_status.MPI_SOURCE, envelope->data_tag);
+					STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
+					_starpu_mpi_complete_inline_request(_forwarded_req);
+					STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
+				}
 				else
 				{
-					_STARPU_MPI_DEBUG(3, "Searching for application request with tag %"PRIi64" and source %d (size %ld)\n", envelope->data_tag, envelope_status.MPI_SOURCE, envelope->size);
+					/* Forwarded data is matched as coming from its owner */
+					int source = envelope_status.MPI_SOURCE;
+					if (envelope->mode == _STARPU_MPI_ENVELOPE_FORWARDED_DATA)
+					{
+						/* Later data sent directly by the owner must not be matched first */
+						_starpu_mpi_forward_ack(envelope, envelope_comm);
+						source = envelope->source;
+					}
+
+					_STARPU_MPI_DEBUG(3, "Searching for application request with tag %"PRIi64" and source %d (size %ld)\n", envelope->data_tag, source, envelope->size);
 
 					STARPU_PTHREAD_MUTEX_UNLOCK(&progress_mutex);
 					STARPU_PTHREAD_MUTEX_LOCK(&early_data_mutex);
 					STARPU_PTHREAD_MUTEX_LOCK(&progress_mutex);
-					struct _starpu_mpi_req *early_request = _starpu_mpi_early_request_dequeue(envelope->data_tag, envelope_status.MPI_SOURCE, envelope_comm);
+					struct _starpu_mpi_req *early_request = _starpu_mpi_early_request_dequeue(envelope->data_tag, source, envelope_comm);
 
 					/* Case: a data will arrive before a matching receive is
 					 * posted by the application. Create a temporary handle to
@@ -1552,6 +2004,13 @@ static void *_starpu_mpi_progress_thread_func(void *arg)
 						_STARPU_MPI_DEBUG(2000, "Request sync %d\n", envelope->sync);
 
 						early_request->sync = envelope->sync;
+						early_request->backend->chunk_size = envelope->chunk_size;
+						if (envelope->mode == _STARPU_MPI_ENVELOPE_FORWARDED_DATA)
+						{
+							early_request->backend->forwarded = 1;
+							early_request->backend->data_source = envelope_status.MPI_SOURCE;
+						}
+						_starpu_mpi_forward_set_dests(early_request, envelope);
 						_starpu_mpi_datatype_allocate(early_request->data_handle, early_request);
 						if (early_request->registered_datatype == 1)
 						{
@@ -1648,6 +2107,14 @@ static void *_starpu_mpi_progress_thread_func(void *arg)
 #endif
 
 	STARPU_MPI_ASSERT_MSG(_starpu_mpi_req_list_empty(&detached_requests), "List of detached requests not empty");
+	STARPU_MPI_ASSERT_MSG(ntested_requests == 0, "Detached requests still being tested");
+	free(tested_requests);
+	free(tested_mpi_requests);
+	free(tested_indices);
+	tested_requests = NULL;
+	tested_mpi_requests = NULL;
+	tested_indices = NULL;
+	tested_requests_size = 0;
 	STARPU_MPI_ASSERT_MSG(ndetached_send_requests == 0, "Number of detached send requests not 0");
 	STARPU_MPI_ASSERT_MSG(_starpu_mpi_req_list_empty(&ready_recv_requests), "List of ready requests not empty");
 	STARPU_MPI_ASSERT_MSG(_starpu_mpi_req_prio_list_empty(&ready_send_requests), "List of ready requests not empty");
@@ -1655,6 +2122,8 @@ static void *_starpu_mpi_progress_thread_func(void *arg)
 	_starpu_mpi_early_request_check_termination();
 	_starpu_mpi_early_data_check_termination();
 	_starpu_mpi_sync_data_check_termination();
+	_starpu_mpi_aggregate_check_termination();
+	_starpu_mpi_forward_check_termination();
 	_starpu_mpi_req_prio_list_deinit(&ready_send_requests);
 
 #ifdef STARPU_USE_FXT
@@ -1695,6 +2164,10 @@ int _starpu_mpi_progress_init(struct _starpu_mpi_argc_argv *argc_argv)
 	nready_process = starpu_getenv_number_default("STARPU_MPI_NREADY_PROCESS", 10);
 	ndetached_send_requests_max = starpu_getenv_number_default("STARPU_MPI_NDETACHED_SEND", 10);
 	early_data_force_allocate = starpu_getenv_number_default("STARPU_MPI_EARLYDATA_ALLOCATE", 0);
+	pipeline_chunk_size = starpu_getenv_number_default("STARPU_MPI_PIPELINE_CHUNK_SIZE", 0);
+	/* Needed before registering the first communicator */
+	_starpu_mpi_aggregate_init();
+	_starpu_mpi_forward_init();
 
 #ifdef STARPU_SIMGRID
 	STARPU_PTHREAD_MUTEX_INIT(&wait_counter_mutex, NULL);
@@ -1756,6 +2229,8 @@ void _starpu_mpi_progress_shutdown(void **value)
 	STARPU_PTHREAD_MUTEX_DESTROY(&early_data_mutex);
 	STARPU_PTHREAD_MUTEX_DESTROY(&send_mutex);
 	STARPU_PTHREAD_COND_DESTROY(&barrier_cond);
+	_starpu_mpi_aggregate_shutdown();
+	_starpu_mpi_forward_shutdown();
 }
 
 static int64_t _starpu_mpi_tag_max = INT64_MAX;
@@ -44,7 +44,15 @@ extern int _starpu_mpi_tag;
 enum _starpu_envelope_mode
 {
 	_STARPU_MPI_ENVELOPE_DATA=0,
-	_STARPU_MPI_ENVELOPE_SYNC_READY=1
+	_STARPU_MPI_ENVELOPE_SYNC_READY=1,
+	/** The data follows the envelope in the same message */
+	_STARPU_MPI_ENVELOPE_INLINE_DATA=2,
+	/** The data of envelope::source is forwarded by the sender of the
+	 * envelope, see envelope::nb_forwards */
+	_STARPU_MPI_ENVELOPE_FORWARDED_DATA=3,
+	/** Tells envelope::source that the data it asked another node to
+	 * forward was received */
+	_STARPU_MPI_ENVELOPE_FORWARD_ACK=4
 };
 
 struct _starpu_mpi_envelope
@@ -53,6 +61,23 @@ struct _starpu_mpi_envelope
 	starpu_ssize_t size;
 	starpu_mpi_tag_t data_tag;
 	unsigned sync;
+	/** Size of the chunks in which the data is sent, 0 if it is sent
+	 * with a single message */
+	starpu_ssize_t chunk_size;
+	/** Number of destinations, following the envelope in the same
+	 * message, to which the receiver has to forward the data once
+	 * received */
+	int nb_forwards;
+	/** For forwarded data and acknowledgements, the rank which owns the
+	 * data */
+	int source;
+};
+
+/** A destination to which the receiver of some data has to forward it */
+struct _starpu_mpi_forward_dest
+{
+	starpu_mpi_tag_t data_tag;
+	int rank;
 };
 
 struct _starpu_mpi_req_backend
@@ -70,6 +95,29 @@ struct _starpu_mpi_req_backend
 
 	struct _starpu_mpi_envelope* envelope;
 
+	/** When the data is transferred in chunks of chunk_size bytes, the
+	 * requests of the nb_chunks-1 first chunks, the last one using
+	 * data_request. For registered datatypes, the datatype of each chunk
+	 * and its displacement from ptr */
+	starpu_ssize_t chunk_size;
+	int nb_chunks;
+	MPI_Request *chunk_requests;
+	MPI_Datatype *chunk_datatypes;
+	MPI_Aint *chunk_displacements;
+
+	/** The destinations to which the receiver of the data has to
+	 * forward it. For a send request, they are sent along with the
+	 * envelope, and for a receive request, the data is forwarded on
+	 * termination */
+	struct _starpu_mpi_forward_dest *forward_dests;
+	int nb_forward_dests;
+	/** Set when the data is forwarded by data_source. For a send
+	 * request, data_source thus sends the data to node_tag.node.rank on
+	 * our behalf, and for a receive request, the data is to be received
+	 * from data_source on behalf of node_tag.node.rank */
+	unsigned forwarded:1;
+	int data_source;
+
 	unsigned is_internal_req:1;
 	unsigned to_destroy:1;
 	struct _starpu_mpi_req *internal_req;
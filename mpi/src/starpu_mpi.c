@@ -489,6 +489,7 @@ void _starpu_mpi_data_clear(starpu_data_handle_t data_handle)
 	_starpu_spin_destroy(&data->coop_lock);
 	free(data->redux_map);
 	data->redux_map = NULL;
+	_starpu_mpi_select_node_data_clear(data_handle);
 	free(data);
 }
 
@@ -19,6 +19,7 @@
 #include <datawizard/coherency.h>
 
 #include <starpu_mpi_cache.h>
+#include <starpu_mpi_select_node.h>
 #include <starpu_mpi_cache_stats.h>
 #include <starpu_mpi_private.h>
 #include <mpi_failure_tolerance/starpu_mpi_ft_stats.h>
@@ -30,13 +31,50 @@ struct _starpu_data_entry
 	starpu_data_handle_t data_handle;
 };
 
+/* Position of a cached copy in the LRU list of the node it was exchanged with */
+LIST_TYPE(_starpu_mpi_cache_lru,
+	starpu_data_handle_t data_handle;
+	int node;
+	size_t size;
+	/** Task during which the copy was last used, see _cache_lru_task */
+	unsigned long task;
+);
+
+/* The copies sent to node n are recorded in cache_lru[n], and the copy
+ * received from the owner in cache_lru[_starpu_cache_comm_size], since the
+ * owner may have changed before the copy gets dropped. */
+#define _STARPU_MPI_CACHE_LRU_RECEIVED _starpu_cache_comm_size
+
 static starpu_pthread_mutex_t _cache_mutex;
 static struct _starpu_data_entry *_cache_data = NULL;
 int _starpu_cache_enabled=1;
 static MPI_Comm _starpu_cache_comm;
 static int _starpu_cache_comm_size;
 
+/*
+ * When STARPU_MPI_CACHE_MAX_SIZE is set, the copies received from each node
+ * are bounded to an even share of it. Since the sender has to know when
+ * the receiver drops a copy, both of them maintain the same LRU list of the
+ * copies exchanged between them, from the same sequence of cache accesses,
+ * and thus evict the same copies at the same point of the submission.
+ */
+static size_t _cache_max_size;
+/** LRU lists of the copies received from each node */
+static struct _starpu_mpi_cache_lru_list *_cache_lru_received;
+/** LRU lists of the copies sent to each node */
+static struct _starpu_mpi_cache_lru_list *_cache_lru_sent;
+static size_t *_cache_lru_received_size;
+static size_t *_cache_lru_sent_size;
+/**
+ * Number of tasks whose data exchanges were started. The copies used by the
+ * task being built may not be evicted, since the invalidation would be
+ * submitted before the task itself. They are thus kept over the budget
+ * until a later task adds a copy to the cache.
+ */
+static unsigned long _cache_lru_task;
+
 static void _starpu_mpi_cache_flush_nolock(starpu_data_handle_t data_handle);
+static void _starpu_mpi_cache_data_remove_nolock(starpu_data_handle_t data_handle);
 
 int starpu_mpi_cache_is_enabled()
 {
@@ -80,6 +118,25 @@ void _starpu_mpi_cache_init(MPI_Comm comm)
 	starpu_mpi_comm_size(comm, &_starpu_cache_comm_size);
 	_starpu_mpi_cache_stats_init();
 	STARPU_PTHREAD_MUTEX_INIT(&_cache_mutex, NULL);
+
+	_cache_max_size = (size_t) starpu_getenv_number_default("STARPU_MPI_CACHE_MAX_SIZE", 0) * 1024 * 1024;
+	if (_cache_max_size && _starpu_cache_comm_size > 1)
+	{
+		int i;
+
+		_cache_max_size /= _starpu_cache_comm_size - 1;
+		_STARPU_MPI_MALLOC(_cache_lru_received, _starpu_cache_comm_size * sizeof(_cache_lru_received[0]));
+		_STARPU_MPI_MALLOC(_cache_lru_sent, _starpu_cache_comm_size * sizeof(_cache_lru_sent[0]));
+		_STARPU_MPI_CALLOC(_cache_lru_received_size, _starpu_cache_comm_size, sizeof(_cache_lru_received_size[0]));
+		_STARPU_MPI_CALLOC(_cache_lru_sent_size, _starpu_cache_comm_size, sizeof(_cache_lru_sent_size[0]));
+		for (i = 0; i < _starpu_cache_comm_size; i++)
+		{
+			_starpu_mpi_cache_lru_list_init(&_cache_lru_received[i]);
+			_starpu_mpi_cache_lru_list_init(&_cache_lru_sent[i]);
+		}
+	}
+	else
+		_cache_max_size = 0;
 }
 
 void _starpu_mpi_cache_shutdown()
@@ -98,6 +155,16 @@ void _starpu_mpi_cache_shutdown()
 	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
 	STARPU_PTHREAD_MUTEX_DESTROY(&_cache_mutex);
 	_starpu_mpi_cache_stats_shutdown();
+
+	free(_cache_lru_received);
+	_cache_lru_received = NULL;
+	free(_cache_lru_sent);
+	_cache_lru_sent = NULL;
+	free(_cache_lru_received_size);
+	_cache_lru_received_size = NULL;
+	free(_cache_lru_sent_size);
+	_cache_lru_sent_size = NULL;
+	_cache_max_size = 0;
 }
 
 void _starpu_mpi_cache_data_clear(starpu_data_handle_t data_handle)
@@ -119,6 +186,7 @@ void _starpu_mpi_cache_data_clear(starpu_data_handle_t data_handle)
 	}
 
 	free(mpi_data->cache_sent);
+	free(mpi_data->cache_lru);
 }
 
 void _starpu_mpi_cache_data_init(starpu_data_handle_t data_handle)
@@ -138,9 +206,134 @@ void _starpu_mpi_cache_data_init(starpu_data_handle_t data_handle)
 	{
 		mpi_data->cache_sent[i] = 0;
 	}
+	if (_cache_max_size)
+	{
+		_STARPU_MALLOC(mpi_data->cache_lru, (_starpu_cache_comm_size+1)*sizeof(mpi_data->cache_lru[0]));
+		for(i=0 ; i<_starpu_cache_comm_size+1 ; i++)
+			mpi_data->cache_lru[i].data_handle = data_handle;
+	}
+	else
+		mpi_data->cache_lru = NULL;
 	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
 }
 
+/**************************************
+ * Bounded cache
+ **************************************/
+
+/* Record a new cached copy exchanged with node, as the most recently used one */
+static void _starpu_mpi_cache_lru_add_nolock(starpu_data_handle_t data_handle, int index, int node, struct _starpu_mpi_cache_lru_list *lists, size_t *sizes)
+{
+	struct _starpu_mpi_data *mpi_data = data_handle->mpi_data;
+	struct _starpu_mpi_cache_lru *lru;
+
+	if (!mpi_data->cache_lru || !_cache_max_size)
+		return;
+
+	lru = &mpi_data->cache_lru[index];
+	lru->node = node;
+	lru->size = starpu_data_get_size(data_handle);
+	lru->task = _cache_lru_task;
+	_starpu_mpi_cache_lru_list_push_back(&lists[node], lru);
+	sizes[node] += lru->size;
+}
+
+/* The cached copy exchanged with node was used again */
+static void _starpu_mpi_cache_lru_touch_nolock(starpu_data_handle_t data_handle, int index, struct _starpu_mpi_cache_lru_list *lists)
+{
+	struct _starpu_mpi_data *mpi_data = data_handle->mpi_data;
+	struct _starpu_mpi_cache_lru *lru;
+
+	if (!mpi_data->cache_lru || !_cache_max_size)
+		return;
+
+	lru = &mpi_data->cache_lru[index];
+	lru->task = _cache_lru_task;
+	_starpu_mpi_cache_lru_list_erase(&lists[lru->node], lru);
+	_starpu_mpi_cache_lru_list_push_back(&lists[lru->node], lru);
+}
+
+size_t _starpu_mpi_cache_get_max_size(void)
+{
+	return _starpu_cache_enabled ? _cache_max_size : 0;
+}
+
+void _starpu_mpi_cache_task_start(void)
+{
+	if (_starpu_cache_enabled == 0 || !_cache_max_size)
+		return;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&_cache_mutex);
+	_cache_lru_task++;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
+}
+
+static void _starpu_mpi_cache_lru_remove_nolock(starpu_data_handle_t data_handle, int index, struct _starpu_mpi_cache_lru_list *lists, size_t *sizes)
+{
+	struct _starpu_mpi_data *mpi_data = data_handle->mpi_data;
+	struct _starpu_mpi_cache_lru *lru;
+
+	if (!mpi_data->cache_lru || !_cache_max_size)
+		return;
+
+	lru = &mpi_data->cache_lru[index];
+	_starpu_mpi_cache_lru_list_erase(&lists[lru->node], lru);
+	sizes[lru->node] -= lru->size;
+}
+
+/* Drop the least recently received copies from node until they fit in the
+ * budget again, but not the copies used by the task being built. The memory
+ * is only released once the tasks already submitted for reading them are
+ * over. */
+static void _starpu_mpi_cache_lru_evict_received_nolock(int node)
+{
+	while (_cache_lru_received_size[node] > _cache_max_size)
+	{
+		struct _starpu_mpi_cache_lru *lru = _starpu_mpi_cache_lru_list_front(&_cache_lru_received[node]);
+		starpu_data_handle_t data_handle = lru->data_handle;
+		struct _starpu_mpi_data *mpi_data = data_handle->mpi_data;
+
+		if (lru->task == _cache_lru_task)
+			/* The others are more recent, thus used by this task too */
+			break;
+
+		_STARPU_MPI_DEBUG(2, "Evicting received copy of data %p from the cache\n", data_handle);
+		_starpu_mpi_cache_lru_remove_nolock(data_handle, _STARPU_MPI_CACHE_LRU_RECEIVED, _cache_lru_received, _cache_lru_received_size);
+		mpi_data->cache_received = 0;
+		mpi_data->ft_induced_cache_received = 0;
+		mpi_data->ft_induced_cache_received_count = 0;
+		starpu_data_invalidate_submit(data_handle);
+		_starpu_mpi_cache_data_remove_nolock(data_handle);
+		_starpu_mpi_cache_stats_dec(node, data_handle);
+		_starpu_mpi_cache_stats_evict(node, data_handle);
+	}
+}
+
+/* Forget the least recently sent copies to node, which the receiver evicts
+ * at the same time, see _starpu_mpi_cache_lru_evict_received_nolock */
+static void _starpu_mpi_cache_lru_evict_sent_nolock(int node)
+{
+	while (_cache_lru_sent_size[node] > _cache_max_size)
+	{
+		struct _starpu_mpi_cache_lru *lru = _starpu_mpi_cache_lru_list_front(&_cache_lru_sent[node]);
+		starpu_data_handle_t data_handle = lru->data_handle;
+		struct _starpu_mpi_data *mpi_data = data_handle->mpi_data;
+		int n;
+
+		if (lru->task == _cache_lru_task)
+			break;
+
+		_STARPU_MPI_DEBUG(2, "Forgetting that data %p was sent to %d\n", data_handle, node);
+		_starpu_mpi_cache_lru_remove_nolock(data_handle, node, _cache_lru_sent, _cache_lru_sent_size);
+		mpi_data->cache_sent[node] = 0;
+		for (n = 0; n < _starpu_cache_comm_size; n++)
+			if (mpi_data->cache_sent[n])
+				break;
+		if (n == _starpu_cache_comm_size)
+			_starpu_mpi_cache_data_remove_nolock(data_handle);
+	}
+}
+
 static void _starpu_mpi_cache_data_add_nolock(starpu_data_handle_t data_handle)
 {
 	struct _starpu_data_entry *entry;
@@ -193,6 +386,7 @@ void starpu_mpi_cached_receive_clear(starpu_data_handle_t data_handle)
 #  warning TODO: Somebody else will write to the data, so discard our cached copy if any. starpu_mpi could just remember itself.
 #endif
 		_STARPU_MPI_DEBUG(2, "Clearing receive cache for data %p\n", data_handle);
+		_starpu_mpi_cache_lru_remove_nolock(data_handle, _STARPU_MPI_CACHE_LRU_RECEIVED, _cache_lru_received, _cache_lru_received_size);
 		mpi_data->cache_received = 0;
 		mpi_data->ft_induced_cache_received = 0;
 		mpi_data->ft_induced_cache_received_count = 0;
@@ -223,9 +417,15 @@ int starpu_mpi_cached_receive_set(starpu_data_handle_t data_handle)
 		mpi_data->cache_received = 1;
 		_starpu_mpi_cache_data_add_nolock(data_handle);
 		_starpu_mpi_cache_stats_inc(mpi_rank, data_handle);
+		_starpu_mpi_cache_stats_miss(mpi_rank, data_handle);
+		_starpu_mpi_cache_lru_add_nolock(data_handle, _STARPU_MPI_CACHE_LRU_RECEIVED, mpi_rank, _cache_lru_received, _cache_lru_received_size);
+		if (_cache_max_size)
+			_starpu_mpi_cache_lru_evict_received_nolock(mpi_rank);
 	}
 	else
 	{
+		_starpu_mpi_cache_stats_hit(mpi_rank, data_handle);
+		_starpu_mpi_cache_lru_touch_nolock(data_handle, _STARPU_MPI_CACHE_LRU_RECEIVED, _cache_lru_received);
 #ifdef STARPU_USE_MPI_FT_STATS
 		if (mpi_data->ft_induced_cache_received == 1 && mpi_data->ft_induced_cache_received_count == 0)
 		{
@@ -263,9 +463,15 @@ int starpu_mpi_cached_cp_receive_set(starpu_data_handle_t data_handle)
 #endif
 		_starpu_mpi_cache_data_add_nolock(data_handle);
 		_starpu_mpi_cache_stats_inc(mpi_rank, data_handle);
+		_starpu_mpi_cache_stats_miss(mpi_rank, data_handle);
+		_starpu_mpi_cache_lru_add_nolock(data_handle, _STARPU_MPI_CACHE_LRU_RECEIVED, mpi_rank, _cache_lru_received, _cache_lru_received_size);
+		if (_cache_max_size)
+			_starpu_mpi_cache_lru_evict_received_nolock(mpi_rank);
 	}
 	else
 	{
+		_starpu_mpi_cache_stats_hit(mpi_rank, data_handle);
+		_starpu_mpi_cache_lru_touch_nolock(data_handle, _STARPU_MPI_CACHE_LRU_RECEIVED, _cache_lru_received);
 #ifdef STARPU_USE_MPI_FT_STATS
 		if (mpi_data->ft_induced_cache_received == 1)
 			_STARPU_MPI_FT_STATS_RECV_CP_CACHED_CP_DATA(starpu_data_get_size(data_handle));
@@ -311,6 +517,7 @@ void starpu_mpi_cached_send_clear(starpu_data_handle_t data_handle)
 		if (mpi_data->cache_sent[n] == 1)
 		{
 			_STARPU_MPI_DEBUG(2, "Clearing send cache for data %p\n", data_handle);
+			_starpu_mpi_cache_lru_remove_nolock(data_handle, n, _cache_lru_sent, _cache_lru_sent_size);
 			mpi_data->cache_sent[n] = 0;
 			_starpu_mpi_cache_data_remove_nolock(data_handle);
 		}
@@ -334,10 +541,14 @@ int starpu_mpi_cached_send_set(starpu_data_handle_t data_handle, int dest)
 		mpi_data->cache_sent[dest] = 1;
 		_starpu_mpi_cache_data_add_nolock(data_handle);
 		_STARPU_MPI_DEBUG(2, "Noting that data %p has already been sent to %d\n", data_handle, dest);
+		_starpu_mpi_cache_lru_add_nolock(data_handle, dest, dest, _cache_lru_sent, _cache_lru_sent_size);
+		if (_cache_max_size)
+			_starpu_mpi_cache_lru_evict_sent_nolock(dest);
 	}
 	else
 	{
 		_STARPU_MPI_DEBUG(2, "Do not send data %p to node %d as it has already been sent\n", data_handle, dest);
+		_starpu_mpi_cache_lru_touch_nolock(data_handle, dest, _cache_lru_sent);
 	}
 	STARPU_PTHREAD_MUTEX_UNLOCK(&_cache_mutex);
 	return already_sent;
@@ -372,6 +583,7 @@ static void _starpu_mpi_cache_flush_nolock(starpu_data_handle_t data_handle)
 		if (mpi_data->cache_sent[i] == 1)
 		{
 			_STARPU_MPI_DEBUG(2, "Clearing send cache for data %p\n", data_handle);
+			_starpu_mpi_cache_lru_remove_nolock(data_handle, i, _cache_lru_sent, _cache_lru_sent_size);
 			mpi_data->cache_sent[i] = 0;
 			_starpu_mpi_cache_stats_dec(i, data_handle);
 		}
@@ -381,11 +593,14 @@ static void _starpu_mpi_cache_flush_nolock(starpu_data_handle_t data_handle)
 	{
 		int mpi_rank = starpu_mpi_data_get_rank(data_handle);
 		_STARPU_MPI_DEBUG(2, "Clearing received cache for data %p\n", data_handle);
+		_starpu_mpi_cache_lru_remove_nolock(data_handle, _STARPU_MPI_CACHE_LRU_RECEIVED, _cache_lru_received, _cache_lru_received_size);
 		mpi_data->cache_received = 0;
 		mpi_data->ft_induced_cache_received = 0;
 		mpi_data->ft_induced_cache_received_count = 0;
 		_starpu_mpi_cache_stats_dec(mpi_rank, data_handle);
 	}
+
+	_starpu_mpi_select_node_data_flush(data_handle);
 }
 
 static void _starpu_mpi_cache_flush_and_invalidate_nolock(MPI_Comm comm, starpu_data_handle_t data_handle)
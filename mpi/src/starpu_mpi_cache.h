@@ -33,6 +33,10 @@ void _starpu_mpi_cache_init(MPI_Comm comm);
 void _starpu_mpi_cache_shutdown();
 void _starpu_mpi_cache_data_init(starpu_data_handle_t data_handle);
 void _starpu_mpi_cache_data_clear(starpu_data_handle_t data_handle);
+/** Called before exchanging the data of a task, the cached copies it uses are then kept until the next task */
+void _starpu_mpi_cache_task_start(void);
+/** Size of the cached copies which may be kept per pair of nodes, or 0 when it is not bounded */
+size_t _starpu_mpi_cache_get_max_size(void);
 
 #ifdef __cplusplus
 }
@@ -20,6 +20,11 @@
 #include <starpu_mpi_private.h>
 
 static int stats_enabled=0;
+/** Accesses to the receive cache */
+static unsigned long nb_hits;
+static unsigned long nb_misses;
+static unsigned long nb_evictions;
+static size_t evicted_size;
 
 void _starpu_mpi_cache_stats_init()
 {
@@ -39,6 +44,8 @@ void _starpu_mpi_cache_stats_shutdown()
 {
 	if (stats_enabled == 0)
 		return;
+
+	_STARPU_MPI_MSG("[communication cache] %lu hits, %lu misses, %lu evictions (%ld bytes)\n", nb_hits, nb_misses, nb_evictions, (long)evicted_size);
 }
 
 void _starpu_mpi_cache_stats_update(unsigned dst, starpu_data_handle_t data_handle, int count)
@@ -59,3 +66,30 @@ void _starpu_mpi_cache_stats_update(unsigned dst, starpu_data_handle_t data_hand
 		_STARPU_MPI_MSG("[communication cache] - %10ld from %u\n", (long)size, dst);
 	}
 }
+
+void _starpu_mpi_cache_stats_access(unsigned src, starpu_data_handle_t data_handle, int hit)
+{
+	(void)src;
+	(void)data_handle;
+
+	if (stats_enabled == 0)
+		return;
+
+	if (hit)
+		nb_hits++;
+	else
+		nb_misses++;
+}
+
+void _starpu_mpi_cache_stats_evict(unsigned src, starpu_data_handle_t data_handle)
+{
+	size_t size;
+
+	if (stats_enabled == 0)
+		return;
+
+	size = starpu_data_get_size(data_handle);
+	nb_evictions++;
+	evicted_size += size;
+	_STARPU_MPI_MSG("[communication cache] evicting %10ld from %u\n", (long)size, src);
+}
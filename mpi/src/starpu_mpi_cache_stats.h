@@ -36,6 +36,14 @@ void _starpu_mpi_cache_stats_update(unsigned dst, starpu_data_handle_t data_hand
 #define _starpu_mpi_cache_stats_inc(dst, data_handle) _starpu_mpi_cache_stats_update(dst, data_handle, +1)
 #define _starpu_mpi_cache_stats_dec(dst, data_handle) _starpu_mpi_cache_stats_update(dst, data_handle, -1)
 
+/** Record an access to the copy received from \p src, which was cached if \p hit */
+void _starpu_mpi_cache_stats_access(unsigned src, starpu_data_handle_t data_handle, int hit);
+#define _starpu_mpi_cache_stats_hit(src, data_handle) _starpu_mpi_cache_stats_access(src, data_handle, 1)
+#define _starpu_mpi_cache_stats_miss(src, data_handle) _starpu_mpi_cache_stats_access(src, data_handle, 0)
+
+/** Record that the copy received from \p src was evicted to stay within STARPU_MPI_CACHE_MAX_SIZE */
+void _starpu_mpi_cache_stats_evict(unsigned src, starpu_data_handle_t data_handle);
+
 #ifdef __cplusplus
 }
 #endif
@@ -397,6 +397,177 @@ void _starpu_mpi_datatype_allocate(starpu_data_handle_t data_handle, struct _sta
 #endif
 }
 
+/*
+ *	Chunks
+ */
+
+/* Get the shape of the predefined interfaces which are sent with a
+ * registered datatype, so that their data can be split along the outermost
+ * dimension. Return the number of dimensions, or 0 if the data cannot be split */
+static int _starpu_mpi_datatype_get_shape(starpu_data_handle_t data_handle, unsigned node, size_t *local_layers, size_t *local_steps, size_t **layers, size_t **steps, size_t *elemsize)
+{
+	enum starpu_data_interface_id id = starpu_data_get_interface_id(data_handle);
+
+	if (id >= STARPU_MAX_INTERFACE_ID || !handle_to_datatype_funcs[id])
+		return 0;
+
+	*layers = local_layers;
+	*steps = local_steps;
+	switch (id)
+	{
+		case STARPU_MATRIX_INTERFACE_ID:
+		{
+			struct starpu_matrix_interface *matrix_interface = starpu_data_get_interface_on_node(data_handle, node);
+			local_layers[0] = STARPU_MATRIX_GET_NX(matrix_interface);
+			local_layers[1] = STARPU_MATRIX_GET_NY(matrix_interface);
+			local_steps[0] = 1;
+			local_steps[1] = STARPU_MATRIX_GET_LD(matrix_interface);
+			*elemsize = STARPU_MATRIX_GET_ELEMSIZE(matrix_interface);
+			return 2;
+		}
+		case STARPU_BLOCK_INTERFACE_ID:
+		{
+			struct starpu_block_interface *block_interface = starpu_data_get_interface_on_node(data_handle, node);
+			local_layers[0] = STARPU_BLOCK_GET_NX(block_interface);
+			local_layers[1] = STARPU_BLOCK_GET_NY(block_interface);
+			local_layers[2] = STARPU_BLOCK_GET_NZ(block_interface);
+			local_steps[0] = 1;
+			local_steps[1] = STARPU_BLOCK_GET_LDY(block_interface);
+			local_steps[2] = STARPU_BLOCK_GET_LDZ(block_interface);
+			*elemsize = STARPU_BLOCK_GET_ELEMSIZE(block_interface);
+			return 3;
+		}
+		case STARPU_TENSOR_INTERFACE_ID:
+		{
+			struct starpu_tensor_interface *tensor_interface = starpu_data_get_interface_on_node(data_handle, node);
+			local_layers[0] = STARPU_TENSOR_GET_NX(tensor_interface);
+			local_layers[1] = STARPU_TENSOR_GET_NY(tensor_interface);
+			local_layers[2] = STARPU_TENSOR_GET_NZ(tensor_interface);
+			local_layers[3] = STARPU_TENSOR_GET_NT(tensor_interface);
+			local_steps[0] = 1;
+			local_steps[1] = STARPU_TENSOR_GET_LDY(tensor_interface);
+			local_steps[2] = STARPU_TENSOR_GET_LDZ(tensor_interface);
+			local_steps[3] = STARPU_TENSOR_GET_LDT(tensor_interface);
+			*elemsize = STARPU_TENSOR_GET_ELEMSIZE(tensor_interface);
+			return 4;
+		}
+		case STARPU_NDIM_INTERFACE_ID:
+		{
+			struct starpu_ndim_interface *ndim_interface = starpu_data_get_interface_on_node(data_handle, node);
+			*layers = STARPU_NDIM_GET_NN(ndim_interface);
+			*steps = STARPU_NDIM_GET_LDN(ndim_interface);
+			*elemsize = STARPU_NDIM_GET_ELEMSIZE(ndim_interface);
+			return STARPU_NDIM_GET_NDIM(ndim_interface);
+		}
+		case STARPU_VECTOR_INTERFACE_ID:
+		{
+			struct starpu_vector_interface *vector_interface = starpu_data_get_interface_on_node(data_handle, node);
+			local_layers[0] = STARPU_VECTOR_GET_NX(vector_interface);
+			local_steps[0] = 1;
+			*elemsize = STARPU_VECTOR_GET_ELEMSIZE(vector_interface);
+			return 1;
+		}
+		default:
+			return 0;
+	}
+}
+
+/* Size of the slices of the outermost dimension */
+static size_t _starpu_mpi_datatype_slice_size(size_t *layers, int nb_dims, size_t elemsize)
+{
+	size_t slice_size = elemsize;
+	int dim;
+	for (dim = 0; dim < nb_dims-1; dim++)
+		slice_size *= layers[dim];
+	return slice_size;
+}
+
+size_t _starpu_mpi_datatype_chunk_size(starpu_data_handle_t data_handle, unsigned node, size_t max_chunk_size)
+{
+	size_t local_layers[4], local_steps[4];
+	size_t *layers, *steps;
+	size_t elemsize, slice_size, nb_slices;
+
+	int nb_dims = _starpu_mpi_datatype_get_shape(data_handle, node, local_layers, local_steps, &layers, &steps, &elemsize);
+	if (nb_dims == 0)
+		return 0;
+
+	slice_size = _starpu_mpi_datatype_slice_size(layers, nb_dims, elemsize);
+	if (slice_size == 0)
+		return 0;
+
+	nb_slices = max_chunk_size / slice_size;
+	if (nb_slices == 0)
+		nb_slices = 1;
+	if (nb_slices >= layers[nb_dims-1])
+		/* Everything fits in a single chunk */
+		return 0;
+	return nb_slices * slice_size;
+}
+
+int _starpu_mpi_datatype_chunk_allocate(starpu_data_handle_t data_handle, unsigned node, size_t chunk_size, MPI_Datatype **datatypes, MPI_Aint **displacements)
+{
+	size_t local_layers[4], local_steps[4];
+	size_t *layers, *steps;
+	size_t elemsize, slice_size, nb_slices, slices_per_chunk, first;
+	MPI_Datatype slice_datatype;
+	int nb_dims, nb_chunks, dim, i, ret;
+
+	nb_dims = _starpu_mpi_datatype_get_shape(data_handle, node, local_layers, local_steps, &layers, &steps, &elemsize);
+	if (nb_dims == 0)
+		return 0;
+	slice_size = _starpu_mpi_datatype_slice_size(layers, nb_dims, elemsize);
+	if (slice_size == 0 || chunk_size % slice_size != 0)
+		return 0;
+
+	nb_slices = layers[nb_dims-1];
+	slices_per_chunk = chunk_size / slice_size;
+	nb_chunks = (nb_slices + slices_per_chunk - 1) / slices_per_chunk;
+	_STARPU_MPI_DEBUG(1200, "splitting data with %d dimensions in %d chunks of %zu slices of size %zu\n", nb_dims, nb_chunks, slices_per_chunk, slice_size);
+
+	/* The datatype of a slice is the datatype of the data without its outermost dimension */
+	ret = MPI_Type_contiguous(nb_dims == 1 ? elemsize : layers[0]*elemsize, MPI_BYTE, &slice_datatype);
+	STARPU_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Type_contiguous failed");
+	for (dim = 1; dim < nb_dims-1; dim++)
+	{
+		MPI_Datatype layer_datatype;
+		ret = MPI_Type_create_hvector(layers[dim], 1, steps[dim]*elemsize, slice_datatype, &layer_datatype);
+		STARPU_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Type_hvector failed");
+		ret = MPI_Type_free(&slice_datatype);
+		STARPU_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Type_free failed");
+		slice_datatype = layer_datatype;
+	}
+
+	_STARPU_MPI_MALLOC(*datatypes, nb_chunks * sizeof(MPI_Datatype));
+	_STARPU_MPI_MALLOC(*displacements, nb_chunks * sizeof(MPI_Aint));
+	for (i = 0, first = 0; i < nb_chunks; i++, first += slices_per_chunk)
+	{
+		size_t nb = STARPU_MIN(slices_per_chunk, nb_slices - first);
+		ret = MPI_Type_create_hvector(nb, 1, steps[nb_dims-1]*elemsize, slice_datatype, &(*datatypes)[i]);
+		STARPU_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Type_hvector failed");
+		ret = MPI_Type_commit(&(*datatypes)[i]);
+		STARPU_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Type_commit failed");
+		(*displacements)[i] = first * steps[nb_dims-1] * elemsize;
+	}
+
+	ret = MPI_Type_free(&slice_datatype);
+	STARPU_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Type_free failed");
+
+	return nb_chunks;
+}
+
+void _starpu_mpi_datatype_chunk_free(int nb_chunks, MPI_Datatype *datatypes, MPI_Aint *displacements)
+{
+	int i;
+	for (i = 0; i < nb_chunks; i++)
+	{
+		int ret = MPI_Type_free(&datatypes[i]);
+		STARPU_ASSERT_MSG(ret == MPI_SUCCESS, "MPI_Type_free failed");
+	}
+	free(datatypes);
+	free(displacements);
+}
+
 static void _starpu_mpi_handle_free_simple_datatype(MPI_Datatype *datatype)
 {
 	int ret = MPI_Type_free(datatype);
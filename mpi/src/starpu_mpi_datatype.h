@@ -35,6 +35,23 @@ void _starpu_mpi_datatype_free(starpu_data_handle_t data_handle, MPI_Datatype *d
 
 MPI_Datatype _starpu_mpi_datatype_get_user_defined_datatype(starpu_data_handle_t data_handle, unsigned node);
 
+/**
+   Return the size in bytes of the chunks, at most \p max_chunk_size but
+   holding at least one slice of the outermost dimension, in which the data
+   of \p data_handle on \p node can be split to be sent with several
+   messages, or 0 if it cannot be split or fits in a single chunk.
+*/
+size_t _starpu_mpi_datatype_chunk_size(starpu_data_handle_t data_handle, unsigned node, size_t max_chunk_size);
+
+/**
+   Allocate the datatypes of the chunks of \p chunk_size bytes of the data
+   of \p data_handle on \p node, along with their displacement from the
+   pointer of the data. Return the number of chunks, or 0 if the data
+   cannot be split in chunks of that size.
+*/
+int _starpu_mpi_datatype_chunk_allocate(starpu_data_handle_t data_handle, unsigned node, size_t chunk_size, MPI_Datatype **datatypes, MPI_Aint **displacements);
+void _starpu_mpi_datatype_chunk_free(int nb_chunks, MPI_Datatype *datatypes, MPI_Aint *displacements);
+
 #ifdef __cplusplus
 }
 #endif
@@ -212,6 +212,9 @@ struct _starpu_mpi_coop_sends
 	long pre_sync_jobid;
 };
 
+struct _starpu_mpi_cache_lru;
+struct _starpu_mpi_select_node_copy;
+
 /** Initialized in starpu_mpi_data_register_comm */
 struct _starpu_mpi_data
 {
@@ -219,6 +222,9 @@ struct _starpu_mpi_data
 	struct _starpu_mpi_node_tag node_tag;
 	char *cache_sent;
 	unsigned int cache_received;
+	/** Position of the cached copies in the LRU lists of the nodes they
+	  * were exchanged with, when the size of the cache is bounded */
+	struct _starpu_mpi_cache_lru *cache_lru;
 	unsigned int ft_induced_cache_received:1;
 	unsigned int ft_induced_cache_received_count:1;
 	unsigned int modified:1; // Whether the data has been modified since the registration.
@@ -235,6 +241,10 @@ struct _starpu_mpi_data
 
 	/** When provided, wait the given number of sends to start a coop, instead of just waiting that data are ready */
 	unsigned nb_future_sends;
+
+	/** Cached copies of the data which all nodes know other nodes to hold,
+	  * for the min_cost node selection policy */
+	struct _starpu_mpi_select_node_copy **select_node_copies;
 };
 
 struct _starpu_mpi_data *_starpu_mpi_data_get(starpu_data_handle_t data_handle);
@@ -309,10 +319,8 @@ void _starpu_mpi_release_req_data(struct _starpu_mpi_req *req);
 
 void _starpu_mpi_isend_irecv_common(struct _starpu_mpi_req *req, enum starpu_data_access_mode mode, int sequential_consistency);
 
-#if 0
-/** Build a communication tree. Called before _starpu_mpi_coop_send is ever called. coop_sends->lock is held. */
+/** Build a communication tree. Called once coop_sends->reqs_array is sorted by priority, before _starpu_mpi_submit_coop_sends is ever called. coop_sends->lock is held. */
 void _starpu_mpi_coop_sends_build_tree(struct _starpu_mpi_coop_sends *coop_sends);
-#endif
 /** Try to merge with send request with other send requests */
 void _starpu_mpi_coop_send(starpu_data_handle_t data_handle, struct _starpu_mpi_req *req, enum starpu_data_access_mode mode, int sequential_consistency);
 
@@ -22,6 +22,7 @@
 #include <starpu_data.h>
 #include <starpu_mpi_private.h>
 #include <starpu_mpi_select_node.h>
+#include <starpu_mpi_cache.h>
 #include <datawizard/coherency.h>
 
 static int _current_policy = STARPU_MPI_NODE_SELECTION_MOST_R_DATA;
@@ -30,13 +31,202 @@ static starpu_mpi_select_node_policy_func_t _policies[_STARPU_MPI_NODE_SELECTION
 
 int _starpu_mpi_select_node_with_most_data(int me, int nb_nodes, struct starpu_data_descr *descr, int nb_data);
 
+/*
+ * State of the min_cost policy. Since all nodes run the policy on their own,
+ * it must only depend on what all nodes know, i.e. the sequence of submitted
+ * tasks: each node thus replays the caching decisions of the others.
+ */
+
+/** Whether the min_cost policy was registered, and the state has to be maintained */
+static int _min_cost_enabled;
+static starpu_pthread_mutex_t _min_cost_mutex = STARPU_PTHREAD_MUTEX_INITIALIZER;
+/** Network model, the bandwidth is in MB/s, i.e. bytes per us, and the latency in us */
+static double _min_cost_bandwidth;
+static double _min_cost_latency;
+/** Cost in us of each task among the recent ones that were given to a node */
+static double _min_cost_task_cost;
+/** Ring of the nodes which were given the last submitted tasks */
+static int *_min_cost_window;
+static unsigned _min_cost_window_size;
+static unsigned _min_cost_window_pos;
+/** Number of tasks in the ring which were given to each node */
+static unsigned *_min_cost_load;
+static int _min_cost_nb_nodes;
+
+/** A copy which a node keeps of the data of another node */
+LIST_TYPE(_starpu_mpi_select_node_copy,
+	starpu_data_handle_t data;
+	int node;
+	int owner;
+	size_t size;
+	unsigned long task;
+);
+
+/** When the size of the cache is bounded, the cached copies are evicted in
+ * the same order as starpu_mpi_cache.c does, but on all nodes: for each node,
+ * the copies of the data of each other node, least recently used first */
+static size_t _min_cost_max_size;
+static struct _starpu_mpi_select_node_copy_list **_min_cost_lru;
+static size_t **_min_cost_lru_size;
+/** Number of tasks submitted so far, the copies used by the last one can not
+ * be evicted */
+static unsigned long _min_cost_task;
+
+static void _starpu_mpi_select_node_min_cost_init(void)
+{
+	_min_cost_bandwidth = starpu_getenv_float_default("STARPU_MPI_SELECT_NODE_BANDWIDTH", 10000.);
+	_min_cost_latency = starpu_getenv_float_default("STARPU_MPI_SELECT_NODE_LATENCY", 2.);
+	_min_cost_task_cost = starpu_getenv_float_default("STARPU_MPI_SELECT_NODE_TASK_COST", 10.);
+	STARPU_ASSERT_MSG(_min_cost_bandwidth > 0., "STARPU_MPI_SELECT_NODE_BANDWIDTH must be positive");
+
+	starpu_mpi_comm_size(MPI_COMM_WORLD, &_min_cost_nb_nodes);
+	_min_cost_window_size = starpu_getenv_number_default("STARPU_MPI_SELECT_NODE_WINDOW", 16*_min_cost_nb_nodes);
+	if (_min_cost_window_size)
+	{
+		unsigned i;
+		_STARPU_MPI_MALLOC(_min_cost_window, _min_cost_window_size*sizeof(_min_cost_window[0]));
+		for (i = 0; i < _min_cost_window_size; i++)
+			_min_cost_window[i] = -1;
+	}
+	_min_cost_window_pos = 0;
+	_STARPU_MPI_CALLOC(_min_cost_load, _min_cost_nb_nodes, sizeof(_min_cost_load[0]));
+
+	_min_cost_max_size = _starpu_mpi_cache_get_max_size();
+	if (_min_cost_max_size)
+	{
+		_STARPU_MPI_CALLOC(_min_cost_lru, _min_cost_nb_nodes, sizeof(_min_cost_lru[0]));
+		_STARPU_MPI_CALLOC(_min_cost_lru_size, _min_cost_nb_nodes, sizeof(_min_cost_lru_size[0]));
+	}
+	_min_cost_task = 0;
+}
+
+// We suppose _min_cost_mutex is locked
+static void _starpu_mpi_select_node_copy_drop_locked(struct _starpu_mpi_data *mpi_data, int node)
+{
+	struct _starpu_mpi_select_node_copy *copy = mpi_data->select_node_copies[node];
+
+	if (!copy)
+		return;
+	if (_min_cost_lru)
+	{
+		_starpu_mpi_select_node_copy_list_erase(&_min_cost_lru[node][copy->owner], copy);
+		_min_cost_lru_size[node][copy->owner] -= copy->size;
+	}
+	mpi_data->select_node_copies[node] = NULL;
+	_starpu_mpi_select_node_copy_delete(copy);
+}
+
+// We suppose _min_cost_mutex is locked
+static void _starpu_mpi_select_node_copies_drop_locked(struct _starpu_mpi_data *mpi_data)
+{
+	int node;
+
+	for (node = 0; node < _min_cost_nb_nodes; node++)
+		_starpu_mpi_select_node_copy_drop_locked(mpi_data, node);
+}
+
+/* Node xrank receives data from its owner and keeps it in its cache, the way
+ * _starpu_mpi_cache_received_data_set does, and the owner records it the way
+ * _starpu_mpi_cache_sent_data_set does */
+// We suppose _min_cost_mutex is locked
+static void _starpu_mpi_select_node_copy_use_locked(starpu_data_handle_t data, int xrank, int owner)
+{
+	struct _starpu_mpi_data *mpi_data = data->mpi_data;
+	struct _starpu_mpi_select_node_copy *copy;
+
+	if (!mpi_data->select_node_copies)
+		_STARPU_MPI_CALLOC(mpi_data->select_node_copies, _min_cost_nb_nodes, sizeof(mpi_data->select_node_copies[0]));
+
+	copy = mpi_data->select_node_copies[xrank];
+	if (!copy)
+	{
+		copy = _starpu_mpi_select_node_copy_new();
+		copy->data = data;
+		copy->node = xrank;
+		copy->owner = owner;
+		copy->size = starpu_data_get_size(data);
+		mpi_data->select_node_copies[xrank] = copy;
+		if (_min_cost_lru)
+		{
+			if (!_min_cost_lru[xrank])
+			{
+				int i;
+				_STARPU_MPI_MALLOC(_min_cost_lru[xrank], _min_cost_nb_nodes * sizeof(_min_cost_lru[xrank][0]));
+				for (i = 0; i < _min_cost_nb_nodes; i++)
+					_starpu_mpi_select_node_copy_list_init(&_min_cost_lru[xrank][i]);
+				_STARPU_MPI_CALLOC(_min_cost_lru_size[xrank], _min_cost_nb_nodes, sizeof(_min_cost_lru_size[xrank][0]));
+			}
+			_starpu_mpi_select_node_copy_list_push_back(&_min_cost_lru[xrank][owner], copy);
+			_min_cost_lru_size[xrank][owner] += copy->size;
+		}
+	}
+	else if (_min_cost_lru)
+	{
+		_starpu_mpi_select_node_copy_list_erase(&_min_cost_lru[xrank][copy->owner], copy);
+		_starpu_mpi_select_node_copy_list_push_back(&_min_cost_lru[xrank][copy->owner], copy);
+	}
+	copy->task = _min_cost_task;
+
+	if (!_min_cost_lru)
+		return;
+
+	/* Same as _starpu_mpi_cache_lru_evict_received_nolock */
+	while (_min_cost_lru_size[xrank][owner] > _min_cost_max_size)
+	{
+		struct _starpu_mpi_select_node_copy *lru = _starpu_mpi_select_node_copy_list_front(&_min_cost_lru[xrank][owner]);
+
+		if (lru->task == _min_cost_task)
+			/* The others are more recent, thus used by this task too */
+			break;
+
+		_starpu_mpi_select_node_copy_drop_locked(lru->data->mpi_data, xrank);
+	}
+}
+
 void _starpu_mpi_select_node_init()
 {
 	int i;
+	char *policy;
 
 	_policies[STARPU_MPI_NODE_SELECTION_MOST_R_DATA] = _starpu_mpi_select_node_with_most_data;
 	for(i=_last_predefined_policy+1 ; i<_STARPU_MPI_NODE_SELECTION_MAX_POLICY ; i++)
 		_policies[i] = NULL;
+	_current_policy = STARPU_MPI_NODE_SELECTION_MOST_R_DATA;
+
+	_starpu_mpi_select_node_min_cost_init();
+
+	policy = starpu_getenv("STARPU_MPI_NODE_SELECTION_POLICY");
+	if (policy && strcmp(policy, "min_cost") == 0)
+		_current_policy = starpu_mpi_node_selection_register_policy(starpu_mpi_select_node_min_cost);
+	else if (policy && strcmp(policy, "most_r_data") != 0)
+		_STARPU_DISP("Warning: unknown node selection policy %s in STARPU_MPI_NODE_SELECTION_POLICY, using most_r_data\n", policy);
+}
+
+void _starpu_mpi_select_node_shutdown()
+{
+	int node;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&_min_cost_mutex);
+	_min_cost_enabled = 0;
+	free(_min_cost_window);
+	_min_cost_window = NULL;
+	free(_min_cost_load);
+	_min_cost_load = NULL;
+	if (_min_cost_lru)
+	{
+		/* The copies of the data which are still registered will be
+		 * freed along them */
+		for (node = 0; node < _min_cost_nb_nodes; node++)
+		{
+			free(_min_cost_lru[node]);
+			free(_min_cost_lru_size[node]);
+		}
+		free(_min_cost_lru);
+		_min_cost_lru = NULL;
+		free(_min_cost_lru_size);
+		_min_cost_lru_size = NULL;
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&_min_cost_mutex);
 }
 
 int starpu_mpi_node_selection_get_current_policy()
@@ -63,6 +253,9 @@ int starpu_mpi_node_selection_register_policy(starpu_mpi_select_node_policy_func
 	}
 	STARPU_ASSERT_MSG(i<_STARPU_MPI_NODE_SELECTION_MAX_POLICY, "No unused policy available. Unregister existing policies before registering a new one.");
 	_policies[i] = policy_func;
+	if (policy_func == starpu_mpi_select_node_min_cost)
+		/* Start replaying the caching decisions */
+		_min_cost_enabled = 1;
 	return i;
 }
 
@@ -116,6 +309,141 @@ int _starpu_mpi_select_node_with_most_data(int me, int nb_nodes, struct starpu_d
 	return xrank;
 }
 
+/* Estimated time in us to transfer the data to node, or back from it */
+static double _starpu_mpi_select_node_transfer_cost(size_t size)
+{
+	return _min_cost_latency + size / _min_cost_bandwidth;
+}
+
+int starpu_mpi_select_node_min_cost(int me, int nb_nodes, struct starpu_data_descr *descr, int nb_data)
+{
+	double *cost_on_nodes;
+	double min_cost;
+	int i, node;
+	int xrank = 0;
+
+	(void)me;
+	_STARPU_MPI_CALLOC(cost_on_nodes, nb_nodes, sizeof(double));
+
+	STARPU_PTHREAD_MUTEX_LOCK(&_min_cost_mutex);
+	for(i= 0 ; i<nb_data ; i++)
+	{
+		starpu_data_handle_t data = descr[i].handle;
+		enum starpu_data_access_mode mode = descr[i].mode;
+		struct _starpu_mpi_data *mpi_data = data->mpi_data;
+		int rank = starpu_data_get_rank(data);
+		double transfer;
+
+		if (rank == STARPU_MPI_PER_NODE)
+			/* Each of them has it */
+			continue;
+
+		transfer = _starpu_mpi_select_node_transfer_cost(data->ops->get_size(data));
+		for (node = 0; node < nb_nodes; node++)
+		{
+			if (node == rank)
+				continue;
+
+			if (mode & STARPU_R && !(mpi_data->select_node_copies && node < _min_cost_nb_nodes && mpi_data->select_node_copies[node]))
+				/* Would have to be received */
+				cost_on_nodes[node] += transfer;
+
+			if (mode & STARPU_W)
+				/* Would have to transfer it back */
+				cost_on_nodes[node] += transfer;
+		}
+	}
+
+	if (_min_cost_load)
+		for (node = 0; node < nb_nodes && node < _min_cost_nb_nodes; node++)
+			cost_on_nodes[node] += _min_cost_load[node] * _min_cost_task_cost;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&_min_cost_mutex);
+
+	min_cost = cost_on_nodes[0];
+	for(node=1 ; node<nb_nodes ; node++)
+	{
+		if (cost_on_nodes[node] < min_cost)
+		{
+			min_cost = cost_on_nodes[node];
+			xrank = node;
+		}
+	}
+
+	free(cost_on_nodes);
+	return xrank;
+}
+
+void _starpu_mpi_select_node_task_submitted(int xrank, struct starpu_data_descr *descr, int nb_data)
+{
+	int i;
+
+	if (!_min_cost_enabled || xrank < 0 || xrank >= _min_cost_nb_nodes)
+		return;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&_min_cost_mutex);
+	_min_cost_task++;
+	if (_min_cost_window_size)
+	{
+		int oldest = _min_cost_window[_min_cost_window_pos];
+		if (oldest >= 0)
+			_min_cost_load[oldest]--;
+		_min_cost_window[_min_cost_window_pos] = xrank;
+		_min_cost_load[xrank]++;
+		_min_cost_window_pos = (_min_cost_window_pos + 1) % _min_cost_window_size;
+	}
+
+	for(i= 0 ; i<nb_data ; i++)
+	{
+		starpu_data_handle_t data = descr[i].handle;
+		enum starpu_data_access_mode mode = descr[i].mode;
+		struct _starpu_mpi_data *mpi_data;
+		int rank;
+
+		if (!data || !data->mpi_data)
+			continue;
+		mpi_data = data->mpi_data;
+		rank = starpu_data_get_rank(data);
+
+		if ((mode & STARPU_W && !(mode & STARPU_MPI_REDUX)) || mode & STARPU_REDUX)
+		{
+			/* The copies get dropped from the caches, see _starpu_mpi_clear_data_after_execution */
+			if (mpi_data->select_node_copies)
+				_starpu_mpi_select_node_copies_drop_locked(mpi_data);
+		}
+		else if (mode & STARPU_R && !(mode & STARPU_MPI_REDUX) && _starpu_cache_enabled
+			 && rank != STARPU_MPI_PER_NODE && rank != xrank && rank >= 0 && rank < _min_cost_nb_nodes)
+			/* xrank receives the data and keeps it in its cache */
+			_starpu_mpi_select_node_copy_use_locked(data, xrank, rank);
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&_min_cost_mutex);
+}
+
+void _starpu_mpi_select_node_data_flush(starpu_data_handle_t data)
+{
+	struct _starpu_mpi_data *mpi_data = data->mpi_data;
+
+	if (!mpi_data->select_node_copies)
+		return;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&_min_cost_mutex);
+	_starpu_mpi_select_node_copies_drop_locked(mpi_data);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&_min_cost_mutex);
+}
+
+void _starpu_mpi_select_node_data_clear(starpu_data_handle_t data)
+{
+	struct _starpu_mpi_data *mpi_data = data->mpi_data;
+
+	if (!mpi_data->select_node_copies)
+		return;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&_min_cost_mutex);
+	_starpu_mpi_select_node_copies_drop_locked(mpi_data);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&_min_cost_mutex);
+	free(mpi_data->select_node_copies);
+	mpi_data->select_node_copies = NULL;
+}
+
 int _starpu_mpi_select_node(int me, int nb_nodes, struct starpu_data_descr *descr, int nb_data, int policy)
 {
 	int ppolicy = policy == STARPU_MPI_NODE_SELECTION_CURRENT_POLICY ? _current_policy : policy;
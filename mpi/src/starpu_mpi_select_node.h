@@ -29,8 +29,26 @@ extern "C"
 #define _STARPU_MPI_NODE_SELECTION_MAX_POLICY 24
 
 void _starpu_mpi_select_node_init();
+void _starpu_mpi_select_node_shutdown();
 int _starpu_mpi_select_node(int me, int nb_nodes, struct starpu_data_descr *descr, int nb_data, int policy);
 
+/**
+   Record that a task accessing \p descr was given to \p xrank, for the
+   policies which take the caching state and the load of the nodes into
+   account. This has to be called on all nodes.
+*/
+void _starpu_mpi_select_node_task_submitted(int xrank, struct starpu_data_descr *descr, int nb_data);
+
+/**
+   Record that the cached copies of \p data have been dropped
+*/
+void _starpu_mpi_select_node_data_flush(starpu_data_handle_t data);
+
+/**
+   Release the state kept about the cached copies of \p data
+*/
+void _starpu_mpi_select_node_data_clear(starpu_data_handle_t data);
+
 #ifdef __cplusplus
 }
 #endif
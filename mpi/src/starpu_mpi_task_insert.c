@@ -659,6 +659,7 @@ int _starpu_mpi_task_build_v(MPI_Comm comm, struct starpu_codelet *codelet, stru
 
 	_STARPU_TRACE_TASK_MPI_PRE_START();
 	/* Send and receive data as requested */
+	_starpu_mpi_cache_task_start();
 	for(i=0 ; i<nb_data ; i++)
 	{
                 if (descrs[i].handle && descrs[i].handle->mpi_data)
@@ -671,6 +672,7 @@ int _starpu_mpi_task_build_v(MPI_Comm comm, struct starpu_codelet *codelet, stru
 		}
 		_starpu_mpi_exchange_data_before_execution(descrs[i].handle, descrs[i].mode, me, xrank, do_execute, prio, comm);
 	}
+	_starpu_mpi_select_node_task_submitted(xrank, descrs, nb_data);
 
 	if (xrank_p)
 		*xrank_p = xrank;
@@ -953,6 +955,7 @@ int starpu_mpi_task_exchange_data_before_execution(MPI_Comm comm, struct starpu_
 		params->do_execute = (params->xrank == STARPU_MPI_PER_NODE) || (me == params->xrank);
 	}
 
+	_starpu_mpi_cache_task_start();
 	for(i=0 ; i<nb_data ; i++)
 	{
 		_starpu_mpi_exchange_data_before_execution(descrs[i].handle,
@@ -963,6 +966,7 @@ int starpu_mpi_task_exchange_data_before_execution(MPI_Comm comm, struct starpu_
 							   task->priority,
 							   comm);
 	}
+	_starpu_mpi_select_node_task_submitted(params->xrank, descrs, nb_data);
 
 	params->priority = task->priority;
 	return 0;
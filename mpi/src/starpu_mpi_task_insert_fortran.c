@@ -19,6 +19,7 @@
 #include <common/config.h>
 #include <starpu_mpi_private.h>
 #include <starpu_mpi_task_insert.h>
+#include <starpu_mpi_cache.h>
 #include <starpu_mpi_select_node.h>
 #include <util/starpu_task_insert_utils.h>
 #include <datawizard/coherency.h>
@@ -490,6 +491,7 @@ int _fstarpu_mpi_task_build_v(MPI_Comm comm, struct starpu_codelet *codelet, str
 
 	_STARPU_TRACE_TASK_MPI_PRE_START();
 	/* Send and receive data as requested */
+	_starpu_mpi_cache_task_start();
 	for(i=0 ; i<nb_data ; i++)
 	{
                 if (descrs[i].handle && descrs[i].handle->mpi_data)
@@ -502,6 +504,7 @@ int _fstarpu_mpi_task_build_v(MPI_Comm comm, struct starpu_codelet *codelet, str
 		}
 		_starpu_mpi_exchange_data_before_execution(descrs[i].handle, descrs[i].mode, me, xrank, do_execute, prio, comm);
 	}
+	_starpu_mpi_select_node_task_submitted(xrank, descrs, nb_data);
 
 	if (xrank_p)
 		*xrank_p = xrank;
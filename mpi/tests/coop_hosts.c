@@ -0,0 +1,150 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu_mpi.h>
+#include "helper.h"
+
+/*
+ * Broadcast a data with cooperative sends, pretending with
+ * STARPU_MPI_FAKE_HOST_SIZE that the nodes run by pairs on the same hosts,
+ * and check that node 0 sends the data only once per other host, the other
+ * nodes of the host getting it forwarded. Receives are posted either before
+ * or after the data arrives.
+ */
+
+#if !defined(STARPU_HAVE_SETENV)
+#warning setenv is not defined. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+#define NX	(256*1024)
+#define NROUNDS	4
+
+int main(int argc, char **argv)
+{
+	int ret, rank, size, host_size;
+	int mpi_init;
+	int round, i;
+	int result = 0;
+	float *vector;
+	size_t *comm_amount;
+	starpu_data_handle_t handle;
+
+	setenv("STARPU_MPI_FAKE_HOST_SIZE", "2", 0);
+	host_size = atoi(getenv("STARPU_MPI_FAKE_HOST_SIZE"));
+
+	MPI_INIT_THREAD(&argc, &argv, MPI_THREAD_SERIALIZED, &mpi_init);
+
+	ret = starpu_mpi_init_conf(&argc, &argv, mpi_init, MPI_COMM_WORLD, NULL);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_init_conf");
+
+	starpu_mpi_comm_rank(MPI_COMM_WORLD, &rank);
+	starpu_mpi_comm_size(MPI_COMM_WORLD, &size);
+
+	if (size < 3 || host_size <= 0 || !starpu_mpi_coop_sends_get_use())
+	{
+		if (rank == 0)
+			FPRINTF(stderr, "We need at least 3 processes, and cooperative sends.\n");
+
+		starpu_mpi_shutdown();
+		if (!mpi_init)
+			MPI_Finalize();
+		return rank == 0 ? STARPU_TEST_SKIPPED : 0;
+	}
+
+	starpu_mpi_comm_stats_enable();
+
+	vector = calloc(NX, sizeof(float));
+	starpu_vector_data_register(&handle, STARPU_MAIN_RAM, (uintptr_t) vector, NX, sizeof(float));
+	starpu_mpi_data_register(handle, 42, 0);
+
+	for (round = 0; round < NROUNDS; round++)
+	{
+		/* Let the data arrive before the receives are posted every other round */
+		int early = round % 2;
+
+		if (rank == 0)
+		{
+			starpu_data_acquire(handle, STARPU_W);
+			for (i = 0; i < NX; i++)
+				vector[i] = round * NX + i;
+			starpu_data_release(handle);
+
+			starpu_mpi_coop_sends_data_handle_nb_sends(handle, size-1);
+			for (i = 1; i < size; i++)
+			{
+				ret = starpu_mpi_isend_detached(handle, i, 42, MPI_COMM_WORLD, NULL, NULL);
+				STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_isend_detached");
+			}
+			if (early)
+				starpu_mpi_barrier(MPI_COMM_WORLD);
+		}
+		else
+		{
+			if (early)
+				starpu_mpi_barrier(MPI_COMM_WORLD);
+			ret = starpu_mpi_recv(handle, 0, 42, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_recv");
+
+			starpu_data_acquire(handle, STARPU_R);
+			for (i = 0; i < NX; i++)
+				if (vector[i] != round * NX + i)
+				{
+					FPRINTF_MPI(stderr, "Incorrect value %f instead of %f at %d in round %d\n", vector[i], (float) (round * NX + i), i, round);
+					result = 1;
+					break;
+				}
+			starpu_data_release(handle);
+		}
+		starpu_mpi_wait_for_all(MPI_COMM_WORLD);
+	}
+
+	starpu_data_unregister(handle);
+	free(vector);
+
+	comm_amount = calloc(size, sizeof(size_t));
+	starpu_mpi_comm_stats_retrieve(comm_amount);
+	if (rank == 0)
+	{
+		int host;
+		for (host = 0; host < size; host += host_size)
+		{
+			/* Each node of our host gets the data, but only one node of the other hosts */
+			size_t expected = (size_t) NROUNDS * NX * sizeof(float);
+			size_t sent = 0;
+			for (i = host; i < size && i < host + host_size; i++)
+				sent += comm_amount[i];
+			if (host == 0)
+				expected *= STARPU_MIN(host_size, size) - 1;
+			if (sent != expected)
+			{
+				FPRINTF_MPI(stderr, "Sent %zu bytes to the nodes of host %d instead of %zu\n", sent, host, expected);
+				result = 1;
+			}
+		}
+	}
+	free(comm_amount);
+
+	starpu_mpi_shutdown();
+	if (!mpi_init)
+		MPI_Finalize();
+
+	return result;
+}
+#endif
@@ -0,0 +1,166 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <starpu_mpi.h>
+#include "helper.h"
+
+/*
+ * Check that with a STARPU_MPI_CACHE_MAX_SIZE smaller than the inputs of a
+ * single task, the copies received for the task are not evicted before it
+ * reads them, and that both nodes still agree on what is cached.
+ */
+
+#if !defined(STARPU_HAVE_SETENV)
+#warning setenv is not defined. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+/* 1MiB per data */
+#define NB_ELEMENTS (1024*1024/sizeof(unsigned))
+#define NB_DATA     5
+/* Node 0 may keep 2 of the data of node 1, while each task reads 3 */
+#define MAX_CACHED  2
+#define NB_READ     3
+
+#ifdef STARPU_QUICK_CHECK
+#define NITER 4
+#else
+#define NITER 16
+#endif
+
+void func_cpu(void *descr[], void *_args)
+{
+	int expected[NB_READ];
+	int i;
+
+	starpu_codelet_unpack_args(_args, &expected);
+	for (i = 0; i < NB_READ; i++)
+	{
+		unsigned *v = (unsigned *)STARPU_VECTOR_GET_PTR(descr[i+1]);
+		unsigned nx = STARPU_VECTOR_GET_NX(descr[i+1]);
+		STARPU_ASSERT_MSG(v[0] == (unsigned) expected[i] && v[nx-1] == (unsigned) expected[i], "data %d was not available to the task\n", expected[i]);
+	}
+}
+
+struct starpu_codelet mycodelet =
+{
+	.cpu_funcs = {func_cpu},
+	.nbuffers = 1+NB_READ,
+	.modes = {STARPU_RW, STARPU_R, STARPU_R, STARPU_R},
+	.model = &starpu_perfmodel_nop,
+};
+
+static void read_data(starpu_data_handle_t *data_handles, int a, int b, int c)
+{
+	int expected[NB_READ] = { a, b, c };
+	int ret = starpu_mpi_task_insert(MPI_COMM_WORLD, &mycodelet,
+					 STARPU_VALUE, expected, sizeof(expected),
+					 STARPU_RW, data_handles[0],
+					 STARPU_R, data_handles[a], STARPU_R, data_handles[b], STARPU_R, data_handles[c], 0);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_task_insert");
+}
+
+int main(int argc, char **argv)
+{
+	int rank, size;
+	int i, ret;
+	int result = 1;
+	unsigned j;
+	char max_size[16];
+	unsigned *v[NB_DATA];
+	starpu_data_handle_t data_handles[NB_DATA];
+	struct starpu_conf conf;
+	size_t *comm_amount;
+
+	MPI_INIT_THREAD_real(&argc, &argv, MPI_THREAD_SERIALIZED);
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+	if (size < 2)
+	{
+		if (rank == 0)
+			FPRINTF(stderr, "We need at least 2 processes.\n");
+		MPI_Finalize();
+		return rank == 0 ? STARPU_TEST_SKIPPED : 0;
+	}
+
+	/* The budget is shared evenly among the other nodes */
+	snprintf(max_size, sizeof(max_size), "%d", MAX_CACHED * (size-1));
+	setenv("STARPU_MPI_CACHE_MAX_SIZE", max_size, 1);
+	setenv("STARPU_MPI_CACHE", "1", 1);
+	setenv("STARPU_MPI_STATS", "1", 1);
+
+	starpu_conf_init(&conf);
+	starpu_conf_noworker(&conf);
+	conf.ncpus = -1;
+	conf.nmpi_ms = -1;
+	conf.ntcpip_ms = -1;
+
+	ret = starpu_mpi_init_conf(NULL, NULL, 0, MPI_COMM_WORLD, &conf);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_init_conf");
+
+	for(i = 0; i < NB_DATA; i++)
+	{
+		/* Data 0 is written by node 0, the others are read from node 1 */
+		int mpi_rank = i == 0 ? 0 : 1;
+		v[i] = calloc(NB_ELEMENTS, sizeof(unsigned));
+		for (j = 0; j < NB_ELEMENTS; j++)
+			v[i][j] = i;
+		if (mpi_rank == rank)
+			starpu_vector_data_register(&data_handles[i], STARPU_MAIN_RAM, (uintptr_t)v[i], NB_ELEMENTS, sizeof(unsigned));
+		else
+			starpu_vector_data_register(&data_handles[i], -1, (uintptr_t)NULL, NB_ELEMENTS, sizeof(unsigned));
+		starpu_mpi_data_register(data_handles[i], i, mpi_rank);
+	}
+
+	/* Each task has to evict copies received for the previous one, but
+	 * none of its own */
+	for (i = 0; i < NITER; i++)
+	{
+		read_data(data_handles, 1, 2, 3);
+		read_data(data_handles, 4, 1, 2);
+	}
+	starpu_mpi_wait_for_all(MPI_COMM_WORLD);
+
+	for(i = 0; i < NB_DATA; i++)
+	{
+		starpu_data_unregister(data_handles[i]);
+		free(v[i]);
+	}
+
+	comm_amount = calloc(size, sizeof(size_t));
+	starpu_mpi_comm_stats_retrieve(comm_amount);
+	if (rank == 1)
+	{
+		/* The first two tasks receive all their data, then the
+		 * second task always misses 4, 1 and 2, while the first one
+		 * only misses 3 */
+		size_t expected = (6 + (NITER-1) * 4) * NB_ELEMENTS * sizeof(unsigned);
+		result = comm_amount[0] == expected;
+		FPRINTF(stderr, "[%d] Bounded communication cache is %sworking (sent: %ld, expected %ld)\n", rank, result?"":"NOT ", (long)comm_amount[0], (long)expected);
+	}
+	free(comm_amount);
+
+	starpu_mpi_shutdown();
+	MPI_Finalize();
+
+	return !result;
+}
+#endif
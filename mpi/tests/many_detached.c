@@ -0,0 +1,112 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu_mpi.h>
+#include "helper.h"
+
+/*
+ * Stress the progression thread with a large set of outstanding detached
+ * requests, and report how long it takes to complete them.
+ */
+
+#ifdef STARPU_QUICK_CHECK
+#  define NDATA	1024
+#elif !defined(STARPU_LONG_CHECK)
+#  define NDATA	4096
+#else
+#  define NDATA	32768
+#endif
+#define SIZE	4
+
+int main(int argc, char **argv)
+{
+	int ret, rank, size;
+	int mpi_init;
+	int i, j;
+
+	MPI_INIT_THREAD(&argc, &argv, MPI_THREAD_SERIALIZED, &mpi_init);
+
+	ret = starpu_mpi_init_conf(&argc, &argv, mpi_init, MPI_COMM_WORLD, NULL);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_init_conf");
+
+	starpu_mpi_comm_rank(MPI_COMM_WORLD, &rank);
+	starpu_mpi_comm_size(MPI_COMM_WORLD, &size);
+
+	if (size%2 != 0)
+	{
+		if (rank == 0)
+			FPRINTF(stderr, "We need a even number of processes.\n");
+
+		starpu_mpi_shutdown();
+		if (!mpi_init)
+			MPI_Finalize();
+		return rank == 0 ? STARPU_TEST_SKIPPED : 0;
+	}
+
+	int sender = rank%2 == 0;
+	int other_rank = sender ? rank+1 : rank-1;
+	float *tab = malloc(NDATA*SIZE*sizeof(float));
+	starpu_data_handle_t *handles = malloc(NDATA*sizeof(*handles));
+
+	for (i = 0; i < NDATA; i++)
+	{
+		for (j = 0; j < SIZE; j++)
+			tab[i*SIZE+j] = sender ? i*SIZE+j : -1.;
+		starpu_vector_data_register(&handles[i], STARPU_MAIN_RAM, (uintptr_t)&tab[i*SIZE], SIZE, sizeof(float));
+	}
+
+	starpu_mpi_barrier(MPI_COMM_WORLD);
+	double start = starpu_timing_now();
+
+	/* Post all requests at once, so that the progression thread has to
+	 * keep testing all of them */
+	for (i = 0; i < NDATA; i++)
+	{
+		if (sender)
+			ret = starpu_mpi_isend_detached(handles[i], other_rank, i, MPI_COMM_WORLD, NULL, NULL);
+		else
+			ret = starpu_mpi_irecv_detached(handles[i], other_rank, i, MPI_COMM_WORLD, NULL, NULL);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_i%s_detached", sender ? "send" : "recv");
+	}
+	starpu_mpi_wait_for_all(MPI_COMM_WORLD);
+
+	double end = starpu_timing_now();
+	FPRINTF_MPI(stderr, "%d detached %s completed in %.3f ms (%.3f us per request)\n", NDATA, sender ? "sends" : "receives", (end - start) / 1000., (end - start) / NDATA);
+
+	ret = 0;
+	for (i = 0; i < NDATA; i++)
+		starpu_data_unregister(handles[i]);
+	if (!sender)
+	{
+		for (i = 0; i < NDATA*SIZE; i++)
+			if (tab[i] != i)
+			{
+				FPRINTF_MPI(stderr, "Incorrect value %f at %d\n", tab[i], i);
+				ret = 1;
+				break;
+			}
+	}
+
+	free(handles);
+	free(tab);
+
+	starpu_mpi_shutdown();
+
+	if (!mpi_init)
+		MPI_Finalize();
+
+	return ret;
+}
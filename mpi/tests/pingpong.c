@@ -27,6 +27,7 @@
 #define DEFAULT_DATA_SIZE 16
 #define DEFAULT_SLEEP_TIME 0
 #define DEFAULT_METHOD 0 // ping pongs
+#define DEFAULT_BURST 1
 
 void usage()
 {
@@ -34,10 +35,58 @@ void usage()
 	fprintf(stderr, "-s [number of floats to exchange] (default: %d)\n", DEFAULT_DATA_SIZE);
 	fprintf(stderr, "-S [time in millisecond of sleep between exchange, less than 1 second] (default: %d)\n", DEFAULT_SLEEP_TIME);
 	fprintf(stderr, "-b : broadcasts instead of simple pair-wise ping-pongs (default: %s)\n", DEFAULT_METHOD ? "broadcast" : "ping pongs");
+	fprintf(stderr, "-B [number of vectors exchanged at each step, which StarPU-MPI may aggregate if they are small] (default: %d)\n", DEFAULT_BURST);
 }
 
 float *tab;
-starpu_data_handle_t tab_handle;
+starpu_data_handle_t *tab_handles;
+starpu_mpi_req *reqs;
+int data_size = DEFAULT_DATA_SIZE;
+int burst = DEFAULT_BURST;
+
+/* Send the burst of vectors, filled with values depending on step */
+static int send_burst(int dest, starpu_mpi_tag_t tag, int step)
+{
+	int b, i, ret;
+
+	for (i = 0; i < burst*data_size; i++)
+		tab[i] = step + i;
+	for (b = 0; b < burst; b++)
+	{
+		ret = starpu_mpi_isend(tab_handles[b], &reqs[b], dest, tag*burst + b, MPI_COMM_WORLD);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_isend");
+	}
+	for (b = 0; b < burst; b++)
+	{
+		ret = starpu_mpi_wait(&reqs[b], MPI_STATUS_IGNORE);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_wait");
+	}
+	return 0;
+}
+
+/* Receive the burst of vectors, and check their values */
+static int recv_burst(int source, starpu_mpi_tag_t tag, int step)
+{
+	int b, i, ret;
+
+	for (b = 0; b < burst; b++)
+	{
+		ret = starpu_mpi_irecv(tab_handles[b], &reqs[b], source, tag*burst + b, MPI_COMM_WORLD);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_irecv");
+	}
+	for (b = 0; b < burst; b++)
+	{
+		ret = starpu_mpi_wait(&reqs[b], MPI_STATUS_IGNORE);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_wait");
+	}
+	for (i = 0; i < burst*data_size; i++)
+		if (tab[i] != step + i)
+		{
+			FPRINTF_MPI(stderr, "Incorrect value %f at %d in step %d, expected %d\n", tab[i], i, step, step + i);
+			return 1;
+		}
+	return 0;
+}
 
 int main(int argc, char **argv)
 {
@@ -46,7 +95,6 @@ int main(int argc, char **argv)
 	int i;
 
 	int niter = DEFAULT_NITER;
-	int data_size = DEFAULT_DATA_SIZE;
 	int sleep_time = DEFAULT_SLEEP_TIME;
 	int method = DEFAULT_METHOD;
 
@@ -89,6 +137,17 @@ int main(int argc, char **argv)
 		{
 			method = 1; // broadcasts
 		}
+		else if(strcmp(argv[i], "-B") == 0)
+		{
+			burst = atoi(argv[i+1]);
+			if (burst <= 0)
+			{
+				fprintf(stderr, "%s: illegal argument %s\n", argv[0], argv[i]);
+				usage();
+				exit(0);
+			}
+			i++;
+		}
 		else
 		{
 			fprintf(stderr, "%s: illegal argument %s\n", argv[0], argv[i]);
@@ -121,6 +180,7 @@ int main(int argc, char **argv)
 	{
 		FPRINTF(stdout, "Number of iterations: %d\n", niter);
 		FPRINTF(stdout, "Number of floats to exchange: %d\n", data_size);
+		FPRINTF(stdout, "Number of vectors to exchange at each step: %d\n", burst);
 		FPRINTF(stdout, "Sleep time between exchanges: %d milliseconds\n", sleep_time);
 		if (method == 0)
 			FPRINTF(stdout, "Method: ping pongs\n");
@@ -128,15 +188,22 @@ int main(int argc, char **argv)
 			FPRINTF(stdout, "Method: broadcasts\n");
 	}
 
-	tab = calloc(data_size, sizeof(float));
+	tab = calloc(burst*data_size, sizeof(float));
+	tab_handles = malloc(burst*sizeof(*tab_handles));
+	reqs = malloc(burst*sizeof(*reqs));
 
-	starpu_vector_data_register(&tab_handle, STARPU_MAIN_RAM, (uintptr_t)tab, data_size, sizeof(float));
+	for (i = 0; i < burst; i++)
+		starpu_vector_data_register(&tab_handles[i], STARPU_MAIN_RAM, (uintptr_t)&tab[i*data_size], data_size, sizeof(float));
 
 	int loop;
 	int other_rank = rank%2 == 0 ? rank+1 : rank-1;
 	int sender;
 	int r;
 
+	starpu_mpi_barrier(MPI_COMM_WORLD);
+	double start = starpu_timing_now();
+	ret = 0;
+
 	if (method == 0) // ping pongs
 	{
 		for (loop = 0; loop < niter; loop++)
@@ -144,15 +211,12 @@ int main(int argc, char **argv)
 			if ((loop % 2) == (rank%2))
 			{
 				//FPRINTF_MPI(stderr, "Sending to %d\n", other_rank);
-				ret = starpu_mpi_send(tab_handle, other_rank, loop, MPI_COMM_WORLD);
-				STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_send");
+				ret |= send_burst(other_rank, loop, loop);
 			}
 			else
 			{
-				MPI_Status status;
 				//FPRINTF_MPI(stderr, "Receiving from %d\n", other_rank);
-				ret = starpu_mpi_recv(tab_handle, other_rank, loop, MPI_COMM_WORLD, &status);
-				STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_recv");
+				ret |= recv_burst(other_rank, loop, loop);
 			}
 
 			starpu_sleep(sleep_time / 1000);
@@ -169,17 +233,14 @@ int main(int argc, char **argv)
 				{
 					if (r != rank)
 					{
-						ret = starpu_mpi_send(tab_handle, r, (r * niter) + loop, MPI_COMM_WORLD);
-						STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_send");
+						ret |= send_burst(r, (r * niter) + loop, loop);
 						starpu_sleep(sleep_time / 1000);
 					}
 				}
 			}
 			else
 			{
-				MPI_Status status;
-				ret = starpu_mpi_recv(tab_handle, sender, (rank * niter) + loop, MPI_COMM_WORLD, &status);
-				STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_recv");
+				ret |= recv_burst(sender, (rank * niter) + loop, loop);
 
 				for (r = 0; r < (size-1); r++)
 					starpu_sleep(sleep_time / 1000);
@@ -187,12 +248,19 @@ int main(int argc, char **argv)
 		}
 	}
 
-	starpu_data_unregister(tab_handle);
+	double end = starpu_timing_now();
+	if (rank == 0)
+		FPRINTF(stdout, "Average time per step: %.3f us\n", (end - start) / niter);
+
+	for (i = 0; i < burst; i++)
+		starpu_data_unregister(tab_handles[i]);
+	free(reqs);
+	free(tab_handles);
 	free(tab);
 
 	starpu_mpi_shutdown();
 	if (!mpi_init)
 		MPI_Finalize();
 
-	return 0;
+	return ret;
 }
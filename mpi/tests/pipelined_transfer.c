@@ -0,0 +1,174 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu_mpi.h>
+#include "helper.h"
+
+/*
+ * Send a non-contiguous tensor in chunks with STARPU_MPI_PIPELINE_CHUNK_SIZE,
+ * either to a posted receive, or as early data received in a handle of the
+ * same shape or in raw memory.
+ */
+
+#if !defined(STARPU_HAVE_SETENV)
+#warning setenv is not defined. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+#define NX	64
+#define NY	16
+#define NZ	8
+#ifdef STARPU_QUICK_CHECK
+#  define NT	8
+#else
+#  define NT	32
+#endif
+/* Leave holes between the lines, planes and cubes */
+#define LDY	(NX+3)
+#define LDZ	(LDY*(NY+1))
+#define LDT	(LDZ*(NZ+2))
+
+#define CHUNK_SIZE	"65536"
+
+enum round
+{
+	POSTED_RECV,
+	EARLY_DATA,
+	EARLY_RAW_DATA,
+	NROUNDS
+};
+
+static const char *round_names[NROUNDS] = { "posted receive", "early data", "raw early data" };
+
+static float value(int round, int x, int y, int z, int t)
+{
+	return round * 1000000. + ((t * NZ + z) * NY + y) * NX + x;
+}
+
+static int check(float *tensor, int round)
+{
+	int x, y, z, t;
+	for (t = 0; t < NT; t++)
+		for (z = 0; z < NZ; z++)
+			for (y = 0; y < NY; y++)
+				for (x = 0; x < NX; x++)
+				{
+					float v = tensor[t*LDT + z*LDZ + y*LDY + x];
+					if (v != value(round, x, y, z, t))
+					{
+						FPRINTF_MPI(stderr, "Incorrect value %f instead of %f at (%d,%d,%d,%d) with %s\n", v, value(round, x, y, z, t), x, y, z, t, round_names[round]);
+						return 1;
+					}
+				}
+	return 0;
+}
+
+int main(int argc, char **argv)
+{
+	int ret, rank, size;
+	int mpi_init;
+	int round, x, y, z, t;
+	float *tensor;
+	starpu_data_handle_t handle;
+
+	/* Chunks of a few 3D layers of the tensor */
+	setenv("STARPU_MPI_PIPELINE_CHUNK_SIZE", CHUNK_SIZE, 0);
+
+	MPI_INIT_THREAD(&argc, &argv, MPI_THREAD_SERIALIZED, &mpi_init);
+
+	ret = starpu_mpi_init_conf(&argc, &argv, mpi_init, MPI_COMM_WORLD, NULL);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_init_conf");
+
+	starpu_mpi_comm_rank(MPI_COMM_WORLD, &rank);
+	starpu_mpi_comm_size(MPI_COMM_WORLD, &size);
+
+	if (size < 2)
+	{
+		if (rank == 0)
+			FPRINTF(stderr, "We need at least 2 processes.\n");
+
+		starpu_mpi_shutdown();
+		if (!mpi_init)
+			MPI_Finalize();
+		return rank == 0 ? STARPU_TEST_SKIPPED : 0;
+	}
+
+	ret = 0;
+	tensor = calloc(NT*LDT, sizeof(float));
+
+	for (round = 0; round < NROUNDS; round++)
+	{
+		double start, end;
+		int err;
+
+		for (t = 0; t < NT; t++)
+			for (z = 0; z < NZ; z++)
+				for (y = 0; y < NY; y++)
+					for (x = 0; x < NX; x++)
+						tensor[t*LDT + z*LDZ + y*LDY + x] = rank == 0 ? value(round, x, y, z, t) : -1.;
+
+		starpu_tensor_data_register(&handle, STARPU_MAIN_RAM, (uintptr_t)tensor, LDY, LDZ, LDT, NX, NY, NZ, NT, sizeof(float));
+		/* Without a registered tag, early data is received as raw memory */
+		if (round != EARLY_RAW_DATA)
+			starpu_mpi_data_register(handle, round, rank == 0 ? 0 : 1);
+
+		starpu_mpi_barrier(MPI_COMM_WORLD);
+		start = starpu_timing_now();
+
+		if (rank == 0)
+		{
+			err = starpu_mpi_isend_detached(handle, 1, round, MPI_COMM_WORLD, NULL, NULL);
+			STARPU_CHECK_RETURN_VALUE(err, "starpu_mpi_isend_detached");
+			if (round != POSTED_RECV)
+				starpu_mpi_barrier(MPI_COMM_WORLD);
+		}
+		else
+		{
+			if (round != POSTED_RECV)
+				/* Let the data arrive before the receive is posted */
+				starpu_mpi_barrier(MPI_COMM_WORLD);
+			if (rank == 1)
+			{
+				MPI_Status status;
+				err = starpu_mpi_recv(handle, 0, round, MPI_COMM_WORLD, &status);
+				STARPU_CHECK_RETURN_VALUE(err, "starpu_mpi_recv");
+			}
+		}
+		starpu_mpi_wait_for_all(MPI_COMM_WORLD);
+
+		end = starpu_timing_now();
+		starpu_data_unregister(handle);
+
+		if (rank == 1)
+		{
+			FPRINTF_MPI(stderr, "transfer with %s took %.3f ms\n", round_names[round], (end - start) / 1000.);
+			ret |= check(tensor, round);
+		}
+	}
+
+	free(tensor);
+
+	starpu_mpi_shutdown();
+
+	if (!mpi_init)
+		MPI_Finalize();
+
+	return ret;
+}
+#endif
@@ -0,0 +1,176 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <starpu_mpi.h>
+#include "helper.h"
+
+/*
+ * Check the nodes selected by the min_cost policy: a task reading a big data
+ * of node 0 and writing a small data of node 1 goes to node 1 while node 1
+ * holds a cached copy of the big data, and to node 0 once that copy was
+ * evicted from the bounded cache of node 1. All nodes have to agree.
+ */
+
+#if !defined(STARPU_HAVE_SETENV)
+#warning setenv is not defined. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+/* 1MiB per big data */
+#define NB_ELEMENTS (1024*1024/sizeof(unsigned))
+#define NB_BIG      3
+/* Node 1 may keep 2 of the big data of node 0 */
+#define MAX_CACHED  2
+
+void func_cpu(void *descr[], void *_args)
+{
+	(void)descr;
+	(void)_args;
+}
+
+struct starpu_codelet mycodelet =
+{
+	.cpu_funcs = {func_cpu},
+	.nbuffers = 2,
+	.modes = {STARPU_RW, STARPU_R},
+	.model = &starpu_perfmodel_nop,
+};
+
+static starpu_data_handle_t small_handle;
+static starpu_data_handle_t big_handles[NB_BIG];
+
+/* Make node 1 receive big data i and keep it in its cache */
+static void read_on_node_1(int i)
+{
+	int ret = starpu_mpi_task_insert(MPI_COMM_WORLD, &mycodelet,
+					 STARPU_RW, small_handle,
+					 STARPU_R, big_handles[i],
+					 STARPU_EXECUTE_ON_NODE, 1,
+					 0);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_task_insert");
+}
+
+/* Check the node selected for reading big data 0, and that all nodes agree */
+static int check_selected(int rank, int size, int expected)
+{
+	struct starpu_data_descr descr[2] =
+	{
+		{ .handle = small_handle, .mode = STARPU_RW },
+		{ .handle = big_handles[0], .mode = STARPU_R },
+	};
+	int xrank, min_xrank, max_xrank;
+
+	xrank = starpu_mpi_select_node_min_cost(rank, size, descr, 2);
+	MPI_Allreduce(&xrank, &min_xrank, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+	MPI_Allreduce(&xrank, &max_xrank, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+	FPRINTF(stderr, "[%d] selected node %d, expected %d\n", rank, xrank, expected);
+	return min_xrank == expected && max_xrank == expected;
+}
+
+int main(int argc, char **argv)
+{
+	int rank, size;
+	int i, ret;
+	int result = 1;
+	int policy;
+	char max_size[16];
+	unsigned small;
+	unsigned *big[NB_BIG];
+	struct starpu_conf conf;
+
+	MPI_INIT_THREAD_real(&argc, &argv, MPI_THREAD_SERIALIZED);
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+	if (size < 2)
+	{
+		if (rank == 0)
+			FPRINTF(stderr, "We need at least 2 processes.\n");
+		MPI_Finalize();
+		return rank == 0 ? STARPU_TEST_SKIPPED : 0;
+	}
+
+	/* The budget is shared evenly among the other nodes */
+	snprintf(max_size, sizeof(max_size), "%d", MAX_CACHED * (size-1));
+	setenv("STARPU_MPI_CACHE_MAX_SIZE", max_size, 1);
+	setenv("STARPU_MPI_CACHE", "1", 1);
+	/* Only consider the transfers */
+	setenv("STARPU_MPI_SELECT_NODE_TASK_COST", "0", 1);
+
+	starpu_conf_init(&conf);
+	starpu_conf_noworker(&conf);
+	conf.ncpus = -1;
+	conf.nmpi_ms = -1;
+	conf.ntcpip_ms = -1;
+
+	ret = starpu_mpi_init_conf(NULL, NULL, 0, MPI_COMM_WORLD, &conf);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_mpi_init_conf");
+
+	policy = starpu_mpi_node_selection_register_policy(starpu_mpi_select_node_min_cost);
+
+	small = 0;
+	if (rank == 1)
+		starpu_variable_data_register(&small_handle, STARPU_MAIN_RAM, (uintptr_t)&small, sizeof(small));
+	else
+		starpu_variable_data_register(&small_handle, -1, (uintptr_t)NULL, sizeof(small));
+	starpu_mpi_data_register(small_handle, 0, 1);
+
+	for(i = 0; i < NB_BIG; i++)
+	{
+		big[i] = calloc(NB_ELEMENTS, sizeof(unsigned));
+		if (rank == 0)
+			starpu_vector_data_register(&big_handles[i], STARPU_MAIN_RAM, (uintptr_t)big[i], NB_ELEMENTS, sizeof(unsigned));
+		else
+			starpu_vector_data_register(&big_handles[i], -1, (uintptr_t)NULL, NB_ELEMENTS, sizeof(unsigned));
+		starpu_mpi_data_register(big_handles[i], 1+i, 0);
+	}
+
+	/* Node 1 has to receive the big data */
+	result = result && check_selected(rank, size, 0);
+
+	/* Once it has it in its cache, it is cheaper to run there */
+	read_on_node_1(0);
+	read_on_node_1(1);
+	if (rank == 1)
+		result = result && starpu_mpi_cached_receive(big_handles[0]);
+	result = result && check_selected(rank, size, 1);
+
+	/* Until it gets evicted */
+	read_on_node_1(2);
+	if (rank == 1)
+		result = result && !starpu_mpi_cached_receive(big_handles[0]);
+	result = result && check_selected(rank, size, 0);
+
+	starpu_mpi_wait_for_all(MPI_COMM_WORLD);
+
+	starpu_data_unregister(small_handle);
+	for(i = 0; i < NB_BIG; i++)
+	{
+		starpu_data_unregister(big_handles[i]);
+		free(big[i]);
+	}
+
+	starpu_mpi_node_selection_unregister_policy(policy);
+	starpu_mpi_shutdown();
+	MPI_Finalize();
+
+	return !result;
+}
+#endif
@@ -137,18 +137,23 @@ int _starpu_barrier_counter_increment_until_full_counter(struct _starpu_barrier_
 	return ret;
 }
 
-int _starpu_barrier_counter_increment(struct _starpu_barrier_counter *barrier_c, double flops)
+int _starpu_barrier_counter_increment_n(struct _starpu_barrier_counter *barrier_c, unsigned n, double flops)
 {
 	struct _starpu_barrier *barrier = &barrier_c->barrier;
 	STARPU_PTHREAD_MUTEX_LOCK(&barrier->mutex);
 
-	barrier->reached_start++;
+	barrier->reached_start += n;
 	barrier->reached_flops += flops;
 	STARPU_PTHREAD_COND_BROADCAST(&barrier_c->cond2);
 	STARPU_PTHREAD_MUTEX_UNLOCK(&barrier->mutex);
 	return 0;
 }
 
+int _starpu_barrier_counter_increment(struct _starpu_barrier_counter *barrier_c, double flops)
+{
+	return _starpu_barrier_counter_increment_n(barrier_c, 1, flops);
+}
+
 int _starpu_barrier_counter_check(struct _starpu_barrier_counter *barrier_c)
 {
 	struct _starpu_barrier *barrier = &barrier_c->barrier;
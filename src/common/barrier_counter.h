@@ -50,6 +50,9 @@ int _starpu_barrier_counter_increment_until_full_counter(struct _starpu_barrier_
 
 int _starpu_barrier_counter_increment(struct _starpu_barrier_counter *barrier_c, double flops);
 
+/** Same as _starpu_barrier_counter_increment, but accounts \p n entries at once */
+int _starpu_barrier_counter_increment_n(struct _starpu_barrier_counter *barrier_c, unsigned n, double flops);
+
 int _starpu_barrier_counter_check(struct _starpu_barrier_counter *barrier_c);
 
 int _starpu_barrier_counter_get_reached_start(struct _starpu_barrier_counter *barrier_c);
@@ -399,17 +399,29 @@ static void _starpu_generate_paje_trace(char *input_fxt_filename, char *output_p
 		char *option = strtok(trace_options, " ");
 		while (option)
 		{
-			int ret = _starpu_generate_paje_trace_read_option(option, &options);
-			if (ret == 1)
-				_STARPU_MSG("Option <%s> is not a valid option for starpu_fxt_tool\n", option);
+			if (strcmp(option, "-only") == 0)
+			{
+				char *outputs = strtok(NULL, " ");
+				if (!outputs || _starpu_fxt_options_select_outputs(&options, outputs))
+					_STARPU_MSG("Option <%s> expects a list of outputs\n", option);
+			}
+			else
+			{
+				int ret = _starpu_generate_paje_trace_read_option(option, &options);
+				if (ret == 1)
+					_STARPU_MSG("Option <%s> is not a valid option for starpu_fxt_tool\n", option);
+			}
 			option = strtok(NULL, " ");
 		}
 	}
 
 	options.ninputfiles = 1;
 	options.filenames[0] = input_fxt_filename;
-	free(options.out_paje_path);
-	options.out_paje_path = strdup(output_paje_filename);
+	if (options.out_paje_path)
+	{
+		free(options.out_paje_path);
+		options.out_paje_path = strdup(output_paje_filename);
+	}
 	options.file_prefix = "";
 	options.file_rank = -1;
 	options.dir = dirname;
@@ -331,6 +331,9 @@ long _starpu_gettid(void) STARPU_ATTRIBUTE_VISIBILITY_DEFAULT;
 
 int _starpu_generate_paje_trace_read_option(const char *option, struct starpu_fxt_options *options) STARPU_ATTRIBUTE_VISIBILITY_DEFAULT;
 
+/** Only generate the outputs given as a comma-separated list, e.g. "tasks,paje" */
+int _starpu_fxt_options_select_outputs(struct starpu_fxt_options *options, const char *outputs) STARPU_ATTRIBUTE_VISIBILITY_DEFAULT;
+
 /** Initialize the FxT library. */
 void _starpu_fxt_init_profiling(uint64_t trace_buffer_size);
 
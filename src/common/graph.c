@@ -17,20 +17,61 @@
 /*
  * This stores the task graph structure, to used by the schedulers which need
  * it.  We do not always enable it since it is costly.  To avoid interfering
- * too much with execution, it may be a bit outdated, i.e. still contain jobs
- * which have completed very recently.
+ * too much with execution, it may be a bit outdated, i.e. not contain jobs
+ * which were submitted very recently, or still contain jobs which have
+ * completed very recently.
  *
- * This is because we drop nodes lazily: when a job terminates, we just add the
- * node to the dropped list (to avoid having to take the mutex on the whole
- * graph).  The graph gets updated whenever the graph mutex becomes available.
+ * This is because submitting and terminating jobs does not touch the graph:
+ * the addition of nodes and dependencies and the removal of nodes are only
+ * recorded in a per-thread buffer.  The buffers get flushed into the graph
+ * whenever the graph lock is taken for writing, or when a buffer gets full
+ * and the graph lock is available.
+ *
+ * A thread may record a dependency on a node whose job is concurrently
+ * terminating, so that the record may be flushed after the record dropping
+ * the node.  Dropped nodes are thus only freed at the flush following the one
+ * which found them dropped, by which time all the records mentioning them
+ * have been flushed.
  */
 
 #include <starpu.h>
 #include <core/jobs.h>
 #include <common/graph.h>
+#include <common/starpu_spinlock.h>
 #include <core/workers.h>
 
-/* Protects the whole task graph except the dropped list */
+/* Number of records after which a thread tries to flush its buffer */
+#define STARPU_GRAPH_FLUSH_RECORDS 256
+
+enum _starpu_graph_record_type
+{
+	_STARPU_GRAPH_ADD_JOB,
+	_STARPU_GRAPH_ADD_JOB_DEP,
+	_STARPU_GRAPH_DROP_JOB,
+};
+
+struct _starpu_graph_record
+{
+	enum _starpu_graph_record_type type;
+	struct _starpu_graph_node *node;
+	/* For _STARPU_GRAPH_ADD_JOB_DEP, the node that node depends on */
+	struct _starpu_graph_node *prev_node;
+};
+
+/* Records of a thread which were not flushed into the graph yet */
+struct _starpu_graph_buffer
+{
+	/* Only contended when the buffer is being flushed */
+	struct _starpu_spinlock lock;
+	struct _starpu_graph_record *records;
+	unsigned n_records;
+	unsigned alloc_records;
+	/* The thread has exited, the buffer can be freed once flushed */
+	int exited;
+	struct _starpu_graph_buffer *next;
+};
+
+/* Protects the whole task graph */
 static starpu_pthread_rwlock_t graph_lock;
 
 /* Whether we should enable recording the task graph */
@@ -43,64 +84,135 @@ static struct _starpu_graph_node_multilist_bottom bottom;
 /* This list contains all nodes */
 static struct _starpu_graph_node_multilist_all all;
 
-/* Protects the dropped list, always taken before graph lock */
-static starpu_pthread_mutex_t dropped_lock;
-/* This list contains all dropped nodes, i.e. the job terminated by the corresponding node is still int he graph */
+/* This list contains all nodes dropped during the previous flush, to be freed at the next flush */
 static struct _starpu_graph_node_multilist_dropped dropped;
 
+/* Whether depths were computed, and only need updating from the new_depth nodes */
+static int depths_valid;
+/* This list contains the nodes which were added or got a new incoming dependency since depths were computed */
+static struct _starpu_graph_node_multilist_new_depth new_depth;
+/* Whether descendants were computed, and only need updating from the new_descendants nodes */
+static int descendants_valid;
+/* This list contains the nodes which were added since descendants were computed */
+static struct _starpu_graph_node_multilist_new_descendants new_descendants;
+/* Identifier of the current graph traversal */
+static unsigned long graph_mark;
+
+/* Protects the list of buffers */
+static starpu_pthread_mutex_t buffers_lock;
+static struct _starpu_graph_buffer *buffers;
+static starpu_pthread_key_t buffer_key;
+
+static void _starpu_graph_flush(void);
+
+static void _starpu_graph_buffer_exit(void *arg)
+{
+	struct _starpu_graph_buffer *buffer = arg;
+	_starpu_spin_lock(&buffer->lock);
+	buffer->exited = 1;
+	_starpu_spin_unlock(&buffer->lock);
+}
+
 void _starpu_graph_init(void)
 {
 	STARPU_PTHREAD_RWLOCK_INIT(&graph_lock, NULL);
 	_starpu_graph_node_multilist_head_init_top(&top);
 	_starpu_graph_node_multilist_head_init_bottom(&bottom);
 	_starpu_graph_node_multilist_head_init_all(&all);
-	STARPU_PTHREAD_MUTEX_INIT(&dropped_lock, NULL);
 	_starpu_graph_node_multilist_head_init_dropped(&dropped);
+	_starpu_graph_node_multilist_head_init_new_depth(&new_depth);
+	_starpu_graph_node_multilist_head_init_new_descendants(&new_descendants);
+	depths_valid = 0;
+	descendants_valid = 0;
+	STARPU_PTHREAD_MUTEX_INIT(&buffers_lock, NULL);
+	buffers = NULL;
+	STARPU_PTHREAD_KEY_CREATE(&buffer_key, _starpu_graph_buffer_exit);
 }
 
-/* LockWR the graph lock */
-void _starpu_graph_wrlock(void)
+void _starpu_graph_deinit(void)
 {
-	starpu_worker_relax_on();
+	struct _starpu_graph_buffer *buffer, *next;
+
+	/* Apply the remaining records, and free the nodes they dropped */
 	STARPU_PTHREAD_RWLOCK_WRLOCK(&graph_lock);
-	starpu_worker_relax_off();
-}
+	_starpu_graph_flush();
+	_starpu_graph_flush();
+	STARPU_PTHREAD_RWLOCK_UNLOCK(&graph_lock);
 
-void _starpu_graph_drop_node(struct _starpu_graph_node *node);
+	STARPU_PTHREAD_KEY_DELETE(buffer_key);
+	for (buffer = buffers; buffer; buffer = next)
+	{
+		next = buffer->next;
+		_starpu_spin_destroy(&buffer->lock);
+		free(buffer->records);
+		free(buffer);
+	}
+	buffers = NULL;
+	STARPU_PTHREAD_MUTEX_DESTROY(&buffers_lock);
+	STARPU_PTHREAD_RWLOCK_DESTROY(&graph_lock);
+}
 
-/* This flushes the list of nodes to be dropped. Both the dropped_lock and
- * graph_lock mutexes have to be held on entry, and are released.  */
-void _starpu_graph_drop_dropped_nodes(void)
+/* Get the buffer of the current thread, locked */
+static struct _starpu_graph_buffer *_starpu_graph_buffer_lock(void)
 {
-	struct _starpu_graph_node_multilist_dropped dropping;
-
-	/* Pick up the list of dropped nodes */
-	_starpu_graph_node_multilist_move_dropped(&dropped, &dropping);
-	STARPU_PTHREAD_MUTEX_UNLOCK(&dropped_lock);
-
-	/* And now process it if it's not empty.  */
-	if (!_starpu_graph_node_multilist_empty_dropped(&dropping))
+	struct _starpu_graph_buffer *buffer = STARPU_PTHREAD_GETSPECIFIC(buffer_key);
+	if (STARPU_UNLIKELY(!buffer))
 	{
-		struct _starpu_graph_node *node, *next;
+		_STARPU_CALLOC(buffer, 1, sizeof(*buffer));
+		_starpu_spin_init(&buffer->lock);
+		STARPU_PTHREAD_MUTEX_LOCK(&buffers_lock);
+		buffer->next = buffers;
+		buffers = buffer;
+		STARPU_PTHREAD_MUTEX_UNLOCK(&buffers_lock);
+		STARPU_PTHREAD_SETSPECIFIC(buffer_key, buffer);
+	}
+	_starpu_spin_lock(&buffer->lock);
+	return buffer;
+}
 
-		for (node = _starpu_graph_node_multilist_begin_dropped(&dropping);
-		     node != _starpu_graph_node_multilist_end_dropped(&dropping);
-		     node = next)
-		{
-			next = _starpu_graph_node_multilist_next_dropped(node);
-			_starpu_graph_drop_node(node);
-		}
+/* Append a record to the locked buffer */
+static void _starpu_graph_buffer_push(struct _starpu_graph_buffer *buffer, enum _starpu_graph_record_type type, struct _starpu_graph_node *node, struct _starpu_graph_node *prev_node)
+{
+	struct _starpu_graph_record *record;
+	if (buffer->n_records == buffer->alloc_records)
+	{
+		if (buffer->alloc_records)
+			buffer->alloc_records *= 2;
+		else
+			buffer->alloc_records = STARPU_GRAPH_FLUSH_RECORDS;
+		_STARPU_REALLOC(buffer->records, buffer->alloc_records * sizeof(*buffer->records));
 	}
-	STARPU_PTHREAD_RWLOCK_UNLOCK(&graph_lock);
+	record = &buffer->records[buffer->n_records++];
+	record->type = type;
+	record->node = node;
+	record->prev_node = prev_node;
 }
 
-/* UnlockWR the graph lock */
-void _starpu_graph_wrunlock(void)
+/* Unlock the buffer, and flush it if it is getting full and nobody is using the graph */
+static void _starpu_graph_buffer_unlock(struct _starpu_graph_buffer *buffer)
+{
+	unsigned n_records = buffer->n_records;
+	_starpu_spin_unlock(&buffer->lock);
+	if (n_records >= STARPU_GRAPH_FLUSH_RECORDS && STARPU_PTHREAD_RWLOCK_TRYWRLOCK(&graph_lock) == 0)
+		_starpu_graph_wrunlock();
+}
+
+/* LockWR the graph lock */
+void _starpu_graph_wrlock(void)
 {
 	starpu_worker_relax_on();
-	STARPU_PTHREAD_MUTEX_LOCK(&dropped_lock);
+	STARPU_PTHREAD_RWLOCK_WRLOCK(&graph_lock);
 	starpu_worker_relax_off();
-	_starpu_graph_drop_dropped_nodes();
+	/* Bring the graph up to date */
+	_starpu_graph_flush();
+}
+
+/* UnlockWR the graph lock */
+void _starpu_graph_wrunlock(void)
+{
+	/* Take the opportunity to flush what was recorded meanwhile */
+	_starpu_graph_flush();
+	STARPU_PTHREAD_RWLOCK_UNLOCK(&graph_lock);
 }
 
 /* LockRD the graph lock */
@@ -117,7 +229,7 @@ void _starpu_graph_rdunlock(void)
 	STARPU_PTHREAD_RWLOCK_UNLOCK(&graph_lock);
 	/* Take the opportunity to try to take it WR */
 	if (STARPU_PTHREAD_RWLOCK_TRYWRLOCK(&graph_lock) == 0)
-		/* Good, flush dropped nodes */
+		/* Good, flush records */
 		_starpu_graph_wrunlock();
 }
 
@@ -134,20 +246,16 @@ static void __starpu_graph_foreach(void (*func)(void *data, struct _starpu_graph
 /* Add a node to the graph */
 void _starpu_graph_add_job(struct _starpu_job *job)
 {
+	struct _starpu_graph_buffer *buffer;
 	struct _starpu_graph_node *node;
 	_STARPU_CALLOC(node, 1, sizeof(*node));
 	node->job = job;
 	job->graph_node = node;
 	STARPU_PTHREAD_MUTEX_INIT0(&node->mutex, NULL);
 
-	_starpu_graph_wrlock();
-
-	/* It does not have any dependency yet, add to all lists */
-	_starpu_graph_node_multilist_push_back_top(&top, node);
-	_starpu_graph_node_multilist_push_back_bottom(&bottom, node);
-	_starpu_graph_node_multilist_push_back_all(&all, node);
-
-	_starpu_graph_wrunlock();
+	buffer = _starpu_graph_buffer_lock();
+	_starpu_graph_buffer_push(buffer, _STARPU_GRAPH_ADD_JOB, node, NULL);
+	_starpu_graph_buffer_unlock(buffer);
 }
 
 /* Add a node to an array of nodes */
@@ -174,16 +282,39 @@ static unsigned add_node(struct _starpu_graph_node *node, struct _starpu_graph_n
 /* Add a dependency between nodes */
 void _starpu_graph_add_job_dep(struct _starpu_job *job, struct _starpu_job *prev_job)
 {
-	unsigned rank_incoming, rank_outgoing;
-	_starpu_graph_wrlock();
+	/* Read the nodes with the buffer locked, so that if a job gets
+	 * dropped meanwhile, the flush which finds it dropped also finds this
+	 * record */
+	struct _starpu_graph_buffer *buffer = _starpu_graph_buffer_lock();
 	struct _starpu_graph_node *node = job->graph_node;
 	struct _starpu_graph_node *prev_node = prev_job->graph_node;
-	if (!node || !prev_node)
-	{
-		/* Already gone */
-		_starpu_graph_wrunlock();
-		return;
-	}
+	if (node && prev_node)
+		_starpu_graph_buffer_push(buffer, _STARPU_GRAPH_ADD_JOB_DEP, node, prev_node);
+	/* else already gone */
+	_starpu_graph_buffer_unlock(buffer);
+}
+
+/* Really add a node to the graph */
+static void _starpu_graph_insert_node(struct _starpu_graph_node *node)
+{
+	/* Its dependencies may have been flushed from other buffers already */
+	if (!node->total_incoming)
+		_starpu_graph_node_multilist_push_back_top(&top, node);
+	if (!node->n_outgoing)
+		_starpu_graph_node_multilist_push_back_bottom(&bottom, node);
+	_starpu_graph_node_multilist_push_back_all(&all, node);
+
+	if (depths_valid && !_starpu_graph_node_multilist_queued_new_depth(node))
+		_starpu_graph_node_multilist_push_back_new_depth(&new_depth, node);
+	if (descendants_valid)
+		_starpu_graph_node_multilist_push_back_new_descendants(&new_descendants, node);
+}
+
+/* Really add a dependency between nodes */
+static void _starpu_graph_insert_dep(struct _starpu_graph_node *node, struct _starpu_graph_node *prev_node)
+{
+	unsigned rank_incoming, rank_outgoing;
+	int inserted = _starpu_graph_node_multilist_queued_all(node);
 
 	if (_starpu_graph_node_multilist_queued_bottom(prev_node))
 		/* Previous node is not at bottom any more */
@@ -199,11 +330,16 @@ void _starpu_graph_add_job_dep(struct _starpu_job *job, struct _starpu_job *prev
 	prev_node->outgoing_slot[rank_outgoing] = rank_incoming;
 	node->incoming_slot[rank_incoming] = rank_outgoing;
 
-	_starpu_graph_wrunlock();
+	/* The ancestors of node may get deeper */
+	if (depths_valid && inserted && !_starpu_graph_node_multilist_queued_new_depth(node))
+		_starpu_graph_node_multilist_push_back_new_depth(&new_depth, node);
+	/* The ancestors of an old node may get more descendants than just the new nodes */
+	if (descendants_valid && inserted && !_starpu_graph_node_multilist_queued_new_descendants(node))
+		descendants_valid = 0;
 }
 
 /* Drop a node, and thus its dependencies */
-void _starpu_graph_drop_node(struct _starpu_graph_node *node)
+static void _starpu_graph_drop_node(struct _starpu_graph_node *node)
 {
 	unsigned i;
 	STARPU_ASSERT(!node->job);
@@ -214,6 +350,10 @@ void _starpu_graph_drop_node(struct _starpu_graph_node *node)
 		_starpu_graph_node_multilist_erase_top(&top, node);
 	if (_starpu_graph_node_multilist_queued_all(node))
 		_starpu_graph_node_multilist_erase_all(&all, node);
+	if (_starpu_graph_node_multilist_queued_new_depth(node))
+		_starpu_graph_node_multilist_erase_new_depth(&new_depth, node);
+	if (_starpu_graph_node_multilist_queued_new_descendants(node))
+		_starpu_graph_node_multilist_erase_new_descendants(&new_descendants, node);
 
 	/* Drop ourself from the incoming part of the outgoing nodes.  */
 	for (i = 0; i < node->n_outgoing; i++)
@@ -244,14 +384,77 @@ void _starpu_graph_drop_node(struct _starpu_graph_node *node)
 	free(node->incoming_slot);
 	node->incoming_slot = NULL;
 	node->alloc_incoming = 0;
+	STARPU_PTHREAD_MUTEX_DESTROY(&node->mutex);
 	free(node);
 }
 
+/* Apply the records of all threads to the graph, the graph lock has to be
+ * held for writing */
+static void _starpu_graph_flush(void)
+{
+	struct _starpu_graph_node_multilist_dropped dropping;
+	struct _starpu_graph_buffer *buffer, **prev;
+	struct _starpu_graph_node *node, *next;
+
+	/* Pick up the nodes found dropped during the previous flush */
+	_starpu_graph_node_multilist_move_dropped(&dropped, &dropping);
+
+	STARPU_PTHREAD_MUTEX_LOCK(&buffers_lock);
+	prev = &buffers;
+	while ((buffer = *prev))
+	{
+		unsigned i;
+		int exited;
+
+		_starpu_spin_lock(&buffer->lock);
+		for (i = 0; i < buffer->n_records; i++)
+		{
+			struct _starpu_graph_record *record = &buffer->records[i];
+			switch (record->type)
+			{
+				case _STARPU_GRAPH_ADD_JOB:
+					_starpu_graph_insert_node(record->node);
+					break;
+				case _STARPU_GRAPH_ADD_JOB_DEP:
+					_starpu_graph_insert_dep(record->node, record->prev_node);
+					break;
+				case _STARPU_GRAPH_DROP_JOB:
+					/* Other buffers may still mention it, free it at the next flush */
+					_starpu_graph_node_multilist_push_back_dropped(&dropped, record->node);
+					break;
+			}
+		}
+		buffer->n_records = 0;
+		exited = buffer->exited;
+		_starpu_spin_unlock(&buffer->lock);
+
+		if (exited)
+		{
+			*prev = buffer->next;
+			_starpu_spin_destroy(&buffer->lock);
+			free(buffer->records);
+			free(buffer);
+		}
+		else
+			prev = &buffer->next;
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&buffers_lock);
+
+	/* And now really drop the nodes */
+	for (node = _starpu_graph_node_multilist_begin_dropped(&dropping);
+	     node != _starpu_graph_node_multilist_end_dropped(&dropping);
+	     node = next)
+	{
+		next = _starpu_graph_node_multilist_next_dropped(node);
+		_starpu_graph_drop_node(node);
+	}
+}
+
 /* Drop a job */
 void _starpu_graph_drop_job(struct _starpu_job *job)
 {
+	struct _starpu_graph_buffer *buffer;
 	struct _starpu_graph_node *node = job->graph_node;
-	job->graph_node = NULL;
 	if (!node)
 		return;
 
@@ -262,18 +465,11 @@ void _starpu_graph_drop_job(struct _starpu_job *job)
 	node->job = NULL;
 	STARPU_PTHREAD_MUTEX_UNLOCK(&node->mutex);
 
-	starpu_worker_relax_on();
-	STARPU_PTHREAD_MUTEX_LOCK(&dropped_lock);
-	starpu_worker_relax_off();
-	/* Queue for removal when lock becomes available */
-	_starpu_graph_node_multilist_push_back_dropped(&dropped, node);
-	if (STARPU_PTHREAD_RWLOCK_TRYWRLOCK(&graph_lock) == 0)
-	{
-		/* Graph wrlock is available, drop nodes immediately */
-		_starpu_graph_drop_dropped_nodes();
-	}
-	else
-		STARPU_PTHREAD_MUTEX_UNLOCK(&dropped_lock);
+	buffer = _starpu_graph_buffer_lock();
+	job->graph_node = NULL;
+	/* Queue for removal when the graph gets flushed */
+	_starpu_graph_buffer_push(buffer, _STARPU_GRAPH_DROP_JOB, node, NULL);
+	_starpu_graph_buffer_unlock(buffer);
 }
 
 static void _starpu_graph_set_n(void *data, struct _starpu_graph_node *node)
@@ -347,12 +543,70 @@ static void compute_depth(struct _starpu_graph_node *next_node, struct _starpu_g
 		prev_node->depth = next_node->depth + 1;
 }
 
+/* Propagate the depth of the new_depth nodes to their ancestors */
+static void _starpu_graph_update_depths(void)
+{
+	struct _starpu_graph_node *node, *node2;
+	struct _starpu_graph_node **current_set = NULL, **next_set = NULL, **swap_set;
+	unsigned current_n, next_n, i, j;
+	unsigned current_alloc = 0, next_alloc = 0, swap_alloc;
+
+	current_n = 0;
+	while (!_starpu_graph_node_multilist_empty_new_depth(&new_depth))
+	{
+		node = _starpu_graph_node_multilist_pop_front_new_depth(&new_depth);
+		add_node(node, &current_set, &current_n, &current_alloc, NULL);
+	}
+
+	/* Propagate to top as long as depths increase */
+	while (current_n)
+	{
+		graph_mark++;
+		next_n = 0;
+
+		for (i = 0; i < current_n; i++)
+		{
+			node = current_set[i];
+			for (j = 0; j < node->n_incoming; j++)
+			{
+				node2 = node->incoming[j];
+				if (!node2 || node2->depth >= node->depth + 1)
+					continue;
+				node2->depth = node->depth + 1;
+				if (node2->mark != graph_mark)
+				{
+					node2->mark = graph_mark;
+					add_node(node2, &next_set, &next_n, &next_alloc, NULL);
+				}
+			}
+		}
+
+		swap_set = next_set;
+		swap_alloc = next_alloc;
+		next_set = current_set;
+		next_alloc = current_alloc;
+		current_set = swap_set;
+		current_alloc = swap_alloc;
+		current_n = next_n;
+	}
+	free(current_set);
+	free(next_set);
+}
+
 void _starpu_graph_compute_depths(void)
 {
 	struct _starpu_graph_node *node;
 
 	_starpu_graph_wrlock();
 
+	if (depths_valid)
+	{
+		/* Only the ancestors of the new nodes may have changed */
+		_starpu_graph_update_depths();
+		_starpu_graph_wrunlock();
+		return;
+	}
+
 	/* The bottom of the graph has depth 0 */
 	for (node = _starpu_graph_node_multilist_begin_bottom(&bottom);
 	     node != _starpu_graph_node_multilist_end_bottom(&bottom);
@@ -361,9 +615,61 @@ void _starpu_graph_compute_depths(void)
 
 	_starpu_graph_compute_bottom_up(compute_depth, NULL);
 
+	/* From now on, keep track of the new nodes */
+	while (!_starpu_graph_node_multilist_empty_new_depth(&new_depth))
+		(void) _starpu_graph_node_multilist_pop_front_new_depth(&new_depth);
+	depths_valid = 1;
+
 	_starpu_graph_wrunlock();
 }
 
+/* Count the new_descendants nodes in the descendants of their ancestors.
+ * This assumes that new nodes only have new descendants. */
+static void _starpu_graph_update_descendants(void)
+{
+	struct _starpu_graph_node *node, *node2, *node3;
+	struct _starpu_graph_node **current_set = NULL, **next_set = NULL, **swap_set;
+	unsigned current_n, next_n, i, j;
+	unsigned current_alloc = 0, next_alloc = 0, swap_alloc;
+
+	while (!_starpu_graph_node_multilist_empty_new_descendants(&new_descendants))
+	{
+		node = _starpu_graph_node_multilist_pop_front_new_descendants(&new_descendants);
+
+		/* Each ancestor gets one more descendant */
+		graph_mark++;
+		node->mark = graph_mark;
+		current_n = 0;
+		add_node(node, &current_set, &current_n, &current_alloc, NULL);
+		while (current_n)
+		{
+			next_n = 0;
+			for (i = 0; i < current_n; i++)
+			{
+				node2 = current_set[i];
+				for (j = 0; j < node2->n_incoming; j++)
+				{
+					node3 = node2->incoming[j];
+					if (!node3 || node3->mark == graph_mark)
+						continue;
+					node3->mark = graph_mark;
+					node3->descendants++;
+					add_node(node3, &next_set, &next_n, &next_alloc, NULL);
+				}
+			}
+			swap_set = next_set;
+			swap_alloc = next_alloc;
+			next_set = current_set;
+			next_alloc = current_alloc;
+			current_set = swap_set;
+			current_alloc = swap_alloc;
+			current_n = next_n;
+		}
+	}
+	free(current_set);
+	free(next_set);
+}
+
 void _starpu_graph_compute_descendants(void)
 {
 	struct _starpu_graph_node *node, *node2, *node3;
@@ -373,6 +679,14 @@ void _starpu_graph_compute_descendants(void)
 
 	_starpu_graph_wrlock();
 
+	if (descendants_valid)
+	{
+		/* Only the ancestors of the new nodes may have changed */
+		_starpu_graph_update_descendants();
+		_starpu_graph_wrunlock();
+		return;
+	}
+
 	/* Yes, this is O(|V|.(|V|+|E|)) */
 
 	/* We could get O(|V|.|E|) by doing a topological sort first.
@@ -435,12 +749,33 @@ void _starpu_graph_compute_descendants(void)
 		node->descendants = descendants;
 	}
 
+	/* From now on, keep track of the new nodes */
+	while (!_starpu_graph_node_multilist_empty_new_descendants(&new_descendants))
+		(void) _starpu_graph_node_multilist_pop_front_new_descendants(&new_descendants);
+	descendants_valid = 1;
+
 	_starpu_graph_wrunlock();
 
 	free(current_set);
 	free(next_set);
 }
 
+static void _starpu_graph_reset_analysis(void *data, struct _starpu_graph_node *node)
+{
+	(void)data;
+	node->depth = 0;
+	node->descendants = 0;
+}
+
+void _starpu_graph_invalidate_analysis(void)
+{
+	_starpu_graph_wrlock();
+	__starpu_graph_foreach(_starpu_graph_reset_analysis, NULL);
+	depths_valid = 0;
+	descendants_valid = 0;
+	_starpu_graph_wrunlock();
+}
+
 void _starpu_graph_foreach(void (*func)(void *data, struct _starpu_graph_node *node), void *data)
 {
 	_starpu_graph_wrlock();
@@ -32,6 +32,8 @@ MULTILIST_CREATE_TYPE(_starpu_graph_node, all)
 MULTILIST_CREATE_TYPE(_starpu_graph_node, top)
 MULTILIST_CREATE_TYPE(_starpu_graph_node, bottom)
 MULTILIST_CREATE_TYPE(_starpu_graph_node, dropped)
+MULTILIST_CREATE_TYPE(_starpu_graph_node, new_depth)
+MULTILIST_CREATE_TYPE(_starpu_graph_node, new_descendants)
 
 struct _starpu_graph_node
 {
@@ -51,6 +53,10 @@ struct _starpu_graph_node
 	struct _starpu_graph_node_multilist_all all;
 	/** Member of list of dropped jobs */
 	struct _starpu_graph_node_multilist_dropped dropped;
+	/** Member of list of jobs whose ancestors may need a depth update */
+	struct _starpu_graph_node_multilist_new_depth new_depth;
+	/** Member of list of jobs not yet counted in the descendants of their ancestors */
+	struct _starpu_graph_node_multilist_new_descendants new_descendants;
 
 	/** set of incoming dependencies */
 	/** May contain NULLs for terminated jobs */
@@ -85,48 +91,67 @@ struct _starpu_graph_node
 
 	/** Variable available for graph flow */
 	int graph_n;
+	/** Last traversal which visited this node, for incremental updates */
+	unsigned long mark;
 };
 
 MULTILIST_CREATE_INLINES(struct _starpu_graph_node, _starpu_graph_node, all)
 MULTILIST_CREATE_INLINES(struct _starpu_graph_node, _starpu_graph_node, top)
 MULTILIST_CREATE_INLINES(struct _starpu_graph_node, _starpu_graph_node, bottom)
 MULTILIST_CREATE_INLINES(struct _starpu_graph_node, _starpu_graph_node, dropped)
+MULTILIST_CREATE_INLINES(struct _starpu_graph_node, _starpu_graph_node, new_depth)
+MULTILIST_CREATE_INLINES(struct _starpu_graph_node, _starpu_graph_node, new_descendants)
 
-extern int _starpu_graph_record;
+extern int _starpu_graph_record STARPU_ATTRIBUTE_VISIBILITY_DEFAULT;
 void _starpu_graph_init(void);
+void _starpu_graph_deinit(void);
 void _starpu_graph_wrlock(void);
 void _starpu_graph_rdlock(void);
 void _starpu_graph_wrunlock(void);
 void _starpu_graph_rdunlock(void);
 
-/** Add a job to the graph, called before any _starpu_graph_add_job_dep call */
-void _starpu_graph_add_job(struct _starpu_job *job);
-
-/** Add a dependency between jobs */
-void _starpu_graph_add_job_dep(struct _starpu_job *job, struct _starpu_job *prev_job);
+/**
+ * Add a job to the graph, called before any _starpu_graph_add_job_dep call.
+ * This only records the job in a per-thread buffer, the graph itself gets
+ * updated the next time its lock is taken for writing.
+ */
+void _starpu_graph_add_job(struct _starpu_job *job) STARPU_ATTRIBUTE_VISIBILITY_DEFAULT;
 
-/** Remove a job from the graph */
-void _starpu_graph_drop_job(struct _starpu_job *job);
+/** Add a dependency between jobs, recorded like _starpu_graph_add_job */
+void _starpu_graph_add_job_dep(struct _starpu_job *job, struct _starpu_job *prev_job) STARPU_ATTRIBUTE_VISIBILITY_DEFAULT;
 
-/** Really drop the nodes from the graph now */
-void _starpu_graph_drop_dropped_nodes(void);
+/** Remove a job from the graph, recorded like _starpu_graph_add_job */
+void _starpu_graph_drop_job(struct _starpu_job *job) STARPU_ATTRIBUTE_VISIBILITY_DEFAULT;
 
 /**
  * This make StarPU compute for each task the depth, i.e. the length
  * of the longest path to a task without outgoing dependencies.
  * This does not take job duration into account, just the number
+ * Once computed, depths are only updated for the jobs added since the
+ * previous call and their ancestors.
 */
-void _starpu_graph_compute_depths(void);
+void _starpu_graph_compute_depths(void) STARPU_ATTRIBUTE_VISIBILITY_DEFAULT;
+
+/**
+ * Compute the descendants of jobs in the graph.
+ * Once computed, descendants are only updated for the jobs added since
+ * the previous call, as long as dependencies are only added to new jobs.
+ */
+void _starpu_graph_compute_descendants(void) STARPU_ATTRIBUTE_VISIBILITY_DEFAULT;
 
-/** Compute the descendants of jobs in the graph */
-void _starpu_graph_compute_descendants(void);
+/**
+ * Forget the depths and descendants computed so far, so that the next
+ * _starpu_graph_compute_depths and _starpu_graph_compute_descendants
+ * calls recompute them over the whole graph.
+ */
+void _starpu_graph_invalidate_analysis(void) STARPU_ATTRIBUTE_VISIBILITY_DEFAULT;
 
 /**
  * This calls \e func for each node of the task graph, passing also \e
  * data as it
  * Apply func on each job of the graph
 */
-void _starpu_graph_foreach(void (*func)(void *data, struct _starpu_graph_node *node), void *data);
+void _starpu_graph_foreach(void (*func)(void *data, struct _starpu_graph_node *node), void *data) STARPU_ATTRIBUTE_VISIBILITY_DEFAULT;
 
 /**
  * @brief Retrieves the graph node associated with a given StarPU task.
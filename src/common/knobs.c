@@ -23,6 +23,7 @@
 #include <common/starpu_spinlock.h>
 #include <core/workers.h>
 #include <common/knobs.h>
+#include <common/perf_counter_export.h>
 
 /* Performance Monitoring */
 struct perf_counter_array
@@ -83,6 +84,8 @@ void _starpu_perf_counter_init(struct _starpu_machine_config *pconfig)
 
 	/* call counter registration routines in each modules */
 	_starpu__task_c__register_counters();
+	_starpu__online_bound_c__register_counters();
+	_starpu__copy_driver_c__register_counters();
 }
 
 void _starpu_perf_counter_exit(void)
@@ -423,6 +426,7 @@ void starpu_perf_counter_set_per_codelet_listener(struct starpu_codelet *cl, str
 	_STARPU_MALLOC(cl->perf_counter_sample, sizeof(*cl->perf_counter_sample));
 	_starpu_perf_counter_sample_init(cl->perf_counter_sample, starpu_perf_counter_scope_per_codelet);
 	set_listener(cl->perf_counter_sample, listener);
+	_starpu_perf_counter_export_add_codelet(cl);
 }
 
 /* - */
@@ -463,6 +467,7 @@ void starpu_perf_counter_unset_all_per_worker_listeners(void)
 void starpu_perf_counter_unset_per_codelet_listener(struct starpu_codelet *cl)
 {
 	STARPU_ASSERT(cl->perf_counter_sample != NULL);
+	_starpu_perf_counter_export_remove_codelet(cl);
 	unset_listener(cl->perf_counter_sample);
 	_starpu_perf_counter_sample_exit(cl->perf_counter_sample);
 	free(cl->perf_counter_sample);
@@ -514,6 +519,20 @@ static void update_sample(struct starpu_perf_counter_sample *sample, void *conte
 	_starpu_spin_unlock(&sample->lock);
 }
 
+void _starpu_perf_counter_sample_snapshot(struct starpu_perf_counter_sample *sample, void *context)
+{
+	struct perf_counter_array *counters = _get_counters(sample->scope);
+	int upd_id;
+
+	STARPU_ASSERT(sample->listener != NULL && sample->listener->set != NULL);
+	_starpu_spin_lock(&sample->lock);
+	for (upd_id = 0; upd_id < counters->updater_array_size; upd_id++)
+	{
+		counters->updater_array[upd_id](sample, context);
+	}
+	_starpu_spin_unlock(&sample->lock);
+}
+
 void _starpu_perf_counter_update_global_sample(void)
 {
 	update_sample(&global_sample, NULL);
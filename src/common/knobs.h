@@ -240,6 +240,13 @@ void _starpu_perf_counter_unregister_all_scopes(void);
 
 void _starpu_perf_counter_register_updater(enum starpu_perf_counter_scope scope, void (*updater)(struct starpu_perf_counter_sample *sample, void *context));
 
+/**
+   Fill the values of \p sample selected by the set of its listener, by
+   calling the updaters of its scope with \p context, without notifying the
+   listener
+*/
+void _starpu_perf_counter_sample_snapshot(struct starpu_perf_counter_sample *sample, void *context);
+
 void _starpu_perf_counter_update_global_sample(void);
 void _starpu_perf_counter_update_per_worker_sample(unsigned workerid);
 void _starpu_perf_counter_update_per_codelet_sample(struct starpu_codelet *cl);
@@ -282,9 +289,12 @@ extern starpu_perf_counter_int64_t _starpu_task__g_peak_submitted__value;
 extern starpu_perf_counter_int64_t _starpu_task__g_current_submitted__value;
 extern starpu_perf_counter_int64_t _starpu_task__g_peak_ready__value;
 extern starpu_perf_counter_int64_t _starpu_task__g_current_ready__value;
+extern starpu_perf_counter_int64_t _starpu_data__g_total_transferred__value;
 
 /* performance counter registration routines per modules */
 void _starpu__task_c__register_counters(void);	/* module: task.c */
+void _starpu__online_bound_c__register_counters(void);	/* module: online_bound.c */
+void _starpu__copy_driver_c__register_counters(void);	/* module: copy_driver.c */
 
 
 /* -------------------------------------------------------------------- */
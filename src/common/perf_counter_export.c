@@ -0,0 +1,550 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+/*
+ * Export the performance counters in the Prometheus text format on a Unix
+ * socket.
+ *
+ * A dedicated thread waits for connections on the socket given by
+ * STARPU_PERF_COUNTER_EXPORT. On each connection, it snapshots the global,
+ * per-worker and per-codelet counters into its own samples by calling the
+ * counter updaters, and writes them to the client. Workers thus only pay
+ * for the counter updates themselves, and nothing is computed between two
+ * scrapes. If the client sends an HTTP GET request, the answer is preceded
+ * with an HTTP header, so that the socket can be scraped directly.
+ *
+ * Per-codelet counters are only maintained for the codelets which have a
+ * listener, see starpu_perf_counter_set_per_codelet_listener().
+ */
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <starpu.h>
+#include <common/config.h>
+#include <common/utils.h>
+#include <core/workers.h>
+#include <common/knobs.h>
+#include <common/perf_counter_export.h>
+
+#if !defined(STARPU_SIMGRID) && !defined(STARPU_HAVE_WINDOWS)
+#include <unistd.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#define STARPU_PERF_COUNTER_EXPORT_SUPPORTED
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+#ifndef MSG_DONTWAIT
+#define MSG_DONTWAIT 0
+#endif
+
+/* How long to wait for the request of a client, in ms */
+#define EXPORT_REQUEST_TIMEOUT 100
+/* How long to wait for a client to make room for the answer, in ms */
+#define EXPORT_SEND_TIMEOUT 1000
+
+struct export_codelet
+{
+	struct starpu_codelet *cl;
+	struct starpu_perf_counter_sample sample;
+	struct export_codelet *next;
+};
+
+struct export_buffer
+{
+	char *buf;
+	size_t size;
+	size_t len;
+};
+
+static int export_enabled;
+static char *export_path;
+static int export_fd = -1;
+static int export_stop_pipe[2] = { -1, -1 };
+static starpu_pthread_t export_thread;
+
+/* Protects the codelet list, and serializes it with the snapshots */
+static starpu_pthread_mutex_t export_mutex = STARPU_PTHREAD_MUTEX_INITIALIZER;
+static struct export_codelet *export_codelets;
+
+static struct starpu_perf_counter_set *global_set;
+static struct starpu_perf_counter_set *per_worker_set;
+static struct starpu_perf_counter_set *per_codelet_set;
+static struct starpu_perf_counter_listener *global_listener;
+static struct starpu_perf_counter_listener *per_worker_listener;
+static struct starpu_perf_counter_listener *per_codelet_listener;
+
+static struct starpu_perf_counter_sample global_sample;
+static unsigned nworkers;
+static struct starpu_perf_counter_sample *worker_samples;
+
+static struct export_buffer export_buffer;
+
+static void export_listener_exit(struct starpu_perf_counter_listener *listener, struct starpu_perf_counter_set *set)
+{
+	starpu_perf_counter_listener_exit(listener);
+	starpu_perf_counter_set_free(set);
+}
+
+static void export_sample_init(struct starpu_perf_counter_sample *sample, struct starpu_perf_counter_listener *listener)
+{
+	_starpu_perf_counter_sample_init(sample, listener->set->scope);
+	sample->listener = listener;
+	_STARPU_CALLOC(sample->value_array, listener->set->size, sizeof(*sample->value_array));
+}
+
+static void export_sample_exit(struct starpu_perf_counter_sample *sample)
+{
+	sample->listener = NULL;
+	_starpu_perf_counter_sample_exit(sample);
+}
+
+void _starpu_perf_counter_export_add_codelet(struct starpu_codelet *cl)
+{
+	struct export_codelet *c;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&export_mutex);
+	if (export_enabled)
+	{
+		_STARPU_MALLOC(c, sizeof(*c));
+		c->cl = cl;
+		export_sample_init(&c->sample, per_codelet_listener);
+		c->next = export_codelets;
+		export_codelets = c;
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&export_mutex);
+}
+
+void _starpu_perf_counter_export_remove_codelet(struct starpu_codelet *cl)
+{
+	struct export_codelet **prev, *c;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&export_mutex);
+	for (prev = &export_codelets; (c = *prev); prev = &c->next)
+	{
+		if (c->cl == cl)
+		{
+			*prev = c->next;
+			export_sample_exit(&c->sample);
+			free(c);
+			break;
+		}
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&export_mutex);
+}
+
+#ifdef STARPU_PERF_COUNTER_EXPORT_SUPPORTED
+/* Our samples are only filled by snapshots, nobody is notified */
+static void export_listener_cb(struct starpu_perf_counter_listener *listener, struct starpu_perf_counter_sample *sample, void *context)
+{
+	(void) listener;
+	(void) sample;
+	(void) context;
+}
+
+static struct starpu_perf_counter_listener *export_listener_init(enum starpu_perf_counter_scope scope, struct starpu_perf_counter_set **set)
+{
+	int nb = starpu_perf_counter_nb(scope);
+	int nth;
+
+	*set = starpu_perf_counter_set_alloc(scope);
+	for (nth = 0; nth < nb; nth++)
+		starpu_perf_counter_set_enable_id(*set, starpu_perf_counter_nth_to_id(scope, nth));
+	return starpu_perf_counter_listener_init(*set, export_listener_cb, NULL);
+}
+
+static void export_printf(struct export_buffer *b, const char *fmt, ...) STARPU_ATTRIBUTE_FORMAT(printf, 2, 3);
+
+static void export_printf(struct export_buffer *b, const char *fmt, ...)
+{
+	va_list args;
+	int n;
+
+	while (1)
+	{
+		va_start(args, fmt);
+		n = vsnprintf(b->buf + b->len, b->size - b->len, fmt, args);
+		va_end(args);
+		STARPU_ASSERT(n >= 0);
+		if (b->len + n < b->size)
+			break;
+		b->size = 2 * (b->len + n + 1);
+		_STARPU_REALLOC(b->buf, b->size);
+	}
+	b->len += n;
+}
+
+/* Write a label value, with the escapes required by the Prometheus format */
+static void export_label(struct export_buffer *b, const char *name, const char *value)
+{
+	const char *c;
+
+	export_printf(b, "%s=\"", name);
+	for (c = value; *c; c++)
+	{
+		if (*c == '\\' || *c == '"')
+			export_printf(b, "\\%c", *c);
+		else if (*c == '\n')
+			export_printf(b, "\\n");
+		else
+			export_printf(b, "%c", *c);
+	}
+	export_printf(b, "\"");
+}
+
+static void export_value(struct export_buffer *b, struct starpu_perf_counter_sample *sample, int id)
+{
+	switch (starpu_perf_counter_get_type_id(id))
+	{
+		case starpu_perf_counter_type_int32:
+			export_printf(b, " %d\n", (int) starpu_perf_counter_sample_get_int32_value(sample, id));
+			break;
+		case starpu_perf_counter_type_int64:
+			export_printf(b, " %lld\n", (long long) starpu_perf_counter_sample_get_int64_value(sample, id));
+			break;
+		case starpu_perf_counter_type_float:
+			export_printf(b, " %.7g\n", (double) starpu_perf_counter_sample_get_float_value(sample, id));
+			break;
+		case starpu_perf_counter_type_double:
+			export_printf(b, " %.15g\n", (double) starpu_perf_counter_sample_get_double_value(sample, id));
+			break;
+		default:
+			STARPU_ASSERT(0);
+	}
+}
+
+/* Write the metadata of the counter, and its metric name in the Prometheus format */
+static void export_counter_header(struct export_buffer *b, int id, char *metric, size_t size)
+{
+	const char *name = starpu_perf_counter_id_to_name(id);
+	char *c;
+
+	snprintf(metric, size, "%s", name);
+	for (c = metric; *c; c++)
+		if (*c == '.')
+			*c = '_';
+
+	export_printf(b, "# HELP %s %s\n", metric, starpu_perf_counter_get_help_string(id));
+	/* Accumulated values only grow, the others may go up and down */
+	export_printf(b, "# TYPE %s %s\n", metric,
+		      strstr(name, "total_") || strstr(name, "cumul_") ? "counter" : "gauge");
+}
+
+static void export_render(struct export_buffer *b)
+{
+	char metric[256];
+	int nb, nth;
+	unsigned workerid;
+	struct export_codelet *c;
+
+	b->len = 0;
+
+	/* global counters */
+	_starpu_perf_counter_sample_snapshot(&global_sample, NULL);
+	nb = starpu_perf_counter_nb(starpu_perf_counter_scope_global);
+	for (nth = 0; nth < nb; nth++)
+	{
+		int id = starpu_perf_counter_nth_to_id(starpu_perf_counter_scope_global, nth);
+		export_counter_header(b, id, metric, sizeof(metric));
+		export_printf(b, "%s", metric);
+		export_value(b, &global_sample, id);
+	}
+
+	/* per-worker counters */
+	for (workerid = 0; workerid < nworkers; workerid++)
+		_starpu_perf_counter_sample_snapshot(&worker_samples[workerid], _starpu_get_worker_struct(workerid));
+	nb = starpu_perf_counter_nb(starpu_perf_counter_scope_per_worker);
+	for (nth = 0; nth < nb; nth++)
+	{
+		int id = starpu_perf_counter_nth_to_id(starpu_perf_counter_scope_per_worker, nth);
+		export_counter_header(b, id, metric, sizeof(metric));
+		for (workerid = 0; workerid < nworkers; workerid++)
+		{
+			char name[64];
+			starpu_worker_get_name(workerid, name, sizeof(name));
+			export_printf(b, "%s{worker=\"%u\",", metric, workerid);
+			export_label(b, "name", name);
+			export_printf(b, "}");
+			export_value(b, &worker_samples[workerid], id);
+		}
+	}
+
+	/* per-codelet counters */
+	STARPU_PTHREAD_MUTEX_LOCK(&export_mutex);
+	if (export_codelets)
+	{
+		for (c = export_codelets; c; c = c->next)
+			_starpu_perf_counter_sample_snapshot(&c->sample, c->cl);
+		nb = starpu_perf_counter_nb(starpu_perf_counter_scope_per_codelet);
+		for (nth = 0; nth < nb; nth++)
+		{
+			int id = starpu_perf_counter_nth_to_id(starpu_perf_counter_scope_per_codelet, nth);
+			export_counter_header(b, id, metric, sizeof(metric));
+			for (c = export_codelets; c; c = c->next)
+			{
+				char name[32];
+				export_printf(b, "%s{", metric);
+				if (c->cl->name)
+					export_label(b, "codelet", c->cl->name);
+				else
+				{
+					snprintf(name, sizeof(name), "%p", c->cl);
+					export_label(b, "codelet", name);
+				}
+				export_printf(b, "}");
+				export_value(b, &c->sample, id);
+			}
+		}
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&export_mutex);
+}
+
+/* Send the whole buffer to the client without blocking the exporter thread:
+ * give up if the client does not read it, or if we are asked to stop */
+static int export_send(int fd, const char *buf, size_t len)
+{
+	struct pollfd pfd[2] =
+	{
+		{ .fd = fd, .events = POLLOUT, .revents = 0 },
+		{ .fd = export_stop_pipe[0], .events = POLLIN, .revents = 0 },
+	};
+	size_t sent = 0;
+
+	while (sent < len)
+	{
+		ssize_t n;
+		int ret = poll(pfd, 2, EXPORT_SEND_TIMEOUT);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0 || pfd[1].revents || !(pfd[0].revents & POLLOUT))
+			return -1;
+
+		n = send(fd, buf + sent, len - sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
+			continue;
+		if (n <= 0)
+			return -1;
+		sent += n;
+	}
+	return 0;
+}
+
+static void export_serve(int fd)
+{
+	struct pollfd pfd = { .fd = fd, .events = POLLIN, .revents = 0 };
+	char request[256];
+	int http = 0;
+
+	/* Plain clients may not send anything, only wait for a short while */
+	if (poll(&pfd, 1, EXPORT_REQUEST_TIMEOUT) > 0 && (pfd.revents & POLLIN))
+	{
+		ssize_t n = recv(fd, request, sizeof(request) - 1, 0);
+		if (n > 0)
+		{
+			request[n] = 0;
+			http = !strncmp(request, "GET ", 4);
+		}
+	}
+
+	export_render(&export_buffer);
+
+	if (http)
+	{
+		char header[128];
+		int n = snprintf(header, sizeof(header), "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: %lu\r\n\r\n", (unsigned long) export_buffer.len);
+		if (export_send(fd, header, n) < 0)
+			return;
+	}
+
+	export_send(fd, export_buffer.buf, export_buffer.len);
+}
+
+static void *export_thread_func(void *arg)
+{
+	struct pollfd pfd[2] =
+	{
+		{ .fd = export_fd, .events = POLLIN, .revents = 0 },
+		{ .fd = export_stop_pipe[0], .events = POLLIN, .revents = 0 },
+	};
+	(void) arg;
+
+	starpu_pthread_setname("perf_export");
+
+	while (1)
+	{
+		int ret = poll(pfd, 2, -1);
+		if (ret < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			_STARPU_DISP("Warning: could not wait for connections on %s: %s\n", export_path, strerror(errno));
+			break;
+		}
+		if (pfd[1].revents)
+			/* We are asked to stop */
+			break;
+		if (pfd[0].revents & POLLIN)
+		{
+			int fd = accept(export_fd, NULL, NULL);
+			if (fd < 0)
+				continue;
+			export_serve(fd);
+			close(fd);
+		}
+	}
+
+	return NULL;
+}
+
+static int export_listen(const char *path)
+{
+	struct sockaddr_un addr;
+	struct stat st;
+	int fd;
+
+	if (strlen(path) >= sizeof(addr.sun_path))
+	{
+		_STARPU_DISP("Warning: STARPU_PERF_COUNTER_EXPORT path %s is too long, not exporting performance counters\n", path);
+		return -1;
+	}
+
+	/* Remove the socket left behind by a previous execution, but nothing else */
+	if (stat(path, &st) == 0 && S_ISSOCK(st.st_mode))
+		unlink(path);
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+
+	fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+	{
+		_STARPU_DISP("Warning: could not create socket for exporting performance counters: %s\n", strerror(errno));
+		return -1;
+	}
+	if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0 || listen(fd, 16) < 0)
+	{
+		_STARPU_DISP("Warning: could not listen on %s for exporting performance counters: %s\n", path, strerror(errno));
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+#endif
+
+void _starpu_perf_counter_export_init(void)
+{
+	const char *path = starpu_getenv("STARPU_PERF_COUNTER_EXPORT");
+	unsigned workerid;
+
+	if (!path || !path[0])
+		return;
+
+#ifndef STARPU_PERF_COUNTER_EXPORT_SUPPORTED
+	_STARPU_DISP("Warning: STARPU_PERF_COUNTER_EXPORT is not supported on this platform, not exporting performance counters\n");
+	(void) workerid;
+#else
+	export_fd = export_listen(path);
+	if (export_fd < 0)
+		return;
+	if (pipe(export_stop_pipe) < 0)
+	{
+		_STARPU_DISP("Warning: could not create pipe for exporting performance counters: %s\n", strerror(errno));
+		close(export_fd);
+		export_fd = -1;
+		return;
+	}
+	export_path = strdup(path);
+
+	global_listener = export_listener_init(starpu_perf_counter_scope_global, &global_set);
+	per_worker_listener = export_listener_init(starpu_perf_counter_scope_per_worker, &per_worker_set);
+	per_codelet_listener = export_listener_init(starpu_perf_counter_scope_per_codelet, &per_codelet_set);
+
+	export_sample_init(&global_sample, global_listener);
+	nworkers = starpu_worker_get_count();
+	_STARPU_MALLOC(worker_samples, nworkers * sizeof(*worker_samples));
+	for (workerid = 0; workerid < nworkers; workerid++)
+		export_sample_init(&worker_samples[workerid], per_worker_listener);
+
+	STARPU_PTHREAD_MUTEX_LOCK(&export_mutex);
+	export_enabled = 1;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&export_mutex);
+
+	/* The counters have to be collected for being exported */
+	starpu_perf_counter_collection_start();
+
+	STARPU_PTHREAD_CREATE(&export_thread, NULL, export_thread_func, NULL);
+#endif
+}
+
+void _starpu_perf_counter_export_shutdown(void)
+{
+	struct export_codelet *c, *next;
+	unsigned workerid;
+
+	if (!export_enabled)
+		return;
+
+#ifdef STARPU_PERF_COUNTER_EXPORT_SUPPORTED
+	const char stop = 0;
+	if (write(export_stop_pipe[1], &stop, 1) != 1)
+		STARPU_ABORT_MSG("could not stop the performance counter export thread: %s\n", strerror(errno));
+	STARPU_PTHREAD_JOIN(export_thread, NULL);
+
+	close(export_stop_pipe[0]);
+	close(export_stop_pipe[1]);
+	close(export_fd);
+	export_fd = -1;
+	unlink(export_path);
+#endif
+	free(export_path);
+	export_path = NULL;
+
+	starpu_perf_counter_collection_stop();
+
+	STARPU_PTHREAD_MUTEX_LOCK(&export_mutex);
+	export_enabled = 0;
+	/* Codelets whose listener is still plugged */
+	for (c = export_codelets; c; c = next)
+	{
+		next = c->next;
+		export_sample_exit(&c->sample);
+		free(c);
+	}
+	export_codelets = NULL;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&export_mutex);
+
+	for (workerid = 0; workerid < nworkers; workerid++)
+		export_sample_exit(&worker_samples[workerid]);
+	free(worker_samples);
+	worker_samples = NULL;
+	nworkers = 0;
+	export_sample_exit(&global_sample);
+
+	export_listener_exit(per_codelet_listener, per_codelet_set);
+	export_listener_exit(per_worker_listener, per_worker_set);
+	export_listener_exit(global_listener, global_set);
+
+	free(export_buffer.buf);
+	memset(&export_buffer, 0, sizeof(export_buffer));
+}
@@ -0,0 +1,40 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#ifndef __PERF_COUNTER_EXPORT_H__
+#define __PERF_COUNTER_EXPORT_H__
+
+/** @file */
+
+#include <starpu.h>
+
+#pragma GCC visibility push(hidden)
+
+/**
+   Start serving the performance counters in the Prometheus text format on
+   the Unix socket given by STARPU_PERF_COUNTER_EXPORT, if set
+*/
+void _starpu_perf_counter_export_init(void);
+void _starpu_perf_counter_export_shutdown(void);
+
+/** Export the per-codelet counters of \p cl, called when a listener is plugged on it */
+void _starpu_perf_counter_export_add_codelet(struct starpu_codelet *cl);
+/** Stop exporting the per-codelet counters of \p cl, called before its listener is unplugged */
+void _starpu_perf_counter_export_remove_codelet(struct starpu_codelet *cl);
+
+#pragma GCC visibility pop
+
+#endif // __PERF_COUNTER_EXPORT_H__
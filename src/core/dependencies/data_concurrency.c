@@ -456,14 +456,17 @@ void _starpu_enforce_data_deps_notify_job_ready_soon(struct _starpu_job *j, _sta
 }
 
 void _starpu_job_set_ordered_buffers(struct _starpu_job *j)
+{
+	_starpu_task_set_ordered_buffers(j->task, _STARPU_JOB_GET_ORDERED_BUFFERS(j));
+}
+
+void _starpu_task_set_ordered_buffers(struct starpu_task *task, struct _starpu_data_descr *buffers)
 {
 	/* Compute an ordered list of the different pieces of data so that we
 	 * grab then according to a total order, thus avoiding a deadlock
 	 * condition */
 	unsigned i;
-	unsigned nbuffers = STARPU_TASK_GET_NBUFFERS(j->task);
-	struct starpu_task *task = j->task;
-	struct _starpu_data_descr *buffers = _STARPU_JOB_GET_ORDERED_BUFFERS(j);
+	unsigned nbuffers = STARPU_TASK_GET_NBUFFERS(task);
 
 	for (i=0 ; i<nbuffers; i++)
 	{
@@ -24,6 +24,8 @@
 #pragma GCC visibility push(hidden)
 
 void _starpu_job_set_ordered_buffers(struct _starpu_job *j);
+/** Same as _starpu_job_set_ordered_buffers, but fill \p buffers */
+void _starpu_task_set_ordered_buffers(struct starpu_task *task, struct _starpu_data_descr *buffers);
 
 unsigned _starpu_concurrent_data_access(struct _starpu_job *j);
 void _starpu_submit_job_enforce_arbitered_deps(struct _starpu_job *j, unsigned buf, unsigned nbuffers);
@@ -29,6 +29,17 @@
 #endif
 
 static void (*write_hook)(starpu_data_handle_t);
+static int read_epochs_enabled;
+
+void _starpu_implicit_data_deps_init(void)
+{
+#ifdef STARPU_USE_FXT
+	/* Ghost dependencies need to know about each reader */
+	read_epochs_enabled = 0;
+#else
+	read_epochs_enabled = starpu_getenv_number_default("STARPU_IMPLICIT_READ_EPOCHS", 1);
+#endif
+}
 
 void _starpu_implicit_data_deps_write_hook(void (*func)(starpu_data_handle_t))
 {
@@ -103,6 +114,144 @@ static void _starpu_add_accessor(starpu_data_handle_t handle, struct starpu_task
 	}
 }
 
+/* Whether post_sync_task can be accounted in the read epoch of the handle
+ * instead of being recorded in last_submitted_accessors */
+static int _starpu_read_epoch_can_join(struct starpu_task *pre_sync_task, struct starpu_task *post_sync_task)
+{
+	return read_epochs_enabled
+		&& pre_sync_task == post_sync_task
+		&& post_sync_task->cl
+		/* These need to know about each reader */
+		&& !_starpu_bound_recording && !STARPU_AYU_EVENT;
+}
+
+/* Account task in the read epoch of the handle, opening one if needed.
+ * handle->sequential_consistency_mutex must be held */
+static void _starpu_read_epoch_join(starpu_data_handle_t handle, struct starpu_task *task, struct _starpu_task_wrapper_dlist *slot)
+{
+	struct _starpu_read_epoch *epoch = handle->read_epoch;
+
+	if (!epoch)
+	{
+		_STARPU_MALLOC(epoch, sizeof(*epoch));
+		epoch->nreaders = 1;
+		epoch->sync_task = NULL;
+		handle->read_epoch = epoch;
+	}
+	(void) STARPU_ATOMIC_ADD(&epoch->nreaders, 1);
+
+	STARPU_ASSERT(!slot->next);
+	STARPU_ASSERT(!slot->epoch);
+	slot->task = task;
+	slot->epoch = epoch;
+
+	/* This task depends on the previous synchronization task if any */
+	if (handle->last_sync_task && handle->last_sync_task != task)
+	{
+		struct starpu_task *task_array[1] = {handle->last_sync_task};
+		_starpu_task_declare_deps_array(task, 1, task_array, 0);
+		_starpu_add_dependency(handle, handle->last_sync_task, task);
+		_STARPU_DEP_DEBUG("dep %p -> %p\n", handle->last_sync_task, task);
+	}
+}
+
+/* The reader is over. If it was the last one of a closed epoch, submit the
+ * synchronization task which replaced the epoch. This does not need
+ * handle->sequential_consistency_mutex */
+static void _starpu_read_epoch_leave(struct _starpu_task_wrapper_dlist *slot)
+{
+	struct _starpu_read_epoch *epoch = slot->epoch;
+
+	slot->task = NULL;
+	slot->epoch = NULL;
+	if (STARPU_ATOMIC_ADD(&epoch->nreaders, -1) == 0)
+	{
+		/* Closed, so sync_task is set */
+		struct starpu_task *sync_task = epoch->sync_task;
+		free(epoch);
+		int ret = _starpu_task_submit_internally(sync_task);
+		STARPU_ASSERT(!ret);
+	}
+}
+
+/* Close the read epoch of the handle if any, by replacing the readers which
+ * are still running with a synchronization task in the accessors list.
+ * handle->sequential_consistency_mutex must be held */
+static void _starpu_read_epoch_close(starpu_data_handle_t handle, struct starpu_task *ignored_task)
+{
+	struct _starpu_read_epoch *epoch = handle->read_epoch;
+
+	if (!epoch)
+		return;
+	handle->read_epoch = NULL;
+
+	if (ignored_task->cl)
+	{
+		/* Don't make the task depend on itself, see _starpu_add_sync_task */
+		struct _starpu_job *j = _starpu_get_job_associated_to_task(ignored_task);
+		struct _starpu_task_wrapper_dlist *slots = _STARPU_JOB_GET_DEP_SLOTS(j);
+		unsigned i, nbuffers = STARPU_TASK_GET_NBUFFERS(ignored_task);
+		for (i = 0; i < nbuffers; i++)
+			if (slots[i].epoch == epoch)
+			{
+				slots[i].task = NULL;
+				slots[i].epoch = NULL;
+				(void) STARPU_ATOMIC_ADD(&epoch->nreaders, -1);
+			}
+	}
+
+	if (epoch->nreaders == 1)
+	{
+		/* Readers can not join any more, and none is running */
+		_STARPU_DEP_DEBUG("read epoch already over\n");
+		free(epoch);
+		return;
+	}
+
+	struct starpu_task *sync_task = starpu_task_create();
+	sync_task->name = "_starpu_sync_task_readers";
+	sync_task->cl = NULL;
+	sync_task->type = STARPU_TASK_TYPE_INTERNAL;
+
+	/* Record it as accessor before the last reader may submit it */
+	struct _starpu_job *sync_job = _starpu_get_job_associated_to_task(sync_task);
+	struct _starpu_task_wrapper_dlist *slot = &sync_job->implicit_dep_slot;
+	slot->task = sync_task;
+	slot->next = handle->last_submitted_accessors.next;
+	slot->prev = &handle->last_submitted_accessors;
+	slot->next->prev = slot;
+	handle->last_submitted_accessors.next = slot;
+
+	/* Add a reference to be released in _starpu_handle_job_termination */
+	_starpu_spin_lock(&handle->header_lock);
+	handle->busy_count++;
+	_starpu_spin_unlock(&handle->header_lock);
+	sync_job->implicit_dep_handle = handle;
+
+	epoch->sync_task = sync_task;
+	if (STARPU_ATOMIC_ADD(&epoch->nreaders, -1) == 0)
+	{
+		/* The readers terminated meanwhile, we do not need it after all */
+		_STARPU_DEP_DEBUG("read epoch over while closing\n");
+		slot->next->prev = slot->prev;
+		slot->prev->next = slot->next;
+		slot->task = NULL;
+		slot->next = NULL;
+		slot->prev = NULL;
+		sync_job->implicit_dep_handle = NULL;
+		_starpu_spin_lock(&handle->header_lock);
+		handle->busy_count--;
+		if (!_starpu_data_check_not_busy(handle))
+			_starpu_spin_unlock(&handle->header_lock);
+		_starpu_task_destroy(sync_task);
+		free(epoch);
+	}
+	else
+	{
+		_STARPU_DEP_DEBUG("closing read epoch with sync task %p\n", sync_task);
+	}
+}
+
 /* This adds a new synchronization task which depends on all the previous accessors */
 static void _starpu_add_sync_task(starpu_data_handle_t handle, struct starpu_task *pre_sync_task, struct starpu_task *post_sync_task, struct starpu_task *ignored_task)
 {
@@ -193,6 +342,37 @@ static void _starpu_add_sync_task(starpu_data_handle_t handle, struct starpu_tas
 	}
 }
 
+/* Update the state of the handle for an access in the given mode. This is
+ * done along the computation of implicit dependencies, and also for accesses
+ * whose dependencies were computed beforehand, see task_graph.c */
+/* NB : handle->sequential_consistency_mutex must be hold by the caller */
+void _starpu_implicit_data_deps_access(starpu_data_handle_t handle, enum starpu_data_access_mode mode)
+{
+	if (mode & STARPU_R && !handle->initialized)
+	{
+		STARPU_ASSERT_MSG(handle->init_cl, "Handle %p is not initialized, it cannot be read", handle);
+		/* The task will initialize it with init_cl */
+		handle->initialized = 1;
+	}
+
+	if (mode & STARPU_W || mode == STARPU_REDUX)
+	{
+
+		STARPU_ASSERT_MSG(!handle->readonly, "Read-only handle %p can not be written to", handle);
+
+		handle->initialized = 1;
+		/* We will change our value, disconnect from our readonly duplicates */
+		if (handle->readonly_dup)
+		{
+			STARPU_ASSERT(handle->readonly_dup->readonly_dup_of == handle);
+			handle->readonly_dup->readonly_dup_of = NULL;
+			handle->readonly_dup = NULL;
+		}
+		if (write_hook)
+			write_hook(handle);
+	}
+}
+
 /* This function adds the implicit task dependencies introduced by data
  * sequential consistency. Two tasks are provided: pre_sync and post_sync which
  * respectively indicates which task is going to depend on the previous deps
@@ -227,29 +407,7 @@ struct starpu_task *_starpu_detect_implicit_data_deps_with_handle(struct starpu_
 		struct _starpu_job *pre_sync_job = _starpu_get_job_associated_to_task(pre_sync_task);
 		struct _starpu_job *post_sync_job = _starpu_get_job_associated_to_task(post_sync_task);
 
-		if (mode & STARPU_R && !handle->initialized)
-		{
-			STARPU_ASSERT_MSG(handle->init_cl, "Handle %p is not initialized, it cannot be read", handle);
-			/* The task will initialize it with init_cl */
-			handle->initialized = 1;
-		}
-
-		if (mode & STARPU_W || mode == STARPU_REDUX)
-		{
-
-			STARPU_ASSERT_MSG(!handle->readonly, "Read-only handle %p can not be written to", handle);
-
-			handle->initialized = 1;
-			/* We will change our value, disconnect from our readonly duplicates */
-			if (handle->readonly_dup)
-			{
-				STARPU_ASSERT(handle->readonly_dup->readonly_dup_of == handle);
-				handle->readonly_dup->readonly_dup_of = NULL;
-				handle->readonly_dup = NULL;
-			}
-			if (write_hook)
-				write_hook(handle);
-		}
+		_starpu_implicit_data_deps_access(handle, mode);
 
 		/* Skip tasks that are associated to a reduction phase so that
 		 * they do not interfere with the application. */
@@ -299,11 +457,16 @@ struct starpu_task *_starpu_detect_implicit_data_deps_with_handle(struct starpu_
 			/* Can access concurrently with current tasks */
 			if (handle->last_sync_task != NULL)
 				*submit_pre_sync = 1;
-			_starpu_add_accessor(handle, pre_sync_task, submit_pre_sync, post_sync_task, post_sync_task_dependency_slot);
+			if (mode == STARPU_R && _starpu_read_epoch_can_join(pre_sync_task, post_sync_task))
+				/* Only count it, so that its termination does not need the mutex */
+				_starpu_read_epoch_join(handle, post_sync_task, post_sync_task_dependency_slot);
+			else
+				_starpu_add_accessor(handle, pre_sync_task, submit_pre_sync, post_sync_task, post_sync_task_dependency_slot);
 		}
 		else
 		{
 			/* Can not access concurrently, have to wait for existing accessors */
+			_starpu_read_epoch_close(handle, post_sync_task);
 			struct _starpu_task_wrapper_dlist *l = handle->last_submitted_accessors.next;
 			_STARPU_DEP_DEBUG("dependency\n");
 
@@ -407,6 +570,14 @@ int _starpu_test_implicit_data_deps_with_handle(starpu_data_handle_t handle, enu
 			return -EAGAIN;
 		if (handle->last_submitted_accessors.next != &handle->last_submitted_accessors)
 			return -EAGAIN;
+		if (handle->read_epoch)
+		{
+			if (handle->read_epoch->nreaders > 1)
+				return -EAGAIN;
+			/* No reader is running any more */
+			free(handle->read_epoch);
+			handle->read_epoch = NULL;
+		}
 
 		if (mode & STARPU_W || mode == STARPU_REDUX)
 			handle->initialized = 1;
@@ -466,8 +637,15 @@ void _starpu_detect_implicit_data_deps(struct starpu_task *task)
 
 		}
 
-		STARPU_PTHREAD_MUTEX_LOCK(&handle->sequential_consistency_mutex);
 		unsigned index = descrs[buffer].index;
+		if (task->handles_sequential_consistency && !task->handles_sequential_consistency[index])
+		{
+			/* Nothing to do for this data, avoid taking its mutex */
+			j->sequential_consistency = 0;
+			continue;
+		}
+
+		STARPU_PTHREAD_MUTEX_LOCK(&handle->sequential_consistency_mutex);
 		unsigned task_handle_sequential_consistency = task->handles_sequential_consistency ? task->handles_sequential_consistency[index] : handle->sequential_consistency;
 		int submit_pre_sync = 1;
 		if (!task_handle_sequential_consistency)
@@ -496,6 +674,15 @@ void _starpu_detect_implicit_data_deps(struct starpu_task *task)
 /* the sequential_consistency_mutex of the handle has to be already held */
 void _starpu_release_data_enforce_sequential_consistency(struct starpu_task *task, struct _starpu_task_wrapper_dlist *task_dependency_slot, starpu_data_handle_t handle)
 {
+	if (task_dependency_slot && task_dependency_slot->epoch)
+	{
+		/* Readers of an epoch can not be the last sync task, and
+		 * are not in the accessors list */
+		STARPU_ASSERT(task_dependency_slot->task == task);
+		_starpu_read_epoch_leave(task_dependency_slot);
+		return;
+	}
+
 	STARPU_PTHREAD_MUTEX_LOCK(&handle->sequential_consistency_mutex);
 
 	if (handle->sequential_consistency)
@@ -753,5 +940,12 @@ void _starpu_data_clear_implicit(starpu_data_handle_t handle)
 		free(list);
 		list = next;
 	}
+	if (handle->read_epoch)
+	{
+		/* All the readers are over by now */
+		STARPU_ASSERT(handle->read_epoch->nreaders == 1);
+		free(handle->read_epoch);
+		handle->read_epoch = NULL;
+	}
 	STARPU_PTHREAD_MUTEX_UNLOCK(&handle->sequential_consistency_mutex);
 }
@@ -24,8 +24,12 @@
 
 #pragma GCC visibility push(hidden)
 
+void _starpu_implicit_data_deps_init(void);
+
 struct starpu_task *_starpu_detect_implicit_data_deps_with_handle(struct starpu_task *pre_sync_task, int *submit_pre_sync, struct starpu_task *post_sync_task, struct _starpu_task_wrapper_dlist *post_sync_task_dependency_slot,
 								  starpu_data_handle_t handle, enum starpu_data_access_mode mode, unsigned task_handle_sequential_consistency);
+/** Update the state of \p handle for an access in \p mode, without computing dependencies */
+void _starpu_implicit_data_deps_access(starpu_data_handle_t handle, enum starpu_data_access_mode mode);
 int _starpu_test_implicit_data_deps_with_handle(starpu_data_handle_t handle, enum starpu_data_access_mode mode);
 void _starpu_detect_implicit_data_deps(struct starpu_task *task);
 void _starpu_release_data_enforce_sequential_consistency(struct starpu_task *task, struct _starpu_task_wrapper_dlist *task_dependency_slot, starpu_data_handle_t handle);
@@ -27,18 +27,51 @@
 
 #define STARPU_AYUDAME_OFFSET 4000000000000000000ULL
 
+/* The tag structure is embedded in its hash table entry, so that a single
+ * allocation is needed, and entries are recycled through per-shard free lists */
 struct _starpu_tag_table
 {
 	UT_hash_handle hh;
 	starpu_tag_t id;
-	struct _starpu_tag *tag;
+	struct _starpu_tag tag;
+	struct _starpu_tag_table *next_free;
 };
 
 #define HASH_ADD_UINT64_T(head,field,add) HASH_ADD(hh,head,field,sizeof(uint64_t),add)
 #define HASH_FIND_UINT64_T(head,find,out) HASH_FIND(hh,head,find,sizeof(uint64_t),out)
 
-static struct _starpu_tag_table *tag_htbl = NULL;
-static starpu_pthread_rwlock_t tag_global_rwlock;
+/* The tags are spread over several hash tables, each protected by its own
+ * rwlock, so that threads declaring different tags do not contend. The
+ * locking order is the same as with a single table: a shard lock may be held
+ * while taking a tag lock, but not the converse, and only one shard lock is
+ * held at a time.
+ *
+ * Since entries are recycled, a tag pointer must never be used outside both
+ * the shard lock and the tag lock: lookups take the tag lock before
+ * releasing the shard lock, and removals take the tag lock after unhashing
+ * the entry, so that nobody can still reach it once it gets recycled. */
+#define STARPU_TAG_NSHARDS_LOG2	6
+#define STARPU_TAG_NSHARDS	(1 << STARPU_TAG_NSHARDS_LOG2)
+/* Number of entries kept for reuse in each shard */
+#define STARPU_TAG_NFREE_MAX	256
+
+struct _starpu_tag_shard
+{
+	starpu_pthread_rwlock_t rwlock;
+	struct _starpu_tag_table *htbl;
+	struct _starpu_spinlock free_lock;
+	struct _starpu_tag_table *free_list;
+	unsigned nfree;
+} STARPU_ATTRIBUTE_ALIGNED(STARPU_CACHELINE_SIZE);
+
+static struct _starpu_tag_shard tag_shards[STARPU_TAG_NSHARDS];
+
+static struct _starpu_tag_shard *_starpu_tag_get_shard(starpu_tag_t id)
+{
+	/* Consecutive tags are common, mix the bits before picking a shard */
+	uint64_t hash = (uint64_t) id * 0x9E3779B97F4A7C15ULL;
+	return &tag_shards[hash >> (64 - STARPU_TAG_NSHARDS_LOG2)];
+}
 
 static struct _starpu_cg *create_cg_apps(unsigned ntags)
 {
@@ -82,11 +115,44 @@ static struct _starpu_cg *create_cg_tag(unsigned ntags, struct _starpu_tag *tag)
 	return cg;
 }
 
-static struct _starpu_tag *_starpu_tag_init(starpu_tag_t id)
+/* The shard rwlock must be held in write mode */
+static struct _starpu_tag_table *_starpu_tag_entry_alloc(struct _starpu_tag_shard *shard)
 {
-	struct _starpu_tag *tag;
-	_STARPU_CALLOC(tag, 1, sizeof(struct _starpu_tag));
+	struct _starpu_tag_table *entry;
+
+	_starpu_spin_lock(&shard->free_lock);
+	entry = shard->free_list;
+	if (entry)
+	{
+		shard->free_list = entry->next_free;
+		shard->nfree--;
+	}
+	_starpu_spin_unlock(&shard->free_lock);
 
+	if (entry)
+		memset(entry, 0, sizeof(*entry));
+	else
+		_STARPU_CALLOC(entry, 1, sizeof(*entry));
+	return entry;
+}
+
+static void _starpu_tag_entry_release(struct _starpu_tag_shard *shard, struct _starpu_tag_table *entry)
+{
+	_starpu_spin_lock(&shard->free_lock);
+	if (shard->nfree < STARPU_TAG_NFREE_MAX)
+	{
+		entry->next_free = shard->free_list;
+		shard->free_list = entry;
+		shard->nfree++;
+		entry = NULL;
+	}
+	_starpu_spin_unlock(&shard->free_lock);
+
+	free(entry);
+}
+
+static void _starpu_tag_init(struct _starpu_tag *tag, starpu_tag_t id)
+{
 	//tag->job = NULL;
 	//tag->is_assigned = 0;
 	//tag->is_submitted = 0;
@@ -97,137 +163,164 @@ static struct _starpu_tag *_starpu_tag_init(starpu_tag_t id)
 	_starpu_cg_list_init0(&tag->tag_successors);
 
 	_starpu_spin_init(&tag->lock);
-
-	return tag;
 }
 
-static void _starpu_tag_free(void *_tag)
+/* Release what the tag refers to, the tag itself is released along with its
+ * hash table entry */
+static void _starpu_tag_free(struct _starpu_tag *tag)
 {
-	struct _starpu_tag *tag = (struct _starpu_tag *) _tag;
+	_starpu_spin_lock(&tag->lock);
+
+	unsigned nsuccs = tag->tag_successors.nsuccs;
+	unsigned succ;
 
-	if (tag)
+	for (succ = 0; succ < nsuccs; succ++)
 	{
-		_starpu_spin_lock(&tag->lock);
+		struct _starpu_cg *cg = tag->tag_successors.succ[succ];
 
-		unsigned nsuccs = tag->tag_successors.nsuccs;
-		unsigned succ;
+		unsigned ntags = STARPU_ATOMIC_ADD(&cg->ntags, -1);
+		unsigned STARPU_ATTRIBUTE_UNUSED remaining = STARPU_ATOMIC_ADD(&cg->remaining, -1);
 
-		for (succ = 0; succ < nsuccs; succ++)
+		if (!ntags && (cg->cg_type == STARPU_CG_TAG))
 		{
-			struct _starpu_cg *cg = tag->tag_successors.succ[succ];
-
-			unsigned ntags = STARPU_ATOMIC_ADD(&cg->ntags, -1);
-			unsigned STARPU_ATTRIBUTE_UNUSED remaining = STARPU_ATOMIC_ADD(&cg->remaining, -1);
-
-			if (!ntags && (cg->cg_type == STARPU_CG_TAG))
-			{
-				/* Last tag this cg depends on, cg becomes unreferenced */
+			/* Last tag this cg depends on, cg becomes unreferenced */
 #ifdef STARPU_DEBUG
-				free(cg->deps);
-				free(cg->done);
+			free(cg->deps);
+			free(cg->done);
 #endif
-				free(cg);
-			}
+			free(cg);
 		}
+	}
 
 #ifdef STARPU_DYNAMIC_DEPS_SIZE
-		free(tag->tag_successors.succ);
+	free(tag->tag_successors.succ);
 #endif
 #ifdef STARPU_DEBUG
-		free(tag->tag_successors.deps);
-		free(tag->tag_successors.done);
+	free(tag->tag_successors.deps);
+	free(tag->tag_successors.done);
 #endif
 
-		_starpu_spin_unlock(&tag->lock);
-		_starpu_spin_destroy(&tag->lock);
-
-		free(tag);
-	}
+	_starpu_spin_unlock(&tag->lock);
+	_starpu_spin_destroy(&tag->lock);
 }
 
 /*
- * Statically initializing tag_global_rwlock seems to lead to weird errors
+ * Statically initializing the shard rwlocks seems to lead to weird errors
  * on Darwin, so we do it dynamically.
  */
 void _starpu_init_tags(void)
 {
-	STARPU_PTHREAD_RWLOCK_INIT(&tag_global_rwlock, NULL);
+	unsigned i;
+	for (i = 0; i < STARPU_TAG_NSHARDS; i++)
+	{
+		STARPU_PTHREAD_RWLOCK_INIT(&tag_shards[i].rwlock, NULL);
+		_starpu_spin_init(&tag_shards[i].free_lock);
+	}
 }
 
 void starpu_tag_remove(starpu_tag_t id)
 {
+	struct _starpu_tag_shard *shard = _starpu_tag_get_shard(id);
 	struct _starpu_tag_table *entry;
 
 	STARPU_ASSERT(!STARPU_AYU_EVENT || id < STARPU_AYUDAME_OFFSET);
 	STARPU_AYU_REMOVETASK(id + STARPU_AYUDAME_OFFSET);
-	STARPU_PTHREAD_RWLOCK_WRLOCK(&tag_global_rwlock);
+	STARPU_PTHREAD_RWLOCK_WRLOCK(&shard->rwlock);
 
-	HASH_FIND_UINT64_T(tag_htbl, &id, entry);
-	if (entry) HASH_DEL(tag_htbl, entry);
+	HASH_FIND_UINT64_T(shard->htbl, &id, entry);
+	if (entry) HASH_DEL(shard->htbl, entry);
 
-	STARPU_PTHREAD_RWLOCK_UNLOCK(&tag_global_rwlock);
+	STARPU_PTHREAD_RWLOCK_UNLOCK(&shard->rwlock);
 
 	if (entry)
 	{
-		_starpu_tag_free(entry->tag);
-		free(entry);
+		_starpu_tag_free(&entry->tag);
+		_starpu_tag_entry_release(shard, entry);
 	}
 }
 
 void starpu_tag_clear(void)
 {
-	STARPU_PTHREAD_RWLOCK_WRLOCK(&tag_global_rwlock);
-
-	/* XXX: _starpu_tag_free takes the tag spinlocks while we are keeping
-	 * the global rwlock. This contradicts the lock order of
-	 * starpu_tag_wait_array. Should not be a problem in practice since
-	 * starpu_tag_clear is called at shutdown only. */
-	struct _starpu_tag_table *entry=NULL, *tmp=NULL;
+	unsigned i;
 
-	HASH_ITER(hh, tag_htbl, entry, tmp)
+	for (i = 0; i < STARPU_TAG_NSHARDS; i++)
 	{
-		HASH_DEL(tag_htbl, entry);
-		_starpu_tag_free(entry->tag);
-		free(entry);
-	}
+		struct _starpu_tag_shard *shard = &tag_shards[i];
+		struct _starpu_tag_table *entry=NULL, *tmp=NULL;
+
+		STARPU_PTHREAD_RWLOCK_WRLOCK(&shard->rwlock);
+
+		/* XXX: _starpu_tag_free takes the tag spinlocks while we are keeping
+		 * the shard rwlock. This contradicts the lock order of
+		 * starpu_tag_wait_array. Should not be a problem in practice since
+		 * starpu_tag_clear is called at shutdown only. */
+		HASH_ITER(hh, shard->htbl, entry, tmp)
+		{
+			HASH_DEL(shard->htbl, entry);
+			_starpu_tag_free(&entry->tag);
+			free(entry);
+		}
 
-	STARPU_PTHREAD_RWLOCK_UNLOCK(&tag_global_rwlock);
+		_starpu_spin_lock(&shard->free_lock);
+		while (shard->free_list)
+		{
+			entry = shard->free_list;
+			shard->free_list = entry->next_free;
+			free(entry);
+		}
+		shard->nfree = 0;
+		_starpu_spin_unlock(&shard->free_lock);
+
+		STARPU_PTHREAD_RWLOCK_UNLOCK(&shard->rwlock);
+	}
 }
 
-static struct _starpu_tag *_gettag_struct(starpu_tag_t id)
+/* The shard rwlock must be held in write mode */
+static struct _starpu_tag *_gettag_struct(struct _starpu_tag_shard *shard, starpu_tag_t id)
 {
 	/* search if the tag is already declared or not */
 	struct _starpu_tag_table *entry;
-	struct _starpu_tag *tag;
 
-	HASH_FIND_UINT64_T(tag_htbl, &id, entry);
-	if (entry != NULL)
-	     tag = entry->tag;
-	else
+	HASH_FIND_UINT64_T(shard->htbl, &id, entry);
+	if (entry == NULL)
 	{
 		/* the tag does not exist yet : create an entry */
-		tag = _starpu_tag_init(id);
+		entry = _starpu_tag_entry_alloc(shard);
+		entry->id = id;
+		_starpu_tag_init(&entry->tag, id);
 
-		struct _starpu_tag_table *entry2;
-		_STARPU_MALLOC(entry2, sizeof(*entry2));
-		entry2->id = id;
-		entry2->tag = tag;
-
-		HASH_ADD_UINT64_T(tag_htbl, id, entry2);
+		HASH_ADD_UINT64_T(shard->htbl, id, entry);
 
 		STARPU_ASSERT(!STARPU_AYU_EVENT || id < STARPU_AYUDAME_OFFSET);
 		STARPU_AYU_ADDTASK(id + STARPU_AYUDAME_OFFSET, NULL);
 	}
 
-	return tag;
+	return &entry->tag;
 }
 
-static struct _starpu_tag *gettag_struct(starpu_tag_t id)
+/* Return the tag, creating it if needed, with its lock taken */
+static struct _starpu_tag *gettag_struct_lock(starpu_tag_t id)
 {
+	struct _starpu_tag_shard *shard = _starpu_tag_get_shard(id);
+	struct _starpu_tag_table *entry;
 	struct _starpu_tag *tag;
-	STARPU_PTHREAD_RWLOCK_WRLOCK(&tag_global_rwlock);
-	tag = _gettag_struct(id);
-	STARPU_PTHREAD_RWLOCK_UNLOCK(&tag_global_rwlock);
+
+	/* Most lookups are for tags which already exist */
+	STARPU_PTHREAD_RWLOCK_RDLOCK(&shard->rwlock);
+	HASH_FIND_UINT64_T(shard->htbl, &id, entry);
+	if (entry)
+	{
+		tag = &entry->tag;
+		_starpu_spin_lock(&tag->lock);
+		STARPU_PTHREAD_RWLOCK_UNLOCK(&shard->rwlock);
+		return tag;
+	}
+	STARPU_PTHREAD_RWLOCK_UNLOCK(&shard->rwlock);
+
+	STARPU_PTHREAD_RWLOCK_WRLOCK(&shard->rwlock);
+	tag = _gettag_struct(shard, id);
+	_starpu_spin_lock(&tag->lock);
+	STARPU_PTHREAD_RWLOCK_UNLOCK(&shard->rwlock);
 	return tag;
 }
 
@@ -268,10 +361,9 @@ static void _starpu_tag_add_succ(struct _starpu_tag *tag, struct _starpu_cg *cg)
 	}
 }
 
-void _starpu_notify_tag_dependencies(struct _starpu_tag *tag)
+/* lock should be taken, and this releases it */
+static void _starpu_notify_tag_dependencies_locked(struct _starpu_tag *tag)
 {
-	_starpu_spin_lock(&tag->lock);
-
 	if (tag->state == STARPU_DONE)
 	{
 		_starpu_spin_unlock(&tag->lock);
@@ -286,6 +378,12 @@ void _starpu_notify_tag_dependencies(struct _starpu_tag *tag)
 	_starpu_spin_unlock(&tag->lock);
 }
 
+void _starpu_notify_tag_dependencies(struct _starpu_tag *tag)
+{
+	_starpu_spin_lock(&tag->lock);
+	_starpu_notify_tag_dependencies_locked(tag);
+}
+
 /* Called when a job has just started, so we can notify tasks which were waiting
  * only for this one when they can expect to start */
 void _starpu_notify_job_start_tag_dependencies(struct _starpu_tag *tag, _starpu_notify_job_start_data *data)
@@ -295,9 +393,8 @@ void _starpu_notify_job_start_tag_dependencies(struct _starpu_tag *tag, _starpu_
 
 void starpu_tag_restart(starpu_tag_t id)
 {
-	struct _starpu_tag *tag = gettag_struct(id);
+	struct _starpu_tag *tag = gettag_struct_lock(id);
 
-	_starpu_spin_lock(&tag->lock);
 	STARPU_ASSERT_MSG(tag->state == STARPU_DONE || tag->state == STARPU_INVALID_STATE || tag->state == STARPU_ASSOCIATED || tag->state == STARPU_BLOCKED, "Only completed tags can be restarted (%llu was %d)", (unsigned long long) id, tag->state);
 	tag->state = STARPU_BLOCKED;
 	_starpu_spin_unlock(&tag->lock);
@@ -305,15 +402,14 @@ void starpu_tag_restart(starpu_tag_t id)
 
 void starpu_tag_notify_from_apps(starpu_tag_t id)
 {
-	struct _starpu_tag *tag = gettag_struct(id);
+	struct _starpu_tag *tag = gettag_struct_lock(id);
 
-	_starpu_notify_tag_dependencies(tag);
+	_starpu_notify_tag_dependencies_locked(tag);
 }
 
-void _starpu_notify_restart_tag_dependencies(struct _starpu_tag *tag)
+/* lock should be taken, and this releases it */
+static void _starpu_notify_restart_tag_dependencies_locked(struct _starpu_tag *tag)
 {
-	_starpu_spin_lock(&tag->lock);
-
 	if (tag->state == STARPU_DONE)
 	{
 		tag->state = STARPU_BLOCKED;
@@ -332,9 +428,9 @@ void _starpu_notify_restart_tag_dependencies(struct _starpu_tag *tag)
 
 void starpu_tag_notify_restart_from_apps(starpu_tag_t id)
 {
-	struct _starpu_tag *tag = gettag_struct(id);
+	struct _starpu_tag *tag = gettag_struct_lock(id);
 
-	_starpu_notify_restart_tag_dependencies(tag);
+	_starpu_notify_restart_tag_dependencies_locked(tag);
 }
 
 void _starpu_tag_declare(starpu_tag_t id, struct _starpu_job *job)
@@ -342,9 +438,7 @@ void _starpu_tag_declare(starpu_tag_t id, struct _starpu_job *job)
 	_STARPU_TRACE_TAG(id, job);
 	job->task->use_tag = 1;
 
-	struct _starpu_tag *tag= gettag_struct(id);
-
-	_starpu_spin_lock(&tag->lock);
+	struct _starpu_tag *tag = gettag_struct_lock(id);
 
 	/* Note: a tag can be shared by several tasks, when it is used to
 	 * detect when either of them are finished. We however don't allow
@@ -378,9 +472,7 @@ void starpu_tag_declare_deps_array(starpu_tag_t id, unsigned ndeps, starpu_tag_t
 	unsigned i;
 
 	/* create the associated completion group */
-	struct _starpu_tag *tag_child = gettag_struct(id);
-
-	_starpu_spin_lock(&tag_child->lock);
+	struct _starpu_tag *tag_child = gettag_struct_lock(id);
 	struct _starpu_cg *cg = create_cg_tag(ndeps, tag_child);
 	_starpu_spin_unlock(&tag_child->lock);
 
@@ -402,9 +494,8 @@ void starpu_tag_declare_deps_array(starpu_tag_t id, unsigned ndeps, starpu_tag_t
 		 * so cg should be among dep_id's successors*/
 		_STARPU_TRACE_TAG_DEPS(id, dep_id);
 		_starpu_bound_tag_dep(id, dep_id);
-		struct _starpu_tag *tag_dep = gettag_struct(dep_id);
-		STARPU_ASSERT(tag_dep != tag_child);
-		_starpu_spin_lock(&tag_dep->lock);
+		STARPU_ASSERT(dep_id != id);
+		struct _starpu_tag *tag_dep = gettag_struct_lock(dep_id);
 		_starpu_tag_add_succ(tag_dep, cg);
 		STARPU_ASSERT(!STARPU_AYU_EVENT || dep_id < STARPU_AYUDAME_OFFSET);
 		STARPU_ASSERT(!STARPU_AYU_EVENT || id < STARPU_AYUDAME_OFFSET);
@@ -421,9 +512,7 @@ void starpu_tag_declare_deps(starpu_tag_t id, unsigned ndeps, ...)
 	unsigned i;
 
 	/* create the associated completion group */
-	struct _starpu_tag *tag_child = gettag_struct(id);
-
-	_starpu_spin_lock(&tag_child->lock);
+	struct _starpu_tag *tag_child = gettag_struct_lock(id);
 	struct _starpu_cg *cg = create_cg_tag(ndeps, tag_child);
 	_starpu_spin_unlock(&tag_child->lock);
 
@@ -438,9 +527,8 @@ void starpu_tag_declare_deps(starpu_tag_t id, unsigned ndeps, ...)
 		 * so cg should be among dep_id's successors*/
 		_STARPU_TRACE_TAG_DEPS(id, dep_id);
 		_starpu_bound_tag_dep(id, dep_id);
-		struct _starpu_tag *tag_dep = gettag_struct(dep_id);
-		STARPU_ASSERT(tag_dep != tag_child);
-		_starpu_spin_lock(&tag_dep->lock);
+		STARPU_ASSERT(dep_id != id);
+		struct _starpu_tag *tag_dep = gettag_struct_lock(dep_id);
 		_starpu_tag_add_succ(tag_dep, cg);
 		STARPU_ASSERT(!STARPU_AYU_EVENT || dep_id < STARPU_AYUDAME_OFFSET);
 		STARPU_ASSERT(!STARPU_AYU_EVENT || id < STARPU_AYUDAME_OFFSET);
@@ -454,52 +542,43 @@ void starpu_tag_declare_deps(starpu_tag_t id, unsigned ndeps, ...)
 int starpu_tag_wait_array(unsigned ntags, starpu_tag_t *id)
 {
 	unsigned i;
-	unsigned current;
-
-	struct _starpu_tag *tag_array[ntags];
+	struct _starpu_cg *cg;
 
 	_STARPU_LOG_IN();
 
 	/* It is forbidden to block within callbacks or codelets */
 	STARPU_ASSERT_MSG(_starpu_worker_may_perform_blocking_calls(), "starpu_tag_wait must not be called from a task or callback");
 
-	starpu_do_schedule();
-	STARPU_PTHREAD_RWLOCK_WRLOCK(&tag_global_rwlock);
-	/* only wait the tags that are not done yet */
-	for (i = 0, current = 0; i < ntags; i++)
+	if (ntags == 0)
 	{
-		struct _starpu_tag *tag = _gettag_struct(id[i]);
+		_STARPU_LOG_OUT_TAG("no tag to wait for");
+		return 0;
+	}
 
-		_starpu_spin_lock(&tag->lock);
+	starpu_do_schedule();
+
+	/* The tags are locked one at a time, so that we never hold a tag lock
+	 * while taking a shard lock, nor several tag locks. Tags which are
+	 * already done account for their part of the completion group
+	 * immediately, the others will when they get done. */
+	cg = create_cg_apps(ntags);
+
+	for (i = 0; i < ntags; i++)
+	{
+		struct _starpu_tag *tag = gettag_struct_lock(id[i]);
 
 		if (tag->state == STARPU_DONE)
 		{
 			/* that tag is done already */
 			_starpu_spin_unlock(&tag->lock);
+			_starpu_notify_cg(NULL, cg);
 		}
 		else
 		{
-			tag_array[current] = tag;
-			current++;
+			_starpu_tag_add_succ(tag, cg);
+			_starpu_spin_unlock(&tag->lock);
 		}
 	}
-	STARPU_PTHREAD_RWLOCK_UNLOCK(&tag_global_rwlock);
-
-	if (current == 0)
-	{
-		/* all deps are already fulfilled */
-		_STARPU_LOG_OUT_TAG("all deps are already fulfilled");
-		return 0;
-	}
-
-	/* there is at least one task that is not finished */
-	struct _starpu_cg *cg = create_cg_apps(current);
-
-	for (i = 0; i < current; i++)
-	{
-		_starpu_tag_add_succ(tag_array[i], cg);
-		_starpu_spin_unlock(&tag_array[i]->lock);
-	}
 
 	STARPU_PTHREAD_MUTEX_LOCK(&cg->succ.succ_apps.cg_mutex);
 
@@ -524,20 +603,24 @@ int starpu_tag_wait(starpu_tag_t id)
 
 struct starpu_task *starpu_tag_get_task(starpu_tag_t id)
 {
+	struct _starpu_tag_shard *shard = _starpu_tag_get_shard(id);
 	struct _starpu_tag_table *entry;
 	struct _starpu_tag *tag;
 
-	STARPU_PTHREAD_RWLOCK_WRLOCK(&tag_global_rwlock);
-	HASH_FIND_UINT64_T(tag_htbl, &id, entry);
-	STARPU_PTHREAD_RWLOCK_UNLOCK(&tag_global_rwlock);
+	struct starpu_task *task = NULL;
 
-	if (!entry)
-		return NULL;
-	tag = entry->tag;
-
-	if (!tag->job)
-		return NULL;
+	STARPU_PTHREAD_RWLOCK_RDLOCK(&shard->rwlock);
+	HASH_FIND_UINT64_T(shard->htbl, &id, entry);
+	if (entry)
+	{
+		tag = &entry->tag;
+		_starpu_spin_lock(&tag->lock);
+		if (tag->job)
+			task = tag->job->task;
+		_starpu_spin_unlock(&tag->lock);
+	}
+	STARPU_PTHREAD_RWLOCK_UNLOCK(&shard->rwlock);
 
-	return tag->job->task;
+	return task;
 }
 
@@ -21,9 +21,11 @@
 #include <core/dependencies/tags.h>
 #include <core/jobs.h>
 #include <core/task.h>
+#include <core/task_graph.h>
 #include <core/sched_policy.h>
 #include <core/dependencies/data_concurrency.h>
 #include <profiling/bound.h>
+#include <profiling/online_bound.h>
 #include <core/debug.h>
 
 static struct _starpu_cg *create_cg_task(unsigned ntags, struct _starpu_job *j)
@@ -140,6 +142,8 @@ void _starpu_task_declare_deps_array(struct starpu_task *task, unsigned ndeps, s
 
 		_STARPU_TRACE_TASK_DEPS(dep_job, job);
 		_starpu_bound_task_dep(job, dep_job);
+		if (_starpu_online_bound_enabled)
+			_starpu_online_bound_task_dep(job, dep_job);
 		if (check)
 		{
 			STARPU_AYU_ADDDEPENDENCY(dep_job->job_id, 0, job->job_id);
@@ -153,8 +157,59 @@ void _starpu_task_declare_deps_array(struct starpu_task *task, unsigned ndeps, s
 	}
 }
 
+void _starpu_job_reserve_successors(struct _starpu_job *j, unsigned nsuccs)
+{
+	struct _starpu_cg_list *successors = &j->job_successors;
+
+	if (nsuccs > successors->succ_list_size)
+	{
+		_STARPU_REALLOC(successors->succ, nsuccs * sizeof(successors->succ[0]));
+		successors->succ_list_size = nsuccs;
+	}
+}
+
+void _starpu_job_declare_recorded_deps(struct _starpu_job *j, unsigned ndeps, struct _starpu_job *dep_jobs[])
+{
+	if (ndeps == 0)
+		return;
+
+	/* None of the jobs is submitted yet, so nobody else can access them
+	 * and we do not need to take their locks */
+	struct _starpu_cg *cg = create_cg_task(ndeps, j);
+
+#ifdef STARPU_DEBUG
+	_STARPU_MALLOC(cg->deps, ndeps * sizeof(cg->deps[0]));
+	_STARPU_MALLOC(cg->done, ndeps * sizeof(cg->done[0]));
+#endif
+
+	unsigned i;
+	for (i = 0; i < ndeps; i++)
+	{
+		struct _starpu_job *dep_job = dep_jobs[i];
+		struct _starpu_cg_list *successors = &dep_job->job_successors;
+
+#ifdef STARPU_DEBUG
+		cg->deps[i] = dep_job;
+		cg->done[i] = 0;
+#endif
+
+		_STARPU_TRACE_TASK_DEPS(dep_job, j);
+		_starpu_bound_task_dep(j, dep_job);
+		if (_starpu_online_bound_enabled)
+			_starpu_online_bound_task_dep(j, dep_job);
+		if (_starpu_graph_record)
+			_starpu_graph_add_job_dep(j, dep_job);
+
+		STARPU_ASSERT(!successors->terminated);
+		STARPU_ASSERT(successors->nsuccs < successors->succ_list_size);
+		successors->succ[successors->nsuccs++] = cg;
+	}
+}
+
 void starpu_task_declare_deps_array(struct starpu_task *task, unsigned ndeps, struct starpu_task *task_array[])
 {
+	if (STARPU_UNLIKELY(_starpu_task_graph_capturing))
+		_starpu_task_graph_capture_deps(task);
 	_starpu_task_declare_deps_array(task, ndeps, task_array, 1);
 }
 
@@ -178,6 +233,9 @@ void starpu_task_declare_end_deps_array(struct starpu_task *task, unsigned ndeps
 {
 	unsigned i;
 
+	if (STARPU_UNLIKELY(_starpu_task_graph_capturing))
+		_starpu_task_graph_capture_deps(task);
+
 	starpu_task_end_dep_add(task, ndeps);
 	for (i = 0; i < ndeps; i++)
 	{
@@ -149,6 +149,8 @@ int starpu_disk_register(struct starpu_disk_ops *func, void *parameter, starpu_s
 
 	_starpu_mem_chunk_disk_register(disk_memnode);
 
+	starpu_disk_set_codec(disk_memnode, starpu_getenv_number_default("STARPU_DISK_COMPRESS", 0) ? &starpu_disk_codec_lz : NULL);
+
 	return disk_memnode;
 }
 
@@ -519,6 +521,15 @@ void _starpu_swap_init(void)
 		return;
 #endif
 
+	}
+	else if (!strcmp(backend, "unistd_uring"))
+	{
+#ifdef STARPU_HAVE_IO_URING
+		ops = &starpu_disk_unistd_uring_ops;
+#else
+		_STARPU_DISP("Warning: io_uring support is not compiled in, could not enable disk swap\n");
+		return;
+#endif
 	}
 	else if (!strcmp(backend, "leveldb"))
 	{
@@ -65,6 +65,13 @@ void _starpu_disk_unregister(void);
 
 void _starpu_swap_init(void);
 
+/** Whether \p handle gets compressed when stored on \p disk_node */
+int _starpu_disk_compress_handle(starpu_data_handle_t handle, unsigned disk_node);
+/** Replace the packed data \p *ptr of \p size bytes allocated on \p node with its compressed version for \p disk_node, and return the size of the latter */
+size_t _starpu_disk_compress(unsigned disk_node, unsigned node, void **ptr, size_t size);
+/** Replace the compressed data \p *ptr of \p size bytes read from \p disk_node with its decompressed version, and return the size of the latter */
+size_t _starpu_disk_decompress(unsigned disk_node, unsigned node, void **ptr, size_t size);
+
 static inline struct _starpu_disk_event *_starpu_disk_get_event(union _starpu_async_channel_event *_event)
 {
 	struct _starpu_disk_event *event;
@@ -0,0 +1,416 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+/*
+ * Transparent compression of the data evicted to disk nodes.
+ *
+ * The data is packed, and the packed buffer is compressed into a blob made of
+ * a small header followed by the compressed bytes, which is what gets written
+ * to the disk backend with full_write. Data which does not compress is stored
+ * as such behind the header.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <common/config.h>
+#include <common/utils.h>
+#include <core/disk.h>
+#include <core/perfmodel/perfmodel.h>
+#include <datawizard/coherency.h>
+#include <datawizard/memory_nodes.h>
+
+#define STARPU_DISK_COMPRESS_MAGIC 0x53504c5aU
+
+/* Re-estimate the effective disk bandwidth every this many transfers */
+#define STARPU_DISK_COMPRESS_UPDATE 16
+
+struct _starpu_disk_compress_header
+{
+	uint32_t magic;
+	/* 0 if the data is stored as such */
+	uint32_t compressed;
+	/* Size of the data */
+	uint64_t size;
+	/* Size of what follows the header */
+	uint64_t stored_size;
+};
+
+struct _starpu_disk_compress
+{
+	struct starpu_disk_codec *codec;
+
+	/* Statistics since the codec was set */
+	double raw_written;
+	double written;
+	double compress_time;
+	double raw_read;
+	double decompress_time;
+	unsigned ntransfers;
+};
+
+static struct _starpu_disk_compress disk_compress[STARPU_MAXNODES];
+static starpu_pthread_mutex_t disk_compress_mutex = STARPU_PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Bundled codec, using the LZ4 block format: a sequence of
+ * token, [literal length], literals, offset, [match length]
+ * where the token holds 4 bits of literal length and 4 bits of match length.
+ */
+
+#define LZ_HASH_LOG 12
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_OFFSET 65535
+/* The last match has to start that many bytes before the end */
+#define LZ_MF_LIMIT 12
+/* The last bytes are always literals */
+#define LZ_LAST_LITERALS 5
+
+static inline uint32_t lz_read32(const unsigned char *p)
+{
+	uint32_t v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static inline unsigned lz_hash(uint32_t v)
+{
+	return (v * 2654435761U) >> (32 - LZ_HASH_LOG);
+}
+
+static unsigned char *lz_put_length(unsigned char *op, size_t length)
+{
+	length -= 15;
+	while (length >= 255)
+	{
+		*op++ = 255;
+		length -= 255;
+	}
+	*op++ = length;
+	return op;
+}
+
+static size_t lz_bound(size_t size)
+{
+	return size + size / 255 + 16;
+}
+
+static size_t lz_compress(const void *src, size_t size, void *dst, size_t dst_size)
+{
+	const unsigned char *base = src;
+	const unsigned char *ip = base;
+	const unsigned char *anchor = base;
+	const unsigned char *iend = base + size;
+	const unsigned char *mflimit = size > LZ_MF_LIMIT ? iend - LZ_MF_LIMIT : base;
+	const unsigned char *mlimit = size > LZ_LAST_LITERALS ? iend - LZ_LAST_LITERALS : base;
+	unsigned char *op = dst;
+	unsigned char *oend = op + dst_size;
+	uint32_t table[1 << LZ_HASH_LOG];
+	unsigned misses = 0;
+	size_t literals;
+
+	if (size > UINT32_MAX)
+		return 0;
+	memset(table, 0, sizeof(table));
+
+	while (ip < mflimit)
+	{
+		uint32_t seq = lz_read32(ip);
+		unsigned h = lz_hash(seq);
+		const unsigned char *ref = base + table[h];
+		table[h] = ip - base;
+
+		if (ref >= ip || ip - ref > LZ_MAX_OFFSET || lz_read32(ref) != seq)
+		{
+			/* Skip faster through data which does not compress */
+			ip += 1 + (misses++ >> 6);
+			continue;
+		}
+		misses = 0;
+
+		/* Extend the match backwards and forwards */
+		while (ip > anchor && ref > base && ip[-1] == ref[-1])
+		{
+			ip--;
+			ref--;
+		}
+		const unsigned char *mp = ip + LZ_MIN_MATCH;
+		const unsigned char *rp = ref + LZ_MIN_MATCH;
+		while (mp < mlimit && *mp == *rp)
+		{
+			mp++;
+			rp++;
+		}
+
+		literals = ip - anchor;
+		size_t match = mp - ip - LZ_MIN_MATCH;
+		if ((size_t) (oend - op) < 1 + literals / 255 + 1 + literals + 2 + match / 255 + 1)
+			return 0;
+
+		unsigned char *token = op++;
+		*token = (literals >= 15 ? 15 : literals) << 4 | (match >= 15 ? 15 : match);
+		if (literals >= 15)
+			op = lz_put_length(op, literals);
+		memcpy(op, anchor, literals);
+		op += literals;
+		size_t offset = ip - ref;
+		*op++ = offset & 0xff;
+		*op++ = offset >> 8;
+		if (match >= 15)
+			op = lz_put_length(op, match);
+
+		ip = anchor = mp;
+	}
+
+	literals = iend - anchor;
+	if ((size_t) (oend - op) < 1 + literals / 255 + 1 + literals)
+		return 0;
+	*op++ = (literals >= 15 ? 15 : literals) << 4;
+	if (literals >= 15)
+		op = lz_put_length(op, literals);
+	memcpy(op, anchor, literals);
+	op += literals;
+
+	return op - (unsigned char *) dst;
+}
+
+static int lz_get_length(const unsigned char **ip, const unsigned char *iend, size_t *length)
+{
+	unsigned char c;
+	do
+	{
+		if (*ip >= iend)
+			return -1;
+		c = *(*ip)++;
+		*length += c;
+	}
+	while (c == 255);
+	return 0;
+}
+
+static size_t lz_decompress(const void *src, size_t size, void *dst, size_t dst_size)
+{
+	const unsigned char *ip = src;
+	const unsigned char *iend = ip + size;
+	unsigned char *ostart = dst;
+	unsigned char *op = ostart;
+	unsigned char *oend = op + dst_size;
+
+	while (ip < iend)
+	{
+		unsigned token = *ip++;
+		size_t length = token >> 4;
+
+		if (length == 15 && lz_get_length(&ip, iend, &length))
+			return 0;
+		if ((size_t) (iend - ip) < length || (size_t) (oend - op) < length)
+			return 0;
+		memcpy(op, ip, length);
+		op += length;
+		ip += length;
+
+		/* The last sequence has no match */
+		if (ip == iend)
+			break;
+
+		if (iend - ip < 2)
+			return 0;
+		size_t offset = ip[0] | (ip[1] << 8);
+		ip += 2;
+		if (offset == 0 || offset > (size_t) (op - ostart))
+			return 0;
+
+		length = token & 15;
+		if (length == 15 && lz_get_length(&ip, iend, &length))
+			return 0;
+		length += LZ_MIN_MATCH;
+		if ((size_t) (oend - op) < length)
+			return 0;
+
+		const unsigned char *ref = op - offset;
+		if (offset >= length)
+		{
+			memcpy(op, ref, length);
+			op += length;
+		}
+		else
+		{
+			/* Overlapping copy, which repeats the pattern */
+			while (length--)
+				*op++ = *ref++;
+		}
+	}
+
+	return op - ostart;
+}
+
+struct starpu_disk_codec starpu_disk_codec_lz =
+{
+	.name = "lz",
+	.bound = lz_bound,
+	.compress = lz_compress,
+	.decompress = lz_decompress,
+};
+
+void starpu_disk_set_codec(unsigned node, struct starpu_disk_codec *codec)
+{
+	STARPU_ASSERT(node < STARPU_MAXNODES);
+	STARPU_ASSERT_MSG(!codec || starpu_node_get_kind(node) == STARPU_DISK_RAM, "node %u is not a disk node", node);
+
+	STARPU_PTHREAD_MUTEX_LOCK(&disk_compress_mutex);
+	memset(&disk_compress[node], 0, sizeof(disk_compress[node]));
+	disk_compress[node].codec = codec;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&disk_compress_mutex);
+
+	/* Start again from the raw disk bandwidth */
+	_starpu_update_bandwidth_disk_codec(node, 0., 0., 1.);
+}
+
+struct starpu_disk_codec *starpu_disk_get_codec(unsigned node)
+{
+	STARPU_ASSERT(node < STARPU_MAXNODES);
+	return disk_compress[node].codec;
+}
+
+int _starpu_disk_compress_handle(starpu_data_handle_t handle, unsigned disk_node)
+{
+	if (!disk_compress[disk_node].codec || !handle->disk_compress)
+		return 0;
+	if (!handle->ops->pack_data || !handle->ops->unpack_data)
+		return 0;
+	/* Data registered on a disk has to be kept as such there */
+	if (handle->home_node >= 0 && starpu_node_get_kind(handle->home_node) == STARPU_DISK_RAM)
+		return 0;
+	return 1;
+}
+
+/* Account a compression or decompression, and let the bus model take it into account from time to time */
+static void record_transfer(unsigned disk_node, int write, size_t raw, size_t stored, double time)
+{
+	struct _starpu_disk_compress *compress = &disk_compress[disk_node];
+	double compress_speed = 0., decompress_speed = 0., ratio = 1.;
+	int update;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&disk_compress_mutex);
+	if (write)
+	{
+		compress->raw_written += raw;
+		compress->written += stored;
+		compress->compress_time += time;
+	}
+	else
+	{
+		compress->raw_read += raw;
+		compress->decompress_time += time;
+	}
+	update = ++compress->ntransfers % STARPU_DISK_COMPRESS_UPDATE == 0;
+	if (update)
+	{
+		if (compress->compress_time > 0.)
+			compress_speed = compress->raw_written / compress->compress_time;
+		if (compress->decompress_time > 0.)
+			decompress_speed = compress->raw_read / compress->decompress_time;
+		if (compress->raw_written > 0.)
+			ratio = compress->written / compress->raw_written;
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&disk_compress_mutex);
+
+	if (update)
+	{
+		_STARPU_DEBUG("disk node %u: compression ratio %f, %f MB/s compression, %f MB/s decompression\n", disk_node, ratio, compress_speed, decompress_speed);
+		_starpu_update_bandwidth_disk_codec(disk_node, compress_speed, decompress_speed, ratio);
+	}
+}
+
+size_t _starpu_disk_compress(unsigned disk_node, unsigned node, void **ptr, size_t size)
+{
+	struct starpu_disk_codec *codec = disk_compress[disk_node].codec;
+	struct _starpu_disk_compress_header *header;
+	size_t bound = codec->bound(size);
+	size_t page_size = getpagesize();
+	size_t stored_size, blob_size;
+	void *scratch;
+	void *blob;
+	double start, end;
+	int ret;
+
+	_STARPU_MALLOC(scratch, bound);
+	start = starpu_timing_now();
+	stored_size = size ? codec->compress(*ptr, size, scratch, bound) : 0;
+	end = starpu_timing_now();
+
+	int compressed = stored_size > 0 && stored_size < size;
+	if (!compressed)
+		stored_size = size;
+
+	/* The o_direct backends can only write multiples of the page size */
+	blob_size = sizeof(*header) + stored_size;
+	blob_size = (blob_size + page_size - 1) / page_size * page_size;
+
+	ret = _starpu_malloc_flags_on_node(node, &blob, blob_size, 0);
+	STARPU_ASSERT_MSG(ret == 0, "Cannot allocate %zu bytes to compress data for disk node %u", blob_size, disk_node);
+	header = blob;
+	header->magic = STARPU_DISK_COMPRESS_MAGIC;
+	header->compressed = compressed;
+	header->size = size;
+	header->stored_size = stored_size;
+	memcpy(header + 1, compressed ? scratch : *ptr, stored_size);
+	memset((char *) (header + 1) + stored_size, 0, blob_size - sizeof(*header) - stored_size);
+
+	free(scratch);
+	_starpu_free_flags_on_node(node, *ptr, size, 0);
+	*ptr = blob;
+
+	record_transfer(disk_node, 1, size, stored_size, end - start);
+
+	return blob_size;
+}
+
+size_t _starpu_disk_decompress(unsigned disk_node, unsigned node, void **ptr, size_t size)
+{
+	struct starpu_disk_codec *codec = disk_compress[disk_node].codec;
+	struct _starpu_disk_compress_header *header = *ptr;
+	size_t data_size;
+	void *data;
+	double start, end;
+	int ret;
+
+	/* Some backends may return a bigger object than what was written */
+	STARPU_ASSERT_MSG(size >= sizeof(*header) && header->magic == STARPU_DISK_COMPRESS_MAGIC && header->stored_size <= size - sizeof(*header),
+			  "Corrupted compressed data read from disk node %u", disk_node);
+	data_size = header->size;
+
+	ret = _starpu_malloc_flags_on_node(node, &data, data_size, 0);
+	STARPU_ASSERT_MSG(ret == 0, "Cannot allocate %zu bytes to decompress data from disk node %u", data_size, disk_node);
+
+	start = starpu_timing_now();
+	if (header->compressed)
+	{
+		size_t decompressed = codec->decompress(header + 1, header->stored_size, data, data_size);
+		STARPU_ASSERT_MSG(decompressed == data_size, "Corrupted compressed data read from disk node %u", disk_node);
+	}
+	else
+		memcpy(data, header + 1, data_size);
+	end = starpu_timing_now();
+
+	_starpu_free_flags_on_node(node, *ptr, size, 0);
+	*ptr = data;
+
+	record_transfer(disk_node, 0, data_size, size - sizeof(*header), end - start);
+
+	return data_size;
+}
@@ -0,0 +1,613 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include <common/config.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include <starpu.h>
+#include <core/disk.h>
+#include <core/perfmodel/perfmodel.h>
+#include <core/disk_ops/unistd/disk_unistd_global.h>
+#include <datawizard/data_request.h>
+
+/* ------------------- use io_uring to write on disk -------------------  */
+
+/*
+ * This reuses the unistd backend for managing the files (one file per
+ * allocation), but asynchronous requests are pushed through an io_uring ring
+ * per disk node. Requests are only queued in the submission ring by
+ * async_read/async_write, they get submitted to the kernel in one batch on
+ * the next test_request/wait_request call, which also reap the completions.
+ *
+ * When the kernel does not support io_uring (or it is forbidden, e.g. by a
+ * seccomp filter), async_read/async_write just return NULL and StarPU falls
+ * back to the synchronous read/write functions.
+ */
+
+/* Number of slots in the registered file table */
+#define STARPU_URING_FIXED_FILES 64
+
+struct starpu_unistd_uring_base
+{
+	/* The underlying unistd base, which manages the directory */
+	void *unistd_base;
+
+	/* -1 if io_uring could not be set up */
+	int ring_fd;
+	unsigned sq_entries;
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_sqe *sqes;
+	struct io_uring_cqe *cqes;
+	void *sq_ring;
+	size_t sq_ring_size;
+	void *cq_ring;
+	size_t cq_ring_size;
+	size_t sqes_size;
+
+	/* Number of requests written in the submission ring, but not submitted yet */
+	unsigned queued;
+	/* Number of requests submitted to the kernel, but not reaped yet */
+	unsigned inflight;
+
+	/* Whether the file table could be registered */
+	int fixed_files;
+	int files[STARPU_URING_FIXED_FILES];
+
+	/* Protects the rings and the file table */
+	starpu_pthread_mutex_t mutex;
+};
+
+struct starpu_unistd_uring_obj
+{
+	/* Must be first, the unistd functions get this pointer */
+	struct starpu_unistd_global_obj obj;
+	/* Index in the registered file table, or -1 */
+	int fixed;
+};
+
+struct starpu_unistd_uring_request
+{
+	struct starpu_unistd_uring_base *base;
+	struct starpu_unistd_uring_obj *obj;
+	/* Descriptor used for the request, reopened if the object does not keep one opened */
+	int fd;
+	int reopened;
+	int write;
+	/* What remains to be transferred, updated on short transfers */
+	struct iovec iov;
+	off_t offset;
+	int finished;
+};
+
+static int _starpu_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+#ifdef __NR_io_uring_setup
+	return syscall(__NR_io_uring_setup, entries, p);
+#else
+	(void) entries;
+	(void) p;
+	errno = ENOSYS;
+	return -1;
+#endif
+}
+
+static int _starpu_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+	return syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static int _starpu_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args)
+{
+	return syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+static int _starpu_uring_init_ring(struct starpu_unistd_uring_base *base, unsigned entries)
+{
+	struct io_uring_params p;
+	memset(&p, 0, sizeof(p));
+
+	base->ring_fd = _starpu_uring_setup(entries, &p);
+	if (base->ring_fd < 0)
+		return -errno;
+
+	base->sq_ring_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	base->cq_ring_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+	{
+		if (base->cq_ring_size > base->sq_ring_size)
+			base->sq_ring_size = base->cq_ring_size;
+		base->cq_ring_size = base->sq_ring_size;
+	}
+
+	base->sq_ring = mmap(NULL, base->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, base->ring_fd, IORING_OFF_SQ_RING);
+	if (base->sq_ring == MAP_FAILED)
+		goto err_close;
+
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+		base->cq_ring = base->sq_ring;
+	else
+	{
+		base->cq_ring = mmap(NULL, base->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, base->ring_fd, IORING_OFF_CQ_RING);
+		if (base->cq_ring == MAP_FAILED)
+			goto err_sq;
+	}
+
+	base->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	base->sqes = mmap(NULL, base->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, base->ring_fd, IORING_OFF_SQES);
+	if (base->sqes == MAP_FAILED)
+		goto err_cq;
+
+	base->sq_entries = p.sq_entries;
+	base->sq_head = (unsigned *) ((char *) base->sq_ring + p.sq_off.head);
+	base->sq_tail = (unsigned *) ((char *) base->sq_ring + p.sq_off.tail);
+	base->sq_mask = (unsigned *) ((char *) base->sq_ring + p.sq_off.ring_mask);
+	base->sq_array = (unsigned *) ((char *) base->sq_ring + p.sq_off.array);
+	base->cq_head = (unsigned *) ((char *) base->cq_ring + p.cq_off.head);
+	base->cq_tail = (unsigned *) ((char *) base->cq_ring + p.cq_off.tail);
+	base->cq_mask = (unsigned *) ((char *) base->cq_ring + p.cq_off.ring_mask);
+	base->cqes = (struct io_uring_cqe *) ((char *) base->cq_ring + p.cq_off.cqes);
+
+	return 0;
+
+err_cq:
+	if (base->cq_ring != base->sq_ring)
+		munmap(base->cq_ring, base->cq_ring_size);
+err_sq:
+	munmap(base->sq_ring, base->sq_ring_size);
+err_close:
+	close(base->ring_fd);
+	base->ring_fd = -1;
+	return -ENOMEM;
+}
+
+static void _starpu_uring_fini_ring(struct starpu_unistd_uring_base *base)
+{
+	if (base->ring_fd < 0)
+		return;
+
+	munmap(base->sqes, base->sqes_size);
+	if (base->cq_ring != base->sq_ring)
+		munmap(base->cq_ring, base->cq_ring_size);
+	munmap(base->sq_ring, base->sq_ring_size);
+	/* This also unregisters the file table */
+	close(base->ring_fd);
+	base->ring_fd = -1;
+}
+
+/* Set the registered file table slot SLOT to FD, or to -1 to clear it.
+ * Called with the base mutex held */
+static int _starpu_uring_update_file(struct starpu_unistd_uring_base *base, int slot, int fd)
+{
+	struct io_uring_files_update update;
+	memset(&update, 0, sizeof(update));
+	update.offset = slot;
+	update.fds = (uintptr_t) &fd;
+
+	int ret = _starpu_uring_register(base->ring_fd, IORING_REGISTER_FILES_UPDATE, &update, 1);
+	if (ret < 0)
+		return -errno;
+	base->files[slot] = fd;
+	return 0;
+}
+
+/* Try to put the descriptor of OBJ in the registered file table, so the
+ * kernel does not have to look it up on each request */
+static void _starpu_uring_register_obj(struct starpu_unistd_uring_base *base, struct starpu_unistd_uring_obj *obj)
+{
+	unsigned i;
+
+	obj->fixed = -1;
+	if (!base->fixed_files || obj->obj.descriptor < 0)
+		return;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&base->mutex);
+	for (i = 0; i < STARPU_URING_FIXED_FILES; i++)
+		if (base->files[i] == -1)
+		{
+			if (_starpu_uring_update_file(base, i, obj->obj.descriptor) == 0)
+				obj->fixed = i;
+			break;
+		}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&base->mutex);
+}
+
+static void _starpu_uring_unregister_obj(struct starpu_unistd_uring_base *base, struct starpu_unistd_uring_obj *obj)
+{
+	if (obj->fixed < 0)
+		return;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&base->mutex);
+	int ret = _starpu_uring_update_file(base, obj->fixed, -1);
+	STARPU_ASSERT_MSG(ret == 0, "Unregistering file from io_uring failed: %s", strerror(-ret));
+	STARPU_PTHREAD_MUTEX_UNLOCK(&base->mutex);
+	obj->fixed = -1;
+}
+
+static void _starpu_uring_submit(struct starpu_unistd_uring_base *base, unsigned min_complete);
+static void _starpu_uring_reap(struct starpu_unistd_uring_base *base);
+
+/* Write the SQE for REQ in the submission ring, without entering the kernel.
+ * Called with the base mutex held */
+static void _starpu_uring_queue(struct starpu_unistd_uring_base *base, struct starpu_unistd_uring_request *req)
+{
+	/* Make sure to never have more requests than the completion ring can hold */
+	while (base->queued + base->inflight >= base->sq_entries)
+	{
+		_starpu_uring_submit(base, 1);
+		_starpu_uring_reap(base);
+	}
+
+	unsigned tail = *base->sq_tail;
+	unsigned index = tail & *base->sq_mask;
+	struct io_uring_sqe *sqe = &base->sqes[index];
+
+	memset(sqe, 0, sizeof(*sqe));
+	/* READV/WRITEV are available since the very first io_uring kernels */
+	sqe->opcode = req->write ? IORING_OP_WRITEV : IORING_OP_READV;
+	if (req->obj->fixed >= 0)
+	{
+		sqe->fd = req->obj->fixed;
+		sqe->flags |= IOSQE_FIXED_FILE;
+	}
+	else
+		sqe->fd = req->fd;
+	sqe->off = req->obj->obj.offset + req->offset;
+	sqe->addr = (uintptr_t) &req->iov;
+	sqe->len = 1;
+	sqe->user_data = (uintptr_t) req;
+
+	base->sq_array[index] = index;
+	/* The SQE has to be visible before the tail update */
+	STARPU_WMB();
+	*(volatile unsigned *) base->sq_tail = tail + 1;
+	base->queued++;
+}
+
+/* Submit all queued requests in one system call, and wait for MIN_COMPLETE of
+ * them to complete. Called with the base mutex held */
+static void _starpu_uring_submit(struct starpu_unistd_uring_base *base, unsigned min_complete)
+{
+	if (!base->queued && !min_complete)
+		return;
+
+	while (1)
+	{
+		int ret = _starpu_uring_enter(base->ring_fd, base->queued, min_complete, min_complete ? IORING_ENTER_GETEVENTS : 0);
+		if (ret < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			if ((errno == EAGAIN || errno == EBUSY) && !min_complete)
+				/* The kernel is busy, we will retry on next test */
+				return;
+			STARPU_ASSERT_MSG(errno == EAGAIN || errno == EBUSY, "io_uring_enter failed: %s", strerror(errno));
+			continue;
+		}
+		base->queued -= ret;
+		base->inflight += ret;
+		return;
+	}
+}
+
+/* Process the completion of REQ. Called with the base mutex held */
+static void _starpu_uring_complete(struct starpu_unistd_uring_base *base, struct starpu_unistd_uring_request *req, int res)
+{
+	if (res == -EAGAIN || res == -EINTR)
+	{
+		_starpu_uring_queue(base, req);
+		return;
+	}
+
+	STARPU_ASSERT_MSG(res >= 0, "Starpu Disk io_uring %s failed: size %lu got error %s", req->write ? "write" : "read", (unsigned long) req->iov.iov_len, strerror(-res));
+	STARPU_ASSERT_MSG(res > 0, "Starpu Disk io_uring %s reached the end of file: offset %lu", req->write ? "write" : "read", (unsigned long) req->offset);
+
+	if ((size_t) res < req->iov.iov_len)
+	{
+		/* Short transfer, resubmit the remainder */
+		req->iov.iov_base = (char *) req->iov.iov_base + res;
+		req->iov.iov_len -= res;
+		req->offset += res;
+		_starpu_uring_queue(base, req);
+		return;
+	}
+
+	if (req->reopened)
+	{
+		close(req->fd);
+		req->reopened = 0;
+	}
+	req->finished = 1;
+}
+
+/* Reap all available completions. Called with the base mutex held */
+static void _starpu_uring_reap(struct starpu_unistd_uring_base *base)
+{
+	while (1)
+	{
+		unsigned head = *base->cq_head;
+		unsigned tail = *(volatile unsigned *) base->cq_tail;
+		if (head == tail)
+			break;
+		/* Read the CQE only after having seen the tail */
+		STARPU_RMB();
+
+		struct io_uring_cqe *cqe = &base->cqes[head & *base->cq_mask];
+		struct starpu_unistd_uring_request *req = (void *) (uintptr_t) cqe->user_data;
+		int res = cqe->res;
+
+		/* Release the CQE slot before possibly queueing again */
+		STARPU_SYNCHRONIZE();
+		*(volatile unsigned *) base->cq_head = head + 1;
+		base->inflight--;
+
+		_starpu_uring_complete(base, req, res);
+	}
+}
+
+static void *starpu_unistd_uring_async_rw(void *base, void *obj, void *buf, off_t offset, size_t size, int write)
+{
+	struct starpu_unistd_uring_base *fileBase = (struct starpu_unistd_uring_base *) base;
+	struct starpu_unistd_uring_obj *tmp = (struct starpu_unistd_uring_obj *) obj;
+	struct starpu_unistd_uring_request *req;
+
+	if (fileBase->ring_fd < 0)
+		return NULL;
+
+	_STARPU_CALLOC(req, 1, sizeof(*req));
+	req->base = fileBase;
+	req->obj = tmp;
+	req->write = write;
+	req->iov.iov_base = buf;
+	req->iov.iov_len = size;
+	req->offset = offset;
+
+	req->fd = tmp->obj.descriptor;
+	if (req->fd < 0)
+	{
+		/* Too many opened files, the unistd layer did not keep it opened */
+		req->fd = open(tmp->obj.path, tmp->obj.flags);
+		STARPU_ASSERT_MSG(req->fd >= 0, "Reopening file %s failed: errno %d", tmp->obj.path, errno);
+		req->reopened = 1;
+	}
+
+	if (size == 0)
+	{
+		if (req->reopened)
+			close(req->fd);
+		req->finished = 1;
+		return req;
+	}
+
+	STARPU_PTHREAD_MUTEX_LOCK(&fileBase->mutex);
+	_starpu_uring_queue(fileBase, req);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&fileBase->mutex);
+
+	return req;
+}
+
+/* allocation memory on disk */
+static void *starpu_unistd_uring_alloc(void *base, size_t size)
+{
+	struct starpu_unistd_uring_base *fileBase = (struct starpu_unistd_uring_base *) base;
+	struct starpu_unistd_uring_obj *obj;
+	_STARPU_MALLOC(obj, sizeof(struct starpu_unistd_uring_obj));
+	obj->obj.flags = O_RDWR | O_BINARY;
+	if (!starpu_unistd_global_alloc(&obj->obj, fileBase->unistd_base, size))
+		return NULL;
+	_starpu_uring_register_obj(fileBase, obj);
+	return obj;
+}
+
+/* free memory on disk */
+static void starpu_unistd_uring_free(void *base, void *obj, size_t size)
+{
+	struct starpu_unistd_uring_base *fileBase = (struct starpu_unistd_uring_base *) base;
+	_starpu_uring_unregister_obj(fileBase, obj);
+	starpu_unistd_global_free(fileBase->unistd_base, obj, size);
+}
+
+/* open an existing memory on disk */
+static void *starpu_unistd_uring_open(void *base, void *pos, size_t size)
+{
+	struct starpu_unistd_uring_base *fileBase = (struct starpu_unistd_uring_base *) base;
+	struct starpu_unistd_uring_obj *obj;
+	_STARPU_MALLOC(obj, sizeof(struct starpu_unistd_uring_obj));
+	obj->obj.flags = O_RDWR | O_BINARY;
+	if (!starpu_unistd_global_open(&obj->obj, fileBase->unistd_base, pos, size))
+		return NULL;
+	_starpu_uring_register_obj(fileBase, obj);
+	return obj;
+}
+
+/* free memory without delete it */
+static void starpu_unistd_uring_close(void *base, void *obj, size_t size)
+{
+	struct starpu_unistd_uring_base *fileBase = (struct starpu_unistd_uring_base *) base;
+	_starpu_uring_unregister_obj(fileBase, obj);
+	starpu_unistd_global_close(fileBase->unistd_base, obj, size);
+}
+
+static int starpu_unistd_uring_full_read(void *base, void *obj, void **ptr, size_t *size, unsigned dst_node)
+{
+	struct starpu_unistd_uring_base *fileBase = (struct starpu_unistd_uring_base *) base;
+	return starpu_unistd_global_full_read(fileBase->unistd_base, obj, ptr, size, dst_node);
+}
+
+static int starpu_unistd_uring_full_write(void *base, void *obj, void *ptr, size_t size)
+{
+	struct starpu_unistd_uring_base *fileBase = (struct starpu_unistd_uring_base *) base;
+	return starpu_unistd_global_full_write(fileBase->unistd_base, obj, ptr, size);
+}
+
+/* create a new copy of parameter == base */
+static void *starpu_unistd_uring_plug(void *parameter, starpu_ssize_t size)
+{
+	struct starpu_unistd_uring_base *base;
+	unsigned i;
+
+	_STARPU_CALLOC(base, 1, sizeof(*base));
+	base->unistd_base = starpu_unistd_global_plug(parameter, size);
+	STARPU_PTHREAD_MUTEX_INIT(&base->mutex, NULL);
+	for (i = 0; i < STARPU_URING_FIXED_FILES; i++)
+		base->files[i] = -1;
+
+	unsigned nb_event = MAX_PENDING_REQUESTS_PER_NODE + MAX_PENDING_PREFETCH_REQUESTS_PER_NODE + MAX_PENDING_IDLE_REQUESTS_PER_NODE;
+	int ret = _starpu_uring_init_ring(base, nb_event);
+	if (ret)
+	{
+		_STARPU_DISP("Warning: could not set up io_uring (%s), the unistd_uring disk backend will only perform synchronous transfers\n", strerror(-ret));
+		return base;
+	}
+
+	/* Sparse file tables are supported since Linux 5.5, just do without on older kernels */
+	base->fixed_files = _starpu_uring_register(base->ring_fd, IORING_REGISTER_FILES, base->files, STARPU_URING_FIXED_FILES) == 0;
+
+	return base;
+}
+
+/* free memory allocated for the base */
+static void starpu_unistd_uring_unplug(void *base)
+{
+	struct starpu_unistd_uring_base *fileBase = (struct starpu_unistd_uring_base *) base;
+
+	STARPU_ASSERT_MSG(fileBase->queued == 0 && fileBase->inflight == 0, "Some io_uring requests are still pending");
+	_starpu_uring_fini_ring(fileBase);
+	STARPU_PTHREAD_MUTEX_DESTROY(&fileBase->mutex);
+	starpu_unistd_global_unplug(fileBase->unistd_base);
+	free(fileBase);
+}
+
+static int starpu_unistd_uring_bandwidth(unsigned node, void *base)
+{
+	struct starpu_unistd_uring_base *fileBase = (struct starpu_unistd_uring_base *) base;
+	return _starpu_get_unistd_global_bandwidth_between_disk_and_main_ram(node, fileBase->unistd_base);
+}
+
+static void *starpu_unistd_uring_async_read(void *base, void *obj, void *buf, off_t offset, size_t size)
+{
+	return starpu_unistd_uring_async_rw(base, obj, buf, offset, size, 0);
+}
+
+static void *starpu_unistd_uring_async_write(void *base, void *obj, void *buf, off_t offset, size_t size)
+{
+	return starpu_unistd_uring_async_rw(base, obj, buf, offset, size, 1);
+}
+
+static void *starpu_unistd_uring_async_full_read(void *base, void *obj, void **ptr, size_t *size, unsigned dst_node)
+{
+	struct starpu_unistd_uring_base *fileBase = (struct starpu_unistd_uring_base *) base;
+
+	if (fileBase->ring_fd < 0)
+		return NULL;
+
+	/* Short transfers are resubmitted, so no need to limit the size like the unistd backend does */
+	*size = starpu_unistd_global_get_size(obj);
+	_starpu_malloc_flags_on_node(dst_node, ptr, *size, 0);
+	return starpu_unistd_uring_async_read(base, obj, *ptr, 0, *size);
+}
+
+static void *starpu_unistd_uring_async_full_write(void *base, void *obj, void *ptr, size_t size)
+{
+	struct starpu_unistd_uring_base *fileBase = (struct starpu_unistd_uring_base *) base;
+
+	if (fileBase->ring_fd < 0)
+		return NULL;
+
+	/* update file size to realise the next good full_read */
+	starpu_unistd_global_resize(fileBase->unistd_base, obj, size);
+
+	return starpu_unistd_uring_async_write(base, obj, ptr, 0, size);
+}
+
+static int starpu_unistd_uring_test_request(void *async_channel)
+{
+	struct starpu_unistd_uring_request *req = (struct starpu_unistd_uring_request *) async_channel;
+	struct starpu_unistd_uring_base *base = req->base;
+	int finished;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&base->mutex);
+	if (!req->finished)
+	{
+		/* Submit everything that was queued since last time in one go */
+		_starpu_uring_submit(base, 0);
+		_starpu_uring_reap(base);
+	}
+	finished = req->finished;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&base->mutex);
+
+	return finished;
+}
+
+static void starpu_unistd_uring_wait_request(void *async_channel)
+{
+	struct starpu_unistd_uring_request *req = (struct starpu_unistd_uring_request *) async_channel;
+	struct starpu_unistd_uring_base *base = req->base;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&base->mutex);
+	while (!req->finished)
+	{
+		_starpu_uring_submit(base, 1);
+		_starpu_uring_reap(base);
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&base->mutex);
+}
+
+static void starpu_unistd_uring_free_request(void *async_channel)
+{
+	struct starpu_unistd_uring_request *req = (struct starpu_unistd_uring_request *) async_channel;
+	STARPU_ASSERT(req->finished);
+	free(req);
+}
+
+struct starpu_disk_ops starpu_disk_unistd_uring_ops =
+{
+	.alloc = starpu_unistd_uring_alloc,
+	.free = starpu_unistd_uring_free,
+	.open = starpu_unistd_uring_open,
+	.close = starpu_unistd_uring_close,
+	.read = starpu_unistd_global_read,
+	.write = starpu_unistd_global_write,
+	.plug = starpu_unistd_uring_plug,
+	.unplug = starpu_unistd_uring_unplug,
+	.copy = NULL,
+	.bandwidth = starpu_unistd_uring_bandwidth,
+	.async_read = starpu_unistd_uring_async_read,
+	.async_write = starpu_unistd_uring_async_write,
+	.wait_request = starpu_unistd_uring_wait_request,
+	.test_request = starpu_unistd_uring_test_request,
+	.free_request = starpu_unistd_uring_free_request,
+	.async_full_read = starpu_unistd_uring_async_full_read,
+	.async_full_write = starpu_unistd_uring_async_full_write,
+	.full_read = starpu_unistd_uring_full_read,
+	.full_write = starpu_unistd_uring_full_write
+};
@@ -34,6 +34,7 @@
 #include <core/disk.h>
 #include <core/perfmodel/perfmodel.h>
 #include <core/disk_ops/unistd/disk_unistd_global.h>
+#include <core/disk_ops/unistd/disk_unistd_slab.h>
 #include <datawizard/copy_driver.h>
 #include <datawizard/data_request.h>
 #include <datawizard/memory_manager.h>
@@ -98,6 +99,8 @@ struct starpu_unistd_base
 {
 	char * path;
 	int created;
+	/* When all objects are stored in one file, see STARPU_DISK_UNISTD_SLAB */
+	struct starpu_unistd_slab *slab;
 	/* To know which thread handles the copy function */
 #ifdef STARPU_UNISTD_USE_COPY
 	unsigned disk_index;
@@ -170,6 +173,20 @@ static void _starpu_unistd_init(struct starpu_unistd_global_obj *obj, int descri
 	obj->descriptor = descriptor;
 	obj->path = path;
 	obj->size = size;
+	obj->extent = NULL;
+	obj->offset = 0;
+}
+
+static void _starpu_unistd_slab_init_obj(struct starpu_unistd_global_obj *obj, struct starpu_unistd_slab *slab, struct starpu_unistd_slab_extent *extent, size_t size)
+{
+	STARPU_PTHREAD_MUTEX_INIT(&obj->mutex, NULL);
+
+	/* The slab file stays opened, and does not count in the opened files */
+	obj->descriptor = slab->descriptor;
+	obj->path = NULL;
+	obj->size = size;
+	obj->extent = extent;
+	obj->offset = extent->offset;
 }
 
 static int _starpu_unistd_reopen(struct starpu_unistd_global_obj *obj)
@@ -186,7 +203,7 @@ static void _starpu_unistd_reclose(int id)
 
 static void _starpu_unistd_close(struct starpu_unistd_global_obj *obj)
 {
-	if (obj->descriptor < 0)
+	if (obj->descriptor < 0 || obj->extent)
 		return;
 
 	if (starpu_unistd_opened_files < MAX_OPEN_FILES)
@@ -209,6 +226,19 @@ void *starpu_unistd_global_alloc(struct starpu_unistd_global_obj *obj, void *bas
 {
 	int id;
 	struct starpu_unistd_base * fileBase = (struct starpu_unistd_base *) base;
+
+	if (fileBase->slab)
+	{
+		struct starpu_unistd_slab_extent *extent = _starpu_unistd_slab_alloc(fileBase->slab, obj->flags, size, NULL);
+		if (!extent)
+		{
+			free(obj);
+			return NULL;
+		}
+		_starpu_unistd_slab_init_obj(obj, fileBase->slab, extent, size);
+		return obj;
+	}
+
 	char *baseCpy = _starpu_mktemp_many(fileBase->path, TEMP_HIERARCHY_DEPTH, obj->flags, &id);
 
 	/* fail */
@@ -236,10 +266,18 @@ void *starpu_unistd_global_alloc(struct starpu_unistd_global_obj *obj, void *bas
 }
 
 /* free memory on disk */
-void starpu_unistd_global_free(void *base STARPU_ATTRIBUTE_UNUSED, void *obj, size_t size STARPU_ATTRIBUTE_UNUSED)
+void starpu_unistd_global_free(void *base, void *obj, size_t size STARPU_ATTRIBUTE_UNUSED)
 {
 	struct starpu_unistd_global_obj *tmp = (struct starpu_unistd_global_obj *) obj;
 
+	if (tmp->extent)
+	{
+		struct starpu_unistd_base *fileBase = (struct starpu_unistd_base *) base;
+		_starpu_unistd_slab_free(fileBase->slab, tmp->extent);
+		_starpu_unistd_fini(tmp);
+		return;
+	}
+
 	_starpu_unistd_close(tmp);
 	unlink(tmp->path);
 	_starpu_rmtemp_many(tmp->path, TEMP_HIERARCHY_DEPTH);
@@ -250,6 +288,24 @@ void starpu_unistd_global_free(void *base STARPU_ATTRIBUTE_UNUSED, void *obj, si
 void *starpu_unistd_global_open(struct starpu_unistd_global_obj *obj, void *base, void *pos, size_t size)
 {
 	struct starpu_unistd_base *fileBase = (struct starpu_unistd_base *) base;
+
+	if (fileBase->slab)
+	{
+		/* Reattach an object saved in the slab file */
+		struct starpu_unistd_slab_extent *extent = _starpu_unistd_slab_lookup(fileBase->slab, obj->flags, pos);
+		if (extent)
+		{
+			if (size > extent->size)
+			{
+				_STARPU_DISP("Object %s of the disk slab file only has %lu bytes, %lu were requested\n", (char *) pos, (unsigned long) extent->size, (unsigned long) size);
+				free(obj);
+				return NULL;
+			}
+			_starpu_unistd_slab_init_obj(obj, fileBase->slab, extent, size);
+			return obj;
+		}
+	}
+
 	/* create template */
 	char *baseCpy;
 	_STARPU_MALLOC(baseCpy, strlen(fileBase->path)+1+strlen(pos)+1);
@@ -257,6 +313,19 @@ void *starpu_unistd_global_open(struct starpu_unistd_global_obj *obj, void *base
 	snprintf(baseCpy, strlen(fileBase->path)+1+strlen(pos)+1, "%s/%s", fileBase->path, (char *)pos);
 
 	int id = open(baseCpy, obj->flags);
+	if (id < 0 && errno == ENOENT && fileBase->slab)
+	{
+		/* No such file, create the object in the slab file */
+		free(baseCpy);
+		struct starpu_unistd_slab_extent *extent = _starpu_unistd_slab_alloc(fileBase->slab, obj->flags, size, pos);
+		if (!extent)
+		{
+			free(obj);
+			return NULL;
+		}
+		_starpu_unistd_slab_init_obj(obj, fileBase->slab, extent, size);
+		return obj;
+	}
 	if (id < 0)
 	{
 		free(obj);
@@ -286,6 +355,8 @@ int starpu_unistd_global_read(void *base STARPU_ATTRIBUTE_UNUSED, void *obj, voi
 	int fd = tmp->descriptor;
 	starpu_ssize_t bytes_to_write = size;
 
+	offset += tmp->offset;
+
 #ifdef HAVE_PREAD
 	if (fd >= 0)
 	{
@@ -348,7 +419,7 @@ void *starpu_unistd_global_async_read(void *base, void *obj, void *buf, off_t of
 	starpu_aiocb->len = size;
 	starpu_aiocb->finished = 0;
 	starpu_aiocb->base = fileBase;
-	io_prep_pread(iocb, fd, buf, size, offset);
+	io_prep_pread(iocb, fd, buf, size, offset + tmp->offset);
 	if ((err = io_submit(fileBase->ctx, 1, &iocb)) < 0)
 	{
 		_STARPU_DISP("Warning: io_submit returned %d (%s)\n", err, strerror(err));
@@ -383,7 +454,7 @@ void *starpu_unistd_global_async_read(void *base STARPU_ATTRIBUTE_UNUSED, void *
 		fd = _starpu_unistd_reopen(obj);
 
 	aiocb->aio_fildes = fd;
-	aiocb->aio_offset = offset;
+	aiocb->aio_offset = offset + tmp->offset;
 	aiocb->aio_nbytes = size;
 	aiocb->aio_buf = buf;
 	aiocb->aio_reqprio = 0;
@@ -400,25 +471,39 @@ void *starpu_unistd_global_async_read(void *base STARPU_ATTRIBUTE_UNUSED, void *
 }
 #endif
 
-int starpu_unistd_global_full_read(void *base STARPU_ATTRIBUTE_UNUSED, void *obj, void **ptr, size_t *size, unsigned dst_node)
+/* size of the object, as set by the last full_write */
+size_t starpu_unistd_global_get_size(void *obj)
 {
 	struct starpu_unistd_global_obj *tmp = (struct starpu_unistd_global_obj *) obj;
+	size_t size;
+
+	if (tmp->extent)
+		/* The slab extent may be bigger */
+		return tmp->size;
+
 	int fd = tmp->descriptor;
 
 	if (fd < 0)
 		fd = _starpu_unistd_reopen(obj);
 #ifdef STARPU_HAVE_WINDOWS
-	*size = _filelength(fd);
+	size = _filelength(fd);
 #else
 	struct stat st;
 	int ret = fstat(fd, &st);
 	STARPU_ASSERT(ret==0);
 
-	*size = st.st_size;
+	size = st.st_size;
 #endif
 	if (tmp->descriptor < 0)
 		_starpu_unistd_reclose(fd);
 
+	return size;
+}
+
+int starpu_unistd_global_full_read(void *base STARPU_ATTRIBUTE_UNUSED, void *obj, void **ptr, size_t *size, unsigned dst_node)
+{
+	*size = starpu_unistd_global_get_size(obj);
+
 	/* Allocated aligned buffer */
 	_starpu_malloc_flags_on_node(dst_node, ptr, *size, 0);
 	return starpu_unistd_global_read(base, obj, *ptr, 0, *size);
@@ -432,6 +517,8 @@ int starpu_unistd_global_write(void *base STARPU_ATTRIBUTE_UNUSED, void *obj, co
 	int fd = tmp->descriptor;
 	starpu_ssize_t bytes_to_write = size;
 
+	offset += tmp->offset;
+
 #ifdef HAVE_PWRITE
 	if (fd >= 0)
 	{
@@ -493,7 +580,7 @@ void *starpu_unistd_global_async_write(void *base, void *obj, void *buf, off_t o
 	starpu_aiocb->len = size;
 	starpu_aiocb->finished = 0;
 	starpu_aiocb->base = fileBase;
-	io_prep_pwrite(iocb, fd, buf, size, offset);
+	io_prep_pwrite(iocb, fd, buf, size, offset + tmp->offset);
 	if ((err = io_submit(fileBase->ctx, 1, &iocb)) < 0)
 	{
 		_STARPU_DISP("Warning: io_submit returned %d (%s)\n", err, strerror(err));
@@ -528,7 +615,7 @@ void *starpu_unistd_global_async_write(void *base STARPU_ATTRIBUTE_UNUSED, void
 		fd = _starpu_unistd_reopen(obj);
 
 	aiocb->aio_fildes = fd;
-	aiocb->aio_offset = offset;
+	aiocb->aio_offset = offset + tmp->offset;
 	aiocb->aio_nbytes = size;
 	aiocb->aio_buf = buf;
 	aiocb->aio_reqprio = 0;
@@ -546,12 +633,21 @@ void *starpu_unistd_global_async_write(void *base STARPU_ATTRIBUTE_UNUSED, void
 }
 #endif
 
-int starpu_unistd_global_full_write(void *base STARPU_ATTRIBUTE_UNUSED, void *obj, void *ptr, size_t size)
+/* update object size to realise the next good full_read, the content is not kept */
+void starpu_unistd_global_resize(void *base, void *obj, size_t size)
 {
 	struct starpu_unistd_global_obj *tmp = (struct starpu_unistd_global_obj *) obj;
 
-	/* update file size to realise the next good full_read */
-	if(size != tmp->size)
+	if (size == tmp->size)
+		return;
+
+	if (tmp->extent)
+	{
+		struct starpu_unistd_base *fileBase = (struct starpu_unistd_base *) base;
+		tmp->extent = _starpu_unistd_slab_realloc(fileBase->slab, tmp->extent, size);
+		tmp->offset = tmp->extent->offset;
+	}
+	else
 	{
 		int fd = tmp->descriptor;
 
@@ -561,8 +657,13 @@ int starpu_unistd_global_full_write(void *base STARPU_ATTRIBUTE_UNUSED, void *ob
 		if (tmp->descriptor < 0)
 			_starpu_unistd_reclose(fd);
 		STARPU_ASSERT(val == 0);
-		tmp->size = size;
 	}
+	tmp->size = size;
+}
+
+int starpu_unistd_global_full_write(void *base, void *obj, void *ptr, size_t size)
+{
+	starpu_unistd_global_resize(base, obj, size);
 
 	return starpu_unistd_global_write(base, obj, ptr, 0, size);
 }
@@ -570,20 +671,7 @@ int starpu_unistd_global_full_write(void *base STARPU_ATTRIBUTE_UNUSED, void *ob
 #if defined(HAVE_AIO_H)
 void * starpu_unistd_global_async_full_read (void * base, void * obj, void ** ptr, size_t * size, unsigned dst_node)
 {
-	struct starpu_unistd_global_obj *tmp = (struct starpu_unistd_global_obj *) obj;
-	int fd = tmp->descriptor;
-
-	if (fd < 0)
-		fd = _starpu_unistd_reopen(obj);
-#ifdef STARPU_HAVE_WINDOWS
-	*size = _filelength(fd);
-#else
-	struct stat st;
-	int ret = fstat(fd, &st);
-	STARPU_ASSERT(ret==0);
-
-	*size = st.st_size;
-#endif
+	*size = starpu_unistd_global_get_size(obj);
 #ifdef STARPU_LINUX_SYS
 	/* on Linux, read() (and similar system calls) will transfer at most 0x7ffff000 bytes, see read(2) */
 	/* FIXME: make starpu_unistd_global_test_request and starpu_unistd_global_wait_request
@@ -592,9 +680,6 @@ void * starpu_unistd_global_async_full_read (void * base, void * obj, void ** pt
 		return NULL;
 #endif
 
-	if (tmp->descriptor < 0)
-		_starpu_unistd_reclose(fd);
-
 	/* Allocated aligned buffer */
 	_starpu_malloc_flags_on_node(dst_node, ptr, *size, 0);
 	return starpu_unistd_global_async_read(base, obj, *ptr, 0, *size);
@@ -602,8 +687,6 @@ void * starpu_unistd_global_async_full_read (void * base, void * obj, void ** pt
 
 void * starpu_unistd_global_async_full_write (void * base, void * obj, void * ptr, size_t size)
 {
-	struct starpu_unistd_global_obj *tmp = (struct starpu_unistd_global_obj *) obj;
-
 #ifdef STARPU_LINUX_SYS
 	/* on Linux, write() (and similar system calls) will transfer at most 0x7ffff000 bytes, see write(2) */
 	/* FIXME: make starpu_unistd_global_test_request and starpu_unistd_global_wait_request
@@ -612,19 +695,7 @@ void * starpu_unistd_global_async_full_write (void * base, void * obj, void * pt
 		return NULL;
 #endif
 
-	/* update file size to realise the next good full_read */
-	if(size != tmp->size)
-	{
-		int fd = tmp->descriptor;
-
-		if (fd < 0)
-			fd = _starpu_unistd_reopen(obj);
-		int val = _starpu_ftruncate(fd,size);
-		if (tmp->descriptor < 0)
-			_starpu_unistd_reclose(fd);
-		STARPU_ASSERT(val == 0);
-		tmp->size = size;
-	}
+	starpu_unistd_global_resize(base, obj, size);
 
 	return starpu_unistd_global_async_write(base, obj, ptr, 0, size);
 }
@@ -697,7 +768,7 @@ static void initialize_working_thread(struct starpu_unistd_copy_thread *internal
 #endif
 
 /* create a new copy of parameter == base */
-void *starpu_unistd_global_plug(void *parameter, starpu_ssize_t size STARPU_ATTRIBUTE_UNUSED)
+void *starpu_unistd_global_plug(void *parameter, starpu_ssize_t size)
 {
 	struct starpu_unistd_base * base;
 	struct stat buf;
@@ -713,6 +784,11 @@ void *starpu_unistd_global_plug(void *parameter, starpu_ssize_t size STARPU_ATTR
 		base->created = 1;
 	}
 
+	if (starpu_getenv_number_default("STARPU_DISK_UNISTD_SLAB", 0))
+		base->slab = _starpu_unistd_slab_init(base->path, size);
+	else
+		base->slab = NULL;
+
 #if defined(HAVE_LIBAIO_H)
 	STARPU_PTHREAD_MUTEX_INIT(&base->mutex, NULL);
 	base->hashtable = NULL;
@@ -762,6 +838,8 @@ void starpu_unistd_global_unplug(void *base)
 	STARPU_PTHREAD_MUTEX_DESTROY(&fileBase->mutex);
 	io_destroy(fileBase->ctx);
 #endif
+	if (fileBase->slab)
+		_starpu_unistd_slab_fini(fileBase->slab);
 	if (fileBase->created)
 		rmdir(fileBase->path);
 
@@ -1102,8 +1180,8 @@ void *  starpu_unistd_global_copy(void *base_src, void* obj_src, off_t offset_sr
 	work->fd_dst = fd_dst;
 	work->obj_src = unistd_obj_src;
 	work->obj_dst = unistd_obj_dst;
-	work->off_src = offset_src;
-	work->off_dst = offset_dst;
+	work->off_src = offset_src + unistd_obj_src->offset;
+	work->off_dst = offset_dst + unistd_obj_dst->offset;
 	work->len = size;
 	/* currently not used by copy_file_range */
 	work->flags = 0;
@@ -42,6 +42,8 @@ typedef loff_t starpu_loff_t;
 typedef off_t starpu_loff_t;
 #endif
 
+struct starpu_unistd_slab_extent;
+
 struct starpu_unistd_global_obj
 {
 	int descriptor;
@@ -49,6 +51,10 @@ struct starpu_unistd_global_obj
 	size_t size;
 	int flags;
 	starpu_pthread_mutex_t mutex;
+	/** When the object is stored in the slab file of the disk node, its extent, NULL otherwise */
+	struct starpu_unistd_slab_extent *extent;
+	/** Offset of the object within the file */
+	off_t offset;
 };
 
 void * starpu_unistd_global_alloc (struct starpu_unistd_global_obj * obj, void *base, size_t size);
@@ -69,6 +75,8 @@ int starpu_unistd_global_test_request(void * async_channel);
 void starpu_unistd_global_free_request(void * async_channel);
 int starpu_unistd_global_full_read(void *base, void * obj, void ** ptr, size_t * size, unsigned dst_node);
 int starpu_unistd_global_full_write (void * base, void * obj, void * ptr, size_t size);
+size_t starpu_unistd_global_get_size(void *obj);
+void starpu_unistd_global_resize(void *base, void *obj, size_t size);
 #ifdef STARPU_UNISTD_USE_COPY
 void *	starpu_unistd_global_copy(void *base_src, void* obj_src, off_t offset_src,  void *base_dst, void* obj_dst, off_t offset_dst, size_t size);
 #endif
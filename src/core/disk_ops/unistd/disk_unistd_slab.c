@@ -0,0 +1,481 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include <common/config.h>
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#include <starpu.h>
+#include <common/utils.h>
+#include <core/disk_ops/unistd/disk_unistd_global.h>
+#include <core/disk_ops/unistd/disk_unistd_slab.h>
+
+/*
+ * Instead of creating one file per allocation, all objects of the disk node
+ * are stored in one big file, split in extents. Free extents are kept in
+ * per-size free lists: since data of a given footprint always allocates the
+ * same size, an extent freed by some data is directly reused by the next
+ * data with the same footprint. When there is no free extent of the exact
+ * size, the smallest bigger free extent is split, and otherwise the file is
+ * grown. Adjacent free extents are coalesced, and a free extent at the end of
+ * the file is given back to the tail.
+ *
+ * Extents allocated through starpu_disk_open() are named, and their list is
+ * saved along the file on shutdown, so that they can be reopened by the next
+ * run without any copy.
+ */
+
+#define STARPU_UNISTD_SLAB_FILE "starpu_slab"
+#define STARPU_UNISTD_SLAB_MAP "starpu_slab.map"
+#define STARPU_UNISTD_SLAB_MAGIC "STARPU_UNISTD_SLAB 1"
+#define STARPU_UNISTD_SLAB_GROW (64*1024*1024)
+
+static size_t _starpu_slab_round(struct starpu_unistd_slab *slab, size_t size)
+{
+	if (size == 0)
+		size = 1;
+	return (size + slab->align - 1) / slab->align * slab->align;
+}
+
+static struct starpu_unistd_slab_extent *_starpu_slab_new_extent(off_t offset, size_t size)
+{
+	struct starpu_unistd_slab_extent *extent;
+	_STARPU_CALLOC(extent, 1, sizeof(*extent));
+	extent->offset = offset;
+	extent->size = size;
+	return extent;
+}
+
+/* Insert EXTENT after PREV in the file list, at the beginning if PREV is NULL */
+static void _starpu_slab_insert_after(struct starpu_unistd_slab *slab, struct starpu_unistd_slab_extent *prev, struct starpu_unistd_slab_extent *extent)
+{
+	extent->prev = prev;
+	if (prev)
+	{
+		extent->next = prev->next;
+		prev->next = extent;
+	}
+	else
+	{
+		extent->next = slab->first;
+		slab->first = extent;
+	}
+	if (extent->next)
+		extent->next->prev = extent;
+	else
+		slab->last = extent;
+}
+
+static void _starpu_slab_remove(struct starpu_unistd_slab *slab, struct starpu_unistd_slab_extent *extent)
+{
+	if (extent->prev)
+		extent->prev->next = extent->next;
+	else
+		slab->first = extent->next;
+	if (extent->next)
+		extent->next->prev = extent->prev;
+	else
+		slab->last = extent->prev;
+}
+
+static void _starpu_slab_class_push(struct starpu_unistd_slab *slab, struct starpu_unistd_slab_extent *extent)
+{
+	struct starpu_unistd_slab_class *class;
+	HASH_FIND(hh, slab->classes, &extent->size, sizeof(extent->size), class);
+	if (!class)
+	{
+		_STARPU_CALLOC(class, 1, sizeof(*class));
+		class->size = extent->size;
+		HASH_ADD(hh, slab->classes, size, sizeof(class->size), class);
+	}
+	extent->free_prev = NULL;
+	extent->free_next = class->free;
+	if (class->free)
+		class->free->free_prev = extent;
+	class->free = extent;
+}
+
+static void _starpu_slab_class_remove(struct starpu_unistd_slab *slab, struct starpu_unistd_slab_extent *extent)
+{
+	struct starpu_unistd_slab_class *class;
+	HASH_FIND(hh, slab->classes, &extent->size, sizeof(extent->size), class);
+	STARPU_ASSERT(class);
+
+	if (extent->free_prev)
+		extent->free_prev->free_next = extent->free_next;
+	else
+		class->free = extent->free_next;
+	if (extent->free_next)
+		extent->free_next->free_prev = extent->free_prev;
+
+	if (!class->free)
+	{
+		/* Keep the hash table small, for best-fit lookups */
+		HASH_DEL(slab->classes, class);
+		free(class);
+	}
+}
+
+/* Make the file big enough to hold END bytes */
+static int _starpu_slab_grow(struct starpu_unistd_slab *slab, off_t end)
+{
+	if (end <= slab->file_size)
+		return 0;
+
+	off_t new_size = (end + slab->grow - 1) / slab->grow * slab->grow;
+	int ret;
+#ifdef HAVE_POSIX_FALLOCATE
+	/* Really reserve the blocks, to avoid both fragmentation and ENOSPC on writeback */
+	ret = posix_fallocate(slab->descriptor, slab->file_size, new_size - slab->file_size);
+	if (ret == 0)
+	{
+		slab->file_size = new_size;
+		return 0;
+	}
+	if (ret != EINVAL && ret != EOPNOTSUPP)
+		return -ret;
+	/* Not supported by the filesystem, just extend the file */
+#endif
+	ret = _starpu_ftruncate(slab->descriptor, new_size);
+	if (ret < 0)
+		return -errno;
+	slab->file_size = new_size;
+	return 0;
+}
+
+static int _starpu_slab_open_file(struct starpu_unistd_slab *slab, int flags)
+{
+	struct stat st;
+
+	if (slab->descriptor >= 0)
+		return 0;
+
+	/* Do not truncate, named extents of a previous run may be there */
+	int fd = open(slab->path, flags | O_CREAT, S_IRUSR | S_IWUSR);
+	if (fd < 0)
+		return -errno;
+	if (fstat(fd, &st) < 0)
+	{
+		close(fd);
+		return -errno;
+	}
+	slab->descriptor = fd;
+	slab->file_size = st.st_size;
+	return 0;
+}
+
+/* Find room for SIZE bytes. Called with the slab mutex held */
+static struct starpu_unistd_slab_extent *_starpu_slab_get_extent(struct starpu_unistd_slab *slab, size_t size)
+{
+	struct starpu_unistd_slab_class *class, *tmp, *best = NULL;
+	struct starpu_unistd_slab_extent *extent;
+
+	size = _starpu_slab_round(slab, size);
+
+	/* Exact size first, that is what data with the same footprint freed */
+	HASH_FIND(hh, slab->classes, &size, sizeof(size), class);
+	if (class)
+	{
+		extent = class->free;
+		_starpu_slab_class_remove(slab, extent);
+		extent->used = 1;
+		return extent;
+	}
+
+	/* Then the smallest bigger one */
+	HASH_ITER(hh, slab->classes, class, tmp)
+	{
+		if (class->size > size && (!best || class->size < best->size))
+			best = class;
+	}
+	if (best)
+	{
+		extent = best->free;
+		_starpu_slab_class_remove(slab, extent);
+		extent->used = 1;
+
+		/* Give back the remainder. Its next neighbour is used, since
+		 * free extents are always coalesced */
+		struct starpu_unistd_slab_extent *remainder = _starpu_slab_new_extent(extent->offset + size, extent->size - size);
+		extent->size = size;
+		_starpu_slab_insert_after(slab, extent, remainder);
+		_starpu_slab_class_push(slab, remainder);
+		return extent;
+	}
+
+	/* And eventually append to the file */
+	off_t offset = slab->last ? slab->last->offset + (off_t) slab->last->size : 0;
+	if (_starpu_slab_grow(slab, offset + size) < 0)
+		return NULL;
+	extent = _starpu_slab_new_extent(offset, size);
+	extent->used = 1;
+	_starpu_slab_insert_after(slab, slab->last, extent);
+	return extent;
+}
+
+/* Called with the slab mutex held */
+static void _starpu_slab_release(struct starpu_unistd_slab *slab, struct starpu_unistd_slab_extent *extent)
+{
+	struct starpu_unistd_slab_extent *neighbour;
+
+	extent->used = 0;
+	if (extent->name)
+	{
+		HASH_DEL(slab->names, extent);
+		free(extent->name);
+		extent->name = NULL;
+	}
+
+	neighbour = extent->prev;
+	if (neighbour && !neighbour->used)
+	{
+		_starpu_slab_class_remove(slab, neighbour);
+		neighbour->size += extent->size;
+		_starpu_slab_remove(slab, extent);
+		free(extent);
+		extent = neighbour;
+	}
+
+	neighbour = extent->next;
+	if (neighbour && !neighbour->used)
+	{
+		_starpu_slab_class_remove(slab, neighbour);
+		extent->size += neighbour->size;
+		_starpu_slab_remove(slab, neighbour);
+		free(neighbour);
+	}
+
+	if (extent == slab->last)
+	{
+		/* Give it back to the tail, the file itself stays preallocated */
+		_starpu_slab_remove(slab, extent);
+		free(extent);
+	}
+	else
+		_starpu_slab_class_push(slab, extent);
+}
+
+static void _starpu_slab_add_name(struct starpu_unistd_slab *slab, struct starpu_unistd_slab_extent *extent, const char *name)
+{
+	extent->name = strdup(name);
+	STARPU_ASSERT(extent->name);
+	HASH_ADD_KEYPTR(hh, slab->names, extent->name, strlen(extent->name), extent);
+}
+
+/* Reload the named extents saved by a previous run */
+static void _starpu_slab_load_map(struct starpu_unistd_slab *slab)
+{
+	char line[1024];
+	FILE *f = fopen(slab->map_path, "r");
+	if (!f)
+		return;
+
+	if (!fgets(line, sizeof(line), f) || strncmp(line, STARPU_UNISTD_SLAB_MAGIC, strlen(STARPU_UNISTD_SLAB_MAGIC)))
+	{
+		_STARPU_DISP("Warning: ignoring invalid disk slab map %s\n", slab->map_path);
+		fclose(f);
+		return;
+	}
+
+	off_t end = 0;
+	while (fgets(line, sizeof(line), f))
+	{
+		long long offset;
+		unsigned long long size;
+		int n;
+
+		if (sscanf(line, "%lld %llu %n", &offset, &size, &n) != 2 || offset < end || size % slab->align)
+		{
+			_STARPU_DISP("Warning: ignoring invalid line in disk slab map %s: %s", slab->map_path, line);
+			continue;
+		}
+		line[strcspn(line, "\n")] = 0;
+
+		if (offset > end)
+		{
+			/* Room left between named extents */
+			struct starpu_unistd_slab_extent *hole = _starpu_slab_new_extent(end, offset - end);
+			_starpu_slab_insert_after(slab, slab->last, hole);
+			_starpu_slab_class_push(slab, hole);
+		}
+
+		struct starpu_unistd_slab_extent *extent = _starpu_slab_new_extent(offset, size);
+		extent->used = 1;
+		_starpu_slab_insert_after(slab, slab->last, extent);
+		_starpu_slab_add_name(slab, extent, line + n);
+		end = offset + size;
+	}
+	fclose(f);
+}
+
+static void _starpu_slab_save_map(struct starpu_unistd_slab *slab)
+{
+	struct starpu_unistd_slab_extent *extent;
+	char *tmp_path;
+	FILE *f;
+
+	if (!slab->names)
+	{
+		/* Nothing to keep */
+		unlink(slab->map_path);
+		unlink(slab->path);
+		return;
+	}
+
+	_STARPU_MALLOC(tmp_path, strlen(slab->map_path) + 5);
+	sprintf(tmp_path, "%s.tmp", slab->map_path);
+	f = fopen(tmp_path, "w");
+	if (!f)
+	{
+		_STARPU_DISP("Warning: could not save disk slab map %s: %s\n", tmp_path, strerror(errno));
+		free(tmp_path);
+		return;
+	}
+	fprintf(f, "%s\n", STARPU_UNISTD_SLAB_MAGIC);
+	for (extent = slab->first; extent; extent = extent->next)
+		if (extent->used && extent->name)
+			fprintf(f, "%lld %llu %s\n", (long long) extent->offset, (unsigned long long) extent->size, extent->name);
+
+	if (slab->descriptor >= 0)
+		fsync(slab->descriptor);
+	if (fclose(f) || rename(tmp_path, slab->map_path))
+	{
+		_STARPU_DISP("Warning: could not save disk slab map %s: %s\n", slab->map_path, strerror(errno));
+		unlink(tmp_path);
+	}
+	free(tmp_path);
+}
+
+struct starpu_unistd_slab *_starpu_unistd_slab_init(const char *dir, starpu_ssize_t size)
+{
+	struct starpu_unistd_slab *slab;
+	_STARPU_CALLOC(slab, 1, sizeof(*slab));
+
+	_STARPU_MALLOC(slab->path, strlen(dir) + 1 + strlen(STARPU_UNISTD_SLAB_FILE) + 1);
+	sprintf(slab->path, "%s/%s", dir, STARPU_UNISTD_SLAB_FILE);
+	_STARPU_MALLOC(slab->map_path, strlen(dir) + 1 + strlen(STARPU_UNISTD_SLAB_MAP) + 1);
+	sprintf(slab->map_path, "%s/%s", dir, STARPU_UNISTD_SLAB_MAP);
+
+	slab->descriptor = -1;
+	/* Keep extents aligned for the O_DIRECT variant */
+	slab->align = getpagesize();
+	slab->grow = STARPU_UNISTD_SLAB_GROW;
+	if (size > 0 && (size_t) size < slab->grow)
+		slab->grow = _starpu_slab_round(slab, size);
+	STARPU_PTHREAD_MUTEX_INIT(&slab->mutex, NULL);
+
+	_starpu_slab_load_map(slab);
+
+	return slab;
+}
+
+void _starpu_unistd_slab_fini(struct starpu_unistd_slab *slab)
+{
+	struct starpu_unistd_slab_extent *extent, *next;
+	struct starpu_unistd_slab_class *class, *tmp;
+
+	_starpu_slab_save_map(slab);
+
+	HASH_CLEAR(hh, slab->names);
+	for (extent = slab->first; extent; extent = next)
+	{
+		next = extent->next;
+		free(extent->name);
+		free(extent);
+	}
+	HASH_ITER(hh, slab->classes, class, tmp)
+	{
+		HASH_DEL(slab->classes, class);
+		free(class);
+	}
+
+	if (slab->descriptor >= 0)
+		close(slab->descriptor);
+	STARPU_PTHREAD_MUTEX_DESTROY(&slab->mutex);
+	free(slab->path);
+	free(slab->map_path);
+	free(slab);
+}
+
+struct starpu_unistd_slab_extent *_starpu_unistd_slab_alloc(struct starpu_unistd_slab *slab, int flags, size_t size, const char *name)
+{
+	struct starpu_unistd_slab_extent *extent = NULL;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&slab->mutex);
+	int ret = _starpu_slab_open_file(slab, flags);
+	if (ret < 0)
+		_STARPU_DISP("Could not open disk slab file %s: %s\n", slab->path, strerror(-ret));
+	else
+	{
+		extent = _starpu_slab_get_extent(slab, size);
+		if (extent && name)
+			_starpu_slab_add_name(slab, extent, name);
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&slab->mutex);
+
+	return extent;
+}
+
+struct starpu_unistd_slab_extent *_starpu_unistd_slab_lookup(struct starpu_unistd_slab *slab, int flags, const char *name)
+{
+	struct starpu_unistd_slab_extent *extent;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&slab->mutex);
+	HASH_FIND(hh, slab->names, name, strlen(name), extent);
+	if (extent && _starpu_slab_open_file(slab, flags) < 0)
+		extent = NULL;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&slab->mutex);
+
+	return extent;
+}
+
+struct starpu_unistd_slab_extent *_starpu_unistd_slab_realloc(struct starpu_unistd_slab *slab, struct starpu_unistd_slab_extent *extent, size_t size)
+{
+	struct starpu_unistd_slab_extent *new_extent;
+
+	if (_starpu_slab_round(slab, size) <= extent->size)
+		return extent;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&slab->mutex);
+	new_extent = _starpu_slab_get_extent(slab, size);
+	STARPU_ASSERT_MSG(new_extent, "Could not grow disk slab file %s to %lu bytes", slab->path, (unsigned long) size);
+	if (extent->name)
+	{
+		/* Transfer the name */
+		char *name = extent->name;
+		HASH_DEL(slab->names, extent);
+		extent->name = NULL;
+		new_extent->name = name;
+		HASH_ADD_KEYPTR(hh, slab->names, new_extent->name, strlen(new_extent->name), new_extent);
+	}
+	_starpu_slab_release(slab, extent);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&slab->mutex);
+
+	return new_extent;
+}
+
+void _starpu_unistd_slab_free(struct starpu_unistd_slab *slab, struct starpu_unistd_slab_extent *extent)
+{
+	STARPU_PTHREAD_MUTEX_LOCK(&slab->mutex);
+	_starpu_slab_release(slab, extent);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&slab->mutex);
+}
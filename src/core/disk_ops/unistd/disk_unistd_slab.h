@@ -0,0 +1,93 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#ifndef __DISK_UNISTD_SLAB_H__
+#define __DISK_UNISTD_SLAB_H__
+
+/** @file */
+
+#include <common/uthash.h>
+
+#pragma GCC visibility push(hidden)
+
+/**
+   Part of the slab file of a disk node, either used by an object, or free
+*/
+struct starpu_unistd_slab_extent
+{
+	off_t offset;
+	/** Capacity, multiple of the slab alignment */
+	size_t size;
+	/** Name given to starpu_disk_open(), NULL for anonymous allocations */
+	char *name;
+	int used;
+	/** Neighbours in the file */
+	struct starpu_unistd_slab_extent *prev;
+	struct starpu_unistd_slab_extent *next;
+	/** Neighbours in the free list of the size class */
+	struct starpu_unistd_slab_extent *free_prev;
+	struct starpu_unistd_slab_extent *free_next;
+	/** Hash of the named extents */
+	UT_hash_handle hh;
+};
+
+/**
+   Free extents of a given size
+*/
+struct starpu_unistd_slab_class
+{
+	size_t size;
+	struct starpu_unistd_slab_extent *free;
+	UT_hash_handle hh;
+};
+
+/**
+   One big file holding all the objects of a disk node
+*/
+struct starpu_unistd_slab
+{
+	char *path;
+	char *map_path;
+	/** Opened on first use, since the flags are only known then */
+	int descriptor;
+	size_t align;
+	/** The file is grown by this amount at a time */
+	size_t grow;
+	off_t file_size;
+	/** All extents, sorted by offset. The last one is always used */
+	struct starpu_unistd_slab_extent *first;
+	struct starpu_unistd_slab_extent *last;
+	struct starpu_unistd_slab_class *classes;
+	struct starpu_unistd_slab_extent *names;
+	starpu_pthread_mutex_t mutex;
+};
+
+/** Create the slab of the disk node stored in directory \p dir, reloading the named extents of a previous run */
+struct starpu_unistd_slab *_starpu_unistd_slab_init(const char *dir, starpu_ssize_t size);
+/** Save the named extents, and release the slab */
+void _starpu_unistd_slab_fini(struct starpu_unistd_slab *slab);
+/** Allocate an extent of \p size bytes, named \p name if not NULL. Returns NULL if there is no room on the disk */
+struct starpu_unistd_slab_extent *_starpu_unistd_slab_alloc(struct starpu_unistd_slab *slab, int flags, size_t size, const char *name);
+/** Look for the extent named \p name */
+struct starpu_unistd_slab_extent *_starpu_unistd_slab_lookup(struct starpu_unistd_slab *slab, int flags, const char *name);
+/** Make \p extent hold at least \p size bytes, possibly moving it, without keeping its content */
+struct starpu_unistd_slab_extent *_starpu_unistd_slab_realloc(struct starpu_unistd_slab *slab, struct starpu_unistd_slab_extent *extent, size_t size);
+/** Release \p extent, which can then be reused */
+void _starpu_unistd_slab_free(struct starpu_unistd_slab *slab, struct starpu_unistd_slab_extent *extent);
+
+#pragma GCC visibility pop
+
+#endif
@@ -19,6 +19,7 @@
 #include <starpu.h>
 #include <core/jobs.h>
 #include <core/task.h>
+#include <core/task_pool.h>
 #include <core/workers.h>
 #include <core/dependencies/data_concurrency.h>
 #include <common/config.h>
@@ -27,6 +28,7 @@
 #include <datawizard/memory_nodes.h>
 #include <profiling/profiling.h>
 #include <profiling/bound.h>
+#include <profiling/online_bound.h>
 #include <core/debug.h>
 #include <limits.h>
 #include <core/workers.h>
@@ -90,7 +92,9 @@ struct _starpu_job* STARPU_ATTRIBUTE_MALLOC _starpu_job_create(struct starpu_tas
 
 	/* As most of the fields must be initialized at NULL, let's put 0
 	 * everywhere */
-	_STARPU_CALLOC(job, 1, sizeof(*job));
+	job = _starpu_task_pool_get_job(task);
+	if (!job)
+		_STARPU_CALLOC(job, 1, sizeof(*job));
 
 	if (task->dyn_handles)
 	{
@@ -205,11 +209,16 @@ void _starpu_job_destroy(struct _starpu_job *j)
 
 	if (_starpu_graph_record && j->graph_node)
 		_starpu_graph_drop_job(j);
+	if (_starpu_online_bound_enabled && j->online_bound_task)
+		_starpu_online_bound_job_destroy(j);
 
 	if (max_memory_use)
 		(void) STARPU_ATOMIC_ADDL(&njobs, -1);
 
-	free(j);
+	if (j->pool != _STARPU_JOB_POOL_NONE)
+		_starpu_task_pool_put_job(j);
+	else
+		free(j);
 }
 
 int _starpu_job_finished(struct _starpu_job *j)
@@ -496,6 +505,8 @@ void _starpu_handle_job_termination(struct _starpu_job *j)
 	/* Remove ourself from the graph before notifying dependencies */
 	if (_starpu_graph_record)
 		_starpu_graph_drop_job(j);
+	if (_starpu_online_bound_enabled)
+		_starpu_online_bound_terminated(j);
 
 	/* Get callback pointer for codelet before notifying dependencies, in
 	   case dependencies free the codelet (see starpu_data_unregister for
@@ -133,6 +133,18 @@ struct _starpu_job
 	 */
 	unsigned terminated:2;
 
+	/** Where the job structure was allocated, see _STARPU_JOB_POOL_* in
+	 * core/task_pool.h */
+	unsigned pool:2;
+
+	/** The ordered buffers were already computed, e.g. when replaying a
+	 * recorded task graph */
+	unsigned ordered_buffers_set:1;
+
+	/** The task is being submitted by starpu_task_submit_array(), which
+	 * has already accounted for it in the submitted task counters */
+	unsigned submit_accounted:1;
+
 #ifdef STARPU_OPENMP
 	/** Job is a continuation or a regular task. */
 	unsigned continuation;
@@ -201,6 +213,8 @@ struct _starpu_job
 	int active_task_alias_count;
 
 	struct bound_task *bound_task;
+	/** Task recorded for the online bound estimation, see STARPU_ONLINE_BOUND */
+	struct _starpu_online_bound_task *online_bound_task;
 
 	/** Parallel workers may have to synchronize before/after the execution of a parallel task. */
 	starpu_pthread_barrier_t before_work_barrier;
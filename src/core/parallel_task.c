@@ -30,6 +30,8 @@ struct starpu_task *starpu_task_dup(struct starpu_task *task)
 	/* TODO perhaps this is a bit too much overhead and we should only copy
 	 * part of the structure ? */
 	*task_dup = *task;
+	/* The duplicate does not come from the pool */
+	task_dup->pooled = 0;
 
 	return task_dup;
 }
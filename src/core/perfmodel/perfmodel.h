@@ -50,6 +50,83 @@ void _starpu_init_perfmodel(void);
 #define STR_LONG_LENGTH 256
 #define STR_VERY_LONG_LENGTH 1024
 
+/**
+ * Performance models can also be stored in a binary format, which is
+ * much faster to load than the text format since it can just be mapped in
+ * memory. Such files start with _STARPU_PERFMODEL_BIN_MAGIC, and contain, in
+ * the byte order of the machine which wrote them:
+ * - a struct _starpu_perfmodel_bin_header,
+ * - the offsets of the ncombs combinations, as uint64_t,
+ * - for each combination, a struct _starpu_perfmodel_bin_comb, its ndevices
+ *   struct _starpu_perfmodel_bin_device, and for each implementation a
+ *   struct _starpu_perfmodel_bin_impl followed by its ncoeff multiple
+ *   regression coefficients, as double, and its nentries history entries,
+ *   as struct _starpu_perfmodel_bin_entry, sorted by footprint.
+ * All fields are 8-byte aligned, so that the file can be accessed in place.
+ * When the text format changes, _STARPU_PERFMODEL_VERSION is updated, which
+ * is also recorded in the binary header. _STARPU_PERFMODEL_BIN_VERSION only
+ * covers the binary layout itself.
+ */
+#define _STARPU_PERFMODEL_BIN_MAGIC "STPUPMB"
+#define _STARPU_PERFMODEL_BIN_VERSION 1
+#define _STARPU_PERFMODEL_BIN_BYTE_ORDER 0x01020304
+
+struct _starpu_perfmodel_bin_header
+{
+	char magic[8];
+	uint32_t byte_order;
+	uint32_t bin_version;
+	uint32_t version;
+	int32_t ncombs;
+	/** Size of the whole file, to detect truncated files */
+	uint64_t size;
+};
+
+struct _starpu_perfmodel_bin_comb
+{
+	int32_t ndevices;
+	int32_t nimpls;
+};
+
+struct _starpu_perfmodel_bin_device
+{
+	int32_t type;
+	int32_t devid;
+	int32_t ncores;
+	int32_t padding;
+};
+
+struct _starpu_perfmodel_bin_impl
+{
+	double sumlnx;
+	double sumlnx2;
+	double sumlny;
+	double sumlnxlny;
+	double alpha;
+	double beta;
+	double a;
+	double b;
+	double c;
+	uint64_t minx;
+	uint64_t maxx;
+	uint32_t nsample;
+	uint32_t ncoeff;
+	uint32_t nentries;
+	uint32_t padding;
+};
+
+struct _starpu_perfmodel_bin_entry
+{
+	uint32_t footprint;
+	uint32_t nsample;
+	uint64_t size;
+	double flops;
+	double mean;
+	double deviation;
+	double sum;
+	double sum2;
+};
+
 struct _starpu_perfmodel_state
 {
 	struct starpu_perfmodel_per_arch** per_arch; /*STARPU_MAXIMPLEMENTATIONS*/
@@ -94,6 +171,9 @@ double _starpu_non_linear_regression_based_job_expected_perf(struct starpu_perfm
 double _starpu_multiple_regression_based_job_expected_perf(struct starpu_perfmodel *model, struct starpu_perfmodel_arch* arch, struct _starpu_job *j, unsigned nimpl);
 void _starpu_update_perfmodel_history(struct _starpu_job *j, struct starpu_perfmodel *model, struct starpu_perfmodel_arch * arch, unsigned cpuid, double measured, unsigned nimpl, unsigned number);
 int _starpu_perfmodel_create_comb_if_needed(struct starpu_perfmodel_arch* arch);
+/** Whether the two archs would be given the same combination, and thus get
+ * the same performance predictions */
+int _starpu_perfmodel_arch_equal(struct starpu_perfmodel_arch *arch1, struct starpu_perfmodel_arch *arch2);
 
 int _starpu_create_bus_sampling_directory_if_needed(int location);
 void _starpu_create_codelet_sampling_directory_if_needed(int location);
@@ -111,6 +191,8 @@ unsigned _starpu_get_calibrate_flag(void);
 unsigned *_starpu_get_affinity_vector_by_kind(unsigned gpuid, enum starpu_node_kind kind);
 
 void _starpu_save_bandwidth_and_latency_disk(double bandwidth_write, double bandwidth_read, double latency_write, double latency_read, unsigned node, const char *name);
+/** Account for the compression of the data stored on the disk node \p node, with the given speeds (in bytes/us of uncompressed data, 0 meaning negligible) and compression ratio */
+void _starpu_update_bandwidth_disk_codec(unsigned node, double compress_speed, double decompress_speed, double ratio);
 
 void _starpu_write_double(FILE *f, const char *format, double val) STARPU_ATTRIBUTE_VISIBILITY_DEFAULT;
 int _starpu_read_double(FILE *f, char *format, double *val) STARPU_ATTRIBUTE_VISIBILITY_DEFAULT;
@@ -118,6 +200,11 @@ void _starpu_simgrid_get_platform_path(int version, char *path, size_t maxlen);
 
 void _starpu_perfmodel_realloc(struct starpu_perfmodel *model, int nb);
 
+/** Save the model as it was loaded, in the binary format if \p binary is set,
+ * in the text format otherwise. This is meant for tools converting model
+ * files, the regressions are not recomputed from the history */
+int _starpu_perfmodel_save_file(struct starpu_perfmodel *model, const char *path, unsigned binary) STARPU_ATTRIBUTE_VISIBILITY_DEFAULT;
+
 void _starpu_free_arch_combs(void);
 
 #if defined(STARPU_HAVE_HWLOC)
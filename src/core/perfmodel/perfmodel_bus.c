@@ -97,6 +97,9 @@ static double raw_bandwidth_matrix[STARPU_MAXNODES][STARPU_MAXNODES];	/* MB/s, i
 static double bandwidth_matrix[STARPU_MAXNODES][STARPU_MAXNODES];	/* MB/s, indexed by memory nodes */
 static double raw_latency_matrix[STARPU_MAXNODES][STARPU_MAXNODES];	/* µs, indexed by devices ids */
 static double latency_matrix[STARPU_MAXNODES][STARPU_MAXNODES];		/* µs, indexed by memory nodes */
+/* MB/s between the disk nodes and the main memory, as measured by the disk backends */
+static double disk_bandwidth_write[STARPU_MAXNODES];
+static double disk_bandwidth_read[STARPU_MAXNODES];
 static unsigned was_benchmarked = 0;
 #ifndef STARPU_SIMGRID
 static unsigned ncpus = 0;
@@ -3028,6 +3031,9 @@ void _starpu_save_bandwidth_and_latency_disk(double bandwidth_write, double band
 	double slowness_disk_between_main_ram, slowness_main_ram_between_node;
 	int print_stats = starpu_getenv_number_default("STARPU_BUS_STATS", 0);
 
+	disk_bandwidth_write[node] = bandwidth_write;
+	disk_bandwidth_read[node] = bandwidth_read;
+
 	if (print_stats)
 	{
 		fprintf(stderr, "\n#---------------------\n");
@@ -3119,3 +3125,46 @@ void _starpu_save_bandwidth_and_latency_disk(double bandwidth_write, double band
 	if (print_stats)
 		fprintf(stderr, "\n#---------------------\n");
 }
+
+void _starpu_update_bandwidth_disk_codec(unsigned node, double compress_speed, double decompress_speed, double ratio)
+{
+	double slowness_disk_write, slowness_disk_read, slowness_main_ram_between_node;
+	unsigned i;
+
+	if (disk_bandwidth_write[node] == 0 || disk_bandwidth_read[node] == 0)
+		/* Not measured */
+		return;
+
+	/* Time per byte of uncompressed data: (de)compress it, and transfer
+	 * the compressed version */
+	slowness_disk_write = ratio/disk_bandwidth_write[node];
+	if (compress_speed != 0)
+		slowness_disk_write += 1/compress_speed;
+	slowness_disk_read = ratio/disk_bandwidth_read[node];
+	if (decompress_speed != 0)
+		slowness_disk_read += 1/decompress_speed;
+
+	for(i = 0; i < STARPU_MAXNODES; ++i)
+	{
+		if (i == node)
+			continue;
+
+		if (!isnan(bandwidth_matrix[node][i])) /* source == disk */
+		{
+			if(bandwidth_matrix[STARPU_MAIN_RAM][i] != 0)
+				slowness_main_ram_between_node = 1/bandwidth_matrix[STARPU_MAIN_RAM][i];
+			else
+				slowness_main_ram_between_node = 0;
+			bandwidth_matrix[node][i] = 1/(slowness_disk_read+slowness_main_ram_between_node);
+		}
+
+		if (!isnan(bandwidth_matrix[i][node])) /* destination == disk */
+		{
+			if(bandwidth_matrix[i][STARPU_MAIN_RAM] != 0)
+				slowness_main_ram_between_node = 1/bandwidth_matrix[i][STARPU_MAIN_RAM];
+			else
+				slowness_main_ram_between_node = 0;
+			bandwidth_matrix[i][node] = 1/(slowness_disk_write+slowness_main_ram_between_node);
+		}
+	}
+}
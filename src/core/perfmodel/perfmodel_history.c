@@ -25,6 +25,9 @@
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
 #include <common/utils.h>
 #include <core/perfmodel/perfmodel.h>
 #include <core/jobs.h>
@@ -50,6 +53,8 @@ static int nb_arch_combs;
 static starpu_pthread_rwlock_t arch_combs_mutex = STARPU_PTHREAD_RWLOCK_INITIALIZER;
 static int historymaxerror;
 static char ignore_devid[STARPU_NARCH];
+/* Whether to save performance models in the binary format */
+static int perfmodel_binary;
 
 /* How many executions a codelet will have to be measured before we
  * consider that calibration will provide a value good enough for scheduling */
@@ -115,6 +120,7 @@ void _starpu_initialize_registered_performance_models(void)
 	current_arch_comb = 0;
 	historymaxerror = starpu_getenv_number_default("STARPU_HISTORY_MAX_ERROR", STARPU_HISTORYMAXERROR);
 	_starpu_calibration_minimum = starpu_getenv_number_default("STARPU_CALIBRATE_MINIMUM", 10);
+	perfmodel_binary = starpu_getenv_number_default("STARPU_PERF_MODEL_BINARY", 0);
 
 	for (archtype = 0; archtype < STARPU_NARCH; archtype++)
 	{
@@ -372,7 +378,10 @@ static void check_reg_model(struct starpu_perfmodel *model, int comb, int impl)
 	}
 }
 
-static void dump_reg_model(FILE *f, struct starpu_perfmodel *model, int comb, int impl)
+/* Get the regression factors to be saved. When recompute is set, they are
+ * computed from the measurements, otherwise they are taken as they were
+ * loaded from a file. */
+static void get_reg_model(struct starpu_perfmodel *model, int comb, int impl, unsigned recompute, double *alpha, double *beta, double *a, double *b, double *c)
 {
 	struct starpu_perfmodel_per_arch *per_arch_model;
 
@@ -380,21 +389,92 @@ static void dump_reg_model(FILE *f, struct starpu_perfmodel *model, int comb, in
 	struct starpu_perfmodel_regression_model *reg_model;
 	reg_model = &per_arch_model->regression;
 
+	if (!recompute)
+	{
+		*alpha = reg_model->alpha;
+		*beta = reg_model->beta;
+		*a = reg_model->a;
+		*b = reg_model->b;
+		*c = reg_model->c;
+		return;
+	}
+
 	/*
 	 * Linear Regression model
 	 */
 
 	/* Unless we have enough measurements, we put NaN in the file to indicate the model is invalid */
-	double alpha = nan(""), beta = nan("");
+	*alpha = nan("");
+	*beta = nan("");
 	if (model->type == STARPU_REGRESSION_BASED || model->type == STARPU_NL_REGRESSION_BASED)
 	{
 		if (reg_model->nsample > 1)
 		{
-			alpha = reg_model->alpha;
-			beta = reg_model->beta;
+			*alpha = reg_model->alpha;
+			*beta = reg_model->beta;
 		}
 	}
 
+	/*
+	 * Non-Linear Regression model
+	 */
+
+	*a = nan("");
+	*b = nan("");
+	*c = nan("");
+
+	if (model->type == STARPU_NL_REGRESSION_BASED)
+	{
+		if (_starpu_regression_non_linear_power(per_arch_model->list, a, b, c) != 0)
+			_STARPU_DISP("Warning: could not compute a non-linear regression for model %s\n", model->symbol);
+	}
+
+	/*
+	 * Multiple Regression Model
+	 */
+
+	if (model->type == STARPU_MULTIPLE_REGRESSION_BASED)
+	{
+		if (reg_model->ncoeff==0 && model->ncombinations!=0 && model->combinations!=NULL)
+		{
+			reg_model->ncoeff = model->ncombinations + 1;
+		}
+
+		_STARPU_MALLOC(reg_model->coeff,  reg_model->ncoeff*sizeof(double));
+		_starpu_multiple_regression(per_arch_model->list, reg_model->coeff, reg_model->ncoeff, model->nparameters, model->parameters_names, model->combinations, model->symbol);
+	}
+}
+
+/* Whether the multiple regression coefficients are to be saved */
+static int has_multiple_reg_model(struct starpu_perfmodel *model, int comb, int impl, unsigned recompute)
+{
+	if (recompute)
+		return model->type == STARPU_MULTIPLE_REGRESSION_BASED;
+	else
+		return model->state->per_arch[comb][impl].regression.ncoeff != 0;
+}
+
+/* Whether the history entries are to be saved */
+static int has_history(struct starpu_perfmodel *model, unsigned recompute)
+{
+	return !recompute || model->type == STARPU_HISTORY_BASED || model->type == STARPU_NL_REGRESSION_BASED || model->type == STARPU_REGRESSION_BASED;
+}
+
+static void dump_reg_model(FILE *f, struct starpu_perfmodel *model, int comb, int impl, unsigned recompute)
+{
+	struct starpu_perfmodel_per_arch *per_arch_model;
+
+	per_arch_model = &model->state->per_arch[comb][impl];
+	struct starpu_perfmodel_regression_model *reg_model;
+	reg_model = &per_arch_model->regression;
+
+	double alpha, beta, a, b, c;
+	get_reg_model(model, comb, impl, recompute, &alpha, &beta, &a, &b, &c);
+
+	/*
+	 * Linear Regression model
+	 */
+
 	fprintf(f, "# sumlnx\tsumlnx2\t\tsumlny\t\tsumlnxlny\talpha\t\tbeta\t\tn\tminx\t\tmaxx\n");
 	fprintf(f, "%-15e\t%-15e\t%-15e\t%-15e\t", reg_model->sumlnx, reg_model->sumlnx2, reg_model->sumlny, reg_model->sumlnxlny);
 	_starpu_write_double(f, "%-15e", alpha);
@@ -406,14 +486,6 @@ static void dump_reg_model(FILE *f, struct starpu_perfmodel *model, int comb, in
 	 * Non-Linear Regression model
 	 */
 
-	double a = nan(""), b = nan(""), c = nan("");
-
-	if (model->type == STARPU_NL_REGRESSION_BASED)
-	{
-		if (_starpu_regression_non_linear_power(per_arch_model->list, &a, &b, &c) != 0)
-			_STARPU_DISP("Warning: could not compute a non-linear regression for model %s\n", model->symbol);
-	}
-
 	fprintf(f, "# a\t\tb\t\tc\n");
 	_starpu_write_double(f, "%-15e", a);
 	fprintf(f, "\t");
@@ -426,30 +498,24 @@ static void dump_reg_model(FILE *f, struct starpu_perfmodel *model, int comb, in
 	 * Multiple Regression Model
 	 */
 
-	if (model->type != STARPU_MULTIPLE_REGRESSION_BASED)
+	if (!has_multiple_reg_model(model, comb, impl, recompute))
 	{
 		fprintf(f, "# not multiple-regression-base\n");
 		fprintf(f, "0\n");
 	}
 	else
 	{
-		if (reg_model->ncoeff==0 && model->ncombinations!=0 && model->combinations!=NULL)
-		{
-			reg_model->ncoeff = model->ncombinations + 1;
-		}
-
-		_STARPU_MALLOC(reg_model->coeff,  reg_model->ncoeff*sizeof(double));
-		_starpu_multiple_regression(per_arch_model->list, reg_model->coeff, reg_model->ncoeff, model->nparameters, model->parameters_names, model->combinations, model->symbol);
-
 		fprintf(f, "# n\tintercept\t");
-		if (reg_model->ncoeff==0 || model->ncombinations==0 || model->combinations==NULL)
+		if (reg_model->ncoeff==0 || (recompute && (model->ncombinations==0 || model->combinations==NULL)))
 			fprintf(f, "\n1\tnan");
 		else
 		{
+			/* Tools converting files do not have the combinations */
+			unsigned ncombinations = model->combinations ? model->ncombinations : reg_model->ncoeff - 1;
 			unsigned i;
-			for (i=0; i < model->ncombinations; i++)
+			for (i=0; i < ncombinations; i++)
 			{
-				if (model->parameters_names == NULL)
+				if (model->parameters_names == NULL || model->combinations == NULL)
 					fprintf(f, "c%u", i+1);
 				else
 				{
@@ -624,6 +690,24 @@ static void scan_history_entry(FILE *f, const char *path, struct starpu_perfmode
 	}
 }
 
+/* Tool loading a perfmodel without having the corresponding codelet, guess
+ * the type of the model from what the file contains */
+static void guess_model_type(struct starpu_perfmodel *model, struct starpu_perfmodel_regression_model *reg_model, unsigned nentries)
+{
+	if (model && model->type == STARPU_PERFMODEL_INVALID)
+	{
+		if (reg_model->ncoeff != 0)
+			model->type = STARPU_MULTIPLE_REGRESSION_BASED;
+		else if (!isnan(reg_model->a) && !isnan(reg_model->b) && !isnan(reg_model->c))
+			model->type = STARPU_NL_REGRESSION_BASED;
+		else if (!isnan(reg_model->alpha) && !isnan(reg_model->beta))
+			model->type = STARPU_REGRESSION_BASED;
+		else if (nentries)
+			model->type = STARPU_HISTORY_BASED;
+		/* else unknown, leave invalid */
+	}
+}
+
 static void parse_per_arch_model_file(FILE *f, const char *path, struct starpu_perfmodel_per_arch *per_arch_model, unsigned scan_history, struct starpu_perfmodel *model)
 {
 	unsigned nentries;
@@ -662,19 +746,7 @@ static void parse_per_arch_model_file(FILE *f, const char *path, struct starpu_p
 			insert_history_entry(entry, &per_arch_model->list, &per_arch_model->history);
 	}
 
-	if (model && model->type == STARPU_PERFMODEL_INVALID)
-	{
-		/* Tool loading a perfmodel without having the corresponding codelet */
-		if (reg_model->ncoeff != 0)
-			model->type = STARPU_MULTIPLE_REGRESSION_BASED;
-		else if (!isnan(reg_model->a) && !isnan(reg_model->b) && !isnan(reg_model->c))
-			model->type = STARPU_NL_REGRESSION_BASED;
-		else if (!isnan(reg_model->alpha) && !isnan(reg_model->beta))
-			model->type = STARPU_REGRESSION_BASED;
-		else if (nentries)
-			model->type = STARPU_HISTORY_BASED;
-		/* else unknown, leave invalid */
-	}
+	guess_model_type(model, reg_model, nentries);
 }
 
 
@@ -804,6 +876,214 @@ static int parse_model_file(FILE *f, const char *path, struct starpu_perfmodel *
 	return 0;
 }
 
+/*
+ * Binary format
+ */
+
+/* Get the next len bytes of the binary model file, checking that they are
+ * within the file */
+static const void *bin_get(const char *buf, size_t size, size_t *offset, size_t len, const char *path)
+{
+	const void *ptr = buf + *offset;
+	STARPU_ASSERT_MSG(len <= size && *offset <= size - len, "Incorrect performance model file %s", path);
+	*offset += len;
+	return ptr;
+}
+
+static void parse_per_arch_model_binary(const char *buf, size_t size, size_t *offset, const char *path, struct starpu_perfmodel_per_arch *per_arch_model, unsigned scan_history, struct starpu_perfmodel *model)
+{
+	const struct _starpu_perfmodel_bin_impl *bimpl = bin_get(buf, size, offset, sizeof(*bimpl), path);
+	const double *coeff = bin_get(buf, size, offset, bimpl->ncoeff * sizeof(*coeff), path);
+	const struct _starpu_perfmodel_bin_entry *bentries = bin_get(buf, size, offset, bimpl->nentries * sizeof(*bentries), path);
+
+	if (!per_arch_model)
+		/* Just skip it */
+		return;
+
+	struct starpu_perfmodel_regression_model *reg_model = &per_arch_model->regression;
+	reg_model->sumlnx = bimpl->sumlnx;
+	reg_model->sumlnx2 = bimpl->sumlnx2;
+	reg_model->sumlny = bimpl->sumlny;
+	reg_model->sumlnxlny = bimpl->sumlnxlny;
+	reg_model->alpha = bimpl->alpha;
+	reg_model->beta = bimpl->beta;
+	reg_model->a = bimpl->a;
+	reg_model->b = bimpl->b;
+	reg_model->c = bimpl->c;
+	reg_model->minx = bimpl->minx;
+	reg_model->maxx = bimpl->maxx;
+	reg_model->nsample = bimpl->nsample;
+	reg_model->valid = !isnan(reg_model->alpha) && !isnan(reg_model->beta) && VALID_REGRESSION(reg_model);
+	reg_model->nl_valid = !isnan(reg_model->a) && !isnan(reg_model->b) && !isnan(reg_model->c) && VALID_REGRESSION(reg_model);
+
+	reg_model->ncoeff = bimpl->ncoeff;
+	if (reg_model->ncoeff != 0)
+	{
+		unsigned multi_invalid = 0;
+		unsigned i;
+		_STARPU_MALLOC(reg_model->coeff, reg_model->ncoeff*sizeof(double));
+		for (i = 0; i < reg_model->ncoeff; i++)
+		{
+			reg_model->coeff[i] = coeff[i];
+			multi_invalid = (multi_invalid||isnan(reg_model->coeff[i]));
+		}
+		reg_model->multi_valid = !multi_invalid;
+	}
+
+	if (scan_history)
+	{
+		/* Insert from the end, so that the list ends up sorted by footprint */
+		unsigned i;
+		for (i = bimpl->nentries; i > 0; i--)
+		{
+			const struct _starpu_perfmodel_bin_entry *bentry = &bentries[i-1];
+			struct starpu_perfmodel_history_entry *entry;
+			_STARPU_CALLOC(entry, 1, sizeof(struct starpu_perfmodel_history_entry));
+
+			/* Tell  helgrind that we do not care about
+			 * racing access to the sampling, we only want a
+			 * good-enough estimation */
+			STARPU_HG_DISABLE_CHECKING(entry->nsample);
+			STARPU_HG_DISABLE_CHECKING(entry->mean);
+
+			entry->footprint = bentry->footprint;
+			entry->size = bentry->size;
+			entry->flops = bentry->flops;
+			entry->mean = bentry->mean;
+			entry->deviation = bentry->deviation;
+			entry->sum = bentry->sum;
+			entry->sum2 = bentry->sum2;
+			entry->nsample = bentry->nsample;
+
+			insert_history_entry(entry, &per_arch_model->list, &per_arch_model->history);
+		}
+	}
+
+	guess_model_type(model, reg_model, bimpl->nentries);
+}
+
+static void parse_comb_binary(const char *buf, size_t size, size_t offset, const char *path, struct starpu_perfmodel *model, unsigned scan_history, int comb)
+{
+	const struct _starpu_perfmodel_bin_comb *bcomb = bin_get(buf, size, &offset, sizeof(*bcomb), path);
+	int ndevices = bcomb->ndevices;
+	STARPU_ASSERT_MSG(ndevices > 0 && bcomb->nimpls >= 0, "Incorrect performance model file %s", path);
+	const struct _starpu_perfmodel_bin_device *bdevices = bin_get(buf, size, &offset, ndevices * sizeof(*bdevices), path);
+
+	struct starpu_perfmodel_device devices[ndevices];
+
+	int dev;
+	for(dev = 0; dev < ndevices; dev++)
+	{
+		devices[dev].type = bdevices[dev].type;
+		devices[dev].devid = bdevices[dev].devid;
+		devices[dev].ncores = bdevices[dev].ncores;
+	}
+	int id_comb = starpu_perfmodel_arch_comb_get(ndevices, devices);
+	if(id_comb == -1)
+		id_comb = starpu_perfmodel_arch_comb_add(ndevices, devices);
+
+	if (id_comb >= model->state->ncombs_set)
+		_starpu_perfmodel_realloc(model, id_comb+1);
+
+	model->state->combs[comb] = id_comb;
+
+	unsigned nimpls = bcomb->nimpls;
+	unsigned implmax = STARPU_MIN(nimpls, STARPU_MAXIMPLEMENTATIONS);
+	unsigned impl;
+	model->state->nimpls[id_comb] = implmax;
+	if (!model->state->per_arch[id_comb])
+		_starpu_perfmodel_malloc_per_arch(model, id_comb, STARPU_MAXIMPLEMENTATIONS);
+	if (!model->state->per_arch_is_set[id_comb])
+		_starpu_perfmodel_malloc_per_arch_is_set(model, id_comb, STARPU_MAXIMPLEMENTATIONS);
+
+	/* if the number of implementation is greater than STARPU_MAXIMPLEMENTATIONS
+	 * we skip the last implementation */
+	for (impl = 0; impl < nimpls; impl++)
+	{
+		struct starpu_perfmodel_per_arch *per_arch_model = NULL;
+		if (impl < implmax)
+		{
+			per_arch_model = &model->state->per_arch[id_comb][impl];
+			model->state->per_arch_is_set[id_comb][impl] = 1;
+		}
+		parse_per_arch_model_binary(buf, size, &offset, path, per_arch_model, scan_history, model);
+	}
+}
+
+static int parse_model_binary(const char *buf, size_t size, const char *path, struct starpu_perfmodel *model, unsigned scan_history)
+{
+	size_t offset = 0;
+	const struct _starpu_perfmodel_bin_header *header = bin_get(buf, size, &offset, sizeof(*header), path);
+
+	STARPU_ASSERT_MSG(header->byte_order == _STARPU_PERFMODEL_BIN_BYTE_ORDER, "Performance model file %s was written on a machine with a different byte order, it has to be converted to the text format with starpu_perfmodel_convert on such a machine\n", path);
+	STARPU_ASSERT_MSG(header->bin_version == _STARPU_PERFMODEL_BIN_VERSION && header->version == _STARPU_PERFMODEL_VERSION, "Incorrect performance model file %s with a model version %u.%u not being the current model version (%d.%d)\n", path,
+			  (unsigned) header->version, (unsigned) header->bin_version, _STARPU_PERFMODEL_VERSION, _STARPU_PERFMODEL_BIN_VERSION);
+	if (header->size != size)
+	{
+		_STARPU_DISP("Performance model file %s is truncated, ignoring it\n", path);
+		return 1;
+	}
+
+	int ncombs = header->ncombs;
+	STARPU_ASSERT_MSG(ncombs >= 0, "Incorrect performance model file %s", path);
+	const uint64_t *comb_offsets = bin_get(buf, size, &offset, ncombs * sizeof(*comb_offsets), path);
+
+	if(ncombs > 0)
+	{
+		model->state->ncombs = ncombs;
+	}
+
+	if (ncombs > model->state->ncombs_set)
+	{
+		// The model has more combs than the original number of arch_combs, we need to reallocate
+		_starpu_perfmodel_realloc(model, ncombs);
+	}
+
+	int comb;
+	for(comb = 0; comb < ncombs; comb++)
+	{
+		STARPU_ASSERT_MSG(comb_offsets[comb] % sizeof(uint64_t) == 0, "Incorrect performance model file %s", path);
+		parse_comb_binary(buf, size, comb_offsets[comb], path, model, scan_history, comb);
+	}
+
+	return 0;
+}
+
+/* Load a model file, whichever its format */
+static int load_model_file(FILE *f, const char *path, struct starpu_perfmodel *model, unsigned scan_history)
+{
+	char magic[sizeof(_STARPU_PERFMODEL_BIN_MAGIC)];
+	struct stat st;
+	int ret;
+
+	if (fread(magic, sizeof(magic), 1, f) != 1 || memcmp(magic, _STARPU_PERFMODEL_BIN_MAGIC, sizeof(magic)) || fstat(fileno(f), &st) != 0)
+		return parse_model_file(f, path, model, scan_history);
+
+	size_t size = st.st_size;
+	char *buf;
+#ifdef HAVE_MMAP
+	/* Only the pages we actually read get loaded */
+	buf = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fileno(f), 0);
+	if (buf != MAP_FAILED)
+	{
+		ret = parse_model_binary(buf, size, path, model, scan_history);
+		munmap(buf, size);
+		return ret;
+	}
+#endif
+	_STARPU_MALLOC(buf, size);
+	rewind(f);
+	if (fread(buf, size, 1, f) != 1)
+	{
+		_STARPU_DISP("Could not read performance model file %s: %s\n", path, strerror(errno));
+		ret = 1;
+	}
+	else
+		ret = parse_model_binary(buf, size, path, model, scan_history);
+	free(buf);
+	return ret;
+}
+
 #ifndef STARPU_SIMGRID
 static void check_per_arch_model(struct starpu_perfmodel *model, int comb, unsigned impl)
 {
@@ -842,7 +1122,7 @@ static void check_per_arch_model(struct starpu_perfmodel *model, int comb, unsig
 		}
 	}
 }
-static void dump_per_arch_model_file(FILE *f, struct starpu_perfmodel *model, int comb, unsigned impl)
+static void dump_per_arch_model_file(FILE *f, struct starpu_perfmodel *model, int comb, unsigned impl, unsigned recompute)
 {
 	struct starpu_perfmodel_per_arch *per_arch_model;
 
@@ -851,7 +1131,7 @@ static void dump_per_arch_model_file(FILE *f, struct starpu_perfmodel *model, in
 	struct starpu_perfmodel_history_list *ptr = NULL;
 	unsigned nentries = 0;
 
-	if (model->type == STARPU_HISTORY_BASED || model->type == STARPU_NL_REGRESSION_BASED || model->type == STARPU_REGRESSION_BASED)
+	if (has_history(model, recompute))
 	{
 		/* Dump the list of all entries in the history */
 		ptr = per_arch_model->list;
@@ -869,10 +1149,10 @@ static void dump_per_arch_model_file(FILE *f, struct starpu_perfmodel *model, in
 	fprintf(f, "# Model for %s\n", archname);
 	fprintf(f, "# number of entries\n%u\n", nentries);
 
-	dump_reg_model(f, model, comb, impl);
+	dump_reg_model(f, model, comb, impl, recompute);
 
 	/* Dump the history into the model file in case it is necessary */
-	if (model->type == STARPU_HISTORY_BASED || model->type == STARPU_NL_REGRESSION_BASED || model->type == STARPU_REGRESSION_BASED)
+	if (has_history(model, recompute))
 	{
 		fprintf(f, "# hash\t\tsize\t\tflops\t\tmean (us or J)\tdev (us or J)\tsum\t\tsum2\t\tn\n");
 		ptr = per_arch_model->list;
@@ -920,7 +1200,7 @@ static void check_model(struct starpu_perfmodel *model)
 
 /* Driver porters: adding your driver here is optional, only needed for performance models.  */
 
-static void dump_model_file(FILE *f, struct starpu_perfmodel *model)
+static void dump_model_file(FILE *f, struct starpu_perfmodel *model, unsigned recompute)
 {
 	fprintf(f, "##################\n");
 	fprintf(f, "# Performance Model Version\n");
@@ -972,10 +1252,209 @@ static void dump_model_file(FILE *f, struct starpu_perfmodel *model)
 		fprintf(f, "%d\n", nimpls);
 		for (impl = 0; impl < nimpls; impl++)
 		{
-			dump_per_arch_model_file(f, model, comb, impl);
+			dump_per_arch_model_file(f, model, comb, impl, recompute);
 		}
 	}
 }
+
+/* Growing buffer in which binary model files are prepared */
+struct bin_buffer
+{
+	char *data;
+	size_t size;
+	size_t allocated;
+};
+
+/* Append len zeroed bytes to the buffer, and return their offset. This may
+ * move the buffer, so pointers have to be recomputed from offsets */
+static size_t bin_append(struct bin_buffer *buf, size_t len)
+{
+	size_t offset = buf->size;
+	if (buf->size + len > buf->allocated)
+	{
+		buf->allocated = STARPU_MAX(2*buf->allocated, buf->size + len);
+		_STARPU_REALLOC(buf->data, buf->allocated);
+	}
+	memset(buf->data + offset, 0, len);
+	buf->size += len;
+	return offset;
+}
+
+static int compar_history_entry(const void *a, const void *b)
+{
+	const struct starpu_perfmodel_history_entry *entry_a = *(struct starpu_perfmodel_history_entry * const *) a;
+	const struct starpu_perfmodel_history_entry *entry_b = *(struct starpu_perfmodel_history_entry * const *) b;
+	return entry_a->footprint < entry_b->footprint ? -1 : entry_a->footprint > entry_b->footprint;
+}
+
+static void dump_per_arch_model_binary(struct bin_buffer *buf, struct starpu_perfmodel *model, int comb, unsigned impl, unsigned recompute)
+{
+	struct starpu_perfmodel_per_arch *per_arch_model = &model->state->per_arch[comb][impl];
+	struct starpu_perfmodel_regression_model *reg_model = &per_arch_model->regression;
+	struct starpu_perfmodel_history_list *ptr;
+	unsigned nentries = 0, ncoeff = 0, i;
+	size_t offset;
+
+	double alpha, beta, a, b, c;
+	get_reg_model(model, comb, impl, recompute, &alpha, &beta, &a, &b, &c);
+	if (has_multiple_reg_model(model, comb, impl, recompute))
+		ncoeff = reg_model->ncoeff;
+	if (has_history(model, recompute))
+		for (ptr = per_arch_model->list; ptr; ptr = ptr->next)
+			nentries++;
+
+	offset = bin_append(buf, sizeof(struct _starpu_perfmodel_bin_impl));
+	struct _starpu_perfmodel_bin_impl *bimpl = (void *) (buf->data + offset);
+	bimpl->sumlnx = reg_model->sumlnx;
+	bimpl->sumlnx2 = reg_model->sumlnx2;
+	bimpl->sumlny = reg_model->sumlny;
+	bimpl->sumlnxlny = reg_model->sumlnxlny;
+	bimpl->alpha = alpha;
+	bimpl->beta = beta;
+	bimpl->a = a;
+	bimpl->b = b;
+	bimpl->c = c;
+	bimpl->minx = reg_model->minx;
+	bimpl->maxx = reg_model->maxx;
+	bimpl->nsample = reg_model->nsample;
+	bimpl->ncoeff = ncoeff;
+	bimpl->nentries = nentries;
+
+	offset = bin_append(buf, ncoeff * sizeof(double));
+	if (ncoeff)
+		memcpy(buf->data + offset, reg_model->coeff, ncoeff * sizeof(double));
+
+	if (!nentries)
+		return;
+
+	/* Sort the entries by footprint, so that the file layout does not
+	 * change as long as no entry is added */
+	struct starpu_perfmodel_history_entry **entries;
+	_STARPU_MALLOC(entries, nentries * sizeof(*entries));
+	for (ptr = per_arch_model->list, i = 0; ptr; ptr = ptr->next, i++)
+		entries[i] = ptr->entry;
+	qsort(entries, nentries, sizeof(*entries), compar_history_entry);
+
+	offset = bin_append(buf, nentries * sizeof(struct _starpu_perfmodel_bin_entry));
+	struct _starpu_perfmodel_bin_entry *bentries = (void *) (buf->data + offset);
+	for (i = 0; i < nentries; i++)
+	{
+		bentries[i].footprint = entries[i]->footprint;
+		bentries[i].nsample = entries[i]->nsample;
+		bentries[i].size = entries[i]->size;
+		bentries[i].flops = entries[i]->flops;
+		bentries[i].mean = entries[i]->mean;
+		bentries[i].deviation = entries[i]->deviation;
+		bentries[i].sum = entries[i]->sum;
+		bentries[i].sum2 = entries[i]->sum2;
+	}
+	free(entries);
+}
+
+static void dump_model_binary(struct bin_buffer *buf, struct starpu_perfmodel *model, unsigned recompute)
+{
+	int ncombs = model->state->ncombs;
+	struct _starpu_perfmodel_bin_header *header;
+	size_t offset, comb_offsets;
+	int i, impl, dev;
+
+	offset = bin_append(buf, sizeof(*header));
+	header = (void *) (buf->data + offset);
+	memcpy(header->magic, _STARPU_PERFMODEL_BIN_MAGIC, sizeof(header->magic));
+	header->byte_order = _STARPU_PERFMODEL_BIN_BYTE_ORDER;
+	header->bin_version = _STARPU_PERFMODEL_BIN_VERSION;
+	header->version = _STARPU_PERFMODEL_VERSION;
+	header->ncombs = ncombs;
+
+	comb_offsets = bin_append(buf, ncombs * sizeof(uint64_t));
+
+	for(i = 0; i < ncombs; i++)
+	{
+		int comb = model->state->combs[i];
+		int ndevices = arch_combs[comb]->ndevices;
+		int nimpls = model->state->nimpls[comb];
+
+		((uint64_t *) (buf->data + comb_offsets))[i] = buf->size;
+
+		offset = bin_append(buf, sizeof(struct _starpu_perfmodel_bin_comb));
+		struct _starpu_perfmodel_bin_comb *bcomb = (void *) (buf->data + offset);
+		bcomb->ndevices = ndevices;
+		bcomb->nimpls = nimpls;
+
+		offset = bin_append(buf, ndevices * sizeof(struct _starpu_perfmodel_bin_device));
+		struct _starpu_perfmodel_bin_device *bdevices = (void *) (buf->data + offset);
+		for(dev = 0; dev < ndevices; dev++)
+		{
+			bdevices[dev].type = arch_combs[comb]->devices[dev].type;
+			bdevices[dev].devid = arch_combs[comb]->devices[dev].devid;
+			bdevices[dev].ncores = arch_combs[comb]->devices[dev].ncores;
+		}
+
+		for (impl = 0; impl < nimpls; impl++)
+			dump_per_arch_model_binary(buf, model, comb, impl, recompute);
+	}
+
+	header = (void *) buf->data;
+	header->size = buf->size;
+}
+
+/* Size of the blocks which are compared with the existing file content */
+#define BIN_UPDATE_BLOCK 4096
+
+static int save_model_binary(FILE *f, const char *path, struct starpu_perfmodel *model, unsigned recompute)
+{
+	struct bin_buffer buf = { NULL, 0, 0 };
+	int ret = 0;
+
+	dump_model_binary(&buf, model, recompute);
+
+#ifdef HAVE_MMAP
+	/* Only overwrite the blocks which changed: since the entries are
+	 * sorted, when existing entries were just updated, only the
+	 * corresponding pages get written back to the disk */
+	int fd = fileno(f);
+	struct stat st;
+	if (fstat(fd, &st) == 0 && ((size_t) st.st_size == buf.size || ftruncate(fd, buf.size) == 0))
+	{
+		char *old = mmap(NULL, buf.size, PROT_READ|PROT_WRITE, MAP_SHARED, fd, 0);
+		if (old != MAP_FAILED)
+		{
+			size_t offset;
+			for (offset = 0; offset < buf.size; offset += BIN_UPDATE_BLOCK)
+			{
+				size_t len = STARPU_MIN(BIN_UPDATE_BLOCK, buf.size - offset);
+				if (memcmp(old + offset, buf.data + offset, len))
+					memcpy(old + offset, buf.data + offset, len);
+			}
+			munmap(old, buf.size);
+			free(buf.data);
+			return 0;
+		}
+	}
+#endif
+
+	fseek(f, 0, SEEK_SET);
+	_starpu_fftruncate(f, 0);
+	if (fwrite(buf.data, buf.size, 1, f) != 1)
+	{
+		_STARPU_DISP("Could not write performance model file %s: %s\n", path, strerror(errno));
+		ret = 1;
+	}
+	free(buf.data);
+	return ret;
+}
+
+static int save_model(FILE *f, const char *path, struct starpu_perfmodel *model, unsigned binary, unsigned recompute)
+{
+	check_model(model);
+	if (binary)
+		return save_model_binary(f, path, model, recompute);
+
+	fseek(f, 0, SEEK_SET);
+	_starpu_fftruncate(f, 0);
+	dump_model_file(f, model, recompute);
+	return 0;
+}
 #endif
 
 static void dump_history_entry_xml(FILE *f, struct starpu_perfmodel_history_entry *entry)
@@ -1251,14 +1730,30 @@ void starpu_save_history_based_model(struct starpu_perfmodel *model)
 	STARPU_ASSERT_MSG(f, "Could not save performance model %s\n", path);
 
 	locked = _starpu_fwrlock(f) == 0;
-	check_model(model);
-	fseek(f, 0, SEEK_SET);
-	_starpu_fftruncate(f, 0);
-	dump_model_file(f, model);
+	save_model(f, path, model, perfmodel_binary, 1);
+	if (locked)
+		_starpu_fwrunlock(f);
+
+	fclose(f);
+}
+
+int _starpu_perfmodel_save_file(struct starpu_perfmodel *model, const char *path, unsigned binary)
+{
+	int locked, ret;
+	FILE *f = fopen(path, "a+");
+	if (!f)
+	{
+		_STARPU_DISP("Could not save performance model %s: %s\n", path, strerror(errno));
+		return 1;
+	}
+
+	locked = _starpu_fwrlock(f) == 0;
+	ret = save_model(f, path, model, binary, 0);
 	if (locked)
 		_starpu_fwrunlock(f);
 
 	fclose(f);
+	return ret;
 }
 #endif
 
@@ -1430,7 +1925,7 @@ void _starpu_load_history_based_model(struct starpu_perfmodel *model, unsigned s
 			{
 				int locked;
 				locked = _starpu_frdlock(f) == 0;
-				parse_model_file(f, path, model, scan_history);
+				load_model_file(f, path, model, scan_history);
 				if (locked)
 					_starpu_frdunlock(f);
 				fclose(f);
@@ -1495,7 +1990,7 @@ int starpu_perfmodel_load_file(const char *filename, struct starpu_perfmodel *mo
 	model->path = strdup(filename);
 
 	locked = _starpu_frdlock(f) == 0;
-	ret = parse_model_file(f, filename, model, 1);
+	ret = load_model_file(f, filename, model, 1);
 	if (locked)
 		_starpu_frdunlock(f);
 
@@ -1863,6 +2358,30 @@ int _starpu_perfmodel_create_comb_if_needed(struct starpu_perfmodel_arch* arch)
 	return comb;
 }
 
+int _starpu_perfmodel_arch_equal(struct starpu_perfmodel_arch *arch1, struct starpu_perfmodel_arch *arch2)
+{
+	int dev1, dev2;
+	int nfounded = 0;
+
+	if (arch1 == arch2)
+		return 1;
+	if (arch1->ndevices != arch2->ndevices)
+		return 0;
+
+	/* Same rules as _starpu_perfmodel_arch_comb_get, so that equal archs
+	 * end up in the same combination */
+	for(dev1 = 0; dev1 < arch1->ndevices; dev1++)
+		for(dev2 = 0; dev2 < arch2->ndevices; dev2++)
+		{
+			if(arch1->devices[dev1].type == arch2->devices[dev2].type &&
+			   (ignore_devid[arch2->devices[dev2].type] ||
+			    arch1->devices[dev1].devid == arch2->devices[dev2].devid) &&
+			   arch1->devices[dev1].ncores == arch2->devices[dev2].ncores)
+				nfounded++;
+		}
+	return nfounded == arch2->ndevices;
+}
+
 void _starpu_update_perfmodel_history(struct _starpu_job *j, struct starpu_perfmodel *model, struct starpu_perfmodel_arch* arch, unsigned cpuid STARPU_ATTRIBUTE_UNUSED, double measured, unsigned impl, unsigned number)
 {
 	STARPU_ASSERT_MSG(measured >= 0, "measured=%lf\n", measured);
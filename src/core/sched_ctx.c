@@ -1586,6 +1586,12 @@ void _starpu_increment_nsubmitted_tasks_of_sched_ctx(unsigned sched_ctx_id)
 	_starpu_barrier_counter_increment(&sched_ctx->tasks_barrier, 0.0);
 }
 
+void _starpu_increment_nsubmitted_tasks_of_sched_ctx_n(unsigned sched_ctx_id, unsigned n)
+{
+	struct _starpu_sched_ctx *sched_ctx = _starpu_get_sched_ctx_struct(sched_ctx_id);
+	_starpu_barrier_counter_increment_n(&sched_ctx->tasks_barrier, n, 0.0);
+}
+
 int _starpu_get_nsubmitted_tasks_of_sched_ctx(unsigned sched_ctx_id)
 {
 	struct _starpu_sched_ctx *sched_ctx = _starpu_get_sched_ctx_struct(sched_ctx_id);
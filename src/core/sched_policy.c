@@ -43,10 +43,13 @@ long _starpu_task_break_on_exec = -1;
 static const char *starpu_idle_file;
 static void *dl_sched_handle = NULL;
 static const char *sched_lib = NULL;
+/* Batch of ready tasks being kept aside by the current thread, if any */
+static starpu_pthread_key_t push_batch_key;
 
 void _starpu_sched_init(void)
 {
 	_starpu_visu_init();
+	STARPU_PTHREAD_KEY_CREATE(&push_batch_key, NULL);
 	_starpu_task_break_on_push = starpu_getenv_number_default("STARPU_TASK_BREAK_ON_PUSH", -1);
 	_starpu_task_break_on_sched = starpu_getenv_number_default("STARPU_TASK_BREAK_ON_SCHED", -1);
 	_starpu_task_break_on_pop = starpu_getenv_number_default("STARPU_TASK_BREAK_ON_POP", -1);
@@ -54,6 +57,11 @@ void _starpu_sched_init(void)
 	starpu_idle_file = starpu_getenv("STARPU_IDLE_FILE");
 }
 
+void _starpu_sched_deinit(void)
+{
+	STARPU_PTHREAD_KEY_DELETE(push_batch_key);
+}
+
 int starpu_get_prefetch_flag(void)
 {
 	return use_prefetch;
@@ -85,6 +93,7 @@ static struct starpu_sched_policy *predefined_policies[] =
 	&_starpu_sched_modular_heteroprio_heft_policy,
 	&_starpu_sched_modular_parallel_heft_policy,
 	&_starpu_sched_eager_policy,
+	&_starpu_sched_eager_numa_policy,
 	&_starpu_sched_prio_policy,
 	&_starpu_sched_random_policy,
 	&_starpu_sched_lws_policy,
@@ -704,6 +713,67 @@ int _starpu_repush_task(struct _starpu_job *j)
 	return ret;
 }
 
+void _starpu_sched_push_batch_begin(struct _starpu_push_batch *batch)
+{
+	starpu_task_list_init(&batch->tasks);
+	batch->sched_ctx = STARPU_NMAX_SCHED_CTXS;
+	batch->previous = STARPU_PTHREAD_GETSPECIFIC(push_batch_key);
+	STARPU_PTHREAD_SETSPECIFIC(push_batch_key, batch);
+}
+
+static int _starpu_sched_push_batch_flush(struct _starpu_push_batch *batch)
+{
+	struct _starpu_sched_ctx *sched_ctx;
+	struct _starpu_worker *worker;
+	int ret;
+
+	if (starpu_task_list_empty(&batch->tasks))
+		return 0;
+
+	sched_ctx = _starpu_get_sched_ctx_struct(batch->sched_ctx);
+	worker = _starpu_get_local_worker_key();
+	if (worker)
+	{
+		STARPU_PTHREAD_MUTEX_LOCK_SCHED(&worker->sched_mutex);
+		_starpu_worker_enter_sched_op(worker);
+		STARPU_PTHREAD_MUTEX_UNLOCK_SCHED(&worker->sched_mutex);
+	}
+	_STARPU_SCHED_BEGIN;
+	ret = sched_ctx->sched_policy->push_tasks(&batch->tasks);
+	_STARPU_SCHED_END;
+	if (worker)
+	{
+		STARPU_PTHREAD_MUTEX_LOCK_SCHED(&worker->sched_mutex);
+		_starpu_worker_leave_sched_op(worker);
+		STARPU_PTHREAD_MUTEX_UNLOCK_SCHED(&worker->sched_mutex);
+	}
+	STARPU_ASSERT_MSG(starpu_task_list_empty(&batch->tasks), "the push_tasks method of the scheduler has to take all the tasks");
+	STARPU_ASSERT_MSG(ret != -1, "the push_tasks method of the scheduler can not ask for the tasks to be pushed again");
+	return ret;
+}
+
+/* Return the result of pushing the tasks of the previous context, if they had
+ * to be pushed first */
+static int _starpu_sched_push_batch_add(struct _starpu_push_batch *batch, struct starpu_task *task)
+{
+	int ret = 0;
+	if (task->sched_ctx != batch->sched_ctx)
+	{
+		/* push_tasks only handles tasks of one context at a time */
+		ret = _starpu_sched_push_batch_flush(batch);
+		batch->sched_ctx = task->sched_ctx;
+	}
+	_STARPU_TASK_BREAK_ON(task, push);
+	starpu_task_list_push_back(&batch->tasks, task);
+	return ret;
+}
+
+int _starpu_sched_push_batch_end(struct _starpu_push_batch *batch)
+{
+	STARPU_PTHREAD_SETSPECIFIC(push_batch_key, batch->previous);
+	return _starpu_sched_push_batch_flush(batch);
+}
+
 int _starpu_push_task_to_workers(struct starpu_task *task)
 {
 	struct _starpu_sched_ctx *sched_ctx = _starpu_get_sched_ctx_struct(task->sched_ctx);
@@ -812,8 +882,13 @@ int _starpu_push_task_to_workers(struct starpu_task *task)
 			STARPU_ASSERT(sched_ctx->sched_policy->push_task);
 			/* check out if there are any workers in the context */
 			unsigned nworkers = starpu_sched_ctx_get_nworkers(sched_ctx->id);
+			struct _starpu_push_batch *batch;
 			if (nworkers == 0)
 				ret = -1;
+			else if (sched_ctx->sched_policy->push_tasks
+				 && (batch = STARPU_PTHREAD_GETSPECIFIC(push_batch_key)) != NULL)
+				/* Will be pushed along the other ready tasks of the batch */
+				ret = _starpu_sched_push_batch_add(batch, task);
 			else
 			{
 				struct _starpu_worker *worker = _starpu_get_local_worker_key();
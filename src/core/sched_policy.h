@@ -38,6 +38,7 @@
 	_STARPU_TRACE_WORKER_SCHEDULING_POP
 
 void _starpu_sched_init(void);
+void _starpu_sched_deinit(void);
 
 struct starpu_machine_config;
 struct starpu_sched_policy *_starpu_get_sched_policy(struct _starpu_sched_ctx *sched_ctx);
@@ -59,6 +60,22 @@ int _starpu_repush_task(struct _starpu_job *task);
 /** actually pushes the tasks to the specific worker or to the scheduler */
 int _starpu_push_task_to_workers(struct starpu_task *task);
 
+/** Ready tasks kept aside during a starpu_task_submit_array() call, to be
+ * given to the push_tasks method of the scheduler all at once */
+struct _starpu_push_batch
+{
+	struct starpu_task_list tasks;
+	unsigned sched_ctx;
+	/** Batch of an enclosing starpu_task_submit_array() call, e.g. from
+	 * the callback of a task without codelet */
+	struct _starpu_push_batch *previous;
+};
+
+/** Start keeping ready tasks aside in \p batch for the current thread */
+void _starpu_sched_push_batch_begin(struct _starpu_push_batch *batch);
+/** Stop keeping ready tasks aside, and push those of \p batch */
+int _starpu_sched_push_batch_end(struct _starpu_push_batch *batch);
+
 /** pop a task that can be executed on the worker */
 struct starpu_task *_starpu_pop_task(struct _starpu_worker *worker);
 void _starpu_sched_post_exec_hook(struct starpu_task *task);
@@ -87,6 +104,7 @@ extern struct starpu_sched_policy _starpu_sched_dmda_ready_policy;
 extern struct starpu_sched_policy _starpu_sched_dmda_sorted_policy;
 extern struct starpu_sched_policy _starpu_sched_dmda_sorted_decision_policy;
 extern struct starpu_sched_policy _starpu_sched_eager_policy;
+extern struct starpu_sched_policy _starpu_sched_eager_numa_policy;
 extern struct starpu_sched_policy _starpu_sched_parallel_heft_policy STARPU_ATTRIBUTE_VISIBILITY_DEFAULT;
 extern struct starpu_sched_policy _starpu_sched_peager_policy;
 extern struct starpu_sched_policy _starpu_sched_heteroprio_policy;
@@ -25,6 +25,8 @@
 #include <core/jobs.h>
 #include <core/task.h>
 #include <core/task_bundle.h>
+#include <core/task_pool.h>
+#include <core/task_graph.h>
 #include <core/dependencies/data_concurrency.h>
 #include <common/config.h>
 #include <common/utils.h>
@@ -33,6 +35,7 @@
 #include <datawizard/memory_nodes.h>
 #include <profiling/profiling.h>
 #include <profiling/bound.h>
+#include <profiling/online_bound.h>
 #include <math.h>
 #include <string.h>
 #include <core/debug.h>
@@ -47,7 +50,9 @@
 /* global counters */
 static int __g_total_submitted;
 static int __g_peak_submitted;
+static int __g_current_submitted;
 static int __g_peak_ready;
+static int __g_current_ready;
 
 /* global counter variables */
 starpu_perf_counter_int64_t _starpu_task__g_total_submitted__value;
@@ -88,7 +93,9 @@ static void global_sample_updater(struct starpu_perf_counter_sample *sample, voi
 
 	_starpu_perf_counter_sample_set_int64_value(sample, __g_total_submitted, _starpu_task__g_total_submitted__value);
 	_starpu_perf_counter_sample_set_int64_value(sample, __g_peak_submitted, _starpu_task__g_peak_submitted__value);
+	_starpu_perf_counter_sample_set_int64_value(sample, __g_current_submitted, _starpu_task__g_current_submitted__value);
 	_starpu_perf_counter_sample_set_int64_value(sample, __g_peak_ready, _starpu_task__g_peak_ready__value);
+	_starpu_perf_counter_sample_set_int64_value(sample, __g_current_ready, _starpu_task__g_current_ready__value);
 }
 
 static void per_worker_sample_updater(struct starpu_perf_counter_sample *sample, void *context)
@@ -121,7 +128,9 @@ void _starpu__task_c__register_counters(void)
 		const enum starpu_perf_counter_scope scope = starpu_perf_counter_scope_global;
 		__STARPU_PERF_COUNTER_REG("starpu.task", scope, g_total_submitted, int64, "number of tasks submitted globally (since StarPU initialization)");
 		__STARPU_PERF_COUNTER_REG("starpu.task", scope, g_peak_submitted, int64, "maximum simultaneous number of tasks submitted and not yet ready, globally (since StarPU initialization)");
+		__STARPU_PERF_COUNTER_REG("starpu.task", scope, g_current_submitted, int64, "number of tasks currently submitted and not yet ready, globally");
 		__STARPU_PERF_COUNTER_REG("starpu.task", scope, g_peak_ready, int64, "maximum simultaneous number of tasks ready and not yet executing, globally (since StarPU initialization)");
+		__STARPU_PERF_COUNTER_REG("starpu.task", scope, g_current_ready, int64, "number of tasks currently ready and not yet executing, globally");
 
 		_starpu_perf_counter_register_updater(scope, global_sample_updater);
 	}
@@ -268,6 +277,7 @@ static struct _starpu_spinlock nosv_task_types_lock;
 void _starpu_task_init(void)
 {
 	STARPU_PTHREAD_KEY_CREATE(&current_task_key, NULL);
+	_starpu_task_pool_init();
 	limit_min_submitted_tasks = starpu_getenv_number("STARPU_LIMIT_MIN_SUBMITTED_TASKS");
 	limit_max_submitted_tasks = starpu_getenv_number("STARPU_LIMIT_MAX_SUBMITTED_TASKS");
 	watchdog_crash = starpu_getenv_number_default("STARPU_WATCHDOG_CRASH", 0);
@@ -297,6 +307,7 @@ void _starpu_task_deinit(void)
 	_starpu_spin_unlock(&nosv_task_types_lock);
 	_starpu_spin_destroy(&nosv_task_types_lock);
 #endif
+	_starpu_task_pool_deinit();
 	STARPU_PTHREAD_KEY_DELETE(current_task_key);
 }
 
@@ -430,12 +441,19 @@ void starpu_task_clean(struct starpu_task *task)
 struct starpu_task * STARPU_ATTRIBUTE_MALLOC starpu_task_create(void)
 {
 	struct starpu_task *task;
+	unsigned pooled = 1;
 
-	_STARPU_MALLOC(task, sizeof(struct starpu_task));
+	task = _starpu_task_pool_get_task();
+	if (!task)
+	{
+		_STARPU_MALLOC(task, sizeof(struct starpu_task));
+		pooled = 0;
+	}
 	starpu_task_init(task);
 
 	/* Dynamically allocated tasks are destroyed by default */
 	task->destroy = 1;
+	task->pooled = pooled;
 
 	return task;
 }
@@ -505,7 +523,10 @@ void _starpu_task_destroy(struct starpu_task *task)
 		if (task->prologue_callback_pop_arg_free)
 			free(task->prologue_callback_pop_arg);
 
-		free(task);
+		if (task->pooled)
+			_starpu_task_pool_put_task(task);
+		else
+			free(task);
 	}
 }
 
@@ -633,6 +654,8 @@ int _starpu_submit_job(struct _starpu_job *j, int nodeps)
 	_STARPU_LOG_IN();
 	/* notify bound computation of a new task */
 	_starpu_bound_record(j);
+	if (_starpu_online_bound_enabled)
+		_starpu_online_bound_submit(j);
 
 #ifdef STARPU_NOSV
 	if (!j->nosv_task_type)
@@ -641,7 +664,11 @@ int _starpu_submit_job(struct _starpu_job *j, int nodeps)
 	}
 #endif
 
-	_starpu_increment_nsubmitted_tasks_of_sched_ctx(j->task->sched_ctx);
+	if (j->submit_accounted)
+		/* starpu_task_submit_array already did it */
+		j->submit_accounted = 0;
+	else
+		_starpu_increment_nsubmitted_tasks_of_sched_ctx(j->task->sched_ctx);
 	_starpu_sched_task_submit(task);
 
 #ifdef STARPU_USE_SC_HYPERVISOR
@@ -897,6 +924,21 @@ void _starpu_task_check_deprecated_fields(struct starpu_task *task STARPU_ATTRIB
 	/* None any more */
 }
 
+int _starpu_task_check_executable(struct starpu_task *task)
+{
+	/* Check the type of worker(s) required by the task exist */
+	if (STARPU_UNLIKELY(!_starpu_worker_exists(task)))
+		return -ENODEV;
+
+	/* In case we require that a task should be explicitly
+	 * executed on a specific worker, we make sure that the worker
+	 * is able to execute this task.  */
+	if (STARPU_UNLIKELY(task->execute_on_a_specific_worker && !starpu_combined_worker_can_execute_task(task->workerid, task, 0)))
+		return -ENODEV;
+
+	return 0;
+}
+
 static int _starpu_task_submit_head(struct starpu_task *task)
 {
 	unsigned is_sync = task->synchronous;
@@ -1008,17 +1050,7 @@ static int _starpu_task_submit_head(struct starpu_task *task)
 				_starpu_data_partition_access_submit(handle, (mode & (STARPU_W|STARPU_REDUX)) != 0);
 		}
 
-		/* Check the type of worker(s) required by the task exist */
-		if (STARPU_UNLIKELY(!_starpu_worker_exists(task)))
-		{
-			_STARPU_LOG_OUT_TAG("ENODEV");
-			return -ENODEV;
-		}
-
-		/* In case we require that a task should be explicitly
-		 * executed on a specific worker, we make sure that the worker
-		 * is able to execute this task.  */
-		if (STARPU_UNLIKELY(task->execute_on_a_specific_worker && !starpu_combined_worker_can_execute_task(task->workerid, task, 0)))
+		if (STARPU_UNLIKELY(_starpu_task_check_executable(task)))
 		{
 			_STARPU_LOG_OUT_TAG("ENODEV");
 			return -ENODEV;
@@ -1034,6 +1066,82 @@ static int _starpu_task_submit_head(struct starpu_task *task)
 	return 0;
 }
 
+/* Account for the tasks of a starpu_task_submit_array() call all at once,
+ * grouped by scheduling context */
+static void _starpu_task_submit_array_account(struct starpu_task **tasks, unsigned ntasks)
+{
+	unsigned sched_ctx = STARPU_NMAX_SCHED_CTXS;
+	unsigned i, n = 0, naccounted = 0;
+
+	for (i = 0; i < ntasks; i++)
+	{
+		struct starpu_task *task = tasks[i];
+		struct _starpu_job *j = _starpu_get_job_associated_to_task(task);
+
+		if (task->synchronous || j->internal
+#ifdef STARPU_OPENMP
+		    || j->continuation
+#endif
+		   )
+			/* Let the normal path take care of these */
+			continue;
+
+		if (task->sched_ctx == STARPU_NMAX_SCHED_CTXS)
+			task->sched_ctx = _starpu_sched_ctx_get_current_context();
+		if (task->sched_ctx != sched_ctx)
+		{
+			if (n)
+				_starpu_increment_nsubmitted_tasks_of_sched_ctx_n(sched_ctx, n);
+			sched_ctx = task->sched_ctx;
+			n = 0;
+		}
+		j->submit_accounted = 1;
+		n++;
+		naccounted++;
+	}
+	if (n)
+		_starpu_increment_nsubmitted_tasks_of_sched_ctx_n(sched_ctx, n);
+
+	if (naccounted && !_starpu_perf_counter_paused())
+	{
+		(void) STARPU_PERF_COUNTER_ADD64(&_starpu_task__g_total_submitted__value, naccounted);
+		int64_t value = STARPU_PERF_COUNTER_ADD64(&_starpu_task__g_current_submitted__value, naccounted);
+		_starpu_perf_counter_update_max_int64(&_starpu_task__g_peak_submitted__value, value);
+		_starpu_perf_counter_update_global_sample();
+	}
+}
+
+/* The task was accounted by starpu_task_submit_array, but will not be
+ * submitted after all */
+static void _starpu_task_submit_unaccount(struct _starpu_job *j)
+{
+	j->submit_accounted = 0;
+	_starpu_decrement_nsubmitted_tasks_of_sched_ctx(j->task->sched_ctx);
+	if (!_starpu_perf_counter_paused())
+	{
+		(void) STARPU_PERF_COUNTER_ADD64(&_starpu_task__g_total_submitted__value, -1);
+		(void) STARPU_PERF_COUNTER_ADD64(&_starpu_task__g_current_submitted__value, -1);
+	}
+}
+
+/* Wait for the number of submitted tasks to go down if the application asked
+ * for it */
+static void _starpu_task_submit_throttle(void)
+{
+	if (limit_max_submitted_tasks >= 0 && limit_min_submitted_tasks >= 0)
+	{
+		int nsubmitted_tasks = starpu_task_nsubmitted();
+		if (limit_max_submitted_tasks < nsubmitted_tasks
+			&& limit_min_submitted_tasks < nsubmitted_tasks)
+		{
+			starpu_do_schedule();
+			_STARPU_TRACE_TASK_THROTTLE_START();
+			starpu_task_wait_for_n_submitted(limit_min_submitted_tasks);
+			_STARPU_TRACE_TASK_THROTTLE_END();
+		}
+	}
+}
+
 /* application should submit new tasks to StarPU through this function */
 int _starpu_task_submit(struct starpu_task *task, int nodeps)
 {
@@ -1081,10 +1189,14 @@ int _starpu_task_submit(struct starpu_task *task, int nodeps)
 		;
 	if (!_starpu_perf_counter_paused() && !j->internal && !continuation)
 	{
-		(void) STARPU_PERF_COUNTER_ADD64(&_starpu_task__g_total_submitted__value, 1);
-		int64_t value = STARPU_PERF_COUNTER_ADD64(&_starpu_task__g_current_submitted__value, 1);
-		_starpu_perf_counter_update_max_int64(&_starpu_task__g_peak_submitted__value, value);
-		_starpu_perf_counter_update_global_sample();
+		int64_t value;
+		if (!j->submit_accounted)
+		{
+			(void) STARPU_PERF_COUNTER_ADD64(&_starpu_task__g_total_submitted__value, 1);
+			value = STARPU_PERF_COUNTER_ADD64(&_starpu_task__g_current_submitted__value, 1);
+			_starpu_perf_counter_update_max_int64(&_starpu_task__g_peak_submitted__value, value);
+			_starpu_perf_counter_update_global_sample();
+		}
 
 		if (task->cl && task->cl->perf_counter_values)
 		{
@@ -1098,22 +1210,12 @@ int _starpu_task_submit(struct starpu_task *task, int nodeps)
 	}
 	STARPU_ASSERT_MSG(!(nodeps && continuation), "not supported\n");
 
-	if (!j->internal && limit_max_submitted_tasks >= 0 && limit_min_submitted_tasks >= 0)
-	{
-		int nsubmitted_tasks = starpu_task_nsubmitted();
-		if (limit_max_submitted_tasks < nsubmitted_tasks
-			&& limit_min_submitted_tasks < nsubmitted_tasks)
-		{
-			starpu_do_schedule();
-			_STARPU_TRACE_TASK_THROTTLE_START();
-			starpu_task_wait_for_n_submitted(limit_min_submitted_tasks);
-			_STARPU_TRACE_TASK_THROTTLE_END();
-		}
-	}
+	if (!j->internal && !j->submit_accounted)
+		_starpu_task_submit_throttle();
 
 	_STARPU_TRACE_TASK_SUBMIT_START();
 
-	if (task->cl && !continuation)
+	if (task->cl && !continuation && !j->ordered_buffers_set)
 	{
 		_starpu_job_set_ordered_buffers(j);
 	}
@@ -1121,6 +1223,8 @@ int _starpu_task_submit(struct starpu_task *task, int nodeps)
 	ret = _starpu_task_submit_head(task);
 	if (ret)
 	{
+		if (STARPU_UNLIKELY(j->submit_accounted))
+			_starpu_task_submit_unaccount(j);
 		_STARPU_TRACE_TASK_SUBMIT_END();
 		return ret;
 	}
@@ -1228,9 +1332,65 @@ int starpu_task_submit(struct starpu_task *task)
 	unsigned long long timestamp = 1000000000ULL*tp.tv_sec + tp.tv_nsec;
 	_STARPU_DEBUG("{%llu} [%s(%p)] Submission | id %lu\n", timestamp, starpu_task_get_name(task), task, starpu_task_get_job_id(task));
 #endif
+	if (STARPU_UNLIKELY(_starpu_task_graph_capturing))
+	{
+		/* Record it before it gets possibly executed and destroyed */
+		_starpu_task_graph_capture_task(task);
+		int ret = _starpu_task_submit(task, 0);
+		if (ret)
+			_starpu_task_graph_capture_cancel(task);
+		return ret;
+	}
 	return _starpu_task_submit(task, 0);
 }
 
+int starpu_task_submit_array(struct starpu_task **tasks, unsigned ntasks)
+{
+	struct _starpu_push_batch batch;
+	unsigned i;
+	int ret = 0, push_ret = 0, err;
+
+	_starpu_task_submit_throttle();
+	_starpu_task_submit_array_account(tasks, ntasks);
+
+	/* Ready tasks are kept aside and given to the scheduler at the end */
+	_starpu_sched_push_batch_begin(&batch);
+	for (i = 0; i < ntasks; i++)
+	{
+		struct starpu_task *task = tasks[i];
+
+		if (STARPU_UNLIKELY(task->synchronous))
+		{
+			/* It will wait for its own termination, which may
+			 * depend on the tasks kept aside */
+			err = _starpu_sched_push_batch_end(&batch);
+			if (!push_ret)
+				push_ret = err;
+			ret = starpu_task_submit(task);
+			_starpu_sched_push_batch_begin(&batch);
+		}
+		else
+			ret = starpu_task_submit(task);
+
+		if (STARPU_UNLIKELY(ret))
+		{
+			/* The remaining tasks will not be submitted */
+			for (i++; i < ntasks; i++)
+			{
+				struct _starpu_job *j = _starpu_get_job_associated_to_task(tasks[i]);
+				if (j->submit_accounted)
+					_starpu_task_submit_unaccount(j);
+			}
+			break;
+		}
+	}
+	err = _starpu_sched_push_batch_end(&batch);
+	if (!push_ret)
+		push_ret = err;
+
+	return ret ? ret : push_ret;
+}
+
 int _starpu_task_submit_internally(struct starpu_task *task)
 {
 	struct _starpu_job *j = _starpu_get_job_associated_to_task(task);
@@ -1551,6 +1711,11 @@ void starpu_iteration_push(unsigned long iteration)
 	unsigned level = ctx->iteration_level++;
 	if (level < sizeof(ctx->iterations)/sizeof(ctx->iterations[0]))
 		ctx->iterations[level] = iteration;
+	if (level == 0 && _starpu_online_bound_enabled)
+		/* Start accounting the iteration in its own window */
+		_starpu_online_bound_new_window();
+	if (STARPU_UNLIKELY(_starpu_task_graph_capturing))
+		_starpu_task_graph_capture_iteration_push(level);
 }
 
 void starpu_iteration_pop(void)
@@ -1562,6 +1727,10 @@ void starpu_iteration_pop(void)
 	unsigned level = ctx->iteration_level--;
 	if (level < sizeof(ctx->iterations)/sizeof(ctx->iterations[0]))
 		ctx->iterations[level] = -1;
+	if (level == 1 && _starpu_online_bound_enabled)
+		_starpu_online_bound_new_window();
+	if (STARPU_UNLIKELY(_starpu_task_graph_capturing))
+		_starpu_task_graph_capture_iteration_pop(level - 1);
 }
 
 void starpu_do_schedule(void)
@@ -50,6 +50,18 @@ int _starpu_submit_job(struct _starpu_job *j, int nodeps);
 
 void _starpu_task_declare_deps_array(struct starpu_task *task, unsigned ndeps, struct starpu_task *task_array[], int check);
 
+/** Return -ENODEV if no worker can execute \p task, whose sched_ctx and where
+ * fields have to be set, 0 otherwise */
+int _starpu_task_check_executable(struct starpu_task *task);
+
+/** Make \p j depend on \p dep_jobs. None of these jobs may have been
+ * submitted yet, and the successor lists of \p dep_jobs must have been
+ * sized with _starpu_job_reserve_successors(). This is used to replay task
+ * graphs, whose dependencies were checked during the capture. */
+void _starpu_job_declare_recorded_deps(struct _starpu_job *j, unsigned ndeps, struct _starpu_job *dep_jobs[]);
+/** Make room for \p nsuccs successors in the successor list of \p j */
+void _starpu_job_reserve_successors(struct _starpu_job *j, unsigned nsuccs);
+
 #define _STARPU_JOB_UNSET ((struct _starpu_job *) NULL)
 #define _STARPU_JOB_SETTING ((struct _starpu_job *) 1)
 
@@ -0,0 +1,632 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+/*
+ * Record and replay of task graphs.
+ *
+ * While capturing, the tasks submitted by the application are copied into
+ * templates. When the capture ends, the dependencies which sequential
+ * consistency infers between the recorded tasks are computed once for all,
+ * as well as the sorted order of their buffers.
+ *
+ * On replay, the tasks are instantiated from the templates, connected with
+ * the recorded dependencies directly, without going through
+ * starpu_task_declare_deps_array(), since none of them is submitted yet, and
+ * submitted with implicit dependencies
+ * computed only for the first and last accesses to each piece of data, which
+ * is enough to order the whole graph with respect to the tasks submitted
+ * before and after it:
+ * - the first access (or first group of concurrent reads) depends on what
+ *   was submitted before, and all other accesses depend on it through the
+ *   recorded dependencies;
+ * - the last write and the reads which follow it become the last accessors
+ *   of the data, on which what is submitted later will depend.
+ * The other accesses still update the state of the data on submission, e.g.
+ * whether it is initialized, see _starpu_implicit_data_deps_access. Since
+ * these updates do not depend on the order of the accesses, they are merged
+ * into one update per piece of data.
+ * Data accessed in STARPU_REDUX or STARPU_COMMUTE mode, or partitioned
+ * asynchronously, keeps going through sequential consistency for all
+ * accesses.
+ */
+
+#include <starpu.h>
+#include <common/config.h>
+#include <common/utils.h>
+#include <common/uthash.h>
+#include <core/jobs.h>
+#include <core/task.h>
+#include <core/task_graph.h>
+#include <core/workers.h>
+#include <core/dependencies/data_concurrency.h>
+#include <core/dependencies/implicit_data_deps.h>
+#include <datawizard/coherency.h>
+
+struct _starpu_task_graph_node
+{
+	/** Template of the task */
+	struct starpu_task task;
+	/** Whether task.cl_arg is a copy owned by the graph, to be
+	 * duplicated for each replay */
+	unsigned cl_arg_copy;
+	/** Per-buffer sequential consistency to be used on replay */
+	unsigned char *handles_sequential_consistency;
+	/** Buffers sorted as _starpu_job_set_ordered_buffers would */
+	struct _starpu_data_descr *ordered_buffers;
+	/** Indexes of the nodes this one depends on */
+	unsigned *deps;
+	unsigned ndeps;
+	/** Number of nodes which depend on this one */
+	unsigned nsuccs;
+};
+
+/* Update of the state of a piece of data for the accesses whose sequential
+ * consistency is dropped on replay */
+struct _starpu_task_graph_update
+{
+	starpu_data_handle_t handle;
+	/** Union of the modes of these accesses */
+	enum starpu_data_access_mode mode;
+	/** Node of the first of these accesses, before whose submission the
+	 * update is done */
+	unsigned node;
+};
+
+struct _starpu_task_graph
+{
+	struct _starpu_task_graph_node *nodes;
+	unsigned nnodes;
+	unsigned nalloc;
+
+	/** Sorted by node */
+	struct _starpu_task_graph_update *updates;
+	unsigned nupdates;
+
+	starpu_pthread_t thread;
+	/** Iteration level of the starpu_iteration_push() starting the capture */
+	unsigned level;
+	unsigned started;
+	unsigned stopped;
+	/** Some task could not be recorded */
+	unsigned failed;
+	/** Last recorded task, in case its submission fails */
+	struct starpu_task *last_task;
+};
+
+/* Sequence of accesses to a piece of data within the recorded graph */
+struct _starpu_task_graph_data
+{
+	starpu_data_handle_t handle;
+	/* Accessing nodes, and their access modes (STARPU_R and/or STARPU_W) */
+	unsigned *nodes;
+	enum starpu_data_access_mode *modes;
+	unsigned naccesses;
+	unsigned nalloc;
+	/* Keep sequential consistency for all accesses */
+	unsigned full;
+	UT_hash_handle hh;
+};
+
+struct _starpu_task_graph *_starpu_task_graph_capturing;
+
+void starpu_task_graph_capture_begin(void)
+{
+	STARPU_ASSERT_MSG(!_starpu_task_graph_capturing, "only one task graph can be captured at a time");
+	struct _starpu_task_graph *graph;
+	_STARPU_CALLOC(graph, 1, sizeof(*graph));
+	graph->thread = starpu_pthread_self();
+	_starpu_task_graph_capturing = graph;
+}
+
+static int _starpu_task_graph_capture_active(struct _starpu_task_graph *graph)
+{
+	return graph && graph->started && !graph->stopped && starpu_pthread_equal(graph->thread, starpu_pthread_self());
+}
+
+void _starpu_task_graph_capture_iteration_push(unsigned level)
+{
+	struct _starpu_task_graph *graph = _starpu_task_graph_capturing;
+	if (!graph->started && starpu_pthread_equal(graph->thread, starpu_pthread_self()))
+	{
+		graph->started = 1;
+		graph->level = level;
+	}
+}
+
+void _starpu_task_graph_capture_iteration_pop(unsigned level)
+{
+	struct _starpu_task_graph *graph = _starpu_task_graph_capturing;
+	if (_starpu_task_graph_capture_active(graph) && level == graph->level)
+		graph->stopped = 1;
+}
+
+static void _starpu_task_graph_fail(struct _starpu_task_graph *graph, const char *reason)
+{
+	if (!graph->failed)
+		_STARPU_DISP("Warning: task graph capture failed: %s\n", reason);
+	graph->failed = 1;
+}
+
+void _starpu_task_graph_capture_deps(struct starpu_task *task)
+{
+	(void) task;
+	struct _starpu_task_graph *graph = _starpu_task_graph_capturing;
+	if (_starpu_task_graph_capture_active(graph))
+		_starpu_task_graph_fail(graph, "explicit task dependencies can not be recorded");
+}
+
+void _starpu_task_graph_capture_task(struct starpu_task *task)
+{
+	struct _starpu_task_graph *graph = _starpu_task_graph_capturing;
+	if (!_starpu_task_graph_capture_active(graph) || graph->failed)
+		return;
+	graph->last_task = NULL;
+
+	struct _starpu_job *j = _starpu_get_job_associated_to_task(task);
+	if (j->internal)
+		return;
+
+	if (task->use_tag || task->regenerate || task->transaction || task->bundle)
+	{
+		_starpu_task_graph_fail(graph, "tasks with tags, regeneration, transactions or bundles can not be recorded");
+		return;
+	}
+	if (task->cl_ret_free || task->callback_arg_free || task->soon_callback_arg_free
+	    || task->prologue_callback_arg_free || task->prologue_callback_pop_arg_free
+	    || task->epilogue_callback_arg_free)
+	{
+		_starpu_task_graph_fail(graph, "tasks with automatically-freed callback arguments can not be recorded");
+		return;
+	}
+
+	if (graph->nnodes == graph->nalloc)
+	{
+		graph->nalloc = graph->nalloc ? 2 * graph->nalloc : 64;
+		_STARPU_REALLOC(graph->nodes, graph->nalloc * sizeof(graph->nodes[0]));
+	}
+	struct _starpu_task_graph_node *node = &graph->nodes[graph->nnodes++];
+	memset(node, 0, sizeof(*node));
+	node->task = *task;
+
+	struct starpu_task *template = &node->task;
+	template->starpu_private = NULL;
+	template->prev = NULL;
+	template->next = NULL;
+	template->profiling_info = NULL;
+	template->dyn_interfaces = NULL;
+	template->pooled = 0;
+	template->synchronous = 0;
+	template->detach = 1;
+	template->destroy = 1;
+	template->status = STARPU_TASK_INIT;
+	template->scheduled = 0;
+	template->prefetched = 0;
+	template->failed = 0;
+
+	if (task->cl_arg_free && task->cl_arg)
+	{
+		_STARPU_MALLOC(template->cl_arg, task->cl_arg_size);
+		memcpy(template->cl_arg, task->cl_arg, task->cl_arg_size);
+		node->cl_arg_copy = 1;
+	}
+	template->cl_arg_free = 0;
+
+	unsigned nbuffers = task->cl ? STARPU_TASK_GET_NBUFFERS(task) : 0;
+	if (task->dyn_handles)
+	{
+		_STARPU_MALLOC(template->dyn_handles, nbuffers * sizeof(template->dyn_handles[0]));
+		memcpy(template->dyn_handles, task->dyn_handles, nbuffers * sizeof(template->dyn_handles[0]));
+	}
+	if (task->dyn_modes)
+	{
+		_STARPU_MALLOC(template->dyn_modes, nbuffers * sizeof(template->dyn_modes[0]));
+		memcpy(template->dyn_modes, task->dyn_modes, nbuffers * sizeof(template->dyn_modes[0]));
+	}
+
+	if (nbuffers)
+	{
+		unsigned i;
+		_STARPU_MALLOC(node->handles_sequential_consistency, nbuffers * sizeof(node->handles_sequential_consistency[0]));
+		for (i = 0; i < nbuffers; i++)
+			node->handles_sequential_consistency[i] = task->sequential_consistency &&
+				(task->handles_sequential_consistency ? task->handles_sequential_consistency[i] : STARPU_TASK_GET_HANDLE(task, i)->sequential_consistency);
+		_STARPU_MALLOC(node->ordered_buffers, nbuffers * sizeof(node->ordered_buffers[0]));
+		_starpu_task_set_ordered_buffers(template, node->ordered_buffers);
+	}
+	template->handles_sequential_consistency = node->handles_sequential_consistency;
+	graph->last_task = task;
+}
+
+static void _starpu_task_graph_node_clean(struct _starpu_task_graph_node *node)
+{
+	if (node->cl_arg_copy)
+		free(node->task.cl_arg);
+	free(node->task.dyn_handles);
+	free(node->task.dyn_modes);
+	free(node->handles_sequential_consistency);
+	free(node->ordered_buffers);
+	free(node->deps);
+}
+
+void _starpu_task_graph_capture_cancel(struct starpu_task *task)
+{
+	struct _starpu_task_graph *graph = _starpu_task_graph_capturing;
+	if (!_starpu_task_graph_capture_active(graph) || graph->last_task != task)
+		return;
+
+	/* The task was not actually submitted */
+	_starpu_task_graph_node_clean(&graph->nodes[--graph->nnodes]);
+	graph->last_task = NULL;
+}
+
+static struct _starpu_task_graph_data *_starpu_task_graph_get_data(struct _starpu_task_graph_data **table, starpu_data_handle_t handle)
+{
+	struct _starpu_task_graph_data *data;
+	HASH_FIND_PTR(*table, &handle, data);
+	if (!data)
+	{
+		_STARPU_CALLOC(data, 1, sizeof(*data));
+		data->handle = handle;
+		data->full = handle->parent_handle && handle->parent_handle->nplans;
+		HASH_ADD_PTR(*table, handle, data);
+	}
+	return data;
+}
+
+static void _starpu_task_graph_add_dep(struct _starpu_task_graph_node *node, unsigned *ndeps_alloc, unsigned *last_dep, unsigned self, unsigned dep)
+{
+	/* Avoid adding the same dependency twice in a row */
+	if (last_dep[dep] == self + 1)
+		return;
+	last_dep[dep] = self + 1;
+
+	if (node->ndeps == *ndeps_alloc)
+	{
+		*ndeps_alloc = *ndeps_alloc ? 2 * *ndeps_alloc : 4;
+		_STARPU_REALLOC(node->deps, *ndeps_alloc * sizeof(node->deps[0]));
+	}
+	node->deps[node->ndeps++] = dep;
+}
+
+/* Drop the sequential consistency of the buffers of \p node which access \p
+ * handle, their dependencies are recorded in the graph */
+static void _starpu_task_graph_drop_consistency(struct _starpu_task_graph_node *node, starpu_data_handle_t handle)
+{
+	unsigned i, nbuffers = STARPU_TASK_GET_NBUFFERS(&node->task);
+	for (i = 0; i < nbuffers; i++)
+		if (STARPU_TASK_GET_HANDLE(&node->task, i) == handle)
+			node->handles_sequential_consistency[i] = 0;
+}
+
+static int _starpu_task_graph_update_cmp(const void *a, const void *b)
+{
+	const struct _starpu_task_graph_update *ua = a, *ub = b;
+	return ua->node < ub->node ? -1 : ua->node > ub->node;
+}
+
+/* Update the state of a handle whose dependencies are recorded in the graph,
+ * as _starpu_detect_implicit_data_deps would */
+static void _starpu_task_graph_update_handle(struct _starpu_task_graph_update *update)
+{
+	starpu_data_handle_t handle = update->handle;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&handle->sequential_consistency_mutex);
+	if (handle->sequential_consistency)
+		_starpu_implicit_data_deps_access(handle, update->mode);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&handle->sequential_consistency_mutex);
+}
+
+/* Compute the dependencies that sequential consistency would infer between the
+ * recorded tasks, and which accesses need to keep it */
+static void _starpu_task_graph_compute_deps(struct _starpu_task_graph *graph)
+{
+	struct _starpu_task_graph_data *table = NULL, *data, *tmp;
+	unsigned *last_dep;
+	unsigned n;
+
+	_STARPU_CALLOC(last_dep, graph->nnodes ? graph->nnodes : 1, sizeof(*last_dep));
+
+	/* Record the sequence of accesses to each piece of data */
+	for (n = 0; n < graph->nnodes; n++)
+	{
+		struct _starpu_task_graph_node *node = &graph->nodes[n];
+		struct starpu_task *task = &node->task;
+		unsigned i, nbuffers = task->cl ? STARPU_TASK_GET_NBUFFERS(task) : 0;
+
+		for (i = 0; i < nbuffers; i++)
+		{
+			starpu_data_handle_t handle = STARPU_TASK_GET_HANDLE(task, i);
+			enum starpu_data_access_mode mode = STARPU_TASK_GET_MODE(task, i) & ~(STARPU_SSEND|STARPU_LOCALITY|STARPU_NOFOOTPRINT);
+
+			if (mode == STARPU_NONE || mode & STARPU_SCRATCH || !node->handles_sequential_consistency[i])
+				continue;
+
+			data = _starpu_task_graph_get_data(&table, handle);
+			if (mode == STARPU_REDUX || mode & STARPU_COMMUTE)
+				data->full = 1;
+
+			if (data->naccesses && data->nodes[data->naccesses-1] == n)
+			{
+				/* Same data accessed several times by the task */
+				data->modes[data->naccesses-1] |= mode & STARPU_RW;
+				continue;
+			}
+			if (data->naccesses == data->nalloc)
+			{
+				data->nalloc = data->nalloc ? 2 * data->nalloc : 8;
+				_STARPU_REALLOC(data->nodes, data->nalloc * sizeof(data->nodes[0]));
+				_STARPU_REALLOC(data->modes, data->nalloc * sizeof(data->modes[0]));
+			}
+			data->nodes[data->naccesses] = n;
+			data->modes[data->naccesses] = mode & STARPU_RW;
+			data->naccesses++;
+		}
+	}
+
+	unsigned *ndeps_alloc;
+	unsigned nupdates_alloc = 0;
+	_STARPU_CALLOC(ndeps_alloc, graph->nnodes ? graph->nnodes : 1, sizeof(*ndeps_alloc));
+
+	HASH_ITER(hh, table, data, tmp)
+	{
+		unsigned a, first_write = data->naccesses, last_write = data->naccesses;
+		struct _starpu_task_graph_update *update = NULL;
+
+		if (data->full)
+			/* Leave dependencies to sequential consistency */
+			continue;
+
+		for (a = 0; a < data->naccesses; a++)
+			if (data->modes[a] & STARPU_W)
+			{
+				if (first_write == data->naccesses)
+					first_write = a;
+				last_write = a;
+			}
+
+		/* Replay the sequential consistency rules: writes depend on
+		 * the previous readers if any, or else on the previous
+		 * writer, and reads depend on the previous writer. */
+		int writer = -1;
+		unsigned readers_start = 0;
+		for (a = 0; a < data->naccesses; a++)
+		{
+			unsigned self = data->nodes[a];
+			struct _starpu_task_graph_node *node = &graph->nodes[self];
+			unsigned b;
+
+			if (data->modes[a] & STARPU_W)
+			{
+				if (readers_start < a)
+					for (b = readers_start; b < a; b++)
+						_starpu_task_graph_add_dep(node, &ndeps_alloc[self], last_dep, self, data->nodes[b]);
+				else if (writer >= 0)
+					_starpu_task_graph_add_dep(node, &ndeps_alloc[self], last_dep, self, writer);
+				writer = self;
+				readers_start = a + 1;
+			}
+			else if (writer >= 0)
+				_starpu_task_graph_add_dep(node, &ndeps_alloc[self], last_dep, self, writer);
+
+			/* Keep sequential consistency only for the first
+			 * accesses (up to the first write included if it
+			 * comes first), and from the last write on */
+			int first = first_write == 0 ? a == 0 : a <= first_write;
+			int last = last_write == data->naccesses || a >= last_write;
+			if (!first && !last)
+			{
+				_starpu_task_graph_drop_consistency(node, data->handle);
+				if (!update)
+				{
+					if (graph->nupdates == nupdates_alloc)
+					{
+						nupdates_alloc = nupdates_alloc ? 2 * nupdates_alloc : 8;
+						_STARPU_REALLOC(graph->updates, nupdates_alloc * sizeof(graph->updates[0]));
+					}
+					update = &graph->updates[graph->nupdates++];
+					update->handle = data->handle;
+					update->mode = 0;
+					update->node = self;
+				}
+				update->mode |= data->modes[a];
+			}
+		}
+	}
+
+	HASH_ITER(hh, table, data, tmp)
+	{
+		HASH_DEL(table, data);
+		free(data->nodes);
+		free(data->modes);
+		free(data);
+	}
+	free(ndeps_alloc);
+	free(last_dep);
+
+	if (graph->nupdates)
+		qsort(graph->updates, graph->nupdates, sizeof(graph->updates[0]), _starpu_task_graph_update_cmp);
+
+	/* Size the successor lists on replay */
+	for (n = 0; n < graph->nnodes; n++)
+	{
+		struct _starpu_task_graph_node *node = &graph->nodes[n];
+		unsigned d;
+		for (d = 0; d < node->ndeps; d++)
+			graph->nodes[node->deps[d]].nsuccs++;
+	}
+
+	/* Tasks which do not keep sequential consistency for any data can
+	 * skip it completely */
+	for (n = 0; n < graph->nnodes; n++)
+	{
+		struct _starpu_task_graph_node *node = &graph->nodes[n];
+		unsigned i, nbuffers = node->task.cl ? STARPU_TASK_GET_NBUFFERS(&node->task) : 0;
+		unsigned consistent = 0;
+		for (i = 0; i < nbuffers; i++)
+			consistent |= node->handles_sequential_consistency[i];
+		if (!consistent)
+			node->task.sequential_consistency = 0;
+	}
+}
+
+starpu_task_graph_t starpu_task_graph_capture_end(void)
+{
+	struct _starpu_task_graph *graph = _starpu_task_graph_capturing;
+	STARPU_ASSERT_MSG(graph, "starpu_task_graph_capture_end must follow starpu_task_graph_capture_begin");
+	STARPU_ASSERT_MSG(starpu_pthread_equal(graph->thread, starpu_pthread_self()), "starpu_task_graph_capture_end must be called by the thread which called starpu_task_graph_capture_begin");
+	STARPU_ASSERT_MSG(!graph->started || graph->stopped, "starpu_task_graph_capture_end must be called after the starpu_iteration_pop call matching the captured iteration");
+	_starpu_task_graph_capturing = NULL;
+
+	if (graph->failed)
+	{
+		starpu_task_graph_destroy(graph);
+		return NULL;
+	}
+
+	_starpu_task_graph_compute_deps(graph);
+	return graph;
+}
+
+unsigned starpu_task_graph_get_ntasks(starpu_task_graph_t graph)
+{
+	return graph->nnodes;
+}
+
+int starpu_task_graph_replay(starpu_task_graph_t graph, unsigned long iteration, void **cl_args)
+{
+	struct starpu_task **tasks;
+	struct _starpu_task_graph_update *update, *updates_end = graph->updates + graph->nupdates;
+	unsigned n;
+	int ret = 0;
+
+	if (!graph->nnodes)
+		return 0;
+
+	_STARPU_MALLOC(tasks, graph->nnodes * sizeof(tasks[0]));
+
+	/* Instantiate all tasks first, so that we can connect them before any
+	 * of them gets submitted, and thus possibly destroyed */
+	for (n = 0; n < graph->nnodes; n++)
+	{
+		struct _starpu_task_graph_node *node = &graph->nodes[n];
+		struct starpu_task *task = starpu_task_create();
+		unsigned pooled = task->pooled;
+		unsigned nbuffers = node->task.cl ? STARPU_TASK_GET_NBUFFERS(&node->task) : 0;
+		struct _starpu_job *j;
+
+		*task = node->task;
+		task->pooled = pooled;
+		tasks[n] = task;
+
+		if (task->cl)
+		{
+			/* Make sure, as _starpu_task_submit_head will, that the
+			 * task can be executed, so that we can give up before
+			 * submitting any task of the graph */
+			if (task->sched_ctx == STARPU_NMAX_SCHED_CTXS)
+				task->sched_ctx = _starpu_sched_ctx_get_current_context();
+			if (task->where == -1)
+				task->where = task->cl->where;
+			ret = _starpu_task_check_executable(task);
+			if (ret)
+			{
+				unsigned m;
+				/* These still belong to the template */
+				task->dyn_handles = NULL;
+				task->dyn_modes = NULL;
+				for (m = 0; m <= n; m++)
+				{
+					tasks[m]->destroy = 0;
+					starpu_task_destroy(tasks[m]);
+				}
+				free(tasks);
+				return ret;
+			}
+		}
+
+		if (cl_args && cl_args[n])
+			task->cl_arg = cl_args[n];
+		else if (node->cl_arg_copy)
+		{
+			_STARPU_MALLOC(task->cl_arg, task->cl_arg_size);
+			memcpy(task->cl_arg, node->task.cl_arg, task->cl_arg_size);
+			task->cl_arg_free = 1;
+		}
+
+		if (node->task.dyn_handles)
+		{
+			_STARPU_MALLOC(task->dyn_handles, nbuffers * sizeof(task->dyn_handles[0]));
+			memcpy(task->dyn_handles, node->task.dyn_handles, nbuffers * sizeof(task->dyn_handles[0]));
+		}
+		if (node->task.dyn_modes)
+		{
+			_STARPU_MALLOC(task->dyn_modes, nbuffers * sizeof(task->dyn_modes[0]));
+			memcpy(task->dyn_modes, node->task.dyn_modes, nbuffers * sizeof(task->dyn_modes[0]));
+		}
+
+		j = _starpu_get_job_associated_to_task(task);
+		if (nbuffers)
+		{
+			/* The buffers were already sorted during the capture */
+			memcpy(_STARPU_JOB_GET_ORDERED_BUFFERS(j), node->ordered_buffers, nbuffers * sizeof(node->ordered_buffers[0]));
+			j->ordered_buffers_set = 1;
+		}
+		_starpu_job_reserve_successors(j, node->nsuccs);
+	}
+
+	for (n = 0; n < graph->nnodes; n++)
+	{
+		struct _starpu_task_graph_node *node = &graph->nodes[n];
+		if (node->ndeps)
+		{
+			struct _starpu_job *deps[node->ndeps];
+			unsigned d;
+			for (d = 0; d < node->ndeps; d++)
+				deps[d] = _starpu_get_job_associated_to_task(tasks[node->deps[d]]);
+			_starpu_job_declare_recorded_deps(_starpu_get_job_associated_to_task(tasks[n]), node->ndeps, deps);
+		}
+	}
+
+	starpu_iteration_push(iteration);
+	update = graph->updates;
+	for (n = 0; n < graph->nnodes; n++)
+	{
+		int err;
+		for ( ; update != updates_end && update->node == n; update++)
+			_starpu_task_graph_update_handle(update);
+		err = starpu_task_submit(tasks[n]);
+		/* The tasks were checked above to be executable, so they do
+		 * get submitted, and an error can only come from pushing them
+		 * to the scheduler, as with starpu_task_submit_array(). The
+		 * tasks which depend on them still have to be submitted. */
+		if (err && !ret)
+			ret = err;
+	}
+	starpu_iteration_pop();
+
+	free(tasks);
+	return ret;
+}
+
+void starpu_task_graph_destroy(starpu_task_graph_t graph)
+{
+	unsigned n;
+	for (n = 0; n < graph->nnodes; n++)
+		_starpu_task_graph_node_clean(&graph->nodes[n]);
+	free(graph->nodes);
+	free(graph->updates);
+	free(graph);
+}
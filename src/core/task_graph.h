@@ -0,0 +1,47 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#ifndef __CORE_TASK_GRAPH_H__
+#define __CORE_TASK_GRAPH_H__
+
+/** @file */
+
+#include <starpu.h>
+#include <core/jobs.h>
+
+#pragma GCC visibility push(hidden)
+
+/** The graph being captured, if any */
+extern struct _starpu_task_graph *_starpu_task_graph_capturing;
+
+/** Record \p task in the graph being captured, if it is submitted by the
+ * capturing thread within the captured iteration */
+void _starpu_task_graph_capture_task(struct starpu_task *task);
+
+/** The submission of \p task failed, drop it from the graph being captured */
+void _starpu_task_graph_capture_cancel(struct starpu_task *task);
+
+/** Explicit dependencies can not be captured, make the capture fail if they
+ * are being declared within the captured iteration */
+void _starpu_task_graph_capture_deps(struct starpu_task *task);
+
+/** Notify the capture that an iteration level is pushed or popped */
+void _starpu_task_graph_capture_iteration_push(unsigned level);
+void _starpu_task_graph_capture_iteration_pop(unsigned level);
+
+#pragma GCC visibility pop
+
+#endif /* __CORE_TASK_GRAPH_H__ */
@@ -0,0 +1,296 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+/*
+ * Recycling pool of task/job blocks.
+ *
+ * Each thread owns a cache of free blocks. Allocation only touches the cache
+ * of the current thread. A block released by its owner thread goes back to
+ * the owner local list, a block released by another thread (typically a task
+ * submitted by the application thread and destroyed by a worker) is pushed
+ * with a compare-and-swap on the remote list of its owner cache. The owner
+ * grabs the whole remote list at once when its local list is empty, so the
+ * remote list is only ever pushed to concurrently, and never popped
+ * concurrently, which avoids ABA issues.
+ */
+
+#include <starpu.h>
+#include <common/config.h>
+#include <common/utils.h>
+#include <core/task.h>
+#include <core/task_pool.h>
+
+struct _starpu_task_cache
+{
+	/* Only accessed by the owner thread */
+	struct _starpu_task_block *local;
+	unsigned nlocal;
+
+	/* Pushed to by other threads, grabbed by the owner thread */
+	struct _starpu_task_block *remote;
+
+	/* Statistics, only updated by the owner thread */
+	unsigned long nallocated;
+	unsigned long nreused;
+	unsigned long nremote_freed;
+	unsigned long nreleased;
+
+	/* The owner thread has exited, another thread can adopt the cache */
+	unsigned orphan;
+
+	struct _starpu_task_cache *next;
+};
+
+/* Maximum number of free blocks kept by each thread */
+static unsigned task_pool_size;
+static unsigned task_pool_enabled;
+static unsigned task_pool_generation;
+static starpu_pthread_key_t task_pool_key;
+
+/* Protects the list of caches */
+static starpu_pthread_mutex_t task_pool_mutex = STARPU_PTHREAD_MUTEX_INITIALIZER;
+static struct _starpu_task_cache *task_pool_caches;
+
+/* Statistics of the caches freed by _starpu_task_pool_deinit */
+static struct starpu_task_pool_stats task_pool_stats;
+
+static void _starpu_task_pool_orphan_cache(void *arg)
+{
+	struct _starpu_task_cache *cache = arg;
+	STARPU_PTHREAD_MUTEX_LOCK(&task_pool_mutex);
+	cache->orphan = 1;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&task_pool_mutex);
+}
+
+void _starpu_task_pool_init(void)
+{
+	task_pool_size = starpu_getenv_number_default("STARPU_TASK_POOL_SIZE", STARPU_RUNNING_ON_VALGRIND ? 0 : 1024);
+	memset(&task_pool_stats, 0, sizeof(task_pool_stats));
+	if (!task_pool_size)
+		return;
+	STARPU_PTHREAD_KEY_CREATE(&task_pool_key, _starpu_task_pool_orphan_cache);
+	task_pool_generation++;
+	task_pool_enabled = 1;
+}
+
+static void _starpu_task_pool_free_list(struct _starpu_task_block *block)
+{
+	while (block)
+	{
+		struct _starpu_task_block *next = block->next;
+		free(block);
+		block = next;
+	}
+}
+
+static void _starpu_task_pool_account(struct starpu_task_pool_stats *stats, struct _starpu_task_cache *cache)
+{
+	stats->allocated += cache->nallocated;
+	stats->reused += cache->nreused;
+	stats->remote_freed += cache->nremote_freed;
+	stats->released += cache->nreleased;
+}
+
+void _starpu_task_pool_deinit(void)
+{
+	if (!task_pool_enabled)
+		return;
+
+	/* Blocks still in use will be freed directly when released */
+	task_pool_enabled = 0;
+	STARPU_PTHREAD_KEY_DELETE(task_pool_key);
+
+	STARPU_PTHREAD_MUTEX_LOCK(&task_pool_mutex);
+	while (task_pool_caches)
+	{
+		struct _starpu_task_cache *cache = task_pool_caches;
+		task_pool_caches = cache->next;
+
+		_starpu_task_pool_account(&task_pool_stats, cache);
+		_starpu_task_pool_free_list(cache->local);
+		_starpu_task_pool_free_list(cache->remote);
+		free(cache);
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&task_pool_mutex);
+}
+
+static struct _starpu_task_cache *_starpu_task_pool_get_cache(void)
+{
+	struct _starpu_task_cache *cache = STARPU_PTHREAD_GETSPECIFIC(task_pool_key);
+	if (STARPU_LIKELY(cache != NULL))
+		return cache;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&task_pool_mutex);
+	for (cache = task_pool_caches; cache; cache = cache->next)
+		if (cache->orphan)
+			break;
+	if (cache)
+		cache->orphan = 0;
+	else
+	{
+		_STARPU_CALLOC(cache, 1, sizeof(*cache));
+		cache->next = task_pool_caches;
+		task_pool_caches = cache;
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&task_pool_mutex);
+
+	STARPU_PTHREAD_SETSPECIFIC(task_pool_key, cache);
+	return cache;
+}
+
+static struct _starpu_task_block *_starpu_task_pool_get_block(void)
+{
+	struct _starpu_task_cache *cache = _starpu_task_pool_get_cache();
+	struct _starpu_task_block *block = cache->local;
+
+	if (!block && cache->remote)
+	{
+		/* Grab all the blocks given back by other threads */
+		struct _starpu_task_block *remote;
+		do
+			remote = cache->remote;
+		while (!STARPU_BOOL_COMPARE_AND_SWAP_PTR(&cache->remote, remote, NULL));
+
+		STARPU_ASSERT(cache->nlocal == 0);
+		struct _starpu_task_block **link = &remote;
+		while (*link && cache->nlocal < task_pool_size)
+		{
+			cache->nlocal++;
+			link = &(*link)->next;
+		}
+
+		/* Give the excess back to the system */
+		block = *link;
+		*link = NULL;
+		while (block)
+		{
+			struct _starpu_task_block *next = block->next;
+			free(block);
+			cache->nreleased++;
+			block = next;
+		}
+		cache->local = block = remote;
+	}
+
+	if (block)
+	{
+		cache->local = block->next;
+		cache->nlocal--;
+		cache->nreused++;
+		return block;
+	}
+
+	_STARPU_MALLOC(block, sizeof(*block));
+	block->cache = cache;
+	block->generation = task_pool_generation;
+	cache->nallocated++;
+	return block;
+}
+
+static void _starpu_task_pool_put_block(struct _starpu_task_block *block)
+{
+	if (!task_pool_enabled || block->generation != task_pool_generation)
+	{
+		/* The pool this comes from is gone */
+		free(block);
+		return;
+	}
+
+	struct _starpu_task_cache *cache = _starpu_task_pool_get_cache();
+	struct _starpu_task_cache *owner = block->cache;
+
+	if (owner == cache)
+	{
+		if (cache->nlocal >= task_pool_size)
+		{
+			free(block);
+			cache->nreleased++;
+			return;
+		}
+		block->next = cache->local;
+		cache->local = block;
+		cache->nlocal++;
+	}
+	else
+	{
+		struct _starpu_task_block *head;
+		do
+		{
+			head = owner->remote;
+			block->next = head;
+		}
+		while (!STARPU_BOOL_COMPARE_AND_SWAP_PTR(&owner->remote, head, block));
+		cache->nremote_freed++;
+	}
+}
+
+struct starpu_task *_starpu_task_pool_get_task(void)
+{
+	if (!task_pool_enabled)
+		return NULL;
+	return &_starpu_task_pool_get_block()->task;
+}
+
+void _starpu_task_pool_put_task(struct starpu_task *task)
+{
+	_starpu_task_pool_put_block((struct _starpu_task_block *) task);
+}
+
+struct _starpu_job *_starpu_task_pool_get_job(struct starpu_task *task)
+{
+	struct _starpu_job *j;
+
+	if (task->pooled)
+	{
+		/* The task already has room for its job */
+		j = &((struct _starpu_task_block *) task)->job;
+		memset(j, 0, sizeof(*j));
+		j->pool = _STARPU_JOB_POOL_EMBEDDED;
+		return j;
+	}
+
+	if (!task_pool_enabled)
+		return NULL;
+
+	j = &_starpu_task_pool_get_block()->job;
+	memset(j, 0, sizeof(*j));
+	j->pool = _STARPU_JOB_POOL_BLOCK;
+	return j;
+}
+
+void _starpu_task_pool_put_job(struct _starpu_job *j)
+{
+	if (j->pool == _STARPU_JOB_POOL_EMBEDDED)
+		/* Will be released along its task */
+		return;
+
+	STARPU_ASSERT(j->pool == _STARPU_JOB_POOL_BLOCK);
+	_starpu_task_pool_put_block((struct _starpu_task_block *) ((char *) j - offsetof(struct _starpu_task_block, job)));
+}
+
+void starpu_task_pool_get_stats(struct starpu_task_pool_stats *stats)
+{
+	struct _starpu_task_cache *cache;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&task_pool_mutex);
+	*stats = task_pool_stats;
+	for (cache = task_pool_caches; cache; cache = cache->next)
+	{
+		_starpu_task_pool_account(stats, cache);
+		stats->cached += cache->nlocal;
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&task_pool_mutex);
+}
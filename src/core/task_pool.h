@@ -0,0 +1,70 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#ifndef __CORE_TASK_POOL_H__
+#define __CORE_TASK_POOL_H__
+
+/** @file */
+
+#include <starpu.h>
+#include <core/jobs.h>
+
+#pragma GCC visibility push(hidden)
+
+struct _starpu_task_cache;
+
+/** A task and its job are co-allocated in a single block, so that
+ * dynamically-created tasks cost only one allocation. Jobs of statically
+ * allocated tasks also use a block, with the task part left unused. */
+struct _starpu_task_block
+{
+	/** Must stay first, so that free(task) releases the whole block */
+	struct starpu_task task;
+	struct _starpu_job job;
+
+	/** Cache of the thread which allocated the block, to which it is
+	 * returned when it is released */
+	struct _starpu_task_cache *cache;
+	/** Pool generation at allocation time, to detect blocks which outlive
+	 * a starpu_shutdown() */
+	unsigned generation;
+	struct _starpu_task_block *next;
+};
+
+/** Values for _starpu_job::pool */
+#define _STARPU_JOB_POOL_NONE		0 /**< allocated with malloc */
+#define _STARPU_JOB_POOL_BLOCK		1 /**< owns its block */
+#define _STARPU_JOB_POOL_EMBEDDED	2 /**< lives in the block of its task */
+
+void _starpu_task_pool_init(void);
+void _starpu_task_pool_deinit(void);
+
+/** Return a task taken from the pool of the current thread, or NULL if the
+ * pool is disabled */
+struct starpu_task *_starpu_task_pool_get_task(void);
+/** Give back a task obtained with _starpu_task_pool_get_task */
+void _starpu_task_pool_put_task(struct starpu_task *task);
+
+/** Return a zeroed job for \p task, either embedded in the block of \p task,
+ * or taken from the pool of the current thread. Return NULL if the pool is
+ * disabled */
+struct _starpu_job *_starpu_task_pool_get_job(struct starpu_task *task);
+/** Give back a job obtained with _starpu_task_pool_get_job */
+void _starpu_task_pool_put_job(struct _starpu_job *j);
+
+#pragma GCC visibility pop
+
+#endif /* __CORE_TASK_POOL_H__ */
@@ -218,6 +218,46 @@ static int _starpu_get_logical_close_numa_node_worker(unsigned workerid)
 	}
 }
 
+void _starpu_get_worker_locality(unsigned workerid, int *numa, int *cluster)
+{
+#if defined(STARPU_HAVE_HWLOC)
+	struct _starpu_worker *worker = _starpu_get_worker_struct(workerid);
+	struct _starpu_machine_config *config = (struct _starpu_machine_config *)_starpu_get_machine_config();
+	struct _starpu_machine_topology *topology = &config->topology;
+
+	hwloc_obj_t obj = NULL;
+	if (starpu_driver_info[worker->arch].get_hwloc_obj)
+		obj = starpu_driver_info[worker->arch].get_hwloc_obj(topology->hwtopology, worker->devid);
+	if (!obj && worker->bindid >= 0)
+		obj = hwloc_get_obj_by_type(topology->hwtopology, HWLOC_OBJ_PU, worker->bindid);
+
+	if (obj)
+	{
+		hwloc_obj_t numa_obj = _starpu_numa_get_obj(obj);
+		hwloc_obj_t cluster_obj;
+
+		*numa = numa_obj ? (int) numa_obj->logical_index : 0;
+
+		/* Cores sharing the last level cache, or else the package */
+#if HWLOC_API_VERSION >= 0x00020000
+		cluster_obj = hwloc_get_ancestor_obj_by_type(topology->hwtopology, HWLOC_OBJ_L3CACHE, obj);
+#else
+		for (cluster_obj = obj->parent; cluster_obj; cluster_obj = cluster_obj->parent)
+			if (cluster_obj->type == HWLOC_OBJ_CACHE && cluster_obj->attr->cache.depth == 3)
+				break;
+#endif
+		if (!cluster_obj)
+			cluster_obj = hwloc_get_ancestor_obj_by_type(topology->hwtopology, HWLOC_OBJ_SOCKET, obj);
+		*cluster = cluster_obj ? (int) cluster_obj->logical_index : 0;
+		return;
+	}
+#else
+	(void) workerid;
+#endif
+	*numa = 0;
+	*cluster = 0;
+}
+
 //TODO change this in an array
 int starpu_memory_nodes_numa_hwloclogid_to_id(int logid)
 {
@@ -139,6 +139,11 @@ int starpu_memory_nodes_numa_hwloclogid_to_id(int logid);
 /* This returns the exact NUMA node next to a worker */
 int _starpu_get_logical_numa_node_worker(unsigned workerid);
 
+/** Get the hwloc logical indexes of the NUMA node and of the core cluster
+ * (last level cache, or else package) of a worker, to group workers by
+ * locality. They are 0 when the topology is not known. */
+void _starpu_get_worker_locality(unsigned workerid, int *numa, int *cluster);
+
 /** returns the number of hyperthreads per core */
 unsigned _starpu_get_nhyperthreads() STARPU_ATTRIBUTE_VISIBILITY_DEFAULT;
 
@@ -39,6 +39,8 @@
 #include <profiling/callbacks.h>
 #include <drivers/max/driver_max_fpga.h>
 #include <profiling/bound.h>
+#include <profiling/online_bound.h>
+#include <common/perf_counter_export.h>
 #include <sched_policies/sched_component.h>
 #include <datawizard/memory_nodes.h>
 #include <common/knobs.h>
@@ -1819,6 +1821,7 @@ int starpu_initialize(struct starpu_conf *user_conf, int *argc, char ***argv)
 	_starpu_sched_init();
 	_starpu_job_init();
 	_starpu_graph_init();
+	_starpu_online_bound_init();
 
 	_starpu_init_all_sched_ctxs(&_starpu_config);
 	_starpu_init_progression_hooks();
@@ -1835,6 +1838,8 @@ int starpu_initialize(struct starpu_conf *user_conf, int *argc, char ***argv)
 	_starpu_open_debug_logfile();
 
 	_starpu_data_interface_init();
+	_starpu_implicit_data_deps_init();
+	_starpu_data_reduction_init();
 
 	_starpu_timing_init();
 
@@ -1929,6 +1934,7 @@ int starpu_initialize(struct starpu_conf *user_conf, int *argc, char ***argv)
 	}
 
 	_starpu_watchdog_init();
+	_starpu_perf_counter_export_init();
 
 	_starpu_profiling_start();
 
@@ -2206,6 +2212,7 @@ void starpu_shutdown(void)
 	_starpu_deinitialize_registered_performance_models();
 
 	_starpu_watchdog_shutdown();
+	_starpu_perf_counter_export_shutdown();
 
 	/* wait for their termination */
 	_starpu_terminate_workers(&_starpu_config);
@@ -2243,6 +2250,8 @@ void starpu_shutdown(void)
 	_starpu_data_interface_shutdown();
 
 	_starpu_job_fini();
+	_starpu_graph_deinit();
+	_starpu_online_bound_shutdown();
 
 	/* Drop all remaining tags */
 	starpu_tag_clear();
@@ -2259,6 +2268,7 @@ void starpu_shutdown(void)
 	STARPU_PTHREAD_KEY_DELETE(_starpu_worker_set_key);
 
 	_starpu_task_deinit();
+	_starpu_sched_deinit();
 
 	STARPU_PTHREAD_MUTEX_LOCK(&init_mutex);
 	initialized = UNINITIALIZED;
@@ -70,6 +70,8 @@
 #define STARPU_MAX_PIPELINE 4
 
 struct mc_cache_entry;
+struct mc_cache_class;
+struct _starpu_chunk_slot;
 struct _starpu_node
 {
 	/*
@@ -93,8 +95,15 @@ struct _starpu_node
 	unsigned mc_nb, mc_clean_nb;
 
 	struct mc_cache_entry *mc_cache;
+	/** The entries of mc_cache, indexed by interface and size class, to
+	 * look for slightly bigger chunks */
+	struct mc_cache_class *mc_cache_classes;
 	int mc_cache_nb;
 	starpu_ssize_t mc_cache_size;
+	/** Allocation cache statistics, protected by mc_lock: exact hits,
+	 * size-class hits, misses, and bytes wasted by size-class hits */
+	unsigned long mc_cache_hit, mc_cache_slack_hit, mc_cache_miss;
+	size_t mc_cache_slack_bytes;
 
 	/** Whether some thread is currently tidying this node */
 	unsigned tidying;
@@ -131,8 +140,17 @@ struct _starpu_node
 	struct _starpu_chunk_list chunks;
 	/** Number of completely free chunks */
 	int nfreechunks;
-	/** This protects chunks and nfreechunks */
+	/** Size of the next chunk to be allocated */
+	size_t chunk_next_size;
+	/** Chunks indexed by address / CHUNK_SIZE, to find the chunk of a segment being freed */
+	struct _starpu_chunk_slot *chunk_slots;
+	/** Free segments, one list per size class, and bitmap of the non-empty lists */
+	struct _starpu_chunk_block_list chunk_free[CHUNK_NCLASSES];
+	unsigned long chunk_free_mask[(CHUNK_NCLASSES + 8*sizeof(unsigned long) - 1) / (8*sizeof(unsigned long))];
+	/** This protects all the fields above */
 	starpu_pthread_mutex_t chunk_mutex;
+	/** Per-worker caches of small segments, only accessed by the worker itself */
+	struct _starpu_chunk_cache *chunk_caches[STARPU_NMAXWORKERS];
 
 	/*
 	 * used by memory_manager.c
@@ -111,6 +111,11 @@ struct _starpu_data_replicate
 
 	/** Pointer to memchunk for LRU strategy */
 	struct _starpu_mem_chunk * mc;
+
+	/** How much bigger than the data allocation size the buffer is, when
+	 * the allocation cache reused a bigger buffer. Protected by the
+	 * mc_lock. */
+	size_t alloc_slack;
 };
 
 struct _starpu_data_requester_prio_list;
@@ -134,6 +139,23 @@ struct _starpu_task_wrapper_dlist
 	struct starpu_task *task;
 	struct _starpu_task_wrapper_dlist *next;
 	struct _starpu_task_wrapper_dlist *prev;
+	/** Read epoch the task was accounted in instead of being linked in the
+	 * list, see _starpu_read_epoch */
+	struct _starpu_read_epoch *epoch;
+};
+
+/** Consecutive readers of a handle are only counted in a read epoch, instead
+ * of being linked in last_submitted_accessors, so that their termination does
+ * not need to take the sequential_consistency_mutex of the handle. When an
+ * access which can not run concurrently with them gets submitted, the epoch is
+ * closed, and replaced in last_submitted_accessors by an empty task, which gets
+ * submitted by the last terminating reader. */
+struct _starpu_read_epoch
+{
+	/** Number of readers still running, plus one while the epoch is open */
+	unsigned nreaders;
+	/** Task to be submitted by the last reader, set when the epoch is closed */
+	struct starpu_task *sync_task;
 };
 
 extern int _starpu_has_not_important_data;
@@ -233,6 +255,8 @@ struct _starpu_data_state
 	unsigned is_not_important:1;
 	/** Can the data be pushed to the disk? */
 	unsigned ooc:1;
+	/** Can the data be compressed when pushed to the disk? */
+	unsigned disk_compress:1;
 	/** Does StarPU have to enforce some implicit data-dependencies ? */
 	unsigned sequential_consistency:1;
 	/** Whether we shall not ever write to this handle, thus allowing various optimizations */
@@ -283,6 +307,8 @@ struct _starpu_data_state
 	enum starpu_data_access_mode last_submitted_mode;
 	struct starpu_task *last_sync_task;
 	struct _starpu_task_wrapper_dlist last_submitted_accessors;
+	/** Open read epoch, if any */
+	struct _starpu_read_epoch *read_epoch;
 
 	/** If FxT is enabled, we keep track of "ghost dependencies": that is to
 	 * say the dependencies that are not needed anymore, but that should
@@ -419,6 +445,7 @@ struct _starpu_data_request *_starpu_create_request_to_fetch_data(starpu_data_ha
 								  void (*callback_func)(void *), void *callback_arg, int prio, const char *origin);
 
 void _starpu_init_data_replicate(starpu_data_handle_t handle, struct _starpu_data_replicate *replicate, int workerid);
+void _starpu_data_reduction_init(void);
 void _starpu_data_start_reduction_mode(starpu_data_handle_t handle);
 void _starpu_data_end_reduction_mode(starpu_data_handle_t handle, int priority);
 void _starpu_data_end_reduction_mode_terminate(starpu_data_handle_t handle);
@@ -32,6 +32,7 @@
 #include <datawizard/copy_driver.h>
 #include <datawizard/memalloc.h>
 #include <profiling/profiling.h>
+#include <common/knobs.h>
 
 #ifdef STARPU_SIMGRID
 #include <core/simgrid.h>
@@ -140,6 +141,30 @@ void starpu_wake_all_blocked_workers(void)
 static unsigned long communication_cnt = 0;
 #endif
 
+/* global counters */
+static int __g_total_transferred;
+
+/* global counter variables */
+starpu_perf_counter_int64_t _starpu_data__g_total_transferred__value;
+
+static void global_sample_updater(struct starpu_perf_counter_sample *sample, void *context)
+{
+	STARPU_ASSERT(context == NULL); /* no context for the global updater */
+	(void)context;
+
+	_starpu_perf_counter_sample_set_int64_value(sample, __g_total_transferred, _starpu_data__g_total_transferred__value);
+}
+
+void _starpu__copy_driver_c__register_counters(void)
+{
+	{
+		const enum starpu_perf_counter_scope scope = starpu_perf_counter_scope_global;
+		__STARPU_PERF_COUNTER_REG("starpu.data", scope, g_total_transferred, int64, "number of bytes transferred between memory nodes, globally (since StarPU initialization)");
+
+		_starpu_perf_counter_register_updater(scope, global_sample_updater);
+	}
+}
+
 int _starpu_copy_interface_any_to_any(starpu_data_handle_t handle, void *src_interface, unsigned src_node, void *dst_interface, unsigned dst_node, struct _starpu_data_request *req)
 {
 	enum starpu_node_kind src_kind = starpu_node_get_kind(src_node);
@@ -346,6 +371,11 @@ int STARPU_ATTRIBUTE_WARN_UNUSED_RESULT _starpu_driver_copy_data_1_to_1(starpu_d
 		unsigned long STARPU_ATTRIBUTE_UNUSED com_id = 0;
 		size_t size = _starpu_data_get_size(handle);
 		_starpu_bus_update_profiling_info((int)src_node, (int)dst_node, size);
+		if (!_starpu_perf_counter_paused())
+		{
+			(void) STARPU_PERF_COUNTER_ADD64(&_starpu_data__g_total_transferred__value, size);
+			_starpu_perf_counter_update_global_sample();
+		}
 
 #ifdef STARPU_USE_FXT
 		if (fut_active)
@@ -52,7 +52,9 @@ LIST_TYPE(_starpu_disk_backend_event,
 struct _starpu_disk_event
 {
 	unsigned memory_node;
-	unsigned node;
+	unsigned node:31;
+	/** Whether ptr holds compressed data which needs to be decompressed before unpacking */
+	unsigned compressed:1;
 	struct _starpu_disk_backend_event_list requests;
 
 	void * ptr;
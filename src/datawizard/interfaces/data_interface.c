@@ -157,6 +157,7 @@ static void _starpu_register_new_data(starpu_data_handle_t handle, int home_node
 	handle->initialized = home_node != -1;
 	//handle->readonly = 0;
 	handle->ooc = 1;
+	handle->disk_compress = 1;
 
 	/* By default, there are no methods available to perform a reduction */
 	//handle->redux_cl = NULL;
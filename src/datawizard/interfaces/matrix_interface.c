@@ -517,6 +517,8 @@ static void reuse_matrix_buffer_on_node(void *dst_data_interface, const void *ca
 	dst_matrix_interface->ptr = cached_matrix_interface->ptr;
 	dst_matrix_interface->dev_handle = cached_matrix_interface->dev_handle;
 	dst_matrix_interface->offset = 0;
+	/* The cached buffer may be bigger than needed */
+	dst_matrix_interface->allocsize = cached_matrix_interface->allocsize;
 	dst_matrix_interface->ld = dst_matrix_interface->nx; // by default
      // TODO: when node is RAM, tell valgrind that it's fresh
 }
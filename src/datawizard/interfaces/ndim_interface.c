@@ -595,6 +595,8 @@ static void reuse_ndim_buffer_on_node(void *dst_data_interface, const void *cach
 	dst_ndarr->ptr = cached_ndarr->ptr;
 	dst_ndarr->dev_handle = cached_ndarr->dev_handle;
 	dst_ndarr->offset = 0;
+	/* The cached buffer may be bigger than needed */
+	dst_ndarr->allocsize = cached_ndarr->allocsize;
 
 	set_trivial_ndim_ld(dst_ndarr);
 }
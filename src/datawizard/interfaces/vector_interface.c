@@ -367,6 +367,8 @@ static void reuse_vector_buffer_on_node(void *data_interface, const void *new_da
 	vector_interface->ptr = new_vector_interface->ptr;
 	vector_interface->dev_handle = new_vector_interface->dev_handle;
 	vector_interface->offset = 0;
+	/* The cached buffer may be bigger than needed */
+	vector_interface->allocsize = new_vector_interface->allocsize;
 }
 
 static int map_vector(void *src_interface, unsigned src_node,
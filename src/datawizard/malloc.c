@@ -29,6 +29,7 @@
 #include <datawizard/malloc.h>
 #include <core/simgrid.h>
 #include <core/task.h>
+#include <common/uthash.h>
 
 #ifdef STARPU_SIMGRID
 #include <sys/mman.h>
@@ -63,7 +64,6 @@ static int enable_suballocator;
 static int bogusfile = -1;
 static unsigned long _starpu_malloc_simulation_fold;
 /* Table to control unique simulation mallocs */
-#include <common/uthash.h>
 struct unique_shared_alloc
 {
         size_t id;
@@ -856,8 +856,15 @@ void
 _starpu_malloc_init(unsigned dst_node)
 {
 	struct _starpu_node *node_struct = _starpu_get_node_struct(dst_node);
+	int i;
 	_starpu_chunk_list_init(&node_struct->chunks);
 	node_struct->nfreechunks = 0;
+	node_struct->chunk_next_size = CHUNK_SIZE;
+	node_struct->chunk_slots = NULL;
+	for (i = 0; i < CHUNK_NCLASSES; i++)
+		_starpu_chunk_block_list_init(&node_struct->chunk_free[i]);
+	memset(node_struct->chunk_free_mask, 0, sizeof(node_struct->chunk_free_mask));
+	memset(node_struct->chunk_caches, 0, sizeof(node_struct->chunk_caches));
 	STARPU_PTHREAD_MUTEX_INIT(&node_struct->chunk_mutex, NULL);
 	disable_pinning = starpu_getenv_number("STARPU_DISABLE_PINNING");
 	enable_suballocator = starpu_getenv_number_default("STARPU_SUBALLOCATOR", 1);
@@ -868,52 +875,400 @@ _starpu_malloc_init(unsigned dst_node)
 #endif
 }
 
-void
-_starpu_malloc_shutdown(unsigned dst_node)
+#define CHUNK_MASK_BITS (8*sizeof(unsigned long))
+#define CHUNK_MASK_WORDS ((CHUNK_NCLASSES + CHUNK_MASK_BITS - 1) / CHUNK_MASK_BITS)
+
+/* A CHUNK_SIZE-aligned slice of the address space, and the (at most two,
+ * since they are at least CHUNK_SIZE big) chunks which overlap it */
+struct _starpu_chunk_slot
 {
-	struct _starpu_node *node_struct = _starpu_get_node_struct(dst_node);
-	struct _starpu_chunk *chunk, *next_chunk;
+	UT_hash_handle hh;
+	uintptr_t slot;
+	struct _starpu_chunk *chunks[2];
+};
 
-	STARPU_PTHREAD_MUTEX_LOCK(&node_struct->chunk_mutex);
-	for (chunk = _starpu_chunk_list_begin(&node_struct->chunks);
-	     chunk != _starpu_chunk_list_end(&node_struct->chunks);
-	     chunk = next_chunk)
+static int _starpu_chunk_class(int nblocks)
+{
+	return nblocks < CHUNK_NCLASSES ? nblocks - 1 : CHUNK_NCLASSES - 1;
+}
+
+/* Queue the free segment starting at block */
+static void _starpu_chunk_insert_free(struct _starpu_node *node_struct, struct _starpu_chunk *chunk, int block, int nblocks)
+{
+	struct _starpu_chunk_block *first = &chunk->blocks[block];
+	struct _starpu_chunk_block *last = &chunk->blocks[block + nblocks - 1];
+	int class = _starpu_chunk_class(nblocks);
+
+	first->length = last->length = nblocks;
+	first->free = last->free = 1;
+	first->chunk = chunk;
+	_starpu_chunk_block_list_push_front(&node_struct->chunk_free[class], first);
+	node_struct->chunk_free_mask[class / CHUNK_MASK_BITS] |= 1UL << (class % CHUNK_MASK_BITS);
+}
+
+/* Dequeue the free segment starting with this block */
+static void _starpu_chunk_remove_free(struct _starpu_node *node_struct, struct _starpu_chunk_block *first)
+{
+	int class = _starpu_chunk_class(first->length);
+
+	_starpu_chunk_block_list_erase(&node_struct->chunk_free[class], first);
+	if (_starpu_chunk_block_list_empty(&node_struct->chunk_free[class]))
+		node_struct->chunk_free_mask[class / CHUNK_MASK_BITS] &= ~(1UL << (class % CHUNK_MASK_BITS));
+}
+
+/* Return the first non-empty size class which is at least class, or -1 */
+static int _starpu_chunk_next_class(struct _starpu_node *node_struct, int class)
+{
+	unsigned word = class / CHUNK_MASK_BITS;
+	unsigned long mask = node_struct->chunk_free_mask[word] & (~0UL << (class % CHUNK_MASK_BITS));
+
+	while (!mask)
 	{
-		next_chunk = _starpu_chunk_list_next(chunk);
-		_starpu_free_on_node_flags(dst_node, chunk->base, CHUNK_SIZE, node_struct->malloc_on_node_default_flags);
-		_starpu_chunk_list_erase(&node_struct->chunks, chunk);
-		free(chunk);
+		if (++word == CHUNK_MASK_WORDS)
+			return -1;
+		mask = node_struct->chunk_free_mask[word];
 	}
-	STARPU_PTHREAD_MUTEX_UNLOCK(&node_struct->chunk_mutex);
-	STARPU_PTHREAD_MUTEX_DESTROY(&node_struct->chunk_mutex);
+#ifdef __GNUC__
+	return word * CHUNK_MASK_BITS + __builtin_ctzl(mask);
+#else
+	class = word * CHUNK_MASK_BITS;
+	while (!(mask & 1))
+	{
+		mask >>= 1;
+		class++;
+	}
+	return class;
+#endif
 }
 
-/* Create a new chunk */
-static struct _starpu_chunk *_starpu_new_chunk(unsigned dst_node, int flags)
+/* Find a free segment of at least nblocks, in the smallest possible size class */
+static struct _starpu_chunk_block *_starpu_chunk_find_free(struct _starpu_node *node_struct, int nblocks)
 {
-	struct _starpu_chunk *chunk;
-	uintptr_t base = _starpu_malloc_on_node(dst_node, CHUNK_SIZE, flags);
+	int class = _starpu_chunk_next_class(node_struct, _starpu_chunk_class(nblocks));
+	struct _starpu_chunk_block *first;
+
+	if (class < 0)
+		return NULL;
+	if (class < CHUNK_NCLASSES - 1)
+		/* Any segment of this class is big enough */
+		return _starpu_chunk_block_list_front(&node_struct->chunk_free[class]);
+
+	/* The last class has segments of all big sizes */
+	for (first = _starpu_chunk_block_list_begin(&node_struct->chunk_free[class]);
+	     first != _starpu_chunk_block_list_end(&node_struct->chunk_free[class]);
+	     first = _starpu_chunk_block_list_next(first))
+		if (first->length >= nblocks)
+			return first;
+	return NULL;
+}
+
+static void _starpu_chunk_slots_add(struct _starpu_node *node_struct, struct _starpu_chunk *chunk)
+{
+	uintptr_t slot;
+	for (slot = chunk->base / CHUNK_SIZE; slot <= (chunk->base + chunk->size - 1) / CHUNK_SIZE; slot++)
+	{
+		struct _starpu_chunk_slot *entry;
+		HASH_FIND(hh, node_struct->chunk_slots, &slot, sizeof(slot), entry);
+		if (!entry)
+		{
+			_STARPU_CALLOC(entry, 1, sizeof(*entry));
+			entry->slot = slot;
+			HASH_ADD(hh, node_struct->chunk_slots, slot, sizeof(entry->slot), entry);
+		}
+		if (!entry->chunks[0])
+			entry->chunks[0] = chunk;
+		else
+		{
+			STARPU_ASSERT(!entry->chunks[1]);
+			entry->chunks[1] = chunk;
+		}
+	}
+}
+
+static void _starpu_chunk_slots_remove(struct _starpu_node *node_struct, struct _starpu_chunk *chunk)
+{
+	uintptr_t slot;
+	for (slot = chunk->base / CHUNK_SIZE; slot <= (chunk->base + chunk->size - 1) / CHUNK_SIZE; slot++)
+	{
+		struct _starpu_chunk_slot *entry;
+		HASH_FIND(hh, node_struct->chunk_slots, &slot, sizeof(slot), entry);
+		STARPU_ASSERT(entry);
+		if (entry->chunks[0] == chunk)
+		{
+			entry->chunks[0] = entry->chunks[1];
+			entry->chunks[1] = NULL;
+		}
+		else
+		{
+			STARPU_ASSERT(entry->chunks[1] == chunk);
+			entry->chunks[1] = NULL;
+		}
+		if (!entry->chunks[0])
+		{
+			HASH_DEL(node_struct->chunk_slots, entry);
+			free(entry);
+		}
+	}
+}
+
+static struct _starpu_chunk *_starpu_chunk_find(struct _starpu_node *node_struct, uintptr_t addr)
+{
+	uintptr_t slot = addr / CHUNK_SIZE;
+	struct _starpu_chunk_slot *entry;
+	unsigned i;
+
+	HASH_FIND(hh, node_struct->chunk_slots, &slot, sizeof(slot), entry);
+	if (entry)
+		for (i = 0; i < 2 && entry->chunks[i]; i++)
+		{
+			struct _starpu_chunk *chunk = entry->chunks[i];
+			if (addr >= chunk->base && addr < chunk->base + chunk->size)
+				return chunk;
+		}
+	return NULL;
+}
+
+static void _starpu_chunk_release(unsigned dst_node, struct _starpu_chunk *chunk, int flags)
+{
+	struct _starpu_node *node_struct = _starpu_get_node_struct(dst_node);
+
+	_starpu_chunk_slots_remove(node_struct, chunk);
+	_starpu_free_on_node_flags(dst_node, chunk->base, chunk->size, flags);
+	_starpu_chunk_list_erase(&node_struct->chunks, chunk);
+	free(chunk->blocks);
+	free(chunk);
+}
 
+/* Create a new chunk, big enough for nblocks */
+static struct _starpu_chunk *_starpu_new_chunk(unsigned dst_node, int nblocks, int flags)
+{
+	struct _starpu_node *node_struct = _starpu_get_node_struct(dst_node);
+	struct _starpu_chunk *chunk;
+	size_t size = node_struct->chunk_next_size;
+	size_t needed = ((nblocks * (size_t) CHUNK_ALLOC_MIN + CHUNK_SIZE - 1) / CHUNK_SIZE) * CHUNK_SIZE;
+	uintptr_t base;
+
+	if (size < needed)
+		size = needed;
+	base = _starpu_malloc_on_node(dst_node, size, flags);
+	if (!base && size > needed)
+	{
+		/* Not so much memory left, stop growing chunks */
+		size = needed;
+		base = _starpu_malloc_on_node(dst_node, size, flags);
+		node_struct->chunk_next_size = size;
+	}
 	if (!base)
 		return NULL;
 
+	if (size >= node_struct->chunk_next_size)
+	{
+		node_struct->chunk_next_size = 2 * size;
+		if (node_struct->chunk_next_size > CHUNK_MAX_SIZE)
+			node_struct->chunk_next_size = CHUNK_MAX_SIZE;
+	}
+
 	/* Create a new chunk */
 	chunk = _starpu_chunk_new();
 	chunk->base = base;
+	chunk->size = size;
+	chunk->nblocks = size / CHUNK_ALLOC_MIN;
+	chunk->available = chunk->nblocks;
+	_STARPU_CALLOC(chunk->blocks, chunk->nblocks, sizeof(chunk->blocks[0]));
 
-	/* First block is just a fake block pointing to the free segments list */
-	chunk->bitmap[0].length = 0;
-	chunk->bitmap[0].next = 1;
+	_starpu_chunk_list_push_back(&node_struct->chunks, chunk);
+	_starpu_chunk_slots_add(node_struct, chunk);
 
 	/* At first we have only one big segment for the whole chunk */
-	chunk->bitmap[1].length = CHUNK_NBLOCKS;
-	chunk->bitmap[1].next = -1;
-
-	chunk->available_max = CHUNK_NBLOCKS;
-	chunk->available = CHUNK_NBLOCKS;
+	_starpu_chunk_insert_free(node_struct, chunk, 0, chunk->nblocks);
+	node_struct->nfreechunks++;
 	return chunk;
 }
 
+/* Allocate a segment of nblocks, with chunk_mutex held */
+static uintptr_t _starpu_chunk_alloc_locked(unsigned dst_node, int nblocks)
+{
+	struct _starpu_node *node_struct = _starpu_get_node_struct(dst_node);
+	struct _starpu_chunk_block *first = _starpu_chunk_find_free(node_struct, nblocks);
+	struct _starpu_chunk *chunk;
+	int block, length;
+
+	if (!first)
+		return 0;
+
+	chunk = first->chunk;
+	block = first - chunk->blocks;
+	length = first->length;
+	STARPU_ASSERT(length >= nblocks);
+
+	_starpu_chunk_remove_free(node_struct, first);
+	if (chunk->available == chunk->nblocks)
+		/* This one was empty, it's not empty any more */
+		node_struct->nfreechunks--;
+	chunk->available -= nblocks;
+
+	if (length > nblocks)
+		/* Still some room */
+		_starpu_chunk_insert_free(node_struct, chunk, block + nblocks, length - nblocks);
+
+	chunk->blocks[block].length = chunk->blocks[block + nblocks - 1].length = nblocks;
+	chunk->blocks[block].free = chunk->blocks[block + nblocks - 1].free = 0;
+
+	return chunk->base + block * CHUNK_ALLOC_MIN;
+}
+
+/* Free a segment of nblocks, with chunk_mutex held */
+static void _starpu_chunk_free_locked(unsigned dst_node, uintptr_t addr, size_t size, int flags)
+{
+	struct _starpu_node *node_struct = _starpu_get_node_struct(dst_node);
+	struct _starpu_chunk *chunk = _starpu_chunk_find(node_struct, addr);
+	int nblocks = (size + CHUNK_ALLOC_MIN - 1) / CHUNK_ALLOC_MIN;
+	int block;
+
+	if (!nblocks)
+		nblocks = 1;
+
+	STARPU_ASSERT_MSG(chunk, "It seems data 0x%lx (size %u) on node %u was not allocated with starpu_malloc_on_node\n", (unsigned long) addr, (unsigned) size, dst_node);
+	block = (addr - chunk->base) / CHUNK_ALLOC_MIN;
+	STARPU_ASSERT_MSG(!chunk->blocks[block].free, "It seems data 0x%lx (size %u) on node %u is being freed a second time\n", (unsigned long) addr, (unsigned) size, dst_node);
+	STARPU_ASSERT_MSG(chunk->blocks[block].length == nblocks, "It seems data 0x%lx on node %u is being freed with size %u while it was allocated with size %u\n", (unsigned long) addr, dst_node, (unsigned) size, (unsigned) (chunk->blocks[block].length * CHUNK_ALLOC_MIN));
+
+	chunk->available += nblocks;
+
+	if (block > 0 && chunk->blocks[block - 1].free)
+	{
+		/* This freed segment is just after a free segment, merge them */
+		int prevblock = block - chunk->blocks[block - 1].length;
+		_starpu_chunk_remove_free(node_struct, &chunk->blocks[prevblock]);
+		nblocks += block - prevblock;
+		block = prevblock;
+	}
+
+	if (block + nblocks < chunk->nblocks && chunk->blocks[block + nblocks].free)
+	{
+		/* This freed segment is just before a free segment, merge them */
+		struct _starpu_chunk_block *next = &chunk->blocks[block + nblocks];
+		_starpu_chunk_remove_free(node_struct, next);
+		nblocks += next->length;
+	}
+
+	if (chunk->available == chunk->nblocks)
+	{
+		/* This chunk is now empty, but avoid chunk free/alloc
+		 * ping-pong by keeping some of these.  */
+		if (node_struct->nfreechunks >= CHUNKS_NFREE &&
+		     starpu_node_get_kind(dst_node) != STARPU_MAX_FPGA_RAM)
+		{
+			/* We already have free chunks, release this one */
+			_starpu_chunk_release(dst_node, chunk, flags);
+			return;
+		}
+		node_struct->nfreechunks++;
+	}
+
+	_starpu_chunk_insert_free(node_struct, chunk, block, nblocks);
+}
+
+/* Give the segments cached by a worker back to the chunks, with chunk_mutex held */
+static void _starpu_chunk_cache_flush_locked(unsigned dst_node, struct _starpu_chunk_cache *cache, int flags)
+{
+	int class;
+	_starpu_spin_lock(&cache->lock);
+	for (class = 0; class < CHUNK_CACHE_NCLASSES; class++)
+		while (cache->n[class])
+			_starpu_chunk_free_locked(dst_node, cache->addr[class][--cache->n[class]], (class + 1) * CHUNK_ALLOC_MIN, flags);
+	_starpu_spin_unlock(&cache->lock);
+}
+
+static void _starpu_chunk_caches_flush_locked(unsigned dst_node, int flags)
+{
+	struct _starpu_node *node_struct = _starpu_get_node_struct(dst_node);
+	unsigned workerid;
+
+	for (workerid = 0; workerid < STARPU_NMAXWORKERS; workerid++)
+	{
+		struct _starpu_chunk_cache *cache = node_struct->chunk_caches[workerid];
+		if (cache)
+			_starpu_chunk_cache_flush_locked(dst_node, cache, flags);
+	}
+}
+
+void _starpu_malloc_flush_caches(unsigned dst_node)
+{
+	struct _starpu_node *node_struct = _starpu_get_node_struct(dst_node);
+
+	STARPU_PTHREAD_MUTEX_LOCK(&node_struct->chunk_mutex);
+	_starpu_chunk_caches_flush_locked(dst_node, node_struct->malloc_on_node_default_flags);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&node_struct->chunk_mutex);
+}
+
+/* Return the cache of the current worker, if any, for allocations of nblocks */
+static struct _starpu_chunk_cache *_starpu_chunk_get_cache(struct _starpu_node *node_struct, int nblocks, int create)
+{
+	if (nblocks > CHUNK_CACHE_NCLASSES)
+		return NULL;
+
+	int workerid = starpu_worker_get_id();
+	if (workerid < 0)
+		return NULL;
+
+	struct _starpu_chunk_cache *cache = node_struct->chunk_caches[workerid];
+	if (!cache && create)
+	{
+		_STARPU_CALLOC(cache, 1, sizeof(*cache));
+		_starpu_spin_init(&cache->lock);
+		/* Other workers may be flushing the caches */
+		STARPU_PTHREAD_MUTEX_LOCK(&node_struct->chunk_mutex);
+		node_struct->chunk_caches[workerid] = cache;
+		STARPU_PTHREAD_MUTEX_UNLOCK(&node_struct->chunk_mutex);
+	}
+	return cache;
+}
+
+void
+_starpu_malloc_shutdown(unsigned dst_node)
+{
+	struct _starpu_node *node_struct = _starpu_get_node_struct(dst_node);
+	struct _starpu_chunk *chunk, *next_chunk;
+	struct _starpu_chunk_slot *entry, *tmp;
+	unsigned workerid;
+	int i;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&node_struct->chunk_mutex);
+	for (workerid = 0; workerid < STARPU_NMAXWORKERS; workerid++)
+	{
+		struct _starpu_chunk_cache *cache = node_struct->chunk_caches[workerid];
+		if (cache)
+		{
+			_starpu_chunk_cache_flush_locked(dst_node, cache, node_struct->malloc_on_node_default_flags);
+			_starpu_spin_destroy(&cache->lock);
+			free(cache);
+			node_struct->chunk_caches[workerid] = NULL;
+		}
+	}
+	for (chunk = _starpu_chunk_list_begin(&node_struct->chunks);
+	     chunk != _starpu_chunk_list_end(&node_struct->chunks);
+	     chunk = next_chunk)
+	{
+		next_chunk = _starpu_chunk_list_next(chunk);
+		_starpu_free_on_node_flags(dst_node, chunk->base, chunk->size, node_struct->malloc_on_node_default_flags);
+		_starpu_chunk_list_erase(&node_struct->chunks, chunk);
+		free(chunk->blocks);
+		free(chunk);
+	}
+	HASH_ITER(hh, node_struct->chunk_slots, entry, tmp)
+	{
+		HASH_DEL(node_struct->chunk_slots, entry);
+		free(entry);
+	}
+	for (i = 0; i < CHUNK_NCLASSES; i++)
+		_starpu_chunk_block_list_init(&node_struct->chunk_free[i]);
+	memset(node_struct->chunk_free_mask, 0, sizeof(node_struct->chunk_free_mask));
+	node_struct->nfreechunks = 0;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&node_struct->chunk_mutex);
+	STARPU_PTHREAD_MUTEX_DESTROY(&node_struct->chunk_mutex);
+}
+
 /* Return whether we should use our suballocator */
 static int _starpu_malloc_should_suballoc(unsigned dst_node, size_t size, int flags)
 {
@@ -922,7 +1277,7 @@ static int _starpu_malloc_should_suballoc(unsigned dst_node, size_t size, int fl
 		(starpu_node_get_kind(dst_node) == STARPU_CUDA_RAM
 		 || starpu_node_get_kind(dst_node) == STARPU_HIP_RAM
 		 || (starpu_node_get_kind(dst_node) == STARPU_CPU_RAM
-		     && _starpu_malloc_should_pin(flags))
+		     && (_starpu_malloc_should_pin(flags) || enable_suballocator > 1))
 		 )))
 	       || starpu_node_get_kind(dst_node) == STARPU_MAX_FPGA_RAM;
 }
@@ -935,98 +1290,54 @@ starpu_malloc_on_node_flags(unsigned dst_node, size_t size, int flags)
 		return _starpu_malloc_on_node(dst_node, size, flags);
 
 	struct _starpu_node *node_struct = _starpu_get_node_struct(dst_node);
+	struct _starpu_chunk_cache *cache;
+	uintptr_t addr;
 
 	/* Round up allocation to block size */
 	int nblocks = (size + CHUNK_ALLOC_MIN - 1) / CHUNK_ALLOC_MIN;
 	if (!nblocks)
 		nblocks = 1;
 
-	struct _starpu_chunk *chunk;
-	int prevblock, block;
-	int available_max;
-	struct block *bitmap;
-
-	STARPU_PTHREAD_MUTEX_LOCK(&node_struct->chunk_mutex);
-
-	/* Try to find a big enough segment among the chunks */
-	for (chunk = _starpu_chunk_list_begin(&node_struct->chunks);
-	     chunk != _starpu_chunk_list_end(&node_struct->chunks);
-	     chunk = _starpu_chunk_list_next(chunk))
-	{
-		if (chunk->available_max < nblocks)
-			continue;
-
-		bitmap = chunk->bitmap;
-		available_max = 0;
-		for (prevblock = block = 0;
-			block != -1;
-			prevblock = block, block = bitmap[prevblock].next)
-		{
-			STARPU_ASSERT(block >= 0 && block <= CHUNK_NBLOCKS);
-			int length = bitmap[block].length;
-			if (length >= nblocks)
-			{
-
-				if (length >= 2*nblocks)
-				{
-					/* This one this has quite some room,
-					 * put it front, to make finding it
-					 * easier next time. */
-					_starpu_chunk_list_erase(&node_struct->chunks, chunk);
-					_starpu_chunk_list_push_front(&node_struct->chunks, chunk);
-				}
-				if (chunk->available == CHUNK_NBLOCKS)
-					/* This one was empty, it's not empty any more */
-					node_struct->nfreechunks--;
-				goto found;
-			}
-			if (length > available_max)
-				available_max = length;
-		}
-
-		/* Didn't find a big enough segment in this chunk, its
-		 * available_max is out of date */
-		chunk->available_max = available_max;
-	}
-
-	/* Didn't find a big enough segment, create another chunk.  */
-	chunk = _starpu_new_chunk(dst_node, flags);
-	if (!chunk)
+	/* Small allocation, try our own cache first */
+	cache = _starpu_chunk_get_cache(node_struct, nblocks, 0);
+	if (cache)
 	{
-		/* Really no memory any more, fail */
-		STARPU_PTHREAD_MUTEX_UNLOCK(&node_struct->chunk_mutex);
-		errno = ENOMEM;
-		return 0;
+		addr = 0;
+		_starpu_spin_lock(&cache->lock);
+		if (cache->n[nblocks - 1])
+			addr = cache->addr[nblocks - 1][--cache->n[nblocks - 1]];
+		_starpu_spin_unlock(&cache->lock);
+		if (addr)
+			return addr;
 	}
 
-	/* And make it easy to find. */
-	_starpu_chunk_list_push_front(&node_struct->chunks, chunk);
-	bitmap = chunk->bitmap;
-	prevblock = 0;
-	block = 1;
-
-found:
+	STARPU_PTHREAD_MUTEX_LOCK(&node_struct->chunk_mutex);
 
-	chunk->available -= nblocks;
-	STARPU_ASSERT(bitmap[block].length >= nblocks);
-	STARPU_ASSERT(block <= CHUNK_NBLOCKS);
-	if (bitmap[block].length == nblocks)
+	addr = _starpu_chunk_alloc_locked(dst_node, nblocks);
+	if (!addr)
 	{
-		/* Fits exactly, drop this segment from the skip list */
-		bitmap[prevblock].next = bitmap[block].next;
+		/* The caches of the workers may be holding what we need */
+		_starpu_chunk_caches_flush_locked(dst_node, flags);
+		addr = _starpu_chunk_alloc_locked(dst_node, nblocks);
 	}
-	else
+
+	if (!addr)
 	{
-		/* Still some room */
-		STARPU_ASSERT(block + nblocks <= CHUNK_NBLOCKS);
-		bitmap[prevblock].next = block + nblocks;
-		bitmap[block + nblocks].length = bitmap[block].length - nblocks;
-		bitmap[block + nblocks].next = bitmap[block].next;
+		/* Didn't find a big enough segment, create another chunk.  */
+		if (!_starpu_new_chunk(dst_node, nblocks, flags))
+		{
+			/* Really no memory any more, fail */
+			STARPU_PTHREAD_MUTEX_UNLOCK(&node_struct->chunk_mutex);
+			errno = ENOMEM;
+			return 0;
+		}
+		addr = _starpu_chunk_alloc_locked(dst_node, nblocks);
+		STARPU_ASSERT(addr);
 	}
 
 	STARPU_PTHREAD_MUTEX_UNLOCK(&node_struct->chunk_mutex);
 
-	return chunk->base + (block-1) * CHUNK_ALLOC_MIN;
+	return addr;
 }
 
 void
@@ -1040,90 +1351,88 @@ starpu_free_on_node_flags(unsigned dst_node, uintptr_t addr, size_t size, int fl
 	}
 
 	struct _starpu_node *node_struct = _starpu_get_node_struct(dst_node);
-	struct _starpu_chunk *chunk;
+	struct _starpu_chunk_cache *cache;
 
 	/* Round up allocation to block size */
 	int nblocks = (size + CHUNK_ALLOC_MIN - 1) / CHUNK_ALLOC_MIN;
 	if (!nblocks)
 		nblocks = 1;
 
-	STARPU_PTHREAD_MUTEX_LOCK(&node_struct->chunk_mutex);
-	for (chunk = _starpu_chunk_list_begin(&node_struct->chunks);
-	     chunk != _starpu_chunk_list_end(&node_struct->chunks);
-	     chunk = _starpu_chunk_list_next(chunk))
-		if (addr >= chunk->base && addr < chunk->base + CHUNK_SIZE)
-			break;
-	STARPU_ASSERT(chunk != _starpu_chunk_list_end(&node_struct->chunks));
-
-	struct block *bitmap = chunk->bitmap;
-	int block = ((addr - chunk->base) / CHUNK_ALLOC_MIN) + 1, prevblock, nextblock;
-
-	/* Look for free segment just before this one */
-	for (prevblock = 0;
-		prevblock != -1;
-		prevblock = nextblock)
+	/* Small allocation, keep it in our cache if there is room */
+	cache = _starpu_chunk_get_cache(node_struct, nblocks, 1);
+	if (cache)
 	{
-		STARPU_ASSERT(prevblock >= 0 && prevblock <= CHUNK_NBLOCKS);
-		nextblock = bitmap[prevblock].next;
-		STARPU_ASSERT_MSG(nextblock != block, "It seems data 0x%lx (size %u) on node %u is being freed a second time\n", (unsigned long) addr, (unsigned) size, dst_node);
-		if (nextblock > block || nextblock == -1)
-			break;
+		int cached = 0;
+		_starpu_spin_lock(&cache->lock);
+		if (cache->n[nblocks - 1] < CHUNK_CACHE_DEPTH)
+		{
+			cache->addr[nblocks - 1][cache->n[nblocks - 1]++] = addr;
+			cached = 1;
+		}
+		_starpu_spin_unlock(&cache->lock);
+		if (cached)
+			return;
 	}
-	STARPU_ASSERT(prevblock != -1);
-
-	chunk->available += nblocks;
 
-	/* Insert in free segments list */
-	bitmap[block].next = nextblock;
-	bitmap[prevblock].next = block;
-	bitmap[block].length = nblocks;
+	STARPU_PTHREAD_MUTEX_LOCK(&node_struct->chunk_mutex);
+	_starpu_chunk_free_locked(dst_node, addr, size, flags);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&node_struct->chunk_mutex);
+}
 
-	STARPU_ASSERT(nextblock >= -1 && nextblock <= CHUNK_NBLOCKS);
-	if (nextblock == block + nblocks)
-	{
-		/* This freed segment is just before a free segment, merge them */
-		bitmap[block].next = bitmap[nextblock].next;
-		bitmap[block].length += bitmap[nextblock].length;
+void _starpu_malloc_display_stats(FILE *stream, unsigned dst_node)
+{
+	struct _starpu_node *node_struct = _starpu_get_node_struct(dst_node);
+	struct _starpu_chunk *chunk;
+	struct _starpu_chunk_block *first;
+	unsigned long nchunks = 0, nfree = 0, ncached = 0;
+	size_t total = 0, available = 0, largest = 0;
+	unsigned workerid;
+	int class;
 
-		if (bitmap[block].length > chunk->available_max)
-			chunk->available_max = bitmap[block].length;
-	}
+	if (dst_node >= starpu_memory_nodes_get_count())
+		return;
 
-	if (prevblock > 0 && prevblock + bitmap[prevblock].length == block)
+	STARPU_PTHREAD_MUTEX_LOCK(&node_struct->chunk_mutex);
+	for (chunk = _starpu_chunk_list_begin(&node_struct->chunks);
+	     chunk != _starpu_chunk_list_end(&node_struct->chunks);
+	     chunk = _starpu_chunk_list_next(chunk))
 	{
-		/* This free segment is just after a free segment, merge them */
-		bitmap[prevblock].next = bitmap[block].next;
-		bitmap[prevblock].length += bitmap[block].length;
-
-		if (bitmap[prevblock].length > chunk->available_max)
-			chunk->available_max = bitmap[prevblock].length;
-
-		block = prevblock;
+		nchunks++;
+		total += chunk->size;
+		available += (size_t) chunk->available * CHUNK_ALLOC_MIN;
 	}
-
-	if (chunk->available == CHUNK_NBLOCKS)
-	{
-		/* This chunk is now empty, but avoid chunk free/alloc
-		 * ping-pong by keeping some of these.  */
-		if (node_struct->nfreechunks >= CHUNKS_NFREE &&
-		     starpu_node_get_kind(dst_node) != STARPU_MAX_FPGA_RAM)
+	for (class = 0; class < CHUNK_NCLASSES; class++)
+		for (first = _starpu_chunk_block_list_begin(&node_struct->chunk_free[class]);
+		     first != _starpu_chunk_block_list_end(&node_struct->chunk_free[class]);
+		     first = _starpu_chunk_block_list_next(first))
 		{
-			/* We already have free chunks, release this one */
-			_starpu_free_on_node_flags(dst_node, chunk->base, CHUNK_SIZE, flags);
-			_starpu_chunk_list_erase(&node_struct->chunks, chunk);
-			free(chunk);
+			nfree++;
+			if ((size_t) first->length * CHUNK_ALLOC_MIN > largest)
+				largest = (size_t) first->length * CHUNK_ALLOC_MIN;
 		}
-		else
-			node_struct->nfreechunks++;
-	}
-	else
+	for (workerid = 0; workerid < STARPU_NMAXWORKERS; workerid++)
 	{
-		/* Freed some room, put this first in chunks list */
-		_starpu_chunk_list_erase(&node_struct->chunks, chunk);
-		_starpu_chunk_list_push_front(&node_struct->chunks, chunk);
+		struct _starpu_chunk_cache *cache = node_struct->chunk_caches[workerid];
+		if (cache)
+		{
+			_starpu_spin_lock(&cache->lock);
+			for (class = 0; class < CHUNK_CACHE_NCLASSES; class++)
+				ncached += cache->n[class];
+			_starpu_spin_unlock(&cache->lock);
+		}
 	}
-
 	STARPU_PTHREAD_MUTEX_UNLOCK(&node_struct->chunk_mutex);
+
+	if (!nchunks)
+		return;
+
+	fprintf(stream, "#-------\n");
+	fprintf(stream, "Suballocator on Node #%u\n", dst_node);
+	fprintf(stream, "\tchunks: %lu, %zu MiB, %d completely free\n", nchunks, total >> 20, node_struct->nfreechunks);
+	fprintf(stream, "\tallocated: %zu MiB, of which %lu segments cached by workers\n", (total - available) >> 20, ncached);
+	fprintf(stream, "\tfree: %zu MiB in %lu segments, largest %zu KiB\n", available >> 20, nfree, largest >> 10);
+	if (available)
+		fprintf(stream, "\tfragmentation: %2.2f %%\n", 100. * (1. - (double) largest / available));
 }
 
 void starpu_malloc_on_node_set_default_flags(unsigned node, int flags)
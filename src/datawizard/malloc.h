@@ -20,6 +20,7 @@
 
 #include <common/list.h>
 #include <common/utils.h>
+#include <common/starpu_spinlock.h>
 
 #pragma GCC visibility push(hidden)
 
@@ -43,8 +44,12 @@ int _starpu_malloc_willpin_on_node(unsigned dst_node) STARPU_ATTRIBUTE_VISIBILIT
  * chunks divided in blocks, and we actually allocate segments of consecutive
  * blocks.
  *
- * We try to keep the list of chunks with increasing occupancy, so we can
- * quickly find free segments to allocate.
+ * This is a segregated-fit allocator: free segments are kept in one list per
+ * size class, so that finding a segment for an allocation does not depend on
+ * the number of chunks. Adjacent free segments are merged on free thanks to
+ * boundary tags kept for the first and last blocks of each segment. Each
+ * worker additionally keeps a few segments of the smallest classes, so that
+ * most small allocations and frees do not take the per-node mutex.
  */
 
 #ifdef STARPU_USE_MAX_FPGA
@@ -53,7 +58,7 @@ int _starpu_malloc_willpin_on_node(unsigned dst_node) STARPU_ATTRIBUTE_VISIBILIT
 #define CHUNK_ALLOC_MAX (CHUNK_SIZE / 8)
 #define CHUNK_ALLOC_MIN (128*192)
 #else
-/* Size of each chunk, 32MiB granularity brings 128 chunks to be allocated in
+/* Size of the first chunk, 32MiB granularity brings 128 chunks to be allocated in
  * order to fill a 4GiB GPU. */
 #define CHUNK_SIZE (32*1024*1024)
 
@@ -62,40 +67,73 @@ int _starpu_malloc_willpin_on_node(unsigned dst_node) STARPU_ATTRIBUTE_VISIBILIT
 
 /* Granularity of allocation, i.e. block size, StarPU will never allocate less
  * than this.
- * 16KiB (i.e. 64x64 float) granularity eats 2MiB RAM for managing a 4GiB GPU.
+ * 16KiB (i.e. 64x64 float) granularity eats 8MiB RAM for managing a 4GiB GPU.
  */
 #define CHUNK_ALLOC_MIN (16*1024)
 #endif
 
+/* Each new chunk is twice as big as the previous one, up to this size, so that
+ * filling a big GPU does not need too many chunks. */
+#define CHUNK_MAX_SIZE (8*CHUNK_SIZE)
+
 /* Don't really deallocate chunks unless we have more than this many chunks
  * which are completely free. */
 #define CHUNKS_NFREE 4
 
-/* Number of blocks */
-#define CHUNK_NBLOCKS (CHUNK_SIZE/CHUNK_ALLOC_MIN)
-
-/* Linked list for available segments */
-struct block
-{
-	int length;	/* Number of consecutive free blocks */
-	int next;	/* next free segment */
-};
+/* Number of size classes: one per number of blocks up to CHUNK_ALLOC_MAX, and
+ * a last one for all bigger free segments */
+#define CHUNK_NCLASSES (CHUNK_ALLOC_MAX/CHUNK_ALLOC_MIN + 1)
+
+/* Number of smallest size classes which are cached by each worker */
+#define CHUNK_CACHE_NCLASSES 4
+/* Number of segments that each worker keeps per cached class */
+#define CHUNK_CACHE_DEPTH 8
+
+struct _starpu_chunk;
+
+/* Boundary tag of a block. It is only meaningful for the first and last
+ * blocks of a segment. The first block of a free segment is also queued in
+ * the free list of its size class. */
+LIST_TYPE(_starpu_chunk_block,
+	/* Number of blocks of the segment */
+	int length;
+	/* Whether the segment is free */
+	int free;
+	struct _starpu_chunk *chunk;
+)
 
 /* One chunk */
 LIST_TYPE(_starpu_chunk,
 	uintptr_t base;
 
-	/* Available number of blocks, for debugging */
-	int available;
+	/* Size of the chunk in bytes, and in blocks */
+	size_t size;
+	int nblocks;
 
-	/* Overestimation of the maximum size of available segments in this chunk */
-	int available_max;
+	/* Available number of blocks */
+	int available;
 
-	/* Bitmap describing availability of the block */
-	/* Block 0 is always empty, and is just the head of the free segments list */
-	struct block bitmap[CHUNK_NBLOCKS+1];
+	/* Boundary tags of the blocks */
+	struct _starpu_chunk_block *blocks;
 )
 
+/* Segments of the smallest size classes kept by a worker for a memory node.
+ * The lock is normally only taken by the worker itself, and by the others when
+ * running out of memory. */
+struct _starpu_chunk_cache
+{
+	struct _starpu_spinlock lock;
+	unsigned n[CHUNK_CACHE_NCLASSES];
+	uintptr_t addr[CHUNK_CACHE_NCLASSES][CHUNK_CACHE_DEPTH];
+};
+
+/* Give the segments cached by all workers back to the suballocator of a node,
+ * when running out of memory */
+void _starpu_malloc_flush_caches(unsigned dst_node);
+
+/* Display the occupancy and fragmentation of the suballocator of a node */
+void _starpu_malloc_display_stats(FILE *stream, unsigned dst_node);
+
 #pragma GCC visibility pop
 
 #endif
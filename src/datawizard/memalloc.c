@@ -35,6 +35,9 @@ static unsigned minimum_clean_p;
 static unsigned target_clean_p;
 /* Whether CPU memory has been explicitly limited by user */
 static int limit_cpu_mem;
+/* Percentage of extra size that a cached chunk may have to be reused for a
+ * smaller allocation, 0 to only reuse exactly-matching chunks */
+static unsigned cache_slack_p;
 
 
 /* TODO: no home doesn't mean always clean, should push to larger memory nodes */
@@ -78,14 +81,50 @@ static int limit_cpu_mem;
 	} \
 } while (0)
 
+/* The chunks of an entry of the cache have both the same footprint and the
+ * same actual size, which may be bigger than the size corresponding to the
+ * footprint when the chunk was reused with some slack */
+struct mc_cache_entry_key
+{
+	size_t size;
+	uint32_t footprint;
+};
+
 /* Explicitly caches memory chunks that can be reused */
 struct mc_cache_entry
 {
 	UT_hash_handle hh;
 	struct _starpu_mem_chunk_list list;
-	uint32_t footprint;
+	struct mc_cache_entry_key key;
+	/** Next entry of the same size class */
+	struct mc_cache_entry *class_next;
+};
+
+/* Size class of the entries of the cache, i.e. the chunks of a given interface
+ * whose size has the same most significant bit. The chunks of all the entries
+ * of a class are thus smaller than the chunks of the entries of the next
+ * classes. */
+struct mc_cache_class_key
+{
+	enum starpu_data_interface_id interfaceid;
+	unsigned log2size;
 };
 
+struct mc_cache_class
+{
+	UT_hash_handle hh;
+	struct mc_cache_class_key key;
+	struct mc_cache_entry *entries;
+};
+
+static unsigned mc_cache_log2(size_t size)
+{
+	unsigned log2size = 0;
+	while (size >>= 1)
+		log2size++;
+	return log2size;
+}
+
 int _starpu_is_reclaiming(unsigned node)
 {
 	struct _starpu_node *node_struct = _starpu_get_node_struct(node);
@@ -171,6 +210,7 @@ void _starpu_init_mem_chunk_lists(void)
 	minimum_clean_p = starpu_getenv_number_default("STARPU_MINIMUM_CLEAN_BUFFERS", 5);
 	target_clean_p = starpu_getenv_number_default("STARPU_TARGET_CLEAN_BUFFERS", 10);
 	limit_cpu_mem = starpu_getenv_number("STARPU_LIMIT_CPU_MEM");
+	cache_slack_p = starpu_getenv_number_default("STARPU_MEMCHUNK_CACHE_SLACK", 0);
 }
 
 void _starpu_deinit_mem_chunk_lists(void)
@@ -180,6 +220,7 @@ void _starpu_deinit_mem_chunk_lists(void)
 	{
 		struct _starpu_node *node = _starpu_get_node_struct(i);
 		struct mc_cache_entry *entry=NULL, *tmp=NULL;
+		struct mc_cache_class *class=NULL, *class_tmp=NULL;
 		STARPU_ASSERT(node->mc_nb == 0);
 		STARPU_ASSERT(node->mc_clean_nb == 0);
 		STARPU_ASSERT(node->mc_dirty_head == NULL);
@@ -189,6 +230,11 @@ void _starpu_deinit_mem_chunk_lists(void)
 			HASH_DEL(node->mc_cache, entry);
 			free(entry);
 		}
+		HASH_ITER(hh, node->mc_cache_classes, class, class_tmp)
+		{
+			HASH_DEL(node->mc_cache_classes, class);
+			free(class);
+		}
 		STARPU_ASSERT(node->mc_cache_nb == 0);
 		STARPU_ASSERT(node->mc_cache_size == 0);
 		_starpu_spin_destroy(&node->mc_lock);
@@ -461,9 +507,10 @@ static size_t do_free_mem_chunk(struct _starpu_mem_chunk *mc, unsigned node)
 	if (handle)
 	{
 		_starpu_spin_checklocked(&handle->header_lock);
-		mc->size = _starpu_data_get_alloc_size(handle);
+		mc->size = _starpu_data_get_alloc_size(handle) + mc->replicate->alloc_slack;
 
 		mc->replicate->mc=NULL;
+		mc->replicate->alloc_slack = 0;
 	}
 
 	/* free the actual buffer */
@@ -500,9 +547,14 @@ static void reuse_mem_chunk(unsigned node, struct _starpu_data_replicate *new_re
 		old_replicate->automatically_allocated = 0;
 		old_replicate->initialized = 0;
 		data_interface = old_replicate->data_interface;
+		new_replicate->alloc_slack = old_replicate->alloc_slack;
+		old_replicate->alloc_slack = 0;
 	}
 	else
+	{
 		data_interface = mc->chunk_interface;
+		new_replicate->alloc_slack = 0;
+	}
 
 	STARPU_ASSERT(new_replicate->data_interface);
 	STARPU_ASSERT(data_interface);
@@ -755,9 +807,13 @@ static struct _starpu_mem_chunk *_starpu_memchunk_cache_lookup_locked(unsigned n
 {
 	/* go through all buffers in the cache */
 	struct mc_cache_entry *entry;
+	struct mc_cache_entry_key key;
 	struct _starpu_node *node_struct = _starpu_get_node_struct(node);
 
-	HASH_FIND(hh, node_struct->mc_cache, &footprint, sizeof(footprint), entry);
+	memset(&key, 0, sizeof(key));
+	key.size = _starpu_data_get_alloc_size(handle);
+	key.footprint = footprint;
+	HASH_FIND(hh, node_struct->mc_cache, &key, sizeof(key), entry);
 	if (!entry)
 		/* No data with that footprint */
 		return NULL;
@@ -786,23 +842,113 @@ static struct _starpu_mem_chunk *_starpu_memchunk_cache_lookup_locked(unsigned n
 	return NULL;
 }
 
+/* This function must be called with node->mc_lock taken.
+ *
+ * Look for the smallest cached chunk of the same interface which is at least
+ * as big as the allocation needed by handle, and at most cache_slack_p
+ * percent bigger. This requires the interface to provide reuse_data_on_node,
+ * which installs the cached buffer (and its actual allocation size) in the
+ * interface of the handle.
+ *
+ * The interface of the main RAM replicate defines the allocation size of the
+ * handle, so we can not put a bigger buffer there. */
+static struct _starpu_mem_chunk *_starpu_memchunk_cache_lookup_slack_locked(unsigned node, starpu_data_handle_t handle)
+{
+	struct _starpu_node *node_struct = _starpu_get_node_struct(node);
+	struct mc_cache_entry *entry, *best_entry = NULL;
+	struct mc_cache_class *class;
+	struct mc_cache_class_key key;
+	struct _starpu_mem_chunk *mc, *best = NULL;
+
+	if (!cache_slack_p || node == STARPU_MAIN_RAM
+		|| !handle->ops->reuse_data_on_node || handle->ops->dontcache)
+		return NULL;
+
+	size_t size = _starpu_data_get_alloc_size(handle);
+	size_t max_size = size + (size * cache_slack_p) / 100;
+	unsigned max_log2size = mc_cache_log2(max_size);
+
+	/* Only look at the size classes which may contain fitting chunks */
+	memset(&key, 0, sizeof(key));
+	key.interfaceid = handle->ops->interfaceid;
+	for (key.log2size = mc_cache_log2(size); key.log2size <= max_log2size; key.log2size++)
+	{
+		HASH_FIND(hh, node_struct->mc_cache_classes, &key, sizeof(key), class);
+		if (!class)
+			continue;
+
+		for (entry = class->entries; entry; entry = entry->class_next)
+		{
+			/* The chunks of an entry all have the size of the
+			 * entry, only consider the first one */
+			if (_starpu_mem_chunk_list_empty(&entry->list))
+				continue;
+			if (entry->key.size < size || entry->key.size > max_size)
+				continue;
+			if (best && entry->key.size >= best->size)
+				continue;
+			mc = _starpu_mem_chunk_list_front(&entry->list);
+			STARPU_ASSERT(mc->size == entry->key.size);
+			best = mc;
+			best_entry = entry;
+			if (best->size == size)
+				/* Can not find better */
+				goto found;
+		}
+		if (best)
+			/* The next classes only have bigger chunks */
+			break;
+	}
+
+found:
+
+	if (!best)
+		return NULL;
+
+	_starpu_mem_chunk_list_erase(&best_entry->list, best);
+	node_struct->mc_cache_nb--;
+	STARPU_ASSERT_MSG(node_struct->mc_cache_nb >= 0, "allocation cache for node %u has %d objects??", node, node_struct->mc_cache_nb);
+	node_struct->mc_cache_size -= best->size;
+	STARPU_ASSERT_MSG(node_struct->mc_cache_size >= 0, "allocation cache for node %u has %ld bytes??", node, (long) node_struct->mc_cache_size);
+	node_struct->mc_cache_slack_bytes += best->size - size;
+	return best;
+}
+
 /* this function looks for a memory chunk that matches a given footprint in the
  * list of mem chunk that need to be freed. */
 static int try_to_find_reusable_mc(unsigned node, starpu_data_handle_t data, struct _starpu_data_replicate *replicate, uint32_t footprint)
 {
 	struct _starpu_mem_chunk *mc;
 	int success = 0;
+	size_t slack = 0;
+	struct _starpu_node *node_struct = _starpu_get_node_struct(node);
 
-	_starpu_spin_lock(&_starpu_get_node_struct(node)->mc_lock);
+	_starpu_spin_lock(&node_struct->mc_lock);
 	/* go through all buffers in the cache */
 	mc = _starpu_memchunk_cache_lookup_locked(node, data, footprint);
+	if (mc)
+		node_struct->mc_cache_hit++;
+	else
+	{
+		/* Try a bigger chunk of the same kind */
+		mc = _starpu_memchunk_cache_lookup_slack_locked(node, data);
+		if (mc)
+		{
+			node_struct->mc_cache_slack_hit++;
+			slack = mc->size - _starpu_data_get_alloc_size(data);
+		}
+		else
+			node_struct->mc_cache_miss++;
+	}
 	if (mc)
 	{
 		/* We found an entry in the cache so we can reuse it */
 		reuse_mem_chunk(node, replicate, mc, 0);
+		/* Remember the actual size of the buffer for when we put it back in the cache */
+		replicate->alloc_slack = slack;
 		success = 1;
 	}
-	_starpu_spin_unlock(&_starpu_get_node_struct(node)->mc_lock);
+	_starpu_spin_unlock(&node_struct->mc_lock);
 	return success;
 }
 #endif
@@ -1155,6 +1301,9 @@ size_t _starpu_memory_reclaim_generic(unsigned node, unsigned force, size_t recl
 		}
 	}
 
+	/* give the small segments kept by workers back to the suballocator */
+	_starpu_malloc_flush_caches(node);
+
 	/* remove all buffers for which there was a removal request */
 	freed += flush_memchunk_cache(node, reclaim);
 
@@ -1485,10 +1634,11 @@ void _starpu_request_mem_chunk_removal(starpu_data_handle_t handle, struct _star
 	/* Record the allocated size, so that later in memory
 	 * reclaiming we can estimate how much memory we free
 	 * by freeing this.  */
-	mc->size = size;
+	mc->size = size + replicate->alloc_slack;
 
 	/* This memchunk doesn't have to do with the data any more. */
 	replicate->mc = NULL;
+	replicate->alloc_slack = 0;
 	mc->replicate = NULL;
 	replicate->allocated = 0;
 	replicate->automatically_allocated = 0;
@@ -1535,17 +1685,39 @@ void _starpu_request_mem_chunk_removal(starpu_data_handle_t handle, struct _star
 		else
 			memcpy(mc->chunk_interface, replicate->data_interface, mc->size_interface);
 
-		/* put it in the list of buffers to be removed */
-		uint32_t footprint = mc->footprint;
+		/* put it in the list of buffers to be removed, along the
+		 * chunks which have both the same footprint and the same
+		 * actual size, so that a chunk reused with some slack gets
+		 * found again by the slack lookup */
+		struct mc_cache_entry_key entry_key;
 		struct mc_cache_entry *entry;
+		memset(&entry_key, 0, sizeof(entry_key));
+		entry_key.size = mc->size;
+		entry_key.footprint = mc->footprint;
 		_starpu_spin_lock(&node_struct->mc_lock);
-		HASH_FIND(hh, node_struct->mc_cache, &footprint, sizeof(footprint), entry);
+		HASH_FIND(hh, node_struct->mc_cache, &entry_key, sizeof(entry_key), entry);
 		if (!entry)
 		{
+			struct mc_cache_class *class;
+			struct mc_cache_class_key key;
+
 			_STARPU_MALLOC(entry, sizeof(*entry));
 			_starpu_mem_chunk_list_init(&entry->list);
-			entry->footprint = footprint;
-			HASH_ADD(hh, node_struct->mc_cache, footprint, sizeof(entry->footprint), entry);
+			entry->key = entry_key;
+			HASH_ADD(hh, node_struct->mc_cache, key, sizeof(entry->key), entry);
+
+			memset(&key, 0, sizeof(key));
+			key.interfaceid = mc->ops->interfaceid;
+			key.log2size = mc_cache_log2(mc->size);
+			HASH_FIND(hh, node_struct->mc_cache_classes, &key, sizeof(key), class);
+			if (!class)
+			{
+				_STARPU_CALLOC(class, 1, sizeof(*class));
+				class->key = key;
+				HASH_ADD(hh, node_struct->mc_cache_classes, key, sizeof(class->key), class);
+			}
+			entry->class_next = class->entries;
+			class->entries = entry;
 		}
 		node_struct->mc_cache_nb++;
 		node_struct->mc_cache_size += mc->size;
@@ -1963,7 +2135,21 @@ void _starpu_memory_display_stats_by_node(FILE *stream, int node)
 
 	}
 
+	if (node_struct->mc_cache_hit + node_struct->mc_cache_slack_hit + node_struct->mc_cache_miss)
+	{
+		char name[128];
+		starpu_memory_node_get_name(node, name, sizeof(name));
+		fprintf(stream, "#-------\n");
+		fprintf(stream, "Allocation cache on Node #%d (%s)\n", node, name);
+		fprintf(stream, "\thit: %lu\n", node_struct->mc_cache_hit);
+		fprintf(stream, "\tsize-class hit: %lu (%zu bytes of slack)\n", node_struct->mc_cache_slack_hit, node_struct->mc_cache_slack_bytes);
+		fprintf(stream, "\tmiss: %lu\n", node_struct->mc_cache_miss);
+		fprintf(stream, "\tcached: %d chunks, %ld bytes\n", node_struct->mc_cache_nb, (long) node_struct->mc_cache_size);
+	}
+
 	_starpu_spin_unlock(&node_struct->mc_lock);
+
+	_starpu_malloc_display_stats(stream, node);
 }
 
 void _starpu_data_display_memory_stats(FILE *stream)
@@ -1987,6 +2173,17 @@ void starpu_data_display_memory_stats(void)
 #endif
 }
 
+unsigned long _starpu_memchunk_cache_slack_hits(unsigned node)
+{
+	struct _starpu_node *node_struct = _starpu_get_node_struct(node);
+	unsigned long hits;
+
+	_starpu_spin_lock(&node_struct->mc_lock);
+	hits = node_struct->mc_cache_slack_hit;
+	_starpu_spin_unlock(&node_struct->mc_lock);
+	return hits;
+}
+
 static int
 get_better_disk_can_accept_size(starpu_data_handle_t handle, unsigned node)
 {
@@ -98,6 +98,10 @@ int _starpu_is_reclaiming(unsigned node);
 
 void _starpu_mem_chunk_disk_register(unsigned disk_memnode);
 
+/** Return the number of allocations of \p node which reused a bigger chunk of
+ * the allocation cache, see STARPU_MEMCHUNK_CACHE_SLACK */
+unsigned long _starpu_memchunk_cache_slack_hits(unsigned node) STARPU_ATTRIBUTE_VISIBILITY_DEFAULT;
+
 #pragma GCC visibility pop
 
 #endif
@@ -22,6 +22,7 @@
 #include <datawizard/datawizard.h>
 #include <drivers/mp_common/source_common.h>
 #include <datawizard/memory_nodes.h>
+#include <core/topology.h>
 
 void starpu_data_set_reduction_methods(starpu_data_handle_t handle, struct starpu_codelet *redux_cl, struct starpu_codelet *init_cl)
 {
@@ -201,6 +202,92 @@ void _starpu_data_start_reduction_mode(starpu_data_handle_t handle)
 
 //#define NO_TREE_REDUCTION
 
+/* Arity of the reduction trees, < 2 means a flat tree */
+static int redux_arity;
+
+void _starpu_data_reduction_init(void)
+{
+	redux_arity = starpu_getenv_number_default("STARPU_REDUX_ARITY", 2);
+}
+
+#ifndef NO_TREE_REDUCTION
+/* The reduction tree first reduces the replicates of workers sharing the same
+ * core cluster, then the same memory node, then the same NUMA node, and
+ * eventually everything together */
+#define REDUX_NLEVELS 3
+
+/* Reduction of the replicate src into the replicate dst. The steps of the
+ * same batch all have the same dst, and may be run in any order */
+struct redux_step
+{
+	unsigned dst;
+	unsigned src;
+	unsigned batch;
+};
+
+struct redux_plan
+{
+	struct redux_step *steps;
+	unsigned nsteps;
+	unsigned nbatches;
+};
+
+/* Plan the reduction of the nroots replicates of roots into the first one,
+ * with a redux_arity-ary tree */
+static void plan_redux_tree_level(struct redux_plan *plan, const unsigned *roots, unsigned nroots)
+{
+	unsigned arity = redux_arity < 2 ? nroots : (unsigned) redux_arity;
+	unsigned step, i, j;
+
+	for (step = 1; step < nroots; step *= arity)
+		for (i = 0; i + step < nroots; i += arity*step)
+		{
+			for (j = 1; j < arity && i + j*step < nroots; j++)
+			{
+				struct redux_step *redux_step = &plan->steps[plan->nsteps++];
+				redux_step->dst = roots[i];
+				redux_step->src = roots[i + j*step];
+				redux_step->batch = plan->nbatches;
+			}
+			plan->nbatches++;
+		}
+}
+
+/* Plan the reduction of the n replicates starting from first into the first
+ * one. They are sorted by locality, and have the same locality up to the given
+ * level. The replicates which also have the same locality at this level are
+ * reduced together first. */
+static void plan_redux_tree(struct redux_plan *plan, int (*locality)[REDUX_NLEVELS], unsigned first, unsigned n, unsigned level)
+{
+	unsigned roots[n];
+	unsigned nroots = 0;
+	unsigned i, j;
+
+	for (i = first; i < first + n; i = j)
+	{
+		j = i + 1;
+		if (level < REDUX_NLEVELS)
+		{
+			while (j < first + n && locality[j][level] == locality[i][level])
+				j++;
+			plan_redux_tree(plan, locality, i, j - i, level + 1);
+		}
+		roots[nroots++] = i;
+	}
+
+	plan_redux_tree_level(plan, roots, nroots);
+}
+
+static int locality_cmp(const int *locality1, const int *locality2)
+{
+	unsigned level;
+	for (level = 0; level < REDUX_NLEVELS; level++)
+		if (locality1[level] != locality2[level])
+			return locality1[level] < locality2[level] ? -1 : 1;
+	return 0;
+}
+#endif
+
 /* Force reduction. The lock should already have been taken.  */
 void _starpu_data_end_reduction_mode(starpu_data_handle_t handle, int priority)
 {
@@ -211,6 +298,10 @@ void _starpu_data_end_reduction_mode(starpu_data_handle_t handle, int priority)
 	/* Put every valid replicate in the same array */
 	unsigned replicate_count = 0;
 	starpu_data_handle_t replicate_array[1 + STARPU_NMAXWORKERS];
+#ifndef NO_TREE_REDUCTION
+	/* Locality of the replicates, from the outermost to the innermost level */
+	int locality[1 + STARPU_NMAXWORKERS][REDUX_NLEVELS];
+#endif
 
 	_starpu_spin_checklocked(&handle->header_lock);
 
@@ -223,8 +314,16 @@ void _starpu_data_end_reduction_mode(starpu_data_handle_t handle, int priority)
 
 #ifndef NO_TREE_REDUCTION
 	if (!empty)
-		/* Include the initial value into the reduction tree */
+	{
+		/* Include the initial value into the reduction tree. It is
+		 * kept first, so that it gets the final result, and is
+		 * only reduced with the results of the whole NUMA nodes */
+		locality[replicate_count][0] = -1;
+		locality[replicate_count][1] = -1;
+		locality[replicate_count][2] = -1;
 		replicate_array[replicate_count++] = handle;
+	}
+	unsigned first_worker_replicate = replicate_count;
 #endif
 
 	/* Register all valid per-worker replicates */
@@ -244,7 +343,25 @@ void _starpu_data_end_reduction_mode(starpu_data_handle_t handle, int priority)
 
 			starpu_data_set_sequential_consistency_flag(handle->reduction_tmp_handles[worker], 0);
 
+#ifndef NO_TREE_REDUCTION
+			/* Insert it sorted by locality */
+			int worker_locality[REDUX_NLEVELS];
+			unsigned i;
+
+			_starpu_get_worker_locality(worker, &worker_locality[0], &worker_locality[2]);
+			worker_locality[1] = home_node;
+
+			for (i = replicate_count; i > first_worker_replicate && locality_cmp(locality[i-1], worker_locality) > 0; i--)
+			{
+				memcpy(locality[i], locality[i-1], sizeof(locality[i]));
+				replicate_array[i] = replicate_array[i-1];
+			}
+			memcpy(locality[i], worker_locality, sizeof(locality[i]));
+			replicate_array[i] = handle->reduction_tmp_handles[worker];
+			replicate_count++;
+#else
 			replicate_array[replicate_count++] = handle->reduction_tmp_handles[worker];
+#endif
 		}
 		else
 		{
@@ -253,6 +370,15 @@ void _starpu_data_end_reduction_mode(starpu_data_handle_t handle, int priority)
 	}
 
 #ifndef NO_TREE_REDUCTION
+	struct redux_step steps[STARPU_NMAXWORKERS];
+	struct redux_plan plan = { .steps = steps };
+
+	if (replicate_count)
+	{
+		plan_redux_tree(&plan, locality, 0, replicate_count, 0);
+		STARPU_ASSERT(plan.nsteps + 1 == replicate_count);
+	}
+
 	if (empty)
 	{
 		/* Only the final copy will touch the actual handle */
@@ -260,14 +386,12 @@ void _starpu_data_end_reduction_mode(starpu_data_handle_t handle, int priority)
 	}
 	else
 	{
-		unsigned step = 1;
+		/* Each reduction into the initial value will touch the actual handle */
+		unsigned i;
 		handle->reduction_refcnt = 0;
-		while (step < replicate_count)
-		{
-			/* Each stage will touch the actual handle */
-			handle->reduction_refcnt++;
-			step *= 2;
-		}
+		for (i = 0; i < plan.nsteps; i++)
+			if (steps[i].dst == 0)
+				handle->reduction_refcnt++;
 	}
 #else
 	/* We know that in this reduction algorithm there is exactly one task per valid replicate. */
@@ -288,90 +412,101 @@ void _starpu_data_end_reduction_mode(starpu_data_handle_t handle, int priority)
 		_starpu_spin_unlock(&handle->header_lock);
 
 #ifndef NO_TREE_REDUCTION
-		/* We will store a pointer to the last task which should modify the
-		 * replicate */
-		struct starpu_task *last_replicate_deps[replicate_count];
-		memset(last_replicate_deps, 0, replicate_count*sizeof(struct starpu_task *));
-		struct starpu_task *redux_tasks[replicate_count];
-
-		/* Redux step-by-step for step from 1 to replicate_count/2, i.e.
-		 * 1-by-1, then 2-by-2, then 4-by-4, etc. */
-		unsigned step;
-		unsigned redux_task_idx = 0;
-		for (step = 1; step < replicate_count; step *=2)
+		struct starpu_task *redux_tasks[STARPU_NMAXWORKERS];
+
+		/* For each replicate, the range of steps of the last batch
+		 * which reduced into it, and of the batch before */
+		unsigned last_batch[replicate_count];
+		unsigned last_start[replicate_count], last_end[replicate_count];
+		unsigned prev_start[replicate_count], prev_end[replicate_count];
+		memset(last_start, 0, sizeof(last_start));
+		memset(last_end, 0, sizeof(last_end));
+		memset(prev_start, 0, sizeof(prev_start));
+		memset(prev_end, 0, sizeof(prev_end));
+		memset(last_batch, 0xff, sizeof(last_batch));
+
+		/* The steps were planned from the leaves to the root, so that
+		 * the source replicate of a step is complete already */
+		unsigned i;
+		for (i = 0; i < plan.nsteps; i++)
 		{
-			unsigned i;
-			for (i = 0; i < replicate_count; i+=2*step)
+			unsigned dst = steps[i].dst;
+			unsigned src = steps[i].src;
+
+			if (last_batch[dst] != steps[i].batch)
+			{
+				/* Start a new batch of reductions into dst */
+				prev_start[dst] = last_start[dst];
+				prev_end[dst] = last_end[dst];
+				last_start[dst] = last_end[dst] = i;
+				last_batch[dst] = steps[i].batch;
+			}
+
+			/* Perform the reduction between replicates dst
+			 * and src and put the result in replicate dst */
+			struct starpu_task *redux_task = starpu_task_create();
+			redux_task->name = "redux_task_between_replicates";
+			redux_task->priority = priority;
+
+			/* Mark these tasks so that StarPU does not block them
+			 * when they try to access the handle (normal tasks are
+			 * data requests to that handle are frozen until the
+			 * data is coherent again). */
+			struct _starpu_job *j = _starpu_get_job_associated_to_task(redux_task);
+			j->reduction_task = 1;
+
+			redux_task->cl = handle->redux_cl;
+			redux_task->cl_arg = handle->redux_cl_arg;
+			STARPU_ASSERT(redux_task->cl);
+			if (!(STARPU_CODELET_GET_MODE(redux_task->cl, 0)))
+				STARPU_CODELET_SET_MODE(redux_task->cl, STARPU_RW|STARPU_COMMUTE, 0);
+			if (!(STARPU_CODELET_GET_MODE(redux_task->cl, 1)))
+				STARPU_CODELET_SET_MODE(redux_task->cl, STARPU_R, 1);
+
+			if (!(STARPU_CODELET_GET_MODE(redux_task->cl, 0) & STARPU_COMMUTE))
 			{
-				if (i + step < replicate_count)
+				static int warned;
+				STARPU_HG_DISABLE_CHECKING(warned);
+				if (!warned)
 				{
-					/* Perform the reduction between replicates i
-					 * and i+step and put the result in replicate i */
-					struct starpu_task *redux_task = starpu_task_create();
-					redux_task->name = "redux_task_between_replicates";
-					redux_task->priority = priority;
-
-					/* Mark these tasks so that StarPU does not block them
-					 * when they try to access the handle (normal tasks are
-					 * data requests to that handle are frozen until the
-					 * data is coherent again). */
-					struct _starpu_job *j = _starpu_get_job_associated_to_task(redux_task);
-					j->reduction_task = 1;
-
-					redux_task->cl = handle->redux_cl;
-					redux_task->cl_arg = handle->redux_cl_arg;
-					STARPU_ASSERT(redux_task->cl);
-					if (!(STARPU_CODELET_GET_MODE(redux_task->cl, 0)))
-						STARPU_CODELET_SET_MODE(redux_task->cl, STARPU_RW|STARPU_COMMUTE, 0);
-					if (!(STARPU_CODELET_GET_MODE(redux_task->cl, 1)))
-						STARPU_CODELET_SET_MODE(redux_task->cl, STARPU_R, 1);
-
-					if (!(STARPU_CODELET_GET_MODE(redux_task->cl, 0) & STARPU_COMMUTE))
-					{
-						static int warned;
-						STARPU_HG_DISABLE_CHECKING(warned);
-						if (!warned)
-						{
-							warned = 1;
-							_STARPU_DISP("Warning: for reductions, codelet %p should have STARPU_COMMUTE along STARPU_RW\n", redux_task->cl);
-						}
-					}
-
-					STARPU_TASK_SET_HANDLE(redux_task, replicate_array[i], 0);
-					STARPU_TASK_SET_HANDLE(redux_task, replicate_array[i+step], 1);
-
-					int ndeps = 0;
-					struct starpu_task *task_deps[2];
-
-					if (last_replicate_deps[i])
-						task_deps[ndeps++] = last_replicate_deps[i];
-
-					if (last_replicate_deps[i+step])
-						task_deps[ndeps++] = last_replicate_deps[i+step];
-
-					/* i depends on this task */
-					last_replicate_deps[i] = redux_task;
-
-					/* we don't perform the reduction until both replicates are ready */
-					starpu_task_declare_deps_array(redux_task, ndeps, task_deps);
-
-					/* We cannot submit tasks here : we do
-					 * not want to depend on tasks that have
-					 * been completed, so we juste store
-					 * this task : it will be submitted
-					 * later. */
-					redux_tasks[redux_task_idx++] = redux_task;
+					warned = 1;
+					_STARPU_DISP("Warning: for reductions, codelet %p should have STARPU_COMMUTE along STARPU_RW\n", redux_task->cl);
 				}
 			}
+
+			STARPU_TASK_SET_HANDLE(redux_task, replicate_array[dst], 0);
+			STARPU_TASK_SET_HANDLE(redux_task, replicate_array[src], 1);
+
+			/* We don't perform the reduction until the previous
+			 * batch of reductions into dst, and the last batch of
+			 * reductions into src, are over. The reductions of the
+			 * same batch can however run in any order. */
+			unsigned ndeps = 0, k;
+			struct starpu_task *task_deps[1 + (prev_end[dst] - prev_start[dst]) + (last_end[src] - last_start[src])];
+
+			for (k = prev_start[dst]; k < prev_end[dst]; k++)
+				task_deps[ndeps++] = redux_tasks[k];
+			for (k = last_start[src]; k < last_end[src]; k++)
+				task_deps[ndeps++] = redux_tasks[k];
+
+			if (ndeps)
+				starpu_task_declare_deps_array(redux_task, ndeps, task_deps);
+
+			/* We cannot submit tasks here : we do
+			 * not want to depend on tasks that have
+			 * been completed, so we juste store
+			 * this task : it will be submitted
+			 * later. */
+			redux_tasks[i] = redux_task;
+			last_end[dst] = i + 1;
 		}
 
 		if (empty)
 			/* The handle was empty, we just need to copy the reduced value. */
-			_starpu_data_cpy(handle, replicate_array[0], 1, NULL, 0, 1, last_replicate_deps[0], priority);
+			_starpu_data_cpy(handle, replicate_array[0], 1, NULL, 0, 1, last_end[0] - last_start[0], &redux_tasks[last_start[0]], priority);
 
 		/* Let's submit all the reduction tasks. */
-		unsigned i;
-		for (i = 0; i < redux_task_idx; i++)
+		for (i = 0; i < plan.nsteps; i++)
 		{
 			int ret = _starpu_task_submit_internally(redux_tasks[i]);
 			STARPU_ASSERT(ret == 0);
@@ -810,6 +810,16 @@ unsigned starpu_data_get_ooc_flag(starpu_data_handle_t handle)
 	return handle->ooc;
 }
 
+void starpu_data_set_disk_compress_flag(starpu_data_handle_t handle, unsigned flag)
+{
+	handle->disk_compress = flag;
+}
+
+unsigned starpu_data_get_disk_compress_flag(starpu_data_handle_t handle)
+{
+	return handle->disk_compress;
+}
+
 /* By default, sequential consistency is enabled */
 static unsigned default_sequential_consistency_flag = 1;
 
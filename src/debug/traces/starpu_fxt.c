@@ -31,6 +31,8 @@
 #ifdef STARPU_USE_FXT
 #include "starpu_fxt.h"
 #include <inttypes.h>
+#include <pthread.h>
+#include <unistd.h>
 #include <starpu_hash.h>
 
 #define CPUS_WORKER_COLORS_NB	8
@@ -902,6 +904,8 @@ static void memnode_event(double time, const char *prefix, unsigned int memnodei
 {
 	if (!options->memory_states)
 		return;
+	if (!out_paje_file)
+		return;
 	// If there is not a valid memory node, we cannot associate it
 	if((int)memnodeid < 0)
 		return;
@@ -4605,6 +4609,67 @@ void starpu_fxt_options_init(struct starpu_fxt_options *options)
 	options->sched_tasks_path = strdup("sched_tasks.rec");
 }
 
+/* The outputs which can be selected with the -only option */
+static const struct
+{
+	const char *name;
+	size_t offset;
+	const char *default_path;
+} _starpu_fxt_outputs[] =
+{
+	{ "paje", offsetof(struct starpu_fxt_options, out_paje_path), "paje.trace" },
+	{ "dag", offsetof(struct starpu_fxt_options, dag_path), "dag.dot" },
+	{ "tasks", offsetof(struct starpu_fxt_options, tasks_path), "tasks.rec" },
+	{ "comms", offsetof(struct starpu_fxt_options, comms_path), "comms.rec" },
+	{ "data", offsetof(struct starpu_fxt_options, data_path), "data.rec" },
+	{ "papi", offsetof(struct starpu_fxt_options, papi_path), "papi.rec" },
+	{ "anim", offsetof(struct starpu_fxt_options, anim_path), "trace.html" },
+	{ "states", offsetof(struct starpu_fxt_options, states_path), "trace.rec" },
+	{ "distrib", offsetof(struct starpu_fxt_options, distrib_time_path), "distrib.data" },
+	{ "activity", offsetof(struct starpu_fxt_options, activity_path), "activity.data" },
+	{ "sched-tasks", offsetof(struct starpu_fxt_options, sched_tasks_path), "sched_tasks.rec" },
+	{ "number-events", offsetof(struct starpu_fxt_options, number_events_path), "number_events.data" },
+};
+#define STARPU_FXT_NOUTPUTS (sizeof(_starpu_fxt_outputs)/sizeof(_starpu_fxt_outputs[0]))
+
+int _starpu_fxt_options_select_outputs(struct starpu_fxt_options *options, const char *outputs)
+{
+	unsigned selected[STARPU_FXT_NOUTPUTS] = { 0 };
+	char *list = strdup(outputs);
+	char *saveptr = NULL;
+	char *name;
+	unsigned i;
+
+	for (name = strtok_r(list, ",", &saveptr); name; name = strtok_r(NULL, ",", &saveptr))
+	{
+		for (i = 0; i < STARPU_FXT_NOUTPUTS; i++)
+			if (strcmp(name, _starpu_fxt_outputs[i].name) == 0)
+				break;
+		if (i == STARPU_FXT_NOUTPUTS)
+		{
+			_STARPU_MSG("Unknown output <%s>\n", name);
+			free(list);
+			return 1;
+		}
+		selected[i] = 1;
+	}
+	free(list);
+
+	/* Generators whose path is NULL are skipped altogether */
+	for (i = 0; i < STARPU_FXT_NOUTPUTS; i++)
+	{
+		char **path = (char **) ((char *) options + _starpu_fxt_outputs[i].offset);
+		if (!selected[i])
+		{
+			free(*path);
+			*path = NULL;
+		}
+		else if (!*path)
+			*path = strdup(_starpu_fxt_outputs[i].default_path);
+	}
+	return 0;
+}
+
 static
 void _set_dir(char *dir, char **option)
 {
@@ -5018,6 +5083,81 @@ uint64_t _starpu_fxt_find_start_time(char *filename_in)
 	return (ev.time);
 }
 
+struct inputscan
+{
+	char *filename;
+	uint64_t start_time;
+	struct starpu_fxt_mpi_offset sync_barriers;
+	int key;
+	int rank;
+};
+
+struct inputscan_thread
+{
+	struct inputscan *scans;
+	unsigned first;
+	unsigned stride;
+	unsigned ninputfiles;
+};
+
+static void *inputscan_thread_func(void *arg)
+{
+	struct inputscan_thread *thread = arg;
+	unsigned inputfile;
+
+	for (inputfile = thread->first; inputfile < thread->ninputfiles; inputfile += thread->stride)
+	{
+		struct inputscan *scan = &thread->scans[inputfile];
+		scan->sync_barriers = _starpu_fxt_mpi_find_sync_points(scan->filename, &scan->key, &scan->rank, &scan->start_time);
+	}
+	return NULL;
+}
+
+/* Get the start time and the synchronization points of all trace files. This
+ * may require reading each of them up to the end, so scan them in parallel.
+ * We are not running StarPU here, so use plain pthreads. */
+static void scan_input_files(struct starpu_fxt_options *options, struct inputscan *scans)
+{
+	unsigned nthreads = options->nthreads;
+	unsigned inputfile, i;
+
+	if (nthreads == 0)
+	{
+		long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+		nthreads = ncpus > 0 ? ncpus : 1;
+	}
+	if (nthreads > options->ninputfiles)
+		nthreads = options->ninputfiles;
+
+	for (inputfile = 0; inputfile < options->ninputfiles; inputfile++)
+	{
+		scans[inputfile].filename = options->filenames[inputfile];
+		scans[inputfile].start_time = 0;
+		scans[inputfile].key = -1;
+		/* In case the file does not have any synchronization point */
+		scans[inputfile].rank = inputfile;
+	}
+
+	pthread_t threads[nthreads];
+	struct inputscan_thread args[nthreads];
+	for (i = 0; i < nthreads; i++)
+	{
+		args[i].scans = scans;
+		args[i].first = i;
+		args[i].stride = nthreads;
+		args[i].ninputfiles = options->ninputfiles;
+		/* The current thread takes the first share */
+		if (i > 0)
+		{
+			int ret = pthread_create(&threads[i], NULL, inputscan_thread_func, &args[i]);
+			STARPU_ASSERT_MSG(ret == 0, "pthread_create failed (err %s)", strerror(ret));
+		}
+	}
+	inputscan_thread_func(&args[0]);
+	for (i = 1; i < nthreads; i++)
+		pthread_join(threads[i], NULL);
+}
+
 struct inputrank
 {
 	int input;
@@ -5035,6 +5175,9 @@ void starpu_fxt_generate_trace(struct starpu_fxt_options *options)
 {
 	starpu_drivers_preinit();
 	_starpu_fxt_options_set_dir(options);
+	if (!options->out_paje_path)
+		/* Flops are only rendered in the Paje trace, do not keep track of them */
+		options->no_flops = 1;
 	_starpu_fxt_dag_init(options->dag_path);
 	_starpu_fxt_distrib_file_init(options);
 	_starpu_fxt_activity_file_init(options);
@@ -5086,24 +5229,21 @@ void starpu_fxt_generate_trace(struct starpu_fxt_options *options)
 		int rank_k[options->ninputfiles];
 		uint64_t start_k[options->ninputfiles];
 		struct starpu_fxt_mpi_offset sync_barriers[options->ninputfiles];
+		struct inputscan scans[options->ninputfiles];
 		uint64_t M_start = 0;
 		uint64_t M_end = 0;
 		int key = -1;
 		unsigned display_mpi = 0;
 
-		/* Get all trace starts */
-		for (inputfile = 0; inputfile < options->ninputfiles; inputfile++)
-		{
-			uint64_t file_start = _starpu_fxt_find_start_time(options->filenames[inputfile]);
-			start_k[inputfile] = file_start;
-		}
+		/* Get all trace starts and synchronization points, if they exist */
+		scan_input_files(options, scans);
 
-		/* Look for all synchronization points, if they exist */
 		for (inputfile = 0; inputfile < options->ninputfiles; inputfile++)
 		{
-			sync_barriers[inputfile] = _starpu_fxt_mpi_find_sync_points(options->filenames[inputfile],
-										   &unique_keys[inputfile],
-										   &rank_k[inputfile]);
+			start_k[inputfile] = scans[inputfile].start_time;
+			sync_barriers[inputfile] = scans[inputfile].sync_barriers;
+			unique_keys[inputfile] = scans[inputfile].key;
+			rank_k[inputfile] = scans[inputfile].rank;
 			if (sync_barriers[inputfile].nb_barriers > 0)
 			{
 				/* Let's start by making sure all trace files come from the same execution: */
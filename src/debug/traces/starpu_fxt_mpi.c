@@ -40,7 +40,7 @@ LIST_TYPE(mpi_transfer,
 	long numa_nodes_bitmap;
 );
 
-struct starpu_fxt_mpi_offset _starpu_fxt_mpi_find_sync_points(char *filename_in, int *key, int *rank)
+struct starpu_fxt_mpi_offset _starpu_fxt_mpi_find_sync_points(char *filename_in, int *key, int *rank, uint64_t *start_time)
 {
 	struct starpu_fxt_mpi_offset offset;
 	offset.nb_barriers = 0;
@@ -58,7 +58,8 @@ struct starpu_fxt_mpi_offset _starpu_fxt_mpi_find_sync_points(char *filename_in,
 		_exit(EXIT_FAILURE);
 	}
 
-	static fxt_t fut;
+	/* Not static, this may be called concurrently on several files */
+	fxt_t fut;
 	fut = fxt_fdopen(fd_in);
 	if (!fut)
 	{
@@ -72,9 +73,17 @@ struct starpu_fxt_mpi_offset _starpu_fxt_mpi_find_sync_points(char *filename_in,
 	struct fxt_ev_native ev;
 	int ret;
 	uint64_t local_sync_time;
+	unsigned first_event = 1;
 
 	while (offset.nb_barriers < 2 && (ret = fxt_next_ev(block, FXT_EV_TYPE_NATIVE, (struct fxt_ev *)&ev)) == FXT_EV_OK)
 	{
+		if (first_event)
+		{
+			/* The trace starts with its first event */
+			*start_time = ev.time;
+			first_event = 0;
+		}
+
 		if (ev.code == _STARPU_MPI_FUT_BARRIER)
 		{
 			/* We found a sync point */
@@ -103,12 +112,20 @@ struct starpu_fxt_mpi_offset _starpu_fxt_mpi_find_sync_points(char *filename_in,
 		}
 	}
 
+#ifdef HAVE_FXT_BLOCKEV_LEAVE
+	fxt_blockev_leave(block);
+#endif
+
 	/* Close the trace file */
+#ifdef HAVE_FXT_CLOSE
+	fxt_close(fut);
+#else
 	if (close(fd_in))
 	{
 		perror("close failed :");
 		_exit(EXIT_FAILURE);
 	}
+#endif
 
 	return offset;
 }
@@ -350,15 +367,18 @@ static void display_all_transfers_from_trace(FILE *out_paje_file, FILE *out_comm
 			match = mpi_transfer_list_pop_front(&pending_receives);
 			current_out_bandwidth[match->src] -= match->bandwidth;
 			current_in_bandwidth[match->dst] -= match->bandwidth;
+			if (out_paje_file)
+			{
 #ifdef STARPU_HAVE_POTI
-			snprintf(mpi_container, sizeof(mpi_container), "%d_mpict", match->src);
-			poti_SetVariable(match->date, mpi_container, "bwo_mpi", current_out_bandwidth[match->src]);
-			snprintf(mpi_container, sizeof(mpi_container), "%d_mpict", match->dst);
-			poti_SetVariable(match->date, mpi_container, "bwi_mpi", current_in_bandwidth[match->dst]);
+				snprintf(mpi_container, sizeof(mpi_container), "%d_mpict", match->src);
+				poti_SetVariable(match->date, mpi_container, "bwo_mpi", current_out_bandwidth[match->src]);
+				snprintf(mpi_container, sizeof(mpi_container), "%d_mpict", match->dst);
+				poti_SetVariable(match->date, mpi_container, "bwi_mpi", current_in_bandwidth[match->dst]);
 #else
-			fprintf(out_paje_file, "13	%.9f	%d_mpict	bwo_mpi	%f\n", match->date, match->src, current_out_bandwidth[match->src]);
-			fprintf(out_paje_file, "13	%.9f	%d_mpict	bwi_mpi	%f\n", match->date, match->dst, current_in_bandwidth[match->dst]);
+				fprintf(out_paje_file, "13	%.9f	%d_mpict	bwo_mpi	%f\n", match->date, match->src, current_out_bandwidth[match->src]);
+				fprintf(out_paje_file, "13	%.9f	%d_mpict	bwi_mpi	%f\n", match->date, match->dst, current_in_bandwidth[match->dst]);
 #endif
+			}
 			continue;
 		}
 
@@ -409,35 +429,38 @@ static void display_all_transfers_from_trace(FILE *out_paje_file, FILE *out_comm
 				_starpu_fxt_dag_add_send(src, cur->jobid, mpi_tag, id);
 			if (match->jobid != -1)
 				_starpu_fxt_dag_add_receive(dst, match->jobid, mpi_tag, id);
+			if (out_paje_file)
+			{
 #ifdef STARPU_HAVE_POTI
-			char paje_value[STARPU_POTI_STR_LEN], paje_key[STARPU_POTI_STR_LEN];
-			snprintf(paje_value, sizeof(paje_value), "%lu", (long unsigned) size);
-			snprintf(paje_key, sizeof(paje_key), "mpicom_%lu", id);
-			snprintf(mpi_container, sizeof(mpi_container), "%d_mpict", src);
-
-			char str_mpi_tag[STARPU_POTI_STR_LEN];
-			snprintf(str_mpi_tag, sizeof(str_mpi_tag), "%ld", mpi_tag);
-			char str_priority[STARPU_POTI_STR_LEN];
-			snprintf(str_priority, sizeof(str_priority), "%d", cur->prio);
-			char str_handle[STARPU_POTI_STR_LEN];
-			snprintf(str_handle, sizeof(str_handle), "%lx", send_handle);
-			char X_str[STARPU_POTI_STR_LEN];
-			snprintf(X_str, sizeof(X_str), "%u", cur->X);
-			char Y_str[STARPU_POTI_STR_LEN];
-			snprintf(Y_str, sizeof(Y_str), "%u", cur->Y);
-
-			poti_user_StartLink(_starpu_poti_MpiLinkStart, start_date, "MPIroot", "MPIL", mpi_container, paje_value, paje_key, 7, str_mpi_tag, get_mpi_type_str(cur->type), str_priority, str_handle, cur->name, X_str, Y_str);
-
-			poti_SetVariable(start_date, mpi_container, "bwo_mpi", current_out_bandwidth[src]);
-			snprintf(mpi_container, sizeof(mpi_container), "%d_mpict", dst);
-			poti_EndLink(end_date, "MPIroot", "MPIL", mpi_container, paje_value, paje_key);
-			poti_SetVariable(start_date, mpi_container, "bwo_mpi", current_in_bandwidth[dst]);
+				char paje_value[STARPU_POTI_STR_LEN], paje_key[STARPU_POTI_STR_LEN];
+				snprintf(paje_value, sizeof(paje_value), "%lu", (long unsigned) size);
+				snprintf(paje_key, sizeof(paje_key), "mpicom_%lu", id);
+				snprintf(mpi_container, sizeof(mpi_container), "%d_mpict", src);
+
+				char str_mpi_tag[STARPU_POTI_STR_LEN];
+				snprintf(str_mpi_tag, sizeof(str_mpi_tag), "%ld", mpi_tag);
+				char str_priority[STARPU_POTI_STR_LEN];
+				snprintf(str_priority, sizeof(str_priority), "%d", cur->prio);
+				char str_handle[STARPU_POTI_STR_LEN];
+				snprintf(str_handle, sizeof(str_handle), "%lx", send_handle);
+				char X_str[STARPU_POTI_STR_LEN];
+				snprintf(X_str, sizeof(X_str), "%u", cur->X);
+				char Y_str[STARPU_POTI_STR_LEN];
+				snprintf(Y_str, sizeof(Y_str), "%u", cur->Y);
+
+				poti_user_StartLink(_starpu_poti_MpiLinkStart, start_date, "MPIroot", "MPIL", mpi_container, paje_value, paje_key, 7, str_mpi_tag, get_mpi_type_str(cur->type), str_priority, str_handle, cur->name, X_str, Y_str);
+
+				poti_SetVariable(start_date, mpi_container, "bwo_mpi", current_out_bandwidth[src]);
+				snprintf(mpi_container, sizeof(mpi_container), "%d_mpict", dst);
+				poti_EndLink(end_date, "MPIroot", "MPIL", mpi_container, paje_value, paje_key);
+				poti_SetVariable(start_date, mpi_container, "bwo_mpi", current_in_bandwidth[dst]);
 #else
-			fprintf(out_paje_file, "13	%.9f	%d_mpict	bwo_mpi	%f\n", start_date, src, current_out_bandwidth[src]);
-			fprintf(out_paje_file, "13	%.9f	%d_mpict	bwi_mpi	%f\n", start_date, dst, current_in_bandwidth[dst]);
-			fprintf(out_paje_file, "23	%.9f	MPIL	MPIroot	%lu	%d_mpict	mpicom_%lu	%ld	%s	%d	%lx	\"%s\"	%u	%u\n", start_date, (unsigned long)size, src, id, mpi_tag, get_mpi_type_str(cur->type), cur->prio, send_handle, cur->name, cur->X, cur->Y);
-			fprintf(out_paje_file, "19	%.9f	MPIL	MPIroot	%lu	%d_mpict	mpicom_%lu\n", end_date, (unsigned long)size, dst, id);
+				fprintf(out_paje_file, "13	%.9f	%d_mpict	bwo_mpi	%f\n", start_date, src, current_out_bandwidth[src]);
+				fprintf(out_paje_file, "13	%.9f	%d_mpict	bwi_mpi	%f\n", start_date, dst, current_in_bandwidth[dst]);
+				fprintf(out_paje_file, "23	%.9f	MPIL	MPIroot	%lu	%d_mpict	mpicom_%lu	%ld	%s	%d	%lx	\"%s\"	%u	%u\n", start_date, (unsigned long)size, src, id, mpi_tag, get_mpi_type_str(cur->type), cur->prio, send_handle, cur->name, cur->X, cur->Y);
+				fprintf(out_paje_file, "19	%.9f	MPIL	MPIroot	%lu	%d_mpict	mpicom_%lu\n", end_date, (unsigned long)size, dst, id);
 #endif
+			}
 
 			if (out_comms_file != NULL)
 			{
@@ -487,7 +510,7 @@ void _starpu_fxt_display_mpi_transfers(struct starpu_fxt_options *options, int *
 	}
 
 	/* display the MPI transfers if possible */
-	if (out_paje_file)
+	if (out_paje_file || out_comms_file || options->dag_path)
 		display_all_transfers_from_trace(out_paje_file, out_comms_file, options->ninputfiles);
 }
 
@@ -73,6 +73,8 @@ unsigned _starpu_disk_test_request_completion(struct _starpu_async_channel *asyn
 		if (disk_event->handle != NULL)
 		{
 			/* read is finished, we can already unpack */
+			if (disk_event->compressed)
+				disk_event->size = _starpu_disk_decompress(disk_event->memory_node, disk_event->node, &disk_event->ptr, disk_event->size);
 			disk_event->handle->ops->unpack_data(disk_event->handle, disk_event->node, disk_event->ptr, disk_event->size);
 		}
 		else
@@ -93,6 +95,8 @@ void _starpu_disk_wait_request_completion(struct _starpu_async_channel *async_ch
 		if (disk_event->handle != NULL)
 		{
 			/* read is finished, we can already unpack */
+			if (disk_event->compressed)
+				disk_event->size = _starpu_disk_decompress(disk_event->memory_node, disk_event->node, &disk_event->ptr, disk_event->size);
 			disk_event->handle->ops->unpack_data(disk_event->handle, disk_event->node, disk_event->ptr, disk_event->size);
 		}
 		else
@@ -119,8 +123,10 @@ int _starpu_disk_copy_interface_from_disk_to_cpu(starpu_data_handle_t handle, vo
 		_starpu_disk_backend_event_list_init(&disk_event->requests);
 		disk_event->ptr = NULL;
 		disk_event->handle = NULL;
+		disk_event->compressed = 0;
 	}
-	if(copy_methods->any_to_any)
+	int compress = _starpu_disk_compress_handle(handle, src_node);
+	if(copy_methods->any_to_any && !compress)
 		ret = copy_methods->any_to_any(src_interface, src_node, dst_interface, dst_node, req && !starpu_asynchronous_copy_disabled()  ? &req->async_channel : NULL);
 	else
 	{
@@ -133,6 +139,8 @@ int _starpu_disk_copy_interface_from_disk_to_cpu(starpu_data_handle_t handle, vo
 		if (ret == 0)
 		{
 			/* read is already finished, we can already unpack */
+			if (compress)
+				size = _starpu_disk_decompress(src_node, dst_node, &ptr, size);
 			handle->ops->unpack_data(handle, dst_node, ptr, size);
 		}
 		else if (ret == -EAGAIN)
@@ -142,6 +150,7 @@ int _starpu_disk_copy_interface_from_disk_to_cpu(starpu_data_handle_t handle, vo
 			disk_event->node = dst_node;
 			disk_event->size = size;
 			disk_event->handle = handle;
+			disk_event->compressed = compress;
 		}
 		STARPU_ASSERT(ret == 0 || ret == -EAGAIN);
 	}
@@ -165,7 +174,31 @@ int _starpu_disk_copy_interface_from_disk_to_disk(starpu_data_handle_t handle, v
 		_starpu_disk_backend_event_list_init(&disk_event->requests);
 		disk_event->ptr = NULL;
 		disk_event->handle = NULL;
+		disk_event->compressed = 0;
 	}
+	int src_compress = _starpu_disk_compress_handle(handle, src_node);
+	int dst_compress = _starpu_disk_compress_handle(handle, dst_node);
+	if (src_compress || dst_compress)
+	{
+		/* The data has to go through the main memory to get (de)compressed */
+		void *src_obj = starpu_data_handle_to_pointer(handle, src_node);
+		void *dst_obj = starpu_data_handle_to_pointer(handle, dst_node);
+		void *ptr = NULL;
+		size_t size = 0;
+		int src_dev = starpu_memory_node_get_devid(src_node);
+		int dst_dev = starpu_memory_node_get_devid(dst_node);
+		ret = _starpu_disk_full_read(src_dev, starpu_memory_node_get_devid(STARPU_MAIN_RAM), src_obj, &ptr, &size, NULL);
+		STARPU_ASSERT(ret == 0);
+		if (src_compress)
+			size = _starpu_disk_decompress(src_node, STARPU_MAIN_RAM, &ptr, size);
+		if (dst_compress)
+			size = _starpu_disk_compress(dst_node, STARPU_MAIN_RAM, &ptr, size);
+		ret = _starpu_disk_full_write(starpu_memory_node_get_devid(STARPU_MAIN_RAM), dst_dev, dst_obj, ptr, size, NULL);
+		STARPU_ASSERT(ret == 0);
+		_starpu_free_flags_on_node(STARPU_MAIN_RAM, ptr, size, 0);
+		return 0;
+	}
+
 	ret = copy_methods->any_to_any(src_interface, src_node, dst_interface, dst_node, req && !starpu_asynchronous_copy_disabled() ? &req->async_channel : NULL);
 	return ret;
 }
@@ -186,9 +219,11 @@ int _starpu_disk_copy_interface_from_cpu_to_disk(starpu_data_handle_t handle, vo
 		_starpu_disk_backend_event_list_init(&disk_event->requests);
 		disk_event->ptr = NULL;
 		disk_event->handle = NULL;
+		disk_event->compressed = 0;
 	}
 
-	if(copy_methods->any_to_any)
+	int compress = _starpu_disk_compress_handle(handle, dst_node);
+	if(copy_methods->any_to_any && !compress)
 		ret = copy_methods->any_to_any(src_interface, src_node, dst_interface, dst_node, req && !starpu_asynchronous_copy_disabled() ? &req->async_channel : NULL);
 	else
 	{
@@ -196,6 +231,8 @@ int _starpu_disk_copy_interface_from_cpu_to_disk(starpu_data_handle_t handle, vo
 		void * ptr = NULL;
 		starpu_ssize_t size = 0;
 		handle->ops->pack_data(handle, src_node, &ptr, &size);
+		if (compress)
+			size = _starpu_disk_compress(dst_node, src_node, &ptr, size);
 		int src_dev = starpu_memory_node_get_devid(src_node);
 		int dst_dev = starpu_memory_node_get_devid(dst_node);
 		ret = _starpu_disk_full_write(src_dev, dst_dev, obj, ptr, size, req && !starpu_asynchronous_copy_disabled() ? &req->async_channel : NULL);
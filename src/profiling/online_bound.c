@@ -0,0 +1,469 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+/*
+ * Estimate online a lower bound of the execution time of the tasks, to be
+ * compared with the achieved execution time through performance counters.
+ *
+ * Contrary to bound.c, no linear program is solved: for each window of
+ * tasks, i.e. each outermost starpu_iteration_push() / starpu_iteration_pop()
+ * section, or what is submitted between them, we maintain incrementally
+ *
+ * - the area bound: the sum of the shortest expected length of each task,
+ *   divided by the number of workers,
+ * - the critical path bound: the longest chain of shortest expected lengths
+ *   along the task dependencies within the window.
+ *
+ * Once all the tasks of a closed window have terminated, the achieved time
+ * of the window is compared with the largest of the two bounds.
+ *
+ * Dependencies on tasks which already terminated, tag dependencies, and
+ * dependencies between tasks of different windows are ignored, which only
+ * makes the bound lower.
+ */
+
+#include <starpu.h>
+#include <math.h>
+#include <profiling/online_bound.h>
+#include <core/jobs.h>
+#include <core/workers.h>
+#include <common/knobs.h>
+
+struct _starpu_online_bound_window;
+
+struct _starpu_online_bound_task
+{
+	/* Window the task is accounted in */
+	struct _starpu_online_bound_window *window;
+	/* Shortest expected length, once submitted */
+	double duration;
+	/* Lower bound of the start time, from the window start */
+	double start;
+	int submitted;
+	/* Its job was destroyed without being submitted */
+	int destroyed;
+	/* Tasks of the window which depend on this one */
+	struct _starpu_online_bound_task **succ;
+	unsigned nsucc;
+	unsigned alloc_succ;
+	/* Other tasks of the window */
+	struct _starpu_online_bound_task *next;
+};
+
+struct _starpu_online_bound_window
+{
+	double start_time;
+	double last_end_time;
+	/* Sum of the task durations */
+	double area;
+	/* Longest chain of task durations */
+	double critical_path;
+	/* Number of submitted tasks which have not terminated yet */
+	unsigned long pending;
+	unsigned long ntasks;
+	int closed;
+	struct _starpu_online_bound_task *tasks;
+	/* Other closed windows */
+	struct _starpu_online_bound_window *next;
+};
+
+int _starpu_online_bound_enabled;
+
+static starpu_pthread_mutex_t mutex = STARPU_PTHREAD_MUTEX_INITIALIZER;
+/* Window receiving the submitted tasks */
+static struct _starpu_online_bound_window *current;
+/* Closed windows whose tasks have not all terminated yet */
+static struct _starpu_online_bound_window *closed_windows;
+/* Recorded in the jobs which have terminated, dependencies on them are not
+ * recorded any more */
+static struct _starpu_online_bound_task terminated_task;
+
+/* Results for the last completed window */
+static starpu_perf_counter_int64_t nwindows;
+static double last_area_bound;
+static double last_critical_path_bound;
+static double last_achieved;
+
+/* global counters */
+static int __g_windows;
+static int __g_area_bound;
+static int __g_critical_path_bound;
+static int __g_achieved;
+static int __g_gap;
+static int __g_efficiency;
+static int __g_current_bound;
+static int __g_current_elapsed;
+
+static struct _starpu_online_bound_window *window_new(void)
+{
+	struct _starpu_online_bound_window *w;
+	_STARPU_CALLOC(w, 1, sizeof(*w));
+	w->start_time = starpu_timing_now();
+	return w;
+}
+
+static double window_bound(struct _starpu_online_bound_window *w)
+{
+	unsigned nworkers = starpu_worker_get_count();
+	double area = nworkers ? w->area / nworkers : w->area;
+	return STARPU_MAX(area, w->critical_path);
+}
+
+static void task_free(struct _starpu_online_bound_task *t)
+{
+	free(t->succ);
+	free(t);
+}
+
+void _starpu_online_bound_init(void)
+{
+	_starpu_online_bound_enabled = starpu_getenv_number_default("STARPU_ONLINE_BOUND", 0);
+	nwindows = 0;
+	last_area_bound = 0.;
+	last_critical_path_bound = 0.;
+	last_achieved = 0.;
+	if (_starpu_online_bound_enabled)
+		current = window_new();
+}
+
+static void window_free(struct _starpu_online_bound_window *w)
+{
+	struct _starpu_online_bound_task *t, *next;
+	for (t = w->tasks; t; t = next)
+	{
+		next = t->next;
+		task_free(t);
+	}
+	free(w);
+}
+
+void _starpu_online_bound_shutdown(void)
+{
+	struct _starpu_online_bound_window *w, *next;
+
+	if (!_starpu_online_bound_enabled)
+		return;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&mutex);
+	/* Jobs are all gone, there is no reference to the tasks any more */
+	for (w = closed_windows; w; w = next)
+	{
+		next = w->next;
+		window_free(w);
+	}
+	closed_windows = NULL;
+	window_free(current);
+	current = NULL;
+	_starpu_online_bound_enabled = 0;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&mutex);
+}
+
+/* Get the task of job j, creating it in the current window if needed. The mutex must be held. */
+static struct _starpu_online_bound_task *get_task(struct _starpu_job *j)
+{
+	struct _starpu_online_bound_task *t = j->online_bound_task;
+	if (!t || t == &terminated_task)
+	{
+		_STARPU_CALLOC(t, 1, sizeof(*t));
+		t->window = current;
+		t->next = current->tasks;
+		current->tasks = t;
+		j->online_bound_task = t;
+	}
+	return t;
+}
+
+/* The end of task t got later, propagate to the tasks which depend on it. The mutex must be held. */
+static void propagate(struct _starpu_online_bound_task *t)
+{
+	struct _starpu_online_bound_task **stack = NULL;
+	unsigned n = 0, alloc = 0;
+
+	for (;;)
+	{
+		struct _starpu_online_bound_window *w = t->window;
+		double end = t->start + t->duration;
+		unsigned i;
+
+		if (end > w->critical_path)
+			w->critical_path = end;
+
+		for (i = 0; i < t->nsucc; i++)
+		{
+			struct _starpu_online_bound_task *succ = t->succ[i];
+			if (succ->start >= end)
+				continue;
+			succ->start = end;
+			if (n == alloc)
+			{
+				alloc = alloc ? alloc * 2 : 16;
+				_STARPU_REALLOC(stack, alloc * sizeof(*stack));
+			}
+			stack[n++] = succ;
+		}
+
+		if (!n)
+			break;
+		t = stack[--n];
+	}
+	free(stack);
+}
+
+/* Shortest expected length of the task among the workers which can execute it */
+static double task_duration(struct _starpu_job *j)
+{
+	struct starpu_task *task = j->task;
+	unsigned nworkers = starpu_worker_get_count();
+	double duration = INFINITY;
+	unsigned worker, nimpl;
+
+	if (!task->cl || !task->cl->model)
+		return 0.;
+
+	for (worker = 0; worker < nworkers; worker++)
+		for (nimpl = 0; nimpl < STARPU_MAXIMPLEMENTATIONS; nimpl++)
+		{
+			double length;
+			if (!starpu_worker_can_execute_task(worker, task, nimpl))
+				continue;
+			length = starpu_task_worker_expected_length(task, worker, task->sched_ctx, nimpl);
+			/* Not calibrated yet, we can not say anything */
+			if (isnan(length) || length <= 0.)
+				return 0.;
+			if (length < duration)
+				duration = length;
+		}
+
+	return isinf(duration) ? 0. : duration;
+}
+
+void _starpu_online_bound_submit(struct _starpu_job *j)
+{
+	struct _starpu_online_bound_task *t;
+	double duration;
+
+	if (j->exclude_from_dag)
+		return;
+
+	duration = task_duration(j);
+
+	STARPU_PTHREAD_MUTEX_LOCK(&mutex);
+	if (!current)
+	{
+		STARPU_PTHREAD_MUTEX_UNLOCK(&mutex);
+		return;
+	}
+	t = get_task(j);
+	if (!t->submitted)
+	{
+		t->submitted = 1;
+		t->duration = duration;
+		t->window->pending++;
+		t->window->ntasks++;
+		t->window->area += duration;
+		propagate(t);
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&mutex);
+}
+
+void _starpu_online_bound_task_dep(struct _starpu_job *j, struct _starpu_job *dep_j)
+{
+	struct _starpu_online_bound_task *t, *dep_t;
+
+	if (j->exclude_from_dag || dep_j->exclude_from_dag)
+		return;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&mutex);
+	if (!current || dep_j->terminated || dep_j->online_bound_task == &terminated_task)
+	{
+		/* Terminated tasks do not constrain the bound any more */
+		STARPU_PTHREAD_MUTEX_UNLOCK(&mutex);
+		return;
+	}
+	t = get_task(j);
+	dep_t = get_task(dep_j);
+	if (t->window == dep_t->window)
+	{
+		double end = dep_t->start + dep_t->duration;
+		if (dep_t->nsucc == dep_t->alloc_succ)
+		{
+			dep_t->alloc_succ = dep_t->alloc_succ ? dep_t->alloc_succ * 2 : 4;
+			_STARPU_REALLOC(dep_t->succ, dep_t->alloc_succ * sizeof(*dep_t->succ));
+		}
+		dep_t->succ[dep_t->nsucc++] = t;
+		if (t->start < end)
+		{
+			t->start = end;
+			propagate(t);
+		}
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&mutex);
+}
+
+/* All the tasks of the closed window w have terminated, publish its results. The mutex must be held. */
+static void window_complete(struct _starpu_online_bound_window *w)
+{
+	struct _starpu_online_bound_window **prev;
+	struct _starpu_online_bound_task *t, *next;
+	unsigned nworkers = starpu_worker_get_count();
+
+	for (prev = &closed_windows; *prev != w; prev = &(*prev)->next)
+		STARPU_ASSERT(*prev);
+	*prev = w->next;
+
+	if (w->ntasks)
+	{
+		nwindows++;
+		last_area_bound = nworkers ? w->area / nworkers : w->area;
+		last_critical_path_bound = w->critical_path;
+		last_achieved = w->last_end_time - w->start_time;
+	}
+
+	for (t = w->tasks; t; t = next)
+	{
+		next = t->next;
+		if (t->submitted || t->destroyed)
+			task_free(t);
+		else
+		{
+			/* Its job will be submitted later on, move it to the current window */
+			t->window = current;
+			t->start = 0.;
+			t->nsucc = 0;
+			t->next = current->tasks;
+			current->tasks = t;
+		}
+	}
+	free(w);
+}
+
+void _starpu_online_bound_terminated(struct _starpu_job *j)
+{
+	struct _starpu_online_bound_task *t;
+	struct _starpu_online_bound_window *w;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&mutex);
+	t = j->online_bound_task;
+	if (!t || t == &terminated_task || !t->submitted)
+	{
+		STARPU_PTHREAD_MUTEX_UNLOCK(&mutex);
+		return;
+	}
+	/* Dependencies on it will not be recorded any more, and the window may free it */
+	j->online_bound_task = &terminated_task;
+	w = t->window;
+	w->last_end_time = STARPU_MAX(w->last_end_time, starpu_timing_now());
+	STARPU_ASSERT(w->pending > 0);
+	if (!--w->pending && w->closed)
+		window_complete(w);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&mutex);
+}
+
+void _starpu_online_bound_job_destroy(struct _starpu_job *j)
+{
+	struct _starpu_online_bound_task *t;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&mutex);
+	t = j->online_bound_task;
+	if (current && t && t != &terminated_task && !t->submitted)
+		/* Some task depended on it, but it will never be submitted,
+		 * let its window free it */
+		t->destroyed = 1;
+	j->online_bound_task = NULL;
+	STARPU_PTHREAD_MUTEX_UNLOCK(&mutex);
+}
+
+void _starpu_online_bound_new_window(void)
+{
+	struct _starpu_online_bound_window *w;
+	struct _starpu_online_bound_task *t, *next;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&mutex);
+	if (!current)
+	{
+		STARPU_PTHREAD_MUTEX_UNLOCK(&mutex);
+		return;
+	}
+	w = current;
+	current = window_new();
+	if (!w->ntasks)
+	{
+		/* Nothing submitted, just restart from now */
+		for (t = w->tasks; t; t = next)
+		{
+			next = t->next;
+			if (t->destroyed)
+			{
+				task_free(t);
+				continue;
+			}
+			t->window = current;
+			t->next = current->tasks;
+			current->tasks = t;
+		}
+		free(w);
+	}
+	else
+	{
+		w->closed = 1;
+		w->next = closed_windows;
+		closed_windows = w;
+		if (!w->pending)
+			window_complete(w);
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&mutex);
+}
+
+static void global_sample_updater(struct starpu_perf_counter_sample *sample, void *context)
+{
+	STARPU_ASSERT(context == NULL); /* no context for the global updater */
+	(void)context;
+	double bound, current_bound = 0., current_elapsed = 0.;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&mutex);
+	bound = STARPU_MAX(last_area_bound, last_critical_path_bound);
+	if (current)
+	{
+		current_bound = window_bound(current);
+		current_elapsed = starpu_timing_now() - current->start_time;
+	}
+	_starpu_perf_counter_sample_set_int64_value(sample, __g_windows, nwindows);
+	_starpu_perf_counter_sample_set_double_value(sample, __g_area_bound, last_area_bound);
+	_starpu_perf_counter_sample_set_double_value(sample, __g_critical_path_bound, last_critical_path_bound);
+	_starpu_perf_counter_sample_set_double_value(sample, __g_achieved, last_achieved);
+	_starpu_perf_counter_sample_set_double_value(sample, __g_gap, last_achieved - bound);
+	_starpu_perf_counter_sample_set_double_value(sample, __g_efficiency, last_achieved > 0. ? bound / last_achieved : 0.);
+	_starpu_perf_counter_sample_set_double_value(sample, __g_current_bound, current_bound);
+	_starpu_perf_counter_sample_set_double_value(sample, __g_current_elapsed, current_elapsed);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&mutex);
+}
+
+void _starpu__online_bound_c__register_counters(void)
+{
+	{
+		const enum starpu_perf_counter_scope scope = starpu_perf_counter_scope_global;
+		__STARPU_PERF_COUNTER_REG("starpu.bound", scope, g_windows, int64, "number of task windows whose execution completed (with STARPU_ONLINE_BOUND)");
+		__STARPU_PERF_COUNTER_REG("starpu.bound", scope, g_area_bound, double, "area lower bound of the execution time of the last completed window (microseconds)");
+		__STARPU_PERF_COUNTER_REG("starpu.bound", scope, g_critical_path_bound, double, "critical path lower bound of the execution time of the last completed window (microseconds)");
+		__STARPU_PERF_COUNTER_REG("starpu.bound", scope, g_achieved, double, "achieved execution time of the last completed window (microseconds)");
+		__STARPU_PERF_COUNTER_REG("starpu.bound", scope, g_gap, double, "difference between the achieved execution time and the lower bound of the last completed window (microseconds)");
+		__STARPU_PERF_COUNTER_REG("starpu.bound", scope, g_efficiency, double, "ratio between the lower bound and the achieved execution time of the last completed window");
+		__STARPU_PERF_COUNTER_REG("starpu.bound", scope, g_current_bound, double, "lower bound of the execution time of the tasks submitted so far in the current window (microseconds)");
+		__STARPU_PERF_COUNTER_REG("starpu.bound", scope, g_current_elapsed, double, "time elapsed since the beginning of the current window (microseconds)");
+
+		_starpu_perf_counter_register_updater(scope, global_sample_updater);
+	}
+}
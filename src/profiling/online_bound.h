@@ -0,0 +1,54 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#ifndef __ONLINE_BOUND_H__
+#define __ONLINE_BOUND_H__
+
+/** @file */
+
+#include <starpu.h>
+#include <core/jobs.h>
+
+#pragma GCC visibility push(hidden)
+
+/** Are we estimating the bound online? Set with STARPU_ONLINE_BOUND */
+extern int _starpu_online_bound_enabled;
+
+void _starpu_online_bound_init(void);
+void _starpu_online_bound_shutdown(void);
+
+/** Record the submission of a task in the current window */
+void _starpu_online_bound_submit(struct _starpu_job *j);
+
+/** Record task dependency: j depends on dep_j */
+void _starpu_online_bound_task_dep(struct _starpu_job *j, struct _starpu_job *dep_j);
+
+/** Record the termination of a task */
+void _starpu_online_bound_terminated(struct _starpu_job *j);
+
+/** Forget about job j, which is being destroyed */
+void _starpu_online_bound_job_destroy(struct _starpu_job *j);
+
+/**
+   Close the current window and open a new one, called when entering or
+   leaving an outermost starpu_iteration_push() / starpu_iteration_pop()
+   section
+*/
+void _starpu_online_bound_new_window(void);
+
+#pragma GCC visibility pop
+
+#endif // __ONLINE_BOUND_H__
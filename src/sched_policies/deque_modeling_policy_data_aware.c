@@ -425,7 +425,21 @@ static int push_task_on_best_worker(struct starpu_task *task, int best_workerid,
 	return ret;
 }
 
-/* TODO: factorise CPU computations, expensive with a lot of cores */
+/* Predictions of a task for all the workers which share the same perf arch */
+struct arch_predictions
+{
+	struct starpu_perfmodel_arch *perf_arch;
+	/* Implementations for which the predictions were computed */
+	unsigned impl_mask;
+	double length[STARPU_MAXIMPLEMENTATIONS];
+	double energy[STARPU_MAXIMPLEMENTATIONS];
+};
+
+static int model_is_per_worker(struct starpu_perfmodel *model)
+{
+	return model && model->type == STARPU_PER_WORKER;
+}
+
 static void compute_all_performance_predictions(struct starpu_task *task,
 						unsigned nworkers,
 						double local_task_length[nworkers][STARPU_MAXIMPLEMENTATIONS],
@@ -458,6 +472,21 @@ static void compute_all_performance_predictions(struct starpu_task *task,
 	struct starpu_worker_collection *workers = starpu_sched_ctx_get_worker_collection(sched_ctx_id);
 	double now = starpu_timing_now();
 
+	/* Most workers share their perf arch and their memory node with other
+	 * workers, and then get the same predictions, so only compute them
+	 * once per distinct arch and per memory node. This is not possible
+	 * for per-worker models, and for codelets which choose the nodes of
+	 * their data depending on the worker. */
+	int share_arch = !bundle && !(task->cl && (model_is_per_worker(task->cl->model) || model_is_per_worker(task->cl->energy_model)));
+	int share_node = !bundle && !(task->cl && task->cl->specific_nodes);
+	struct arch_predictions arch_predictions[nworkers];
+	unsigned narchs = 0;
+	double node_penalty[STARPU_MAXNODES];
+	char node_penalty_set[STARPU_MAXNODES];
+
+	if (share_node && local_data_penalty)
+		memset(node_penalty_set, 0, sizeof(node_penalty_set));
+
 	struct starpu_sched_ctx_iterator it;
 	workers->init_iterator_for_parallel_tasks(workers, &it, task);
 	while(worker_current<nworkers && workers->has_next(workers, &it))
@@ -468,6 +497,7 @@ static void compute_all_performance_predictions(struct starpu_task *task,
 		struct starpu_st_fifo_taskq *fifo = &dt->queue_array[workerid];
 		struct starpu_perfmodel_arch* perf_arch = starpu_worker_get_perf_archtype(workerid, sched_ctx_id);
 		unsigned memory_node = starpu_worker_get_memory_node(workerid);
+		struct arch_predictions *predictions = NULL;
 
 		STARPU_ASSERT_MSG(fifo != NULL, "workerid %u ctx %u\n", workerid, sched_ctx_id);
 
@@ -477,6 +507,29 @@ static void compute_all_performance_predictions(struct starpu_task *task,
 		if (!starpu_worker_can_execute_task_impl(workerid, task, &impl_mask))
 			continue;
 
+		if (share_arch)
+		{
+			unsigned i;
+			for (i = 0; i < narchs; i++)
+				if (_starpu_perfmodel_arch_equal(arch_predictions[i].perf_arch, perf_arch))
+				{
+					predictions = &arch_predictions[i];
+					break;
+				}
+			if (!predictions)
+			{
+				predictions = &arch_predictions[narchs++];
+				predictions->perf_arch = perf_arch;
+				predictions->impl_mask = 0;
+			}
+		}
+
+		if (local_data_penalty && share_node && !node_penalty_set[memory_node])
+		{
+			node_penalty[memory_node] = starpu_task_expected_data_transfer_time_for(task, workerid);
+			node_penalty_set[memory_node] = 1;
+		}
+
 		for (nimpl  = 0; nimpl < STARPU_MAXIMPLEMENTATIONS; nimpl++)
 		{
 			if (!(impl_mask & (1U << nimpl)))
@@ -520,16 +573,33 @@ static void compute_all_performance_predictions(struct starpu_task *task,
 					local_energy[worker_current][nimpl] = starpu_task_bundle_expected_energy(bundle, perf_arch,nimpl);
 
 			}
+			else if (predictions && (predictions->impl_mask & (1U << nimpl)))
+			{
+				/* Already computed for another worker with the same arch */
+				local_task_length[worker_current][nimpl] = predictions->length[nimpl];
+				if (local_data_penalty)
+					local_data_penalty[worker_current][nimpl] = share_node ? node_penalty[memory_node] : starpu_task_expected_data_transfer_time_for(task, workerid);
+				if (local_energy)
+					local_energy[worker_current][nimpl] = predictions->energy[nimpl];
+			}
 			else
 			{
 				local_task_length[worker_current][nimpl] = starpu_task_worker_expected_length(task, workerid, sched_ctx_id, nimpl);
 				if (local_data_penalty)
-					local_data_penalty[worker_current][nimpl] = starpu_task_expected_data_transfer_time_for(task, workerid);
+					local_data_penalty[worker_current][nimpl] = share_node ? node_penalty[memory_node] : starpu_task_expected_data_transfer_time_for(task, workerid);
 				if (local_energy)
 					local_energy[worker_current][nimpl] = starpu_task_worker_expected_energy(task, workerid, sched_ctx_id,nimpl);
 				double conversion_time = starpu_task_expected_conversion_time(task, perf_arch, nimpl);
 				if (conversion_time > 0.0)
 					local_task_length[worker_current][nimpl] += conversion_time;
+
+				if (predictions)
+				{
+					predictions->length[nimpl] = local_task_length[worker_current][nimpl];
+					if (local_energy)
+						predictions->energy[nimpl] = local_energy[worker_current][nimpl];
+					predictions->impl_mask |= 1U << nimpl;
+				}
 			}
 			double ntasks_end = fifo_ntasks / starpu_worker_get_relative_speedup(perf_arch);
 
@@ -59,17 +59,15 @@ static void deinitialize_eager_center_policy(unsigned sched_ctx_id)
 	free(data);
 }
 
-static int push_task_eager_policy(struct starpu_task *task)
+/* Queue the task in fifo, and note in dowake which workers could be woken up
+ * to execute it. The mutex protecting fifo and waiters must be held. */
+static void eager_queue_task_locked(struct starpu_st_fifo_taskq *fifo, struct starpu_bitmap *waiters STARPU_ATTRIBUTE_UNUSED, struct starpu_worker_collection *workers, struct starpu_task *task, char *dowake STARPU_ATTRIBUTE_UNUSED)
 {
 	unsigned sched_ctx_id = task->sched_ctx;
-	struct _starpu_eager_center_policy_data *data = (struct _starpu_eager_center_policy_data*)starpu_sched_ctx_get_policy_data(sched_ctx_id);
 
-	starpu_worker_relax_on();
-	STARPU_PTHREAD_MUTEX_LOCK(&data->policy_mutex);
-	starpu_worker_relax_off();
-	starpu_task_list_push_back(&data->fifo.taskq,task);
-	data->fifo.ntasks++;
-	data->fifo.nprocessed++;
+	starpu_task_list_push_back(&fifo->taskq,task);
+	fifo->ntasks++;
+	fifo->nprocessed++;
 
 	if (_starpu_get_nsched_ctxs() > 1)
 	{
@@ -84,12 +82,7 @@ static int push_task_eager_policy(struct starpu_task *task)
 
 	/*if there are no tasks block */
 	/* wake people waiting for a task */
-	struct starpu_worker_collection *workers = starpu_sched_ctx_get_worker_collection(sched_ctx_id);
-
 	struct starpu_sched_ctx_iterator it;
-#ifndef STARPU_NON_BLOCKING_DRIVERS
-	char dowake[STARPU_NMAXWORKERS] = { 0 };
-#endif
 
 	workers->init_iterator_for_parallel_tasks(workers, &it, task);
 	while(workers->has_next(workers, &it))
@@ -97,7 +90,7 @@ static int push_task_eager_policy(struct starpu_task *task)
 		unsigned worker = workers->get_next(workers, &it);
 
 #ifdef STARPU_NON_BLOCKING_DRIVERS
-		if (!starpu_bitmap_get(&data->waiters, worker))
+		if (!waiters || !starpu_bitmap_get(waiters, worker))
 			/* This worker is not waiting for a task */
 			continue;
 #endif
@@ -106,7 +99,7 @@ static int push_task_eager_policy(struct starpu_task *task)
 		{
 			/* It can execute this one, tell him! */
 #ifdef STARPU_NON_BLOCKING_DRIVERS
-			starpu_bitmap_unset(&data->waiters, worker);
+			starpu_bitmap_unset(waiters, worker);
 			/* We really woke at least somebody, no need to wake somebody else */
 			break;
 #else
@@ -114,21 +107,69 @@ static int push_task_eager_policy(struct starpu_task *task)
 #endif
 		}
 	}
-	/* Let the task free */
-	STARPU_PTHREAD_MUTEX_UNLOCK(&data->policy_mutex);
+}
 
+/* Try to wake up to nwake of the workers noted in dowake */
+static void eager_wake_workers(struct starpu_worker_collection *workers STARPU_ATTRIBUTE_UNUSED, struct starpu_sched_ctx_iterator *it STARPU_ATTRIBUTE_UNUSED, char *dowake STARPU_ATTRIBUTE_UNUSED, unsigned nwake STARPU_ATTRIBUTE_UNUSED)
+{
 #if !defined(STARPU_NON_BLOCKING_DRIVERS) || defined(STARPU_SIMGRID)
-	/* Now that we have a list of potential workers, try to wake one */
-
-	workers->init_iterator_for_parallel_tasks(workers, &it, task);
-	while(workers->has_next(workers, &it))
+	/* Now that we have a list of potential workers, try to wake them */
+	while(workers->has_next(workers, it))
 	{
-		unsigned worker = workers->get_next(workers, &it);
+		unsigned worker = workers->get_next(workers, it);
 		if (dowake[worker])
-			if (starpu_wake_worker_relax_light(worker))
-				break; // wake up a single worker
+			if (starpu_wake_worker_relax_light(worker) && !--nwake)
+				break;
 	}
 #endif
+}
+
+static int push_task_eager_policy(struct starpu_task *task)
+{
+	unsigned sched_ctx_id = task->sched_ctx;
+	struct _starpu_eager_center_policy_data *data = (struct _starpu_eager_center_policy_data*)starpu_sched_ctx_get_policy_data(sched_ctx_id);
+	struct starpu_worker_collection *workers = starpu_sched_ctx_get_worker_collection(sched_ctx_id);
+	struct starpu_sched_ctx_iterator it;
+	char dowake[STARPU_NMAXWORKERS] = { 0 };
+
+	starpu_worker_relax_on();
+	STARPU_PTHREAD_MUTEX_LOCK(&data->policy_mutex);
+	starpu_worker_relax_off();
+	eager_queue_task_locked(&data->fifo, &data->waiters, workers, task, dowake);
+	/* Let the task free */
+	STARPU_PTHREAD_MUTEX_UNLOCK(&data->policy_mutex);
+
+	/* Wake a single worker */
+	workers->init_iterator_for_parallel_tasks(workers, &it, task);
+	eager_wake_workers(workers, &it, dowake, 1);
+
+	return 0;
+}
+
+static int push_tasks_eager_policy(struct starpu_task_list *tasks)
+{
+	unsigned sched_ctx_id = starpu_task_list_front(tasks)->sched_ctx;
+	struct _starpu_eager_center_policy_data *data = (struct _starpu_eager_center_policy_data*)starpu_sched_ctx_get_policy_data(sched_ctx_id);
+	struct starpu_worker_collection *workers = starpu_sched_ctx_get_worker_collection(sched_ctx_id);
+	struct starpu_sched_ctx_iterator it;
+	char dowake[STARPU_NMAXWORKERS] = { 0 };
+	unsigned ntasks = 0;
+
+	/* Queue all the tasks with only one lock acquisition */
+	starpu_worker_relax_on();
+	STARPU_PTHREAD_MUTEX_LOCK(&data->policy_mutex);
+	starpu_worker_relax_off();
+	while (!starpu_task_list_empty(tasks))
+	{
+		eager_queue_task_locked(&data->fifo, &data->waiters, workers, starpu_task_list_pop_front(tasks), dowake);
+		ntasks++;
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&data->policy_mutex);
+
+	/* Wake as many workers as there are tasks. The tasks may be gone
+	 * already, so do not use them to iterate */
+	workers->init_iterator(workers, &it);
+	eager_wake_workers(workers, &it, dowake, ntasks);
 
 	return 0;
 }
@@ -201,6 +242,7 @@ struct starpu_sched_policy _starpu_sched_eager_policy =
 	.add_workers = eager_add_workers,
 	.remove_workers = NULL,
 	.push_task = push_task_eager_policy,
+	.push_tasks = push_tasks_eager_policy,
 	.pop_task = pop_task_eager_policy,
 	.pre_exec_hook = NULL,
 	.post_exec_hook = NULL,
@@ -208,3 +250,199 @@ struct starpu_sched_policy _starpu_sched_eager_policy =
 	.policy_description = "eager policy with a central queue",
 	.worker_type = STARPU_WORKER_LIST,
 };
+
+/*
+ *	Variant with one central queue per NUMA node, so that the queues
+ *	and their mutex do not bounce between sockets. Workers pop from the
+ *	queue of their NUMA node first, and look at the other queues only
+ *	when it is empty.
+ */
+
+struct _starpu_eager_numa_shard
+{
+	struct starpu_st_fifo_taskq fifo;
+	starpu_pthread_mutex_t mutex;
+	char fill[STARPU_CACHELINE_SIZE];
+};
+
+struct _starpu_eager_numa_policy_data
+{
+	unsigned nshards;
+	struct _starpu_eager_numa_shard *shards;
+	/* Shard from which each worker pops first */
+	unsigned worker_shard[STARPU_NMAXWORKERS];
+	/* Round-robin for the tasks pushed by non-workers */
+	unsigned next_shard;
+};
+
+static void initialize_eager_numa_policy(unsigned sched_ctx_id)
+{
+	struct _starpu_eager_numa_policy_data *data;
+	unsigned i;
+
+	_STARPU_CALLOC(data, 1, sizeof(*data));
+	data->nshards = starpu_memory_nodes_get_numa_count();
+	if (!data->nshards)
+		data->nshards = 1;
+	_STARPU_MALLOC(data->shards, data->nshards * sizeof(data->shards[0]));
+	for (i = 0; i < data->nshards; i++)
+	{
+		starpu_st_fifo_taskq_init(&data->shards[i].fifo);
+		STARPU_PTHREAD_MUTEX_INIT(&data->shards[i].mutex, NULL);
+	}
+	STARPU_HG_DISABLE_CHECKING(data->next_shard);
+
+	starpu_sched_ctx_set_policy_data(sched_ctx_id, (void*)data);
+}
+
+static void deinitialize_eager_numa_policy(unsigned sched_ctx_id)
+{
+	struct _starpu_eager_numa_policy_data *data = (struct _starpu_eager_numa_policy_data*)starpu_sched_ctx_get_policy_data(sched_ctx_id);
+	unsigned i;
+
+	for (i = 0; i < data->nshards; i++)
+	{
+		STARPU_ASSERT(starpu_task_list_empty(&data->shards[i].fifo.taskq));
+		STARPU_PTHREAD_MUTEX_DESTROY(&data->shards[i].mutex);
+	}
+	free(data->shards);
+	free(data);
+}
+
+/* The shard of the NUMA node of the worker. Accelerators are attached to the
+ * first one */
+static unsigned eager_numa_worker_shard(struct _starpu_eager_numa_policy_data *data, int workerid)
+{
+	unsigned node = starpu_worker_get_memory_node(workerid);
+
+	if (starpu_node_get_kind(node) == STARPU_CPU_RAM)
+	{
+		unsigned numa = starpu_memory_node_get_devid(node);
+		if (numa < data->nshards)
+			return numa;
+	}
+	return 0;
+}
+
+/* Tasks pushed by a worker are probably using data it has just produced, keep
+ * them on its NUMA node. Spread the others. */
+static unsigned eager_numa_task_shard(struct _starpu_eager_numa_policy_data *data, struct starpu_task *task)
+{
+	int workerid = starpu_worker_get_id();
+
+	if (workerid >= 0 && starpu_sched_ctx_contains_worker(workerid, task->sched_ctx))
+		return data->worker_shard[workerid];
+	if (data->nshards == 1)
+		return 0;
+	return STARPU_ATOMIC_ADD(&data->next_shard, 1) % data->nshards;
+}
+
+/* Try to wake up to nwake of the workers noted in dowake, starting with those
+ * of shard */
+static void eager_numa_wake_workers(struct _starpu_eager_numa_policy_data *data STARPU_ATTRIBUTE_UNUSED, struct starpu_worker_collection *workers STARPU_ATTRIBUTE_UNUSED, char *dowake STARPU_ATTRIBUTE_UNUSED, unsigned shard STARPU_ATTRIBUTE_UNUSED, unsigned nwake STARPU_ATTRIBUTE_UNUSED)
+{
+#if !defined(STARPU_NON_BLOCKING_DRIVERS) || defined(STARPU_SIMGRID)
+	struct starpu_sched_ctx_iterator it;
+	int local;
+
+	for (local = 1; local >= 0; local--)
+	{
+		workers->init_iterator(workers, &it);
+		while(workers->has_next(workers, &it))
+		{
+			unsigned worker = workers->get_next(workers, &it);
+			if (dowake[worker] && (data->worker_shard[worker] == shard) == local)
+				if (starpu_wake_worker_relax_light(worker) && !--nwake)
+					return;
+		}
+	}
+#endif
+}
+
+static int push_task_eager_numa_policy(struct starpu_task *task)
+{
+	unsigned sched_ctx_id = task->sched_ctx;
+	struct _starpu_eager_numa_policy_data *data = (struct _starpu_eager_numa_policy_data*)starpu_sched_ctx_get_policy_data(sched_ctx_id);
+	struct starpu_worker_collection *workers = starpu_sched_ctx_get_worker_collection(sched_ctx_id);
+	char dowake[STARPU_NMAXWORKERS] = { 0 };
+	unsigned shard = eager_numa_task_shard(data, task);
+
+	starpu_worker_relax_on();
+	STARPU_PTHREAD_MUTEX_LOCK(&data->shards[shard].mutex);
+	starpu_worker_relax_off();
+	/* Idle workers poll the shards, there is no waiters bitmap */
+	eager_queue_task_locked(&data->shards[shard].fifo, NULL, workers, task, dowake);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&data->shards[shard].mutex);
+
+	/* Wake a single worker, preferably on the same NUMA node */
+	eager_numa_wake_workers(data, workers, dowake, shard, 1);
+
+	return 0;
+}
+
+static struct starpu_task *pop_task_eager_numa_policy(unsigned sched_ctx_id)
+{
+	struct starpu_task *chosen_task = NULL;
+	unsigned workerid = starpu_worker_get_id_check();
+	struct _starpu_eager_numa_policy_data *data = (struct _starpu_eager_numa_policy_data*)starpu_sched_ctx_get_policy_data(sched_ctx_id);
+	unsigned local = data->worker_shard[workerid];
+	unsigned i;
+
+	/* Our NUMA node first, then the others */
+	for (i = 0; i < data->nshards && !chosen_task; i++)
+	{
+		struct _starpu_eager_numa_shard *shard = &data->shards[(local + i) % data->nshards];
+
+		/* Here helgrind would shout that this is unprotected, this is
+		 * just an integer access, and we hold the sched mutex, so we
+		 * can not miss any wake up. */
+		if (!STARPU_RUNNING_ON_VALGRIND && starpu_st_fifo_taskq_empty(&shard->fifo))
+			continue;
+
+		starpu_worker_relax_on();
+		STARPU_PTHREAD_MUTEX_LOCK(&shard->mutex);
+		starpu_worker_relax_off();
+		chosen_task = starpu_st_fifo_taskq_pop_task(&shard->fifo, workerid);
+		STARPU_PTHREAD_MUTEX_UNLOCK(&shard->mutex);
+	}
+
+	if(chosen_task &&_starpu_get_nsched_ctxs() > 1)
+	{
+		starpu_worker_relax_on();
+		_starpu_sched_ctx_lock_write(sched_ctx_id);
+		starpu_worker_relax_off();
+		starpu_sched_ctx_list_task_counters_decrement_all_ctx_locked(chosen_task, sched_ctx_id);
+
+		if (_starpu_sched_ctx_worker_is_master_for_child_ctx(sched_ctx_id, workerid, chosen_task))
+			chosen_task = NULL;
+		_starpu_sched_ctx_unlock_write(sched_ctx_id);
+	}
+
+	return chosen_task;
+}
+
+static void eager_numa_add_workers(unsigned sched_ctx_id, int *workerids, unsigned nworkers)
+{
+	struct _starpu_eager_numa_policy_data *data = (struct _starpu_eager_numa_policy_data*)starpu_sched_ctx_get_policy_data(sched_ctx_id);
+	unsigned i;
+
+	for (i = 0; i < nworkers; i++)
+		data->worker_shard[workerids[i]] = eager_numa_worker_shard(data, workerids[i]);
+
+	eager_add_workers(sched_ctx_id, workerids, nworkers);
+}
+
+struct starpu_sched_policy _starpu_sched_eager_numa_policy =
+{
+	.init_sched = initialize_eager_numa_policy,
+	.deinit_sched = deinitialize_eager_numa_policy,
+	.add_workers = eager_numa_add_workers,
+	.remove_workers = NULL,
+	.push_task = push_task_eager_numa_policy,
+	.pop_task = pop_task_eager_numa_policy,
+	.pre_exec_hook = NULL,
+	.post_exec_hook = NULL,
+	.policy_name = "eager-numa",
+	.policy_description = "eager policy with a central queue per NUMA node",
+	.worker_type = STARPU_WORKER_LIST,
+};
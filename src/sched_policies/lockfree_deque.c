@@ -0,0 +1,177 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+/*
+ * Chase-Lev work-stealing deque, as described in "Dynamic Circular
+ * Work-Stealing Deque" (Chase, Lev, SPAA'05), with the memory barriers
+ * from "Correct and Efficient Work-Stealing for Weak Memory Models" (Lê
+ * et al., PPoPP'13).
+ */
+
+#include <starpu.h>
+#include <common/utils.h>
+#include <sched_policies/lockfree_deque.h>
+
+#define LOCKFREE_DEQUE_INITIAL_SIZE 256
+
+static struct _starpu_lockfree_deque_array *_starpu_lockfree_deque_array_create(int64_t size)
+{
+	struct _starpu_lockfree_deque_array *array;
+	_STARPU_MALLOC(array, sizeof(*array) + size * sizeof(array->tasks[0]));
+	array->prev = NULL;
+	array->mask = size - 1;
+	return array;
+}
+
+void _starpu_lockfree_deque_init(struct _starpu_lockfree_deque *deque)
+{
+	memset(deque, 0, sizeof(*deque));
+	deque->array = _starpu_lockfree_deque_array_create(LOCKFREE_DEQUE_INITIAL_SIZE);
+	/* Thieves and the owner race on these on purpose */
+	STARPU_HG_DISABLE_CHECKING(deque->top);
+	STARPU_HG_DISABLE_CHECKING(deque->bottom);
+	STARPU_HG_DISABLE_CHECKING(deque->array);
+	STARPU_HG_DISABLE_CHECKING(deque->inbox);
+}
+
+void _starpu_lockfree_deque_destroy(struct _starpu_lockfree_deque *deque)
+{
+	struct _starpu_lockfree_deque_array *array = deque->array;
+	while (array)
+	{
+		struct _starpu_lockfree_deque_array *prev = array->prev;
+		free(array);
+		array = prev;
+	}
+	deque->array = NULL;
+}
+
+/* The array is full, double its size. Only the owner can do this */
+static struct _starpu_lockfree_deque_array *_starpu_lockfree_deque_grow(struct _starpu_lockfree_deque *deque, struct _starpu_lockfree_deque_array *array, int64_t top, int64_t bottom)
+{
+	struct _starpu_lockfree_deque_array *new_array = _starpu_lockfree_deque_array_create(2 * (array->mask + 1));
+	int64_t i;
+
+	for (i = top; i < bottom; i++)
+		new_array->tasks[i & new_array->mask] = array->tasks[i & array->mask];
+	new_array->prev = array;
+
+	/* Make the content visible before the array */
+	STARPU_WMB();
+	deque->array = new_array;
+	return new_array;
+}
+
+void _starpu_lockfree_deque_push(struct _starpu_lockfree_deque *deque, struct starpu_task *task)
+{
+	int64_t bottom = deque->bottom;
+	int64_t top = deque->top;
+	struct _starpu_lockfree_deque_array *array = deque->array;
+
+	if (bottom - top > array->mask)
+		array = _starpu_lockfree_deque_grow(deque, array, top, bottom);
+
+	array->tasks[bottom & array->mask] = task;
+	/* Make the task visible before thieves can see it */
+	STARPU_WMB();
+	deque->bottom = bottom + 1;
+}
+
+struct starpu_task *_starpu_lockfree_deque_pop(struct _starpu_lockfree_deque *deque)
+{
+	int64_t bottom = deque->bottom - 1;
+	struct _starpu_lockfree_deque_array *array = deque->array;
+	struct starpu_task *task;
+	int64_t top;
+
+	deque->bottom = bottom;
+	/* Thieves have to see the new bottom before we look at top */
+	STARPU_SYNCHRONIZE();
+	top = deque->top;
+
+	if (top > bottom)
+	{
+		/* Empty */
+		deque->bottom = bottom + 1;
+		return NULL;
+	}
+
+	task = array->tasks[bottom & array->mask];
+	if (top == bottom)
+	{
+		/* Last task, race with the thieves */
+		if (!STARPU_BOOL_COMPARE_AND_SWAP64((uint64_t *) &deque->top, (uint64_t) top, (uint64_t) (top + 1)))
+			/* Lost */
+			task = NULL;
+		deque->bottom = bottom + 1;
+	}
+	return task;
+}
+
+struct starpu_task *_starpu_lockfree_deque_steal(struct _starpu_lockfree_deque *deque)
+{
+	int64_t top = deque->top;
+	/* Read top before bottom */
+	STARPU_SYNCHRONIZE();
+	int64_t bottom = deque->bottom;
+
+	if (top >= bottom)
+		return NULL;
+
+	STARPU_RMB();
+	struct _starpu_lockfree_deque_array *array = deque->array;
+	STARPU_RMB();
+	struct starpu_task *task = array->tasks[top & array->mask];
+	if (!STARPU_BOOL_COMPARE_AND_SWAP64((uint64_t *) &deque->top, (uint64_t) top, (uint64_t) (top + 1)))
+		/* Somebody else got it */
+		return NULL;
+	return task;
+}
+
+void _starpu_lockfree_deque_push_inbox(struct _starpu_lockfree_deque *deque, struct starpu_task *task)
+{
+	struct starpu_task *head;
+	do
+	{
+		head = deque->inbox;
+		task->next = head;
+	}
+	while (!STARPU_BOOL_COMPARE_AND_SWAP_PTR(&deque->inbox, head, task));
+}
+
+struct starpu_task *_starpu_lockfree_deque_take_inbox(struct _starpu_lockfree_deque *deque)
+{
+	struct starpu_task *head, *first = NULL;
+
+	/* We only ever take the whole stack, so there is no ABA issue */
+	do
+	{
+		head = deque->inbox;
+		if (!head)
+			return NULL;
+	}
+	while (!STARPU_BOOL_COMPARE_AND_SWAP_PTR(&deque->inbox, head, NULL));
+
+	/* Reverse it to get the submission order */
+	while (head)
+	{
+		struct starpu_task *next = head->next;
+		head->next = first;
+		first = head;
+		head = next;
+	}
+	return first;
+}
@@ -0,0 +1,97 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#ifndef __LOCKFREE_DEQUE_H__
+#define __LOCKFREE_DEQUE_H__
+
+#include <stdint.h>
+#include <starpu_util.h>
+
+/** @file */
+
+#pragma GCC visibility push(hidden)
+
+struct starpu_task;
+
+/** Circular array of a lock-free deque */
+struct _starpu_lockfree_deque_array
+{
+	/** Previous (smaller) array, kept until the deque is destroyed since
+	 * thieves may still be reading from it */
+	struct _starpu_lockfree_deque_array *prev;
+	int64_t mask;
+	struct starpu_task *tasks[];
+};
+
+/**
+ * Chase-Lev work-stealing deque.
+ *
+ * Only the owner thread may push and pop, at the bottom. Other threads may
+ * steal concurrently at the top, without taking any lock. Task priorities
+ * are not taken into account.
+ *
+ * Other threads can not push to the deque itself, they push to the inbox
+ * stack instead, which is taken as a whole, either by the owner to fill
+ * the deque, or by a thief.
+ */
+struct _starpu_lockfree_deque
+{
+	/** Next task to be stolen, only ever incremented */
+	volatile int64_t top;
+	char fill1[STARPU_CACHELINE_SIZE];
+	/** Next free slot, only modified by the owner */
+	volatile int64_t bottom;
+	struct _starpu_lockfree_deque_array * volatile array;
+	char fill2[STARPU_CACHELINE_SIZE];
+	/** Tasks pushed by other threads, chained through starpu_task::next,
+	 * the last pushed first */
+	struct starpu_task * volatile inbox;
+	char fill3[STARPU_CACHELINE_SIZE];
+};
+
+void _starpu_lockfree_deque_init(struct _starpu_lockfree_deque *deque);
+void _starpu_lockfree_deque_destroy(struct _starpu_lockfree_deque *deque);
+
+/** Push a task at the bottom, only for the owner */
+void _starpu_lockfree_deque_push(struct _starpu_lockfree_deque *deque, struct starpu_task *task);
+/** Pop the last pushed task, only for the owner */
+struct starpu_task *_starpu_lockfree_deque_pop(struct _starpu_lockfree_deque *deque);
+/** Steal the oldest task, for any thread. Returns NULL if the deque was
+ * empty, or if another thread won the race for the task */
+struct starpu_task *_starpu_lockfree_deque_steal(struct _starpu_lockfree_deque *deque);
+
+/** Push a task to the inbox, for any thread */
+void _starpu_lockfree_deque_push_inbox(struct _starpu_lockfree_deque *deque, struct starpu_task *task);
+/** Take all the tasks of the inbox, for any thread. They are returned
+ * chained through starpu_task::next, the first pushed first */
+struct starpu_task *_starpu_lockfree_deque_take_inbox(struct _starpu_lockfree_deque *deque);
+
+/** Estimation of the number of tasks in the deque, not counting the inbox */
+static inline int64_t _starpu_lockfree_deque_size(struct _starpu_lockfree_deque *deque)
+{
+	int64_t size = deque->bottom - deque->top;
+	return size < 0 ? 0 : size;
+}
+
+/** Whether both the deque and its inbox are empty. This is only an estimation */
+static inline int _starpu_lockfree_deque_is_empty(struct _starpu_lockfree_deque *deque)
+{
+	return deque->bottom <= deque->top && !deque->inbox;
+}
+
+#pragma GCC visibility pop
+
+#endif /* __LOCKFREE_DEQUE_H__ */
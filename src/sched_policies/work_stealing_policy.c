@@ -28,6 +28,7 @@
 #include <core/debug.h>
 #include <core/task.h>
 #include <sched_policies/prio_deque.h>
+#include <sched_policies/lockfree_deque.h>
 
 /* Experimental (dead) code which needs to be tested, fixed... */
 /* #define USE_OVERLOAD */
@@ -80,6 +81,9 @@ struct _starpu_work_stealing_data_per_worker
 	char fill2[STARPU_CACHELINE_SIZE];
 
 	struct starpu_st_prio_deque queue;
+	/* Used instead of queue with STARPU_WS_LOCKFREE_DEQUES, so that
+	 * neither pushing nor stealing needs the worker lock */
+	struct _starpu_lockfree_deque lockfree_queue;
 	int running;
 	int *proxlist;
 	int busy;	/* Whether this worker is working on a task */
@@ -109,8 +113,18 @@ struct _starpu_work_stealing_data
 	 * better decisions about which queue to select when deferring work
 	 */
 	unsigned last_push_worker;
+	/* Whether to use lockfree_queue instead of queue */
+	int lockfree;
 };
 
+/* Whether the worker may have tasks to be stolen. This is only an estimation */
+static inline int ws_worker_has_tasks(struct _starpu_work_stealing_data *ws, int workerid)
+{
+	if (ws->lockfree)
+		return !_starpu_lockfree_deque_is_empty(&ws->per_worker[workerid].lockfree_queue);
+	return !ws->per_worker[workerid].notask;
+}
+
 #ifdef USE_OVERLOAD
 
 /**
@@ -144,7 +158,7 @@ static int select_victim_round_robin(struct _starpu_work_stealing_data *ws, unsi
 		/* Here helgrind would shout that this is unprotected, but we
 		 * are fine with getting outdated values, this is just an
 		 * estimation */
-		if (!ws->per_worker[workerids[worker]].notask)
+		if (ws_worker_has_tasks(ws, workerids[worker]))
 		{
 			if (ws->per_worker[workerids[worker]].busy
 			    || starpu_worker_is_blocked_in_parallel(workerids[worker]))
@@ -560,6 +574,117 @@ static inline unsigned select_worker(struct _starpu_work_stealing_data *ws, stru
 }
 
 
+/* Pop a task from our own lock-free queue, refilling it from its inbox if needed */
+static struct starpu_task *ws_pop_lockfree(struct _starpu_work_stealing_data *ws, int workerid)
+{
+	struct _starpu_lockfree_deque *deque = &ws->per_worker[workerid].lockfree_queue;
+	struct starpu_task *task, *next;
+
+	task = _starpu_lockfree_deque_pop(deque);
+	if (task)
+		return task;
+
+	task = _starpu_lockfree_deque_take_inbox(deque);
+	if (!task)
+		return NULL;
+
+	/* Keep the oldest one, and make the others available to thieves */
+	for (next = task->next; next; )
+	{
+		struct starpu_task *cur = next;
+		next = cur->next;
+		cur->next = NULL;
+		_starpu_lockfree_deque_push(deque, cur);
+	}
+	task->next = NULL;
+	return task;
+}
+
+/* Move the accounting of a stolen task from victim to workerid */
+static void ws_steal_task_counters(unsigned sched_ctx_id, int victim, int workerid, int keep)
+{
+	if (_starpu_get_nsched_ctxs() <= 1)
+		return;
+
+	/* These are protected by the worker lock */
+	starpu_worker_lock(victim);
+	starpu_sched_ctx_list_task_counters_decrement(sched_ctx_id, victim);
+	starpu_worker_unlock(victim);
+	if (keep)
+		starpu_sched_ctx_list_task_counters_increment(sched_ctx_id, workerid);
+}
+
+/* Steal a task from the lock-free queue of victim, for execution on workerid.
+ * If the queue is empty, take the whole inbox of victim instead, and
+ * keep the tasks that we did not choose in our own queue. */
+static struct starpu_task *ws_steal_lockfree(struct _starpu_work_stealing_data *ws, unsigned sched_ctx_id, int victim, int workerid)
+{
+	struct _starpu_lockfree_deque *victim_deque = &ws->per_worker[victim].lockfree_queue;
+	struct starpu_task *task, *list;
+	int giveback = 0;
+
+	if (!ws->per_worker[victim].running)
+		return NULL;
+
+	task = _starpu_lockfree_deque_steal(victim_deque);
+	if (task)
+		list = NULL;
+	else
+	{
+		list = _starpu_lockfree_deque_take_inbox(victim_deque);
+		if (!list)
+			return NULL;
+		task = list;
+		list = list->next;
+		task->next = NULL;
+	}
+
+	if (!starpu_worker_can_execute_task_first_impl(workerid, task, NULL))
+	{
+		/* We can not run it, give it back to victim */
+		_starpu_lockfree_deque_push_inbox(victim_deque, task);
+		task = NULL;
+		giveback = 1;
+	}
+
+	while (list)
+	{
+		struct starpu_task *cur = list;
+		list = cur->next;
+		cur->next = NULL;
+		if (!starpu_worker_can_execute_task_first_impl(workerid, cur, NULL))
+		{
+			_starpu_lockfree_deque_push_inbox(victim_deque, cur);
+			giveback = 1;
+		}
+		else if (!task)
+			task = cur;
+		else
+		{
+			record_data_locality(cur, workerid);
+			_starpu_lockfree_deque_push(&ws->per_worker[workerid].lockfree_queue, cur);
+			ws_steal_task_counters(sched_ctx_id, victim, workerid, 1);
+		}
+	}
+
+#if !defined(STARPU_NON_BLOCKING_DRIVERS) || defined(STARPU_SIMGRID)
+	if (giveback)
+		/* It may have gone to sleep meanwhile */
+		starpu_wake_worker_relax_light(victim);
+#else
+	(void) giveback;
+#endif
+
+	if (task)
+	{
+		_STARPU_TRACE_WORK_STEALING(workerid, victim);
+		starpu_sched_task_break(task);
+		ws_steal_task_counters(sched_ctx_id, victim, workerid, 0);
+		record_data_locality(task, workerid);
+	}
+	return task;
+}
+
 /* Note: this is not scalable work stealing,  use lws instead */
 static struct starpu_task *ws_pop_task(unsigned sched_ctx_id)
 {
@@ -571,6 +696,9 @@ static struct starpu_task *ws_pop_task(unsigned sched_ctx_id)
 	if (ws->per_worker[workerid].busy)
 		ws->per_worker[workerid].busy = 0;
 
+	if (ws->lockfree)
+		task = ws_pop_lockfree(ws, workerid);
+	else
 #ifdef STARPU_NON_BLOCKING_DRIVERS
 	if (STARPU_RUNNING_ON_VALGRIND || !starpu_st_prio_deque_is_empty(&ws->per_worker[workerid].queue))
 #endif
@@ -606,31 +734,36 @@ static struct starpu_task *ws_pop_task(unsigned sched_ctx_id)
 		return NULL;
 	}
 
-	if (_starpu_worker_trylock(victim))
+	if (ws->lockfree)
+		task = ws_steal_lockfree(ws, sched_ctx_id, victim, workerid);
+	else
 	{
-		/* victim is busy, don't bother it, come back later */
+		if (_starpu_worker_trylock(victim))
+		{
+			/* victim is busy, don't bother it, come back later */
 #ifdef STARPU_SIMGRID
-		starpu_sleep(0.000001);
-		/* Make sure we come back and not block */
-		starpu_wake_worker_no_relax(workerid);
+			starpu_sleep(0.000001);
+			/* Make sure we come back and not block */
+			starpu_wake_worker_no_relax(workerid);
 #endif
-		return NULL;
-	}
-	if (ws->per_worker[victim].running && ws->per_worker[victim].queue.ntasks > 0)
-	{
-		task = ws_pick_task(ws, victim, workerid);
-	}
+			return NULL;
+		}
+		if (ws->per_worker[victim].running && ws->per_worker[victim].queue.ntasks > 0)
+		{
+			task = ws_pick_task(ws, victim, workerid);
+		}
 
-	if (task)
-	{
-		_STARPU_TRACE_WORK_STEALING(workerid, victim);
-		starpu_sched_task_break(task);
-		starpu_sched_ctx_list_task_counters_decrement(sched_ctx_id, victim);
-		record_data_locality(task, workerid);
-		record_worker_locality(ws, task, workerid, sched_ctx_id);
-		locality_popped_task(ws, task, victim, sched_ctx_id);
+		if (task)
+		{
+			_STARPU_TRACE_WORK_STEALING(workerid, victim);
+			starpu_sched_task_break(task);
+			starpu_sched_ctx_list_task_counters_decrement(sched_ctx_id, victim);
+			record_data_locality(task, workerid);
+			record_worker_locality(ws, task, workerid, sched_ctx_id);
+			locality_popped_task(ws, task, victim, sched_ctx_id);
+		}
+		starpu_worker_unlock(victim);
 	}
-	starpu_worker_unlock(victim);
 
 #ifndef STARPU_NON_BLOCKING_DRIVERS
 	/* While stealing, perhaps somebody actually give us a task, don't miss
@@ -639,7 +772,10 @@ static struct starpu_task *ws_pop_task(unsigned sched_ctx_id)
 		struct _starpu_worker *worker = _starpu_get_worker_struct(starpu_worker_get_id());
 		if (!task && worker->state_keep_awake)
 		{
-			task = ws_pick_task(ws, workerid, workerid);
+			if (ws->lockfree)
+				task = ws_pop_lockfree(ws, workerid);
+			else
+				task = ws_pick_task(ws, workerid, workerid);
 			if (task)
 			{
 				/* keep_awake notice taken into account here, clear flag */
@@ -687,21 +823,38 @@ int ws_push_task(struct starpu_task *task)
 	if (workerid == -1 || !starpu_sched_ctx_contains_worker(workerid, sched_ctx_id) ||
 			!starpu_worker_can_execute_task_first_impl(workerid, task, NULL))
 		workerid = select_worker(ws, task, sched_ctx_id);
-	starpu_worker_lock(workerid);
-	STARPU_AYU_ADDTOTASKQUEUE(starpu_task_get_job_id(task), workerid);
-	starpu_sched_task_break(task);
-	record_data_locality(task, workerid);
-	STARPU_ASSERT_MSG(ws->per_worker[workerid].running, "workerid=%d, ws=%p\n", workerid, ws);
-	starpu_st_prio_deque_push_back_task(&ws->per_worker[workerid].queue, task);
-	if (ws->per_worker[workerid].queue.ntasks == 1)
+
+	if (ws->lockfree)
 	{
-		STARPU_ASSERT(ws->per_worker[workerid].notask == 1);
-		ws->per_worker[workerid].notask = 0;
+		STARPU_AYU_ADDTOTASKQUEUE(starpu_task_get_job_id(task), workerid);
+		starpu_sched_task_break(task);
+		record_data_locality(task, workerid);
+		STARPU_ASSERT_MSG(ws->per_worker[workerid].running, "workerid=%d, ws=%p\n", workerid, ws);
+		/* The task may be popped as soon as it is queued */
+		starpu_push_task_end(task);
+		if (workerid == starpu_worker_get_id())
+			_starpu_lockfree_deque_push(&ws->per_worker[workerid].lockfree_queue, task);
+		else
+			_starpu_lockfree_deque_push_inbox(&ws->per_worker[workerid].lockfree_queue, task);
 	}
-	locality_pushed_task(ws, task, workerid, sched_ctx_id);
+	else
+	{
+		starpu_worker_lock(workerid);
+		STARPU_AYU_ADDTOTASKQUEUE(starpu_task_get_job_id(task), workerid);
+		starpu_sched_task_break(task);
+		record_data_locality(task, workerid);
+		STARPU_ASSERT_MSG(ws->per_worker[workerid].running, "workerid=%d, ws=%p\n", workerid, ws);
+		starpu_st_prio_deque_push_back_task(&ws->per_worker[workerid].queue, task);
+		if (ws->per_worker[workerid].queue.ntasks == 1)
+		{
+			STARPU_ASSERT(ws->per_worker[workerid].notask == 1);
+			ws->per_worker[workerid].notask = 0;
+		}
+		locality_pushed_task(ws, task, workerid, sched_ctx_id);
 
-	starpu_push_task_end(task);
-	starpu_worker_unlock(workerid);
+		starpu_push_task_end(task);
+		starpu_worker_unlock(workerid);
+	}
 	starpu_sched_ctx_list_task_counters_increment(sched_ctx_id, workerid);
 
 #if !defined(STARPU_NON_BLOCKING_DRIVERS) || defined(STARPU_SIMGRID)
@@ -735,6 +888,8 @@ static void ws_add_workers(unsigned sched_ctx_id, int *workerids,unsigned nworke
 		int workerid = workerids[i];
 		starpu_sched_ctx_worker_shares_tasks_lists(workerid, sched_ctx_id);
 		starpu_st_prio_deque_init(&ws->per_worker[workerid].queue);
+		if (ws->lockfree && !ws->per_worker[workerid].lockfree_queue.array)
+			_starpu_lockfree_deque_init(&ws->per_worker[workerid].lockfree_queue);
 		ws->per_worker[workerid].notask = 1;
 		ws->per_worker[workerid].running = 1;
 
@@ -757,6 +912,8 @@ static void ws_remove_workers(unsigned sched_ctx_id, int *workerids, unsigned nw
 		int workerid = workerids[i];
 
 		starpu_st_prio_deque_destroy(&ws->per_worker[workerid].queue);
+		/* Thieves may still be looking at lockfree_queue, it is only
+		 * destroyed along the policy */
 		ws->per_worker[workerid].running = 0;
 		free(ws->per_worker[workerid].proxlist);
 		ws->per_worker[workerid].proxlist = NULL;
@@ -772,6 +929,12 @@ static void initialize_ws_policy(unsigned sched_ctx_id)
 	ws->last_push_worker = 0;
 	STARPU_HG_DISABLE_CHECKING(ws->last_push_worker);
 	ws->select_victim = select_victim;
+#ifdef USE_LOCALITY_TASKS
+	/* The locality hash tables are only maintained along queue */
+	ws->lockfree = 0;
+#else
+	ws->lockfree = starpu_getenv_number_default("STARPU_WS_LOCKFREE_DEQUES", 0);
+#endif
 
 	unsigned nw = starpu_worker_get_count();
 	_STARPU_CALLOC(ws->per_worker, nw, sizeof(struct _starpu_work_stealing_data_per_worker));
@@ -787,6 +950,14 @@ static void deinit_ws_policy(unsigned sched_ctx_id)
 {
 	struct _starpu_work_stealing_data *ws = (struct _starpu_work_stealing_data*)starpu_sched_ctx_get_policy_data(sched_ctx_id);
 
+	if (ws->lockfree)
+	{
+		unsigned nw = starpu_worker_get_count();
+		unsigned workerid;
+		for (workerid = 0; workerid < nw; workerid++)
+			if (ws->per_worker[workerid].lockfree_queue.array)
+				_starpu_lockfree_deque_destroy(&ws->per_worker[workerid].lockfree_queue);
+	}
 	free(ws->per_worker);
 	free(ws);
 }
@@ -819,7 +990,7 @@ static int lws_select_victim(struct _starpu_work_stealing_data *ws, unsigned sch
 	for (i = 0; i < nworkers; i++)
 	{
 		int neighbor = ws->per_worker[workerid].proxlist[i];
-		if (ws->per_worker[neighbor].notask)
+		if (!ws_worker_has_tasks(ws, neighbor))
 			continue;
 		/* FIXME: do not keep looking again and again at some worker
 		 * which has tasks, but that can't execute on me */
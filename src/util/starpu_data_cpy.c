@@ -118,7 +118,7 @@ static struct starpu_codelet copy_cl =
 
 int _starpu_data_cpy(starpu_data_handle_t dst_handle, starpu_data_handle_t src_handle,
 		     int asynchronous, void (*callback_func)(void*), void *callback_arg,
-		     int reduction, struct starpu_task *reduction_dep_task, int priority)
+		     int reduction, unsigned nreduction_deps, struct starpu_task **reduction_deps, int priority)
 {
 	if (dst_handle == src_handle)
 	{
@@ -135,8 +135,8 @@ int _starpu_data_cpy(starpu_data_handle_t dst_handle, starpu_data_handle_t src_h
 	if (reduction)
 	{
 		j->reduction_task = reduction;
-		if (reduction_dep_task)
-			starpu_task_declare_deps_array(task, 1, &reduction_dep_task);
+		if (nreduction_deps)
+			starpu_task_declare_deps_array(task, nreduction_deps, reduction_deps);
 	}
 
 	task->cl = &copy_cl;
@@ -168,13 +168,13 @@ int _starpu_data_cpy(starpu_data_handle_t dst_handle, starpu_data_handle_t src_h
 int starpu_data_cpy(starpu_data_handle_t dst_handle, starpu_data_handle_t src_handle,
 		    int asynchronous, void (*callback_func)(void*), void *callback_arg)
 {
-	return _starpu_data_cpy(dst_handle, src_handle, asynchronous, callback_func, callback_arg, 0, NULL, STARPU_DEFAULT_PRIO);
+	return _starpu_data_cpy(dst_handle, src_handle, asynchronous, callback_func, callback_arg, 0, 0, NULL, STARPU_DEFAULT_PRIO);
 }
 
 int starpu_data_cpy_priority(starpu_data_handle_t dst_handle, starpu_data_handle_t src_handle,
 			     int asynchronous, void (*callback_func)(void*), void *callback_arg, int priority)
 {
-	return _starpu_data_cpy(dst_handle, src_handle, asynchronous, callback_func, callback_arg, 0, NULL, priority);
+	return _starpu_data_cpy(dst_handle, src_handle, asynchronous, callback_func, callback_arg, 0, 0, NULL, priority);
 }
 
 /* TODO: implement copy on write, and introduce starpu_data_dup as well */
@@ -201,7 +201,7 @@ int starpu_data_dup_ro(starpu_data_handle_t *dst_handle, starpu_data_handle_t sr
 	_starpu_spin_unlock(&src_handle->header_lock);
 
 	starpu_data_register_same(dst_handle, src_handle);
-	_starpu_data_cpy(*dst_handle, src_handle, asynchronous, NULL, NULL, 0, NULL, STARPU_DEFAULT_PRIO);
+	_starpu_data_cpy(*dst_handle, src_handle, asynchronous, NULL, NULL, 0, 0, NULL, STARPU_DEFAULT_PRIO);
 	(*dst_handle)->readonly = 1;
 
 	_starpu_spin_lock(&src_handle->header_lock);
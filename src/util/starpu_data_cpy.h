@@ -25,7 +25,7 @@
 
 int _starpu_data_cpy(starpu_data_handle_t dst_handle, starpu_data_handle_t src_handle,
 		     int asynchronous, void (*callback_func)(void*), void *callback_arg,
-		     int reduction, struct starpu_task *reduction_dep_task, int priority);
+		     int reduction, unsigned nreduction_deps, struct starpu_task **reduction_deps, int priority);
 
 #pragma GCC visibility pop
 
@@ -0,0 +1,116 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include "../helper.h"
+#include <datawizard/malloc.h>
+
+/*
+ * One worker fills the first chunk of the suballocator with small segments
+ * and frees them, so that it keeps some of them in its cache. Another worker
+ * then needs the whole chunk, while the memory limit prevents allocating
+ * another one: it has to get the segments cached by the first worker.
+ */
+
+#if !defined(STARPU_HAVE_SETENV) || defined(STARPU_SIMGRID)
+#warning setenv is not defined or simgrid is used. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+#define NSEGMENTS (CHUNK_SIZE / CHUNK_ALLOC_MIN)
+
+static uintptr_t segments[NSEGMENTS];
+
+static void alloc_func(void *descr[], void *arg)
+{
+	unsigned free_them = (uintptr_t) arg;
+	unsigned i;
+	(void)descr;
+
+	for (i = 0; i < NSEGMENTS; i++)
+	{
+		segments[i] = starpu_malloc_on_node_flags(STARPU_MAIN_RAM, CHUNK_ALLOC_MIN, STARPU_MALLOC_COUNT);
+		STARPU_ASSERT_MSG(segments[i], "could not allocate segment %u\n", i);
+	}
+
+	if (free_them)
+		for (i = 0; i < NSEGMENTS; i++)
+			starpu_free_on_node_flags(STARPU_MAIN_RAM, segments[i], CHUNK_ALLOC_MIN, STARPU_MALLOC_COUNT);
+}
+
+static struct starpu_codelet alloc_cl =
+{
+	.cpu_funcs = {alloc_func},
+	.nbuffers = 0,
+};
+
+static void run_on(unsigned workerid, unsigned free_them)
+{
+	struct starpu_task *task = starpu_task_create();
+	int ret;
+
+	task->cl = &alloc_cl;
+	task->cl_arg = (void*) (uintptr_t) free_them;
+	task->execute_on_a_specific_worker = 1;
+	task->workerid = workerid;
+	task->synchronous = 1;
+	ret = starpu_task_submit(task);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_submit");
+}
+
+int main(int argc, char **argv)
+{
+	int ret;
+	int workers[2];
+	char limit[16];
+	struct starpu_conf conf;
+	unsigned i;
+
+	/* Room for one chunk, but not for another one */
+	snprintf(limit, sizeof(limit), "%d", (int) ((CHUNK_SIZE + CHUNK_SIZE / 2) >> 20));
+	setenv("STARPU_LIMIT_CPU_NUMA_MEM", limit, 1);
+	/* Also suballocate unpinned main memory */
+	setenv("STARPU_SUBALLOCATOR", "2", 1);
+
+	starpu_conf_init(&conf);
+	starpu_conf_noworker(&conf);
+	conf.ncpus = 2;
+
+	ret = starpu_initialize(&conf, &argc, &argv);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	if (starpu_worker_get_ids_by_type(STARPU_CPU_WORKER, workers, 2) < 2)
+	{
+		FPRINTF(stderr, "We need at least 2 CPU workers.\n");
+		starpu_shutdown();
+		return STARPU_TEST_SKIPPED;
+	}
+
+	run_on(workers[0], 1);
+	run_on(workers[1], 0);
+
+	for (i = 0; i < NSEGMENTS; i++)
+		starpu_free_on_node_flags(STARPU_MAIN_RAM, segments[i], CHUNK_ALLOC_MIN, STARPU_MALLOC_COUNT);
+
+	starpu_shutdown();
+
+	return EXIT_SUCCESS;
+}
+#endif
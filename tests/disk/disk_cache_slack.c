@@ -0,0 +1,155 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <datawizard/memalloc.h>
+#include "../helper.h"
+
+/*
+ * Push vectors of slowly decreasing sizes to a disk and back, with
+ * STARPU_MEMCHUNK_CACHE_SLACK set, so that the disk allocation of a vector
+ * gets reused for the next, smaller, vectors. Check that the allocation
+ * cache did reuse bigger chunks, and that the data survives the trip.
+ */
+
+#define NX	(64*1024)
+#ifdef STARPU_QUICK_CHECK
+#define NITER	16
+#else
+#define NITER	64
+#endif
+
+#if !defined(STARPU_HAVE_SETENV)
+#warning setenv is not defined. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#elif STARPU_MAXNODES == 1
+/* Cannot register a disk */
+int main(int argc, char **argv)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+int dotest(struct starpu_disk_ops *ops, void *param)
+{
+	int *A;
+	unsigned i, j;
+	int ret;
+	int try = 1;
+
+	setenv("STARPU_MEMCHUNK_CACHE_SLACK", "50", 1);
+
+	struct starpu_conf conf;
+	ret = starpu_conf_init(&conf);
+	if (ret == -EINVAL)
+		return EXIT_FAILURE;
+	conf.precedence_over_environment_variables = 1;
+	starpu_conf_noworker(&conf);
+	conf.ncpus = 1;
+	ret = starpu_init(&conf);
+	if (ret == -ENODEV) goto enodev;
+
+	int disk = starpu_disk_register(ops, param, STARPU_DISK_SIZE_MIN);
+	/* can't write on /tmp/ */
+	if (disk == -ENOENT) goto enoent;
+
+	starpu_malloc_flags((void **)&A, NX*sizeof(int), STARPU_MALLOC_COUNT);
+
+	for (i = 0; i < NITER && try; i++)
+	{
+		/* Each vector is 1% smaller than the previous one */
+		unsigned nx = NX - i * (NX / 100);
+		starpu_data_handle_t handle;
+
+		for (j = 0; j < nx; j++)
+			A[j] = i + j;
+
+		starpu_vector_data_register(&handle, STARPU_MAIN_RAM, (uintptr_t) A, nx, sizeof(int));
+
+		/* Move the data to the disk, dropping the main RAM copy */
+		ret = starpu_data_acquire_on_node(handle, disk, STARPU_RW);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_acquire_on_node");
+		starpu_data_release_on_node(handle, disk);
+
+		/* And bring it back */
+		ret = starpu_data_acquire(handle, STARPU_R);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_acquire");
+		for (j = 0; j < nx; j++)
+			if (A[j] != (int) (i + j))
+			{
+				FPRINTF(stderr, "Fail at iteration %u: A[%u] = %d instead of %u\n", i, j, A[j], i + j);
+				try = 0;
+				break;
+			}
+		starpu_data_release(handle);
+
+		/* This puts the disk allocation in the cache */
+		starpu_data_unregister(handle);
+	}
+
+	starpu_data_display_memory_stats();
+
+	if (try && !_starpu_memchunk_cache_slack_hits(disk))
+	{
+		FPRINTF(stderr, "The disk allocations were never reused with slack\n");
+		try = 0;
+	}
+
+	starpu_free_flags(A, NX*sizeof(int), STARPU_MALLOC_COUNT);
+
+	starpu_shutdown();
+	unsetenv("STARPU_MEMCHUNK_CACHE_SLACK");
+
+	return try ? EXIT_SUCCESS : EXIT_FAILURE;
+
+enodev:
+	unsetenv("STARPU_MEMCHUNK_CACHE_SLACK");
+	return STARPU_TEST_SKIPPED;
+enoent:
+	FPRINTF(stderr, "Couldn't write data: ENOENT\n");
+	starpu_shutdown();
+	unsetenv("STARPU_MEMCHUNK_CACHE_SLACK");
+	return STARPU_TEST_SKIPPED;
+}
+
+int main(void)
+{
+	int ret, ret2;
+	char s[128];
+	char *ptr;
+
+	snprintf(s, sizeof(s), "/tmp/%s-disk-XXXXXX", getenv("USER"));
+	ptr = _starpu_mkdtemp(s);
+	if (!ptr)
+	{
+		FPRINTF(stderr, "Cannot make directory <%s>\n", s);
+		return STARPU_TEST_SKIPPED;
+	}
+
+	ret = dotest(&starpu_disk_unistd_ops, s);
+
+	ret2 = rmdir(s);
+	if (ret2 < 0)
+		STARPU_CHECK_RETURN_VALUE(-errno, "rmdir '%s'\n", s);
+	return ret;
+}
+#endif
@@ -0,0 +1,235 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <common/utils.h>
+#include "../helper.h"
+
+/*
+ * Check the bundled disk compression codec, and that data evicted to a disk
+ * node with a codec gets compressed, unless it was opted out.
+ */
+
+#define NX	(64*1024)
+
+#if STARPU_MAXNODES == 1
+/* Cannot register a disk */
+int main(int argc, char **argv)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+static unsigned ncompress, ndecompress;
+
+static size_t count_bound(size_t size)
+{
+	return starpu_disk_codec_lz.bound(size);
+}
+
+static size_t count_compress(const void *src, size_t size, void *dst, size_t dst_size)
+{
+	ncompress++;
+	return starpu_disk_codec_lz.compress(src, size, dst, dst_size);
+}
+
+static size_t count_decompress(const void *src, size_t size, void *dst, size_t dst_size)
+{
+	ndecompress++;
+	return starpu_disk_codec_lz.decompress(src, size, dst, dst_size);
+}
+
+static struct starpu_disk_codec count_codec =
+{
+	.name = "count",
+	.bound = count_bound,
+	.compress = count_compress,
+	.decompress = count_decompress,
+};
+
+/* Compress and decompress \p size bytes, return the compressed size, or 0 on failure */
+static size_t roundtrip(const unsigned char *data, size_t size)
+{
+	size_t bound = starpu_disk_codec_lz.bound(size);
+	unsigned char *compressed = malloc(bound);
+	unsigned char *decompressed = malloc(size + 1);
+	size_t csize = starpu_disk_codec_lz.compress(data, size, compressed, bound);
+
+	if (csize == 0 && size > 0)
+	{
+		FPRINTF(stderr, "Could not compress %zu bytes\n", size);
+		goto out;
+	}
+	if (starpu_disk_codec_lz.decompress(compressed, csize, decompressed, size) != size || memcmp(data, decompressed, size))
+	{
+		FPRINTF(stderr, "Roundtrip of %zu bytes failed\n", size);
+		csize = 0;
+	}
+	/* Too small a destination has to be detected */
+	else if (size > 0 && starpu_disk_codec_lz.compress(data, size, compressed, csize - 1) != 0)
+	{
+		FPRINTF(stderr, "Compression of %zu bytes overflowed\n", size);
+		csize = 0;
+	}
+out:
+	free(compressed);
+	free(decompressed);
+	return csize;
+}
+
+static int test_codec(void)
+{
+	size_t size = NX*sizeof(int);
+	unsigned char *data = malloc(size);
+	int *ints = (int *) data;
+	size_t i, csize;
+	int ret = EXIT_SUCCESS;
+
+	for (i = 0; i < NX; i++)
+		ints[i] = i % 100;
+	csize = roundtrip(data, size);
+	if (csize == 0 || csize > size / 2)
+	{
+		FPRINTF(stderr, "Regular data compressed to %zu bytes out of %zu\n", csize, size);
+		ret = EXIT_FAILURE;
+	}
+
+	/* Long runs, which need extended lengths and overlapping copies */
+	memset(data, 0, size);
+	if (!roundtrip(data, size))
+		ret = EXIT_FAILURE;
+
+	/* Random data does not compress, but has to be handled */
+	srand(42);
+	for (i = 0; i < size; i++)
+		data[i] = rand();
+	if (!roundtrip(data, size))
+		ret = EXIT_FAILURE;
+
+	/* Small sizes */
+	memset(data, 'a', 64);
+	for (i = 0; i <= 64; i++)
+		if (!roundtrip(data, i))
+			ret = EXIT_FAILURE;
+
+	free(data);
+	return ret;
+}
+
+static int test_disk(char *base)
+{
+	struct starpu_conf conf;
+	int ret = starpu_conf_init(&conf);
+	if (ret == -EINVAL)
+		return EXIT_FAILURE;
+	conf.precedence_over_environment_variables = 1;
+	starpu_conf_noworker(&conf);
+	conf.ncpus = 1;
+	conf.nmpi_ms = 0;
+	conf.ntcpip_ms = 0;
+	ret = starpu_init(&conf);
+	if (ret == -ENODEV)
+		return STARPU_TEST_SKIPPED;
+
+	int new_dd = starpu_disk_register(&starpu_disk_unistd_ops, (void *) base, STARPU_DISK_SIZE_MIN);
+	/* can't write on /tmp/ */
+	if (new_dd == -ENOENT)
+	{
+		starpu_shutdown();
+		return STARPU_TEST_SKIPPED;
+	}
+	unsigned dd = new_dd;
+	starpu_disk_set_codec(dd, &count_codec);
+	STARPU_ASSERT(starpu_disk_get_codec(dd) == &count_codec);
+
+	int *A = malloc(NX*sizeof(int));
+	int *B = malloc(NX*sizeof(int));
+	int i;
+	for (i = 0; i < NX; i++)
+		A[i] = B[i] = i % 100;
+
+	starpu_data_handle_t handleA, handleB;
+	starpu_vector_data_register(&handleA, STARPU_MAIN_RAM, (uintptr_t) A, NX, sizeof(int));
+	starpu_vector_data_register(&handleB, STARPU_MAIN_RAM, (uintptr_t) B, NX, sizeof(int));
+	starpu_data_set_disk_compress_flag(handleB, 0);
+	STARPU_ASSERT(starpu_data_get_disk_compress_flag(handleA) == 1);
+
+	/* Move the data to the disk only, and back */
+	ret = starpu_data_acquire_on_node(handleA, dd, STARPU_RW);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_acquire_on_node");
+	starpu_data_release_on_node(handleA, dd);
+	ret = starpu_data_acquire_on_node(handleB, dd, STARPU_RW);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_acquire_on_node");
+	starpu_data_release_on_node(handleB, dd);
+
+	memset(A, 0, NX*sizeof(int));
+	memset(B, 0, NX*sizeof(int));
+
+	starpu_data_unregister(handleA);
+	starpu_data_unregister(handleB);
+
+	ret = EXIT_SUCCESS;
+	for (i = 0; i < NX; i++)
+		if (A[i] != i % 100 || B[i] != i % 100)
+		{
+			FPRINTF(stderr, "Fail %d: %d %d != %d\n", i, A[i], B[i], i % 100);
+			ret = EXIT_FAILURE;
+			break;
+		}
+	if (ncompress != 1 || ndecompress != 1)
+	{
+		FPRINTF(stderr, "Expected one compression and one decompression, got %u and %u\n", ncompress, ndecompress);
+		ret = EXIT_FAILURE;
+	}
+
+	free(A);
+	free(B);
+	starpu_shutdown();
+	return ret;
+}
+
+int main(void)
+{
+	int ret;
+	char s[128];
+	char *ptr;
+
+#ifdef STARPU_HAVE_SETENV
+	setenv("STARPU_CALIBRATE_MINIMUM", "1", 1);
+#endif
+
+	ret = test_codec();
+	if (ret != EXIT_SUCCESS)
+		return ret;
+
+	snprintf(s, sizeof(s), "/tmp/%s-disk-XXXXXX", getenv("USER"));
+	ptr = _starpu_mkdtemp(s);
+	if (!ptr)
+	{
+		FPRINTF(stderr, "Cannot make directory '%s'\n", s);
+		return STARPU_TEST_SKIPPED;
+	}
+
+	ret = test_disk(s);
+
+	if (rmdir(s) < 0)
+		STARPU_CHECK_RETURN_VALUE(-errno, "rmdir '%s'\n", s);
+	return ret;
+}
+#endif
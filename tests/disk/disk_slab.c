@@ -0,0 +1,229 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <common/utils.h>
+#include "../helper.h"
+
+/*
+ * Check that with STARPU_DISK_UNISTD_SLAB, the unistd backend stores all data
+ * in one file, reuses the room of freed data, and that objects opened with
+ * starpu_disk_open can be reopened by a later run.
+ */
+
+#define NX	(16*1024)
+#define NDATA	16
+#define NAME	"STARPU_DISK_SLAB_DATA"
+
+#if !defined(STARPU_HAVE_SETENV)
+#warning setenv is not defined. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#elif STARPU_MAXNODES == 1
+/* Cannot register a disk */
+int main(int argc, char **argv)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+
+static char path_slab[256];
+static char path_map[256];
+
+static int init(char *base, unsigned *dd)
+{
+	struct starpu_conf conf;
+	int ret = starpu_conf_init(&conf);
+	if (ret == -EINVAL)
+		return EXIT_FAILURE;
+	conf.precedence_over_environment_variables = 1;
+	starpu_conf_noworker(&conf);
+	conf.ncpus = 1;
+	conf.nmpi_ms = 0;
+	conf.ntcpip_ms = 0;
+	ret = starpu_init(&conf);
+	if (ret == -ENODEV)
+		return STARPU_TEST_SKIPPED;
+
+	int new_dd = starpu_disk_register(&starpu_disk_unistd_ops, (void *) base, STARPU_DISK_SIZE_MIN);
+	/* can't write on /tmp/ */
+	if (new_dd == -ENOENT)
+	{
+		starpu_shutdown();
+		return STARPU_TEST_SKIPPED;
+	}
+	*dd = new_dd;
+	return 0;
+}
+
+/* Push NDATA vectors to the disk, and return the size of the slab file */
+static off_t push_data(unsigned dd, int *A)
+{
+	starpu_data_handle_t handles[NDATA];
+	struct stat st;
+	int i;
+
+	for (i = 0; i < NDATA; i++)
+	{
+		starpu_vector_data_register(&handles[i], STARPU_MAIN_RAM, (uintptr_t) A, NX, sizeof(int));
+		starpu_data_fetch_on_node(handles[i], dd, 0);
+	}
+	for (i = 0; i < NDATA; i++)
+		starpu_data_unregister(handles[i]);
+
+	if (stat(path_slab, &st) < 0)
+		return -1;
+	return st.st_size;
+}
+
+/* Check that there is nothing but the slab file in the directory */
+static int check_files(char *base)
+{
+	DIR *dir = opendir(base);
+	struct dirent *entry;
+	int ret = 0;
+
+	STARPU_ASSERT(dir);
+	while ((entry = readdir(dir)))
+	{
+		if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, "..") || !strcmp(entry->d_name, "starpu_slab"))
+			continue;
+		FPRINTF(stderr, "Unexpected file %s in disk directory\n", entry->d_name);
+		ret = 1;
+	}
+	closedir(dir);
+	return ret;
+}
+
+static int first_run(char *base, int *A)
+{
+	unsigned dd;
+	int ret = init(base, &dd);
+	if (ret)
+		return ret;
+
+	/* This does not exist yet, so it gets created in the slab file */
+	void *data = starpu_disk_open(dd, (void *) NAME, NX*sizeof(int));
+	STARPU_ASSERT(data);
+
+	starpu_data_handle_t handle;
+	starpu_vector_data_register(&handle, dd, (uintptr_t) data, NX, sizeof(int));
+	ret = starpu_data_acquire_on_node(handle, STARPU_MAIN_RAM, STARPU_W);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_acquire_on_node");
+	int *v = (int *) starpu_vector_get_local_ptr(handle);
+	memcpy(v, A, NX*sizeof(int));
+	starpu_data_release_on_node(handle, STARPU_MAIN_RAM);
+	starpu_data_unregister(handle);
+	starpu_disk_close(dd, data, NX*sizeof(int));
+
+	off_t size1 = push_data(dd, A);
+	off_t size2 = push_data(dd, A);
+	ret = EXIT_SUCCESS;
+	if (size1 <= 0 || size2 != size1)
+	{
+		FPRINTF(stderr, "Slab file did not get reused: %ld then %ld bytes\n", (long) size1, (long) size2);
+		ret = EXIT_FAILURE;
+	}
+	if (check_files(base))
+		ret = EXIT_FAILURE;
+
+	starpu_shutdown();
+
+	if (access(path_map, R_OK))
+	{
+		FPRINTF(stderr, "The slab map was not saved\n");
+		ret = EXIT_FAILURE;
+	}
+	return ret;
+}
+
+static int second_run(char *base, int *A)
+{
+	unsigned dd;
+	int i, ret = init(base, &dd);
+	if (ret)
+		return ret;
+
+	void *data = starpu_disk_open(dd, (void *) NAME, NX*sizeof(int));
+	STARPU_ASSERT(data);
+
+	starpu_data_handle_t handle;
+	starpu_vector_data_register(&handle, dd, (uintptr_t) data, NX, sizeof(int));
+	ret = starpu_data_acquire_on_node(handle, STARPU_MAIN_RAM, STARPU_R);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_acquire_on_node");
+	int *v = (int *) starpu_vector_get_local_ptr(handle);
+	ret = EXIT_SUCCESS;
+	for (i = 0; i < NX; i++)
+		if (v[i] != A[i])
+		{
+			FPRINTF(stderr, "Fail %d: %d != %d\n", i, v[i], A[i]);
+			ret = EXIT_FAILURE;
+			break;
+		}
+	starpu_data_release_on_node(handle, STARPU_MAIN_RAM);
+	starpu_data_unregister(handle);
+	starpu_disk_close(dd, data, NX*sizeof(int));
+
+	starpu_shutdown();
+	return ret;
+}
+
+int main(void)
+{
+	int ret;
+	char s[128];
+	char *ptr;
+	int *A;
+	int i;
+
+	setenv("STARPU_DISK_UNISTD_SLAB", "1", 1);
+#ifdef STARPU_HAVE_SETENV
+	setenv("STARPU_CALIBRATE_MINIMUM", "1", 1);
+#endif
+
+	snprintf(s, sizeof(s), "/tmp/%s-disk-XXXXXX", getenv("USER"));
+	ptr = _starpu_mkdtemp(s);
+	if (!ptr)
+	{
+		FPRINTF(stderr, "Cannot make directory '%s'\n", s);
+		return STARPU_TEST_SKIPPED;
+	}
+	snprintf(path_slab, sizeof(path_slab), "%s/starpu_slab", s);
+	snprintf(path_map, sizeof(path_map), "%s/starpu_slab.map", s);
+
+	A = malloc(NX*sizeof(int));
+	for (i = 0; i < NX; i++)
+		A[i] = i;
+
+	ret = first_run(s, A);
+	if (ret == EXIT_SUCCESS)
+		ret = second_run(s, A);
+
+	free(A);
+	unlink(path_slab);
+	unlink(path_map);
+	if (rmdir(s) < 0)
+		STARPU_CHECK_RETURN_VALUE(-errno, "rmdir '%s'\n", s);
+	return ret;
+}
+#endif
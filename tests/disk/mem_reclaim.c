@@ -287,6 +287,12 @@ int main(void)
 	ret = merge_result(ret, dotest(&starpu_disk_unistd_o_direct_ops, s, starpu_my_vector_data_register, "unistd_direct with pack/unpack vector ops"));
 	if (ret == STARPU_TEST_SKIPPED) goto skipped;
 #endif
+#ifdef STARPU_HAVE_IO_URING
+	ret = merge_result(ret, dotest(&starpu_disk_unistd_uring_ops, s, starpu_vector_data_register, "unistd_uring with read/write vector ops"));
+	if (ret == STARPU_TEST_SKIPPED) goto skipped;
+	ret = merge_result(ret, dotest(&starpu_disk_unistd_uring_ops, s, starpu_my_vector_data_register, "unistd_uring with pack/unpack vector ops"));
+	if (ret == STARPU_TEST_SKIPPED) goto skipped;
+#endif
 
 skipped:
 	ret2 = rmdir(s);
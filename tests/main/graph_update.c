@@ -0,0 +1,255 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <core/jobs.h>
+#include <common/graph.h>
+#include "../helper.h"
+
+/*
+ * Check that the depths and descendants which the task graph updates
+ * incrementally are the same as the ones computed over the whole graph.
+ *
+ * Several threads record a random DAG of jobs, and drop the jobs whose
+ * predecessors were all dropped, as the termination of the tasks would. They
+ * also ask for the depths and descendants meanwhile, so that the updates
+ * happen in the middle of the recording. After each round, the incremental
+ * values are compared with a full computation.
+ */
+
+#define NTHREADS 4
+#define MAXDEPS 3
+/* Pick the predecessors among the last jobs, to get a deep graph */
+#define WINDOW 32
+#ifdef STARPU_QUICK_CHECK
+#define NROUNDS 2
+#define NJOBS 64
+#else
+#define NROUNDS 4
+#define NJOBS 512
+#endif
+#define TOTAL_JOBS (NROUNDS*NTHREADS*NJOBS)
+
+struct test_job
+{
+	/* First, so that the graph nodes lead back to the test job */
+	struct _starpu_job job;
+	/* Number of predecessors not dropped yet */
+	unsigned npreds;
+	struct test_job **succs;
+	unsigned nsuccs;
+	/* Recorded in the graph */
+	int added;
+	int dropped;
+	/* Incremental values */
+	unsigned depth;
+	unsigned descendants;
+	int seen;
+};
+
+static starpu_pthread_mutex_t mutex = STARPU_PTHREAD_MUTEX_INITIALIZER;
+static struct test_job *pool;
+static unsigned npool;
+/* Jobs recorded in the graph, in recording order */
+static struct test_job **added;
+static unsigned nadded;
+/* Jobs recorded in the graph whose predecessors were all dropped */
+static struct test_job **ready;
+static unsigned nready;
+
+static long get_random(starpu_drand48_data *buffer)
+{
+	long r;
+	starpu_lrand48_r(buffer, &r);
+	return r;
+}
+
+/* Call with the mutex held */
+static void push_ready(struct test_job *j)
+{
+	ready[nready++] = j;
+}
+
+static void add_job(starpu_drand48_data *buffer)
+{
+	struct test_job *j, *preds[MAXDEPS];
+	unsigned npreds = 0, n, i, k;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&mutex);
+	j = &pool[npool++];
+	if (nadded)
+	{
+		n = get_random(buffer) % (MAXDEPS+1);
+		for (i = 0; i < n; i++)
+		{
+			unsigned window = nadded < WINDOW ? nadded : WINDOW;
+			struct test_job *p = added[nadded - 1 - get_random(buffer) % window];
+			for (k = 0; k < npreds; k++)
+				if (preds[k] == p)
+					break;
+			if (k < npreds)
+				continue;
+			preds[npreds++] = p;
+			if (!p->dropped)
+			{
+				j->npreds++;
+				_STARPU_REALLOC(p->succs, (p->nsuccs+1) * sizeof(*p->succs));
+				p->succs[p->nsuccs++] = j;
+			}
+		}
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&mutex);
+
+	/* Dependencies on jobs dropped meanwhile are ignored by the graph */
+	_starpu_graph_add_job(&j->job);
+	for (k = 0; k < npreds; k++)
+		_starpu_graph_add_job_dep(&j->job, &preds[k]->job);
+
+	STARPU_PTHREAD_MUTEX_LOCK(&mutex);
+	j->added = 1;
+	added[nadded++] = j;
+	if (!j->npreds)
+		push_ready(j);
+	STARPU_PTHREAD_MUTEX_UNLOCK(&mutex);
+}
+
+/* Drop a job whose predecessors were all dropped */
+static void drop_job(starpu_drand48_data *buffer)
+{
+	struct test_job *j;
+	unsigned k;
+
+	STARPU_PTHREAD_MUTEX_LOCK(&mutex);
+	if (!nready)
+	{
+		STARPU_PTHREAD_MUTEX_UNLOCK(&mutex);
+		return;
+	}
+	k = get_random(buffer) % nready;
+	j = ready[k];
+	ready[k] = ready[--nready];
+	j->dropped = 1;
+	for (k = 0; k < j->nsuccs; k++)
+	{
+		struct test_job *s = j->succs[k];
+		if (!--s->npreds && s->added)
+			push_ready(s);
+	}
+	STARPU_PTHREAD_MUTEX_UNLOCK(&mutex);
+
+	_starpu_graph_drop_job(&j->job);
+}
+
+static void *thread_func(void *arg)
+{
+	starpu_drand48_data buffer;
+	unsigned i;
+
+	starpu_srand48_r((uintptr_t) arg, &buffer);
+	for (i = 0; i < NJOBS; i++)
+	{
+		long r = get_random(&buffer);
+		add_job(&buffer);
+		if (r % 3)
+			drop_job(&buffer);
+		if (r % 16 == 0)
+			_starpu_graph_compute_depths();
+		else if (r % 16 == 1)
+			_starpu_graph_compute_descendants();
+	}
+	return NULL;
+}
+
+static void save_values(void *data, struct _starpu_graph_node *node)
+{
+	struct test_job *j = (struct test_job *) node->job;
+	(void)data;
+	if (!j)
+		return;
+	j->depth = node->depth;
+	j->descendants = node->descendants;
+	j->seen = 1;
+}
+
+static void check_values(void *data, struct _starpu_graph_node *node)
+{
+	struct test_job *j = (struct test_job *) node->job;
+	int *errors = data;
+	if (!j)
+		return;
+	STARPU_ASSERT(j->seen);
+	if (j->depth != node->depth || j->descendants != node->descendants)
+	{
+		FPRINTF(stderr, "job %u: incremental depth %u descendants %u, full depth %u descendants %u\n",
+			(unsigned) (j - pool), j->depth, j->descendants, node->depth, node->descendants);
+		(*errors)++;
+	}
+	j->seen = 0;
+}
+
+int main(void)
+{
+	starpu_pthread_t threads[NTHREADS];
+	unsigned round, t, i;
+	int ret, errors = 0;
+
+	ret = starpu_init(NULL);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	pool = calloc(TOTAL_JOBS, sizeof(*pool));
+	added = calloc(TOTAL_JOBS, sizeof(*added));
+	ready = calloc(TOTAL_JOBS, sizeof(*ready));
+
+	/* Start tracking the updates from the empty graph */
+	_starpu_graph_compute_depths();
+	_starpu_graph_compute_descendants();
+
+	for (round = 0; round < NROUNDS; round++)
+	{
+		for (t = 0; t < NTHREADS; t++)
+			STARPU_PTHREAD_CREATE(&threads[t], NULL, thread_func, (void*) (uintptr_t) (round*NTHREADS + t));
+		for (t = 0; t < NTHREADS; t++)
+			STARPU_PTHREAD_JOIN(threads[t], NULL);
+
+		/* Apply what remains recorded, and update incrementally */
+		_starpu_graph_compute_depths();
+		_starpu_graph_compute_descendants();
+		_starpu_graph_foreach(save_values, NULL);
+
+		/* And compare with the full computation */
+		_starpu_graph_invalidate_analysis();
+		_starpu_graph_compute_depths();
+		_starpu_graph_compute_descendants();
+		_starpu_graph_foreach(check_values, &errors);
+		FPRINTF(stderr, "round %u: %u jobs recorded, %u ready\n", round, nadded, nready);
+	}
+
+	/* Drop the remaining jobs, predecessors first */
+	for (i = 0; i < nadded; i++)
+		if (!added[i]->dropped)
+			_starpu_graph_drop_job(&added[i]->job);
+
+	starpu_shutdown();
+
+	for (i = 0; i < npool; i++)
+		free(pool[i].succs);
+	free(pool);
+	free(added);
+	free(ready);
+
+	return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,176 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include "../helper.h"
+
+/*
+ * Submit tasks with starpu_task_submit_array, some independent, some
+ * depending on each other through data, some synchronous, and check that
+ * they are all executed, and that failures are properly reported.
+ */
+
+#ifdef STARPU_QUICK_CHECK
+#define NTASKS 64
+#else
+#define NTASKS 1024
+#endif
+
+static unsigned counters[NTASKS];
+
+void counter_cpu(void *descr[], void *arg)
+{
+	(void)descr;
+	unsigned *counter = arg;
+	(*counter)++;
+}
+
+void increment_cpu(void *descr[], void *arg)
+{
+	(void)arg;
+	unsigned *x = (unsigned *)STARPU_VARIABLE_GET_PTR(descr[0]);
+	(*x)++;
+}
+
+static struct starpu_codelet counter_cl =
+{
+	.cpu_funcs = {counter_cpu},
+	.cpu_funcs_name = {"counter_cpu"},
+	.nbuffers = 0,
+};
+
+static struct starpu_codelet increment_cl =
+{
+	.cpu_funcs = {increment_cpu},
+	.cpu_funcs_name = {"increment_cpu"},
+	.nbuffers = 1,
+	.modes = {STARPU_RW},
+};
+
+static int run(const char *sched_policy)
+{
+	struct starpu_task *tasks[NTASKS];
+	struct starpu_conf conf;
+	starpu_data_handle_t handle;
+	unsigned x = 0, nincrements = 0;
+	unsigned i;
+	int ret;
+
+	starpu_conf_init(&conf);
+	if (sched_policy)
+		conf.sched_policy_name = sched_policy;
+	ret = starpu_initialize(&conf, NULL, NULL);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	if (starpu_cpu_worker_get_count() == 0)
+	{
+		starpu_shutdown();
+		return STARPU_TEST_SKIPPED;
+	}
+
+	starpu_variable_data_register(&handle, STARPU_MAIN_RAM, (uintptr_t)&x, sizeof(x));
+	memset(counters, 0, sizeof(counters));
+
+	for (i = 0; i < NTASKS; i++)
+	{
+		struct starpu_task *task = starpu_task_create();
+		if (i % 3 == 0)
+		{
+			task->cl = &increment_cl;
+			task->handles[0] = handle;
+			nincrements++;
+		}
+		else
+		{
+			task->cl = &counter_cl;
+			task->cl_arg = &counters[i];
+			task->cl_arg_size = sizeof(counters[i]);
+		}
+		if (i == NTASKS / 2)
+		{
+			task->synchronous = 1;
+			task->destroy = 0;
+		}
+		tasks[i] = task;
+	}
+
+	ret = starpu_task_submit_array(tasks, NTASKS);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_submit_array");
+	starpu_task_destroy(tasks[NTASKS / 2]);
+
+	starpu_task_wait_for_all();
+	STARPU_ASSERT(starpu_task_nsubmitted() == 0);
+
+	for (i = 0; i < NTASKS; i++)
+		if (i % 3 != 0)
+			STARPU_ASSERT_MSG(counters[i] == 1, "task %u was executed %u times\n", i, counters[i]);
+
+	ret = starpu_data_acquire(handle, STARPU_R);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_acquire");
+	STARPU_ASSERT_MSG(x == nincrements, "x is %u instead of %u\n", x, nincrements);
+	starpu_data_release(handle);
+
+	if (starpu_cuda_worker_get_count() == 0)
+	{
+		/* The task in the middle can not be executed, the tasks after it
+		 * must not be submitted */
+		for (i = 0; i < NTASKS; i++)
+		{
+			tasks[i] = starpu_task_create();
+			tasks[i]->cl = &counter_cl;
+			tasks[i]->cl_arg = &counters[i];
+			tasks[i]->cl_arg_size = sizeof(counters[i]);
+		}
+		tasks[NTASKS / 2]->where = STARPU_CUDA;
+
+		ret = starpu_task_submit_array(tasks, NTASKS);
+		STARPU_ASSERT(ret == -ENODEV);
+
+		starpu_task_wait_for_all();
+		STARPU_ASSERT(starpu_task_nsubmitted() == 0);
+
+		for (i = 0; i < NTASKS; i++)
+		{
+			if (i < NTASKS / 2)
+				STARPU_ASSERT_MSG(counters[i] == (i % 3 == 0 ? 1 : 2), "task %u was not executed\n", i);
+			else
+			{
+				STARPU_ASSERT_MSG(counters[i] == (i % 3 == 0 ? 0 : 1), "task %u was executed\n", i);
+				tasks[i]->destroy = 0;
+				starpu_task_destroy(tasks[i]);
+			}
+		}
+	}
+
+	starpu_data_unregister(handle);
+	starpu_shutdown();
+
+	return EXIT_SUCCESS;
+}
+
+int main(void)
+{
+	int ret;
+
+	/* Default scheduler, which may not implement push_tasks */
+	ret = run(NULL);
+	if (ret != EXIT_SUCCESS)
+		return ret;
+
+	/* eager implements push_tasks */
+	return run("eager");
+}
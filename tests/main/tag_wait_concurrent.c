@@ -0,0 +1,88 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <starpu.h>
+#include "../helper.h"
+
+/*
+ * Several application threads wait for overlapping sets of tags, given in
+ * different orders, while another thread notifies and removes them.
+ */
+
+#define NTHREADS 4
+#define NTAGS 256
+
+#ifdef STARPU_QUICK_CHECK
+#define NROUNDS 10
+#else
+#define NROUNDS 100
+#endif
+
+static unsigned round_id;
+
+static void *wait_func(void *arg)
+{
+	uintptr_t t = (uintptr_t) arg;
+	starpu_tag_t tags[NTAGS];
+	unsigned ntags = NTAGS / 2 + t * NTAGS / (2 * NTHREADS);
+	unsigned i;
+
+	for (i = 0; i < ntags; i++)
+	{
+		/* Odd threads wait for the tags in reverse order */
+		unsigned n = t % 2 ? NTAGS - 1 - i : i;
+		tags[i] = (starpu_tag_t) round_id * NTAGS + n;
+	}
+
+	starpu_tag_wait_array(ntags, tags);
+	return NULL;
+}
+
+int main(void)
+{
+	starpu_pthread_t threads[NTHREADS];
+	unsigned t, i;
+	int ret;
+
+	ret = starpu_init(NULL);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	for (round_id = 0; round_id < NROUNDS; round_id++)
+	{
+		starpu_tag_t base = (starpu_tag_t) round_id * NTAGS;
+
+		for (t = 0; t < NTHREADS; t++)
+			STARPU_PTHREAD_CREATE(&threads[t], NULL, wait_func, (void*) (uintptr_t) t);
+
+		/* Notify some tags before the waiters get them, some after */
+		for (i = 0; i < NTAGS; i++)
+			starpu_tag_notify_from_apps(base + (i * 7) % NTAGS);
+
+		for (t = 0; t < NTHREADS; t++)
+			STARPU_PTHREAD_JOIN(threads[t], NULL);
+
+		for (i = 0; i < NTAGS; i++)
+			starpu_tag_remove(base + i);
+	}
+
+	starpu_shutdown();
+
+	return EXIT_SUCCESS;
+}
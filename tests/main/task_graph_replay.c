@@ -0,0 +1,196 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include "../helper.h"
+
+/*
+ * Capture the task graph of an iteration, and replay it with different
+ * cl_arg values
+ *
+ *	x += inc	(A)
+ *	y1 = x		(B)
+ *	y2 = x		(C)
+ *	x += 1		(E)
+ *	z += y1 + y2	(D)
+ */
+
+#ifdef STARPU_QUICK_CHECK
+static unsigned niter = 16;
+#else
+static unsigned niter = 1024;
+#endif
+
+void add_cpu(void *descr[], void *arg)
+{
+	int *x = (int *)STARPU_VARIABLE_GET_PTR(descr[0]);
+	*x += *(int *) arg;
+}
+
+void copy_cpu(void *descr[], void *arg)
+{
+	(void)arg;
+	int *src = (int *)STARPU_VARIABLE_GET_PTR(descr[0]);
+	int *dst = (int *)STARPU_VARIABLE_GET_PTR(descr[1]);
+	*dst = *src;
+}
+
+void sum_cpu(void *descr[], void *arg)
+{
+	int *y1 = (int *)STARPU_VARIABLE_GET_PTR(descr[0]);
+	int *y2 = (int *)STARPU_VARIABLE_GET_PTR(descr[1]);
+	int *z = (int *)STARPU_VARIABLE_GET_PTR(descr[2]);
+	int factor;
+	starpu_codelet_unpack_args(arg, &factor);
+	*z += factor * (*y1 + *y2);
+}
+
+static struct starpu_codelet add_cl =
+{
+	.cpu_funcs = {add_cpu},
+	.cpu_funcs_name = {"add_cpu"},
+	.nbuffers = 1,
+	.modes = {STARPU_RW},
+};
+
+static struct starpu_codelet copy_cl =
+{
+	.cpu_funcs = {copy_cpu},
+	.cpu_funcs_name = {"copy_cpu"},
+	.nbuffers = 2,
+	.modes = {STARPU_R, STARPU_W},
+};
+
+static struct starpu_codelet sum_cl =
+{
+	.cpu_funcs = {sum_cpu},
+	.cpu_funcs_name = {"sum_cpu"},
+	.nbuffers = 3,
+	.modes = {STARPU_R, STARPU_R, STARPU_RW},
+};
+
+static int one = 1;
+static int two = 2;
+
+static int submit_add(starpu_data_handle_t handle, int *inc)
+{
+	struct starpu_task *task = starpu_task_create();
+	task->cl = &add_cl;
+	task->handles[0] = handle;
+	task->cl_arg = inc;
+	task->cl_arg_size = sizeof(*inc);
+	return starpu_task_submit(task);
+}
+
+int main(void)
+{
+	int x = 0, y1 = 0, y2 = 0, z = 0;
+	int expected_x = 0, expected_z = 0;
+	starpu_data_handle_t x_handle, y1_handle, y2_handle, z_handle;
+	starpu_task_graph_t graph;
+	int ret;
+	unsigned i;
+	int factor = 1;
+
+	ret = starpu_init(NULL);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	if (starpu_cpu_worker_get_count() == 0)
+	{
+		starpu_shutdown();
+		return STARPU_TEST_SKIPPED;
+	}
+
+	starpu_variable_data_register(&x_handle, STARPU_MAIN_RAM, (uintptr_t)&x, sizeof(x));
+	starpu_variable_data_register(&y1_handle, STARPU_MAIN_RAM, (uintptr_t)&y1, sizeof(y1));
+	starpu_variable_data_register(&y2_handle, STARPU_MAIN_RAM, (uintptr_t)&y2, sizeof(y2));
+	starpu_variable_data_register(&z_handle, STARPU_MAIN_RAM, (uintptr_t)&z, sizeof(z));
+
+	starpu_task_graph_capture_begin();
+	starpu_iteration_push(0);
+	ret = submit_add(x_handle, &one);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_submit");
+	ret = starpu_task_insert(&copy_cl, STARPU_R, x_handle, STARPU_W, y1_handle, 0);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+	ret = starpu_task_insert(&copy_cl, STARPU_R, x_handle, STARPU_W, y2_handle, 0);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+	ret = submit_add(x_handle, &one);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_submit");
+	ret = starpu_task_insert(&sum_cl, STARPU_R, y1_handle, STARPU_R, y2_handle, STARPU_RW, z_handle,
+				 STARPU_VALUE, &factor, sizeof(factor), 0);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+	starpu_iteration_pop();
+	graph = starpu_task_graph_capture_end();
+	STARPU_ASSERT(graph);
+	STARPU_ASSERT(starpu_task_graph_get_ntasks(graph) == 5);
+
+	expected_z += 2 * (expected_x + 1);
+	expected_x += 2;
+
+	for (i = 1; i <= niter; i++)
+	{
+		int inc = i % 2 ? 2 : 1;
+		void *cl_args[5] = { i % 2 ? &two : NULL, NULL, NULL, NULL, NULL };
+
+		ret = starpu_task_graph_replay(graph, i, cl_args);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_graph_replay");
+
+		expected_z += 2 * (expected_x + inc);
+		expected_x += inc + 1;
+
+		if (i % 4 == 0)
+		{
+			/* Check that accesses from the application are properly ordered */
+			ret = starpu_data_acquire(x_handle, STARPU_RW);
+			STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_acquire");
+			STARPU_ASSERT_MSG(x == expected_x, "x is %d instead of %d\n", x, expected_x);
+			starpu_data_release(x_handle);
+		}
+	}
+
+	if (starpu_cuda_worker_get_count() == 0)
+	{
+		/* If some task can not be executed any more, none gets submitted */
+		uint32_t where = copy_cl.where;
+		copy_cl.where = STARPU_CUDA;
+		ret = starpu_task_graph_replay(graph, niter + 1, NULL);
+		STARPU_ASSERT_MSG(ret == -ENODEV, "replay returned %d instead of -ENODEV\n", ret);
+		copy_cl.where = where;
+
+		ret = starpu_data_acquire(x_handle, STARPU_R);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_acquire");
+		STARPU_ASSERT_MSG(x == expected_x, "x is %d instead of %d\n", x, expected_x);
+		starpu_data_release(x_handle);
+	}
+
+	starpu_task_graph_destroy(graph);
+
+	starpu_data_unregister(x_handle);
+	starpu_data_unregister(y1_handle);
+	starpu_data_unregister(y2_handle);
+	starpu_data_unregister(z_handle);
+
+	starpu_shutdown();
+
+	if (x != expected_x || z != expected_z)
+	{
+		FPRINTF(stderr, "x is %d instead of %d, z is %d instead of %d\n", x, expected_x, z, expected_z);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -21,4 +21,10 @@ source $(dirname $0)/microbench.sh
 
 XFAIL="modular-eager-prefetching modular-prio-prefetching modular-random modular-random-prio modular-random-prefetching modular-random-prio-prefetching modular-prandom modular-prandom-prio modular-ws modular-heft modular-heft-prio modular-heft2 modular-heteroprio modular-gemm random peager heteroprio graph_test"
 
+if [ -z "$STARPU_SCHED" -a -z "$STARPU_WS_LOCKFREE_DEQUES" ]
+then
+	# Also check the lock-free deques of the work stealing schedulers
+	STARPU_SCHED="ws lws" STARPU_WS_LOCKFREE_DEQUES=1 $0 "$@"
+fi
+
 test_scheds parallel_independent_homogeneous_tasks
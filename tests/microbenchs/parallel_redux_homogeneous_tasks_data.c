@@ -77,7 +77,7 @@ static struct starpu_codelet cl_init =
 	.opencl_funcs = { wait_homogeneous },
 	.cpu_funcs_name = { "wait_homogeneous" },
 	.nbuffers = 1,
-	.modes = {STARPU_RW},
+	.modes = {STARPU_W},
 	.flags = STARPU_CODELET_SIMGRID_EXECUTE,
 	.model = &perf_model_init,
 	.name = "init",
@@ -111,7 +111,7 @@ int main(int argc, char *argv[])
 	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
 
 	unsigned nb_tasks, nb_workers;
-	double begin_time, end_time, time_m, time_s, speed_up, expected_speed_up, percentage_expected_speed_up;
+	double begin_time, redux_begin_time, end_time, time_m, time_r, time_s, speed_up, expected_speed_up, percentage_expected_speed_up;
 	bool check, check_sup;
 
 	nb_workers = starpu_worker_get_count_by_type(STARPU_CPU_WORKER) + starpu_worker_get_count_by_type(STARPU_CUDA_WORKER) + starpu_worker_get_count_by_type(STARPU_OPENCL_WORKER);
@@ -153,15 +153,21 @@ int main(int argc, char *argv[])
 		ret = starpu_task_insert(&cl, STARPU_REDUX, vector_handle, 0);
 		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
 	}
-	starpu_data_wont_use(vector_handle);
 
 	starpu_task_wait_for_all();
 
+	/* Now trigger the reduction of the partial results, and measure how
+	 * long it takes */
+	redux_begin_time = starpu_timing_now();
+	ret = starpu_data_acquire(vector_handle, STARPU_R);
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_data_acquire");
 	end_time = starpu_timing_now();
+	starpu_data_release(vector_handle);
 
 	starpu_data_unregister(vector_handle);
 
 	time_m = (end_time - begin_time)/SECONDS_SCALE_COEFFICIENT_TIMING_NOW; //pour ramener en secondes
+	time_r = (end_time - redux_begin_time)/SECONDS_SCALE_COEFFICIENT_TIMING_NOW;
 	time_s = nb_tasks * TIME;
 	speed_up = time_s/time_m;
 	expected_speed_up = nb_workers;
@@ -169,7 +175,7 @@ int main(int argc, char *argv[])
 	check = speed_up >= ((1 - MARGIN) * expected_speed_up);
 	check_sup = speed_up <= ((1 + MARGIN) * expected_speed_up);
 
-	printf("measured time = %f seconds\nsequential time = %f seconds\nspeed up = %f\nnumber of workers = %u\nnumber of tasks = %u\nexpected speed up = %f\npercentage of expected speed up %.2f%%\n", time_m, time_s, speed_up, nb_workers, nb_tasks, expected_speed_up, percentage_expected_speed_up);
+	printf("measured time = %f seconds\nreduction time = %f seconds\nsequential time = %f seconds\nspeed up = %f\nnumber of workers = %u\nnumber of tasks = %u\nexpected speed up = %f\npercentage of expected speed up %.2f%%\n", time_m, time_r, time_s, speed_up, nb_workers, nb_tasks, expected_speed_up, percentage_expected_speed_up);
 
 	starpu_shutdown();
 	free(vector);
@@ -0,0 +1,191 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <starpu.h>
+#include "../helper.h"
+
+/*
+ * Measure the cost of implicit dependencies when a lot of tasks read the same
+ * data, with a writer every once in a while. The readers check that they see
+ * the value of the last writer.
+ *
+ * Compare with STARPU_IMPLICIT_READ_EPOCHS=0 to see the benefit of read epochs.
+ */
+
+#ifdef STARPU_QUICK_CHECK
+static unsigned ntasks = 1024;
+#else
+static unsigned ntasks = 65536;
+#endif
+static unsigned nreaders = 256;
+
+static unsigned long nerrors;
+
+void read_func(void *descr[], void *arg)
+{
+	unsigned *x = (unsigned *)STARPU_VARIABLE_GET_PTR(descr[0]);
+	unsigned expected = (uintptr_t) arg;
+	if (*x != expected)
+		(void) STARPU_ATOMIC_ADDL(&nerrors, 1);
+}
+
+void write_func(void *descr[], void *arg)
+{
+	(void)arg;
+	unsigned *x = (unsigned *)STARPU_VARIABLE_GET_PTR(descr[0]);
+	(*x)++;
+}
+
+static struct starpu_codelet read_codelet =
+{
+	.cpu_funcs = {read_func},
+	.cpu_funcs_name = {"read_func"},
+	.nbuffers = 1,
+	.modes = {STARPU_R}
+};
+
+static struct starpu_codelet write_codelet =
+{
+	.cpu_funcs = {write_func},
+	.cpu_funcs_name = {"write_func"},
+	.nbuffers = 1,
+	.modes = {STARPU_RW}
+};
+
+static void usage(char **argv)
+{
+	fprintf(stderr, "Usage: %s [-i ntasks] [-r nreaders] [-p sched_policy] [-h]\n", argv[0]);
+	fprintf(stderr, "\t-r nreaders\tnumber of readers between two writers\n");
+	exit(EXIT_FAILURE);
+}
+
+static void parse_args(int argc, char **argv, struct starpu_conf *conf)
+{
+	int c;
+	while ((c = getopt(argc, argv, "i:r:p:h")) != -1)
+	switch(c)
+	{
+		case 'i':
+			ntasks = atoi(optarg);
+			break;
+		case 'r':
+			nreaders = atoi(optarg);
+			break;
+		case 'p':
+			conf->sched_policy_name = optarg;
+			break;
+		case 'h':
+			usage(argv);
+			break;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int ret;
+	unsigned i;
+	unsigned x = 0, nwrites = 0;
+	double timing;
+	double start;
+	double end;
+	starpu_data_handle_t handle;
+	struct starpu_conf conf;
+	starpu_conf_init(&conf);
+
+	parse_args(argc, argv, &conf);
+
+	ret = starpu_initialize(&conf, &argc, &argv);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	if (starpu_cpu_worker_get_count() == 0)
+	{
+		starpu_shutdown();
+		return STARPU_TEST_SKIPPED;
+	}
+
+	starpu_variable_data_register(&handle, STARPU_MAIN_RAM, (uintptr_t)&x, sizeof(x));
+
+	fprintf(stderr, "#tasks : %u\n#readers between writers : %u\n", ntasks, nreaders);
+
+	start = starpu_timing_now();
+	for (i = 0; i < ntasks; i++)
+	{
+		struct starpu_task *task = starpu_task_create();
+
+		if (nreaders && (i + 1) % (nreaders + 1))
+		{
+			task->cl = &read_codelet;
+			task->cl_arg = (void*) (uintptr_t) nwrites;
+		}
+		else
+		{
+			task->cl = &write_codelet;
+			nwrites++;
+		}
+		task->handles[0] = handle;
+
+		ret = starpu_task_submit(task);
+		if (ret == -ENODEV) goto enodev;
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_submit");
+	}
+	starpu_task_wait_for_all();
+	end = starpu_timing_now();
+
+	timing = end - start;
+
+	fprintf(stderr, "Total: %f secs\n", timing/1000000);
+	fprintf(stderr, "Per task: %f usecs\n", timing/ntasks);
+
+	{
+		char *output_dir = getenv("STARPU_BENCH_DIR");
+		char *bench_id = getenv("STARPU_BENCH_ID");
+
+		if (output_dir && bench_id)
+		{
+			char file[1024];
+			FILE *f;
+
+			snprintf(file, sizeof(file), "%s/shared_read_overhead_per_task_%u.dat", output_dir, nreaders);
+			f = fopen(file, "a");
+			fprintf(f, "%s\t%f\n", bench_id, timing/ntasks);
+			fclose(f);
+		}
+	}
+
+	starpu_data_unregister(handle);
+	starpu_shutdown();
+
+	if (nerrors || x != nwrites)
+	{
+		FPRINTF(stderr, "%lu readers saw a wrong value, x is %u instead of %u\n", nerrors, x, nwrites);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+
+enodev:
+	fprintf(stderr, "WARNING: No one can execute this task\n");
+	/* yes, we do not perform the computation but we did detect that no one
+	 * could perform the kernel, so this is not an error from StarPU */
+	starpu_task_wait_for_all();
+	starpu_data_unregister(handle);
+	starpu_shutdown();
+	return STARPU_TEST_SKIPPED;
+}
@@ -0,0 +1,134 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <starpu.h>
+#include "../helper.h"
+
+/*
+ * Measure the throughput of tag declarations, notifications and removals
+ * performed concurrently by several application threads, each of them
+ * building a chain of tags and removing the oldest ones as it goes.
+ */
+
+#define MAXTHREADS 64
+
+static starpu_pthread_t threads[MAXTHREADS];
+
+#ifdef STARPU_QUICK_CHECK
+static unsigned ntags = 1024;
+#else
+static unsigned ntags = 262144;
+#endif
+static unsigned nthreads = 4;
+/* Number of tags kept declared by each thread */
+static unsigned window = 256;
+
+static void *thread_func(void *arg)
+{
+	uintptr_t t = (uintptr_t) arg;
+	starpu_tag_t base = (starpu_tag_t) t << 32;
+	unsigned i;
+
+	for (i = 0; i < ntags; i++)
+	{
+		starpu_tag_t id = base + i;
+
+		if (i > 0)
+			starpu_tag_declare_deps(id, 1, id - 1);
+		starpu_tag_notify_from_apps(id);
+		if (i >= window)
+			starpu_tag_remove(id - window);
+	}
+
+	/* The chain is complete */
+	starpu_tag_wait(base + ntags - 1);
+
+	for (i = ntags > window ? ntags - window : 0; i < ntags; i++)
+		starpu_tag_remove(base + i);
+
+	return NULL;
+}
+
+static void usage(char **argv)
+{
+	FPRINTF(stderr, "%s [-i ntags] [-t nthreads] [-w window] [-h]\n", argv[0]);
+	exit(-1);
+}
+
+static void parse_args(int argc, char **argv)
+{
+	int c;
+	while ((c = getopt(argc, argv, "i:t:w:h")) != -1)
+	switch(c)
+	{
+		case 'i':
+			ntags = atoi(optarg);
+			break;
+		case 't':
+			nthreads = atoi(optarg);
+			break;
+		case 'w':
+			window = atoi(optarg);
+			break;
+		case 'h':
+			usage(argv);
+			break;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	double timing;
+	double start;
+	double end;
+	unsigned t;
+	int ret;
+
+	parse_args(argc, argv);
+	if (nthreads > MAXTHREADS)
+		nthreads = MAXTHREADS;
+	if (ntags == 0 || window == 0)
+		usage(argv);
+
+	ret = starpu_initialize(NULL, &argc, &argv);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	FPRINTF(stderr, "#tags : %u\n#threads : %u\n#window : %u\n", ntags, nthreads, window);
+
+	start = starpu_timing_now();
+
+	for (t = 0; t < nthreads; t++)
+		STARPU_PTHREAD_CREATE(&threads[t], NULL, thread_func, (void*) (uintptr_t) t);
+
+	for (t = 0; t < nthreads; t++)
+		STARPU_PTHREAD_JOIN(threads[t], NULL);
+
+	end = starpu_timing_now();
+
+	timing = end - start;
+
+	FPRINTF(stderr, "Total: %f secs\n", timing/1000000);
+	FPRINTF(stderr, "Per tag: %f usecs\n", timing/((double) ntags*nthreads));
+	FPRINTF(stderr, "Throughput: %f Mtags/s\n", ((double) ntags*nthreads)/timing);
+
+	starpu_shutdown();
+
+	return EXIT_SUCCESS;
+}
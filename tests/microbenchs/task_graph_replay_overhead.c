@@ -0,0 +1,204 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <stdio.h>
+#include <unistd.h>
+
+#include <starpu.h>
+#include "../helper.h"
+
+/*
+ * Compare the submission time of the tasks of an iteration when they are
+ * submitted normally, and when they are replayed from a captured task graph.
+ * Task i of an iteration reads data i and modifies data i+1 (modulo the number
+ * of data), so that sequential consistency infers dependencies between them.
+ */
+
+#define BUFFERSIZE 16
+#define NDATA_MAX 64
+
+#ifdef STARPU_QUICK_CHECK
+static unsigned ntasks = 64;
+static unsigned niter = 4;
+#else
+static unsigned ntasks = 1024;
+static unsigned niter = 64;
+#endif
+static unsigned ndata = 16;
+
+static starpu_data_handle_t data_handles[NDATA_MAX];
+static float *buffers[NDATA_MAX];
+
+void dummy_func(void *descr[], void *arg)
+{
+	(void)descr;
+	(void)arg;
+}
+
+static struct starpu_codelet dummy_codelet =
+{
+	.cpu_funcs = {dummy_func},
+	.cuda_funcs = {dummy_func},
+	.opencl_funcs = {dummy_func},
+	.cpu_funcs_name = {"dummy_func"},
+	.model = NULL,
+	.nbuffers = 2,
+	.modes = {STARPU_R, STARPU_RW}
+};
+
+static void usage(char **argv)
+{
+	fprintf(stderr, "Usage: %s [-i ntasks] [-n niter] [-d ndata] [-p sched_policy] [-h]\n", argv[0]);
+	exit(EXIT_FAILURE);
+}
+
+static void parse_args(int argc, char **argv, struct starpu_conf *conf)
+{
+	int c;
+	while ((c = getopt(argc, argv, "i:n:d:p:h")) != -1)
+	switch(c)
+	{
+		case 'i':
+			ntasks = atoi(optarg);
+			break;
+		case 'n':
+			niter = atoi(optarg);
+			break;
+		case 'd':
+			ndata = atoi(optarg);
+			if (ndata < 2 || ndata > NDATA_MAX)
+				usage(argv);
+			break;
+		case 'p':
+			conf->sched_policy_name = optarg;
+			break;
+		case 'h':
+			usage(argv);
+			break;
+	}
+}
+
+static int submit_iteration(unsigned long iteration)
+{
+	unsigned i;
+	int ret = 0;
+
+	starpu_iteration_push(iteration);
+	for (i = 0; i < ntasks; i++)
+	{
+		struct starpu_task *task = starpu_task_create();
+		task->cl = &dummy_codelet;
+		task->handles[0] = data_handles[i % ndata];
+		task->handles[1] = data_handles[(i+1) % ndata];
+		ret = starpu_task_submit(task);
+		if (ret)
+		{
+			task->destroy = 0;
+			starpu_task_destroy(task);
+			break;
+		}
+	}
+	starpu_iteration_pop();
+	return ret;
+}
+
+static void print_timing(const char *what, double timing)
+{
+	fprintf(stderr, "%s: total submit %f secs, per task submit %f usecs\n", what, timing/1000000, timing/(niter*ntasks));
+}
+
+int main(int argc, char **argv)
+{
+	int ret;
+	unsigned i;
+	double start, timing_submit, timing_replay;
+	starpu_task_graph_t graph;
+	struct starpu_conf conf;
+
+	starpu_conf_init(&conf);
+	conf.ncpus = 2;
+
+	parse_args(argc, argv, &conf);
+
+	ret = starpu_initialize(&conf, &argc, &argv);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	for (i = 0; i < ndata; i++)
+	{
+		starpu_malloc((void**)&buffers[i], BUFFERSIZE*sizeof(float));
+		starpu_vector_data_register(&data_handles[i], STARPU_MAIN_RAM, (uintptr_t)buffers[i], BUFFERSIZE, sizeof(float));
+	}
+
+	fprintf(stderr, "#tasks per iteration : %u\n#iterations : %u\n#data : %u\n", ntasks, niter, ndata);
+
+	/* Normal submission */
+	start = starpu_timing_now();
+	for (i = 0; i < niter; i++)
+	{
+		ret = submit_iteration(i);
+		if (ret == -ENODEV) goto enodev;
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_submit");
+	}
+	timing_submit = starpu_timing_now() - start;
+	starpu_task_wait_for_all();
+
+	/* Capture one iteration, and replay it */
+	starpu_task_graph_capture_begin();
+	ret = submit_iteration(niter);
+	graph = starpu_task_graph_capture_end();
+	if (ret == -ENODEV) goto enodev;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_submit");
+	STARPU_ASSERT(graph);
+	STARPU_ASSERT(starpu_task_graph_get_ntasks(graph) == ntasks);
+	starpu_task_wait_for_all();
+
+	start = starpu_timing_now();
+	for (i = 0; i < niter; i++)
+	{
+		ret = starpu_task_graph_replay(graph, niter + 1 + i, NULL);
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_graph_replay");
+	}
+	timing_replay = starpu_timing_now() - start;
+	starpu_task_wait_for_all();
+
+	starpu_task_graph_destroy(graph);
+
+	print_timing("Normal submission", timing_submit);
+	print_timing("Task graph replay", timing_replay);
+
+	for (i = 0; i < ndata; i++)
+	{
+		starpu_data_unregister(data_handles[i]);
+		starpu_free_noflag((void*)buffers[i], BUFFERSIZE*sizeof(float));
+	}
+
+	starpu_shutdown();
+	return EXIT_SUCCESS;
+
+enodev:
+	fprintf(stderr, "WARNING: No one can execute this task\n");
+	/* yes, we do not perform the computation but we did detect that no one
+	 * could perform the kernel, so this is not an error from StarPU */
+	starpu_task_wait_for_all();
+	for (i = 0; i < ndata; i++)
+	{
+		starpu_data_unregister(data_handles[i]);
+		starpu_free_noflag((void*)buffers[i], BUFFERSIZE*sizeof(float));
+	}
+	starpu_shutdown();
+	return STARPU_TEST_SKIPPED;
+}
@@ -18,6 +18,7 @@
 #include <unistd.h>
 
 #include <starpu.h>
+#include <common/graph.h>
 #include "../helper.h"
 
 /*
@@ -33,6 +34,8 @@ static unsigned ntasks = 128;
 static unsigned ntasks = 65536;
 #endif
 static unsigned nbuffers = 0;
+static unsigned submit_array = 0;
+static unsigned record_graph = 0;
 
 #define BUFFERSIZE 16
 
@@ -57,14 +60,16 @@ static struct starpu_codelet dummy_codelet =
 
 static void usage(char **argv)
 {
-	fprintf(stderr, "Usage: %s [-i ntasks] [-p sched_policy] [-b nbuffers] [-h]\n", argv[0]);
+	fprintf(stderr, "Usage: %s [-i ntasks] [-p sched_policy] [-b nbuffers] [-a] [-g] [-h]\n", argv[0]);
+	fprintf(stderr, "\t-a: submit the tasks with starpu_task_submit_array\n");
+	fprintf(stderr, "\t-g: record the task graph, as graph-based schedulers do\n");
 	exit(EXIT_FAILURE);
 }
 
 static void parse_args(int argc, char **argv, struct starpu_conf *conf)
 {
 	int c;
-	while ((c = getopt(argc, argv, "i:b:p:h")) != -1)
+	while ((c = getopt(argc, argv, "i:b:p:agh")) != -1)
 	switch(c)
 	{
 		case 'i':
@@ -77,6 +82,12 @@ static void parse_args(int argc, char **argv, struct starpu_conf *conf)
 		case 'p':
 			conf->sched_policy_name = optarg;
 			break;
+		case 'a':
+			submit_array = 1;
+			break;
+		case 'g':
+			record_graph = 1;
+			break;
 		case 'h':
 			usage(argv);
 			break;
@@ -105,6 +116,9 @@ int main(int argc, char **argv)
 	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
 	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
 
+	if (record_graph)
+		_starpu_graph_record = 1;
+
 	unsigned buffer;
 	for (buffer = 0; buffer < nbuffers; buffer++)
 	{
@@ -133,8 +147,26 @@ int main(int argc, char **argv)
 	}
 	tasks[ntasks-1].detach = 0;
 
+	struct starpu_task **task_ptrs = NULL;
+	if (submit_array)
+	{
+		task_ptrs = malloc(ntasks * sizeof(*task_ptrs));
+		for (i = 0; i < ntasks; i++)
+			task_ptrs[i] = &tasks[i];
+	}
+
 	start_submit = starpu_timing_now();
-	if (nbuffers)
+	if (submit_array)
+	{
+		if (!nbuffers)
+			for (i = 1; i < ntasks; i++)
+				starpu_tag_declare_deps((starpu_tag_t)i, 1, (starpu_tag_t)(i-1));
+
+		ret = starpu_task_submit_array(task_ptrs, ntasks);
+		if (ret == -ENODEV) goto enodev;
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_submit_array");
+	}
+	else if (nbuffers)
 	{
 		/* Data dependency, just submit them all */
 		for (i = 0; i < ntasks; i++)
@@ -187,6 +219,14 @@ int main(int argc, char **argv)
 	fprintf(stderr, "Total: %f secs\n", (timing_submit+timing_exec)/1000000);
 	fprintf(stderr, "Per task: %f usecs\n", (timing_submit+timing_exec)/ntasks);
 
+	{
+		struct starpu_task_pool_stats stats;
+		starpu_task_pool_get_stats(&stats);
+		fprintf(stderr, "\n");
+		fprintf(stderr, "Task pool: %lu allocated, %lu reused, %lu freed remotely, %lu released, %lu cached\n",
+			stats.allocated, stats.reused, stats.remote_freed, stats.released, stats.cached);
+	}
+
 	{
 		char *output_dir = getenv("STARPU_BENCH_DIR");
 		char *bench_id = getenv("STARPU_BENCH_ID");
@@ -245,6 +285,7 @@ int main(int argc, char **argv)
 	}
 
 	starpu_shutdown();
+	free(task_ptrs);
 	free(tasks);
 	return EXIT_SUCCESS;
 
@@ -253,6 +294,7 @@ enodev:
 	/* yes, we do not perform the computation but we did detect that no one
 	 * could perform the kernel, so this is not an error from StarPU */
 	starpu_shutdown();
+	free(task_ptrs);
 	free(tasks);
 	return STARPU_TEST_SKIPPED;
 }
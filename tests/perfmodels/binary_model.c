@@ -0,0 +1,243 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <starpu.h>
+#include <core/perfmodel/perfmodel.h>
+#include <math.h>
+#include <unistd.h>
+#include "../helper.h"
+
+/*
+ * Check that performance models saved in the binary format get reloaded
+ * and updated, and that converting them to the text format keeps the same
+ * content
+ */
+
+#define NSIZES	4
+#define NLOOPS	10
+#define NROUNDS	2
+
+void func(void *descr[], void *arg)
+{
+	(void)descr;
+	(void)arg;
+	starpu_usleep(100);
+}
+
+static struct starpu_perfmodel model =
+{
+	.type = STARPU_REGRESSION_BASED,
+	.symbol = "binary_model_regression_based"
+};
+
+static struct starpu_codelet mycodelet =
+{
+	.cpu_funcs = {func},
+	.cpu_funcs_name = {"func"},
+	.model = &model,
+	.nbuffers = 1,
+	.modes = {STARPU_W}
+};
+
+static unsigned count_nsamples(struct starpu_perfmodel *lmodel)
+{
+	unsigned nsamples = 0;
+	int i, impl;
+	for(i = 0; i < lmodel->state->ncombs; i++)
+	{
+		int comb = lmodel->state->combs[i];
+		for(impl = 0; impl < lmodel->state->nimpls[comb]; impl++)
+			nsamples += lmodel->state->per_arch[comb][impl].regression.nsample;
+	}
+	return nsamples;
+}
+
+static int close_enough(double a, double b)
+{
+	if (isnan(a) || isnan(b))
+		return isnan(a) && isnan(b);
+	/* The text format only keeps 7 digits */
+	return fabs(a - b) <= 1e-5 * fabs(a);
+}
+
+/* Check that both models have the same content */
+static int compare_models(struct starpu_perfmodel *model1, struct starpu_perfmodel *model2)
+{
+	int i, impl;
+
+	if (model1->state->ncombs != model2->state->ncombs)
+		return 1;
+	for(i = 0; i < model1->state->ncombs; i++)
+	{
+		int comb = model1->state->combs[i];
+		if (model1->state->nimpls[comb] != model2->state->nimpls[comb])
+			return 1;
+		for(impl = 0; impl < model1->state->nimpls[comb]; impl++)
+		{
+			struct starpu_perfmodel_per_arch *per_arch1 = &model1->state->per_arch[comb][impl];
+			struct starpu_perfmodel_per_arch *per_arch2 = &model2->state->per_arch[comb][impl];
+			struct starpu_perfmodel_history_list *ptr;
+
+			if (per_arch1->regression.nsample != per_arch2->regression.nsample
+			    || !close_enough(per_arch1->regression.sumlny, per_arch2->regression.sumlny)
+			    || !close_enough(per_arch1->regression.alpha, per_arch2->regression.alpha)
+			    || !close_enough(per_arch1->regression.beta, per_arch2->regression.beta))
+				return 1;
+
+			for (ptr = per_arch1->list; ptr; ptr = ptr->next)
+			{
+				struct starpu_perfmodel_history_list *ptr2;
+				for (ptr2 = per_arch2->list; ptr2; ptr2 = ptr2->next)
+					if (ptr2->entry->footprint == ptr->entry->footprint)
+						break;
+				if (!ptr2
+				    || ptr->entry->nsample != ptr2->entry->nsample
+				    || !close_enough(ptr->entry->mean, ptr2->entry->mean))
+					return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+#if !defined(STARPU_HAVE_SETENV)
+#warning setenv is not defined. Skipping test
+int main(void)
+{
+	return STARPU_TEST_SKIPPED;
+}
+#else
+int main(void)
+{
+	struct starpu_perfmodel lmodel;
+	struct starpu_conf conf;
+	starpu_data_handle_t handles[NSIZES];
+	unsigned old_nsamples = 0, nsamples;
+	char path[256];
+	char textpath[sizeof(path)+8];
+	int round, loop, i, ret;
+	FILE *f;
+
+	setenv("STARPU_PERF_MODEL_BINARY", "1", 1);
+
+	for (round = 0; round < NROUNDS; round++)
+	{
+		starpu_conf_init(&conf);
+		conf.sched_policy_name = "eager";
+		conf.calibrate = 1;
+
+		ret = starpu_init(&conf);
+		if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+		STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+		if (round == 0)
+		{
+			memset(&lmodel, 0, sizeof(lmodel));
+			lmodel.type = model.type;
+			if (starpu_perfmodel_load_symbol(model.symbol, &lmodel) != 1)
+			{
+				old_nsamples = count_nsamples(&lmodel);
+				starpu_perfmodel_unload_model(&lmodel);
+			}
+		}
+
+		for (i = 0; i < NSIZES; i++)
+			starpu_vector_data_register(&handles[i], -1, (uintptr_t)NULL, 100 << i, sizeof(int));
+		for (loop = 0; loop < NLOOPS; loop++)
+			for (i = 0; i < NSIZES; i++)
+			{
+				ret = starpu_task_insert(&mycodelet, STARPU_W, handles[i], 0);
+				if (ret == -ENODEV) goto enodev;
+				STARPU_CHECK_RETURN_VALUE(ret, "starpu_task_insert");
+			}
+		for (i = 0; i < NSIZES; i++)
+			starpu_data_unregister(handles[i]);
+
+		/* This saves the model, the second round updates it in place */
+		starpu_shutdown();
+	}
+
+	ret = starpu_init(NULL);
+	if (ret == -ENODEV) return STARPU_TEST_SKIPPED;
+	STARPU_CHECK_RETURN_VALUE(ret, "starpu_init");
+
+	starpu_perfmodel_get_model_path(model.symbol, path, sizeof(path));
+	FPRINTF(stderr, "Perfmodel File <%s>\n", path);
+
+	/* Check that it was saved in the binary format */
+	char magic[sizeof(_STARPU_PERFMODEL_BIN_MAGIC)];
+	f = fopen(path, "r");
+	STARPU_ASSERT(f);
+	ret = fread(magic, sizeof(magic), 1, f);
+	fclose(f);
+	if (ret != 1 || memcmp(magic, _STARPU_PERFMODEL_BIN_MAGIC, sizeof(magic)))
+	{
+		FPRINTF(stderr, "The performance model was not saved in the binary format\n");
+		goto fail;
+	}
+
+	memset(&lmodel, 0, sizeof(lmodel));
+	ret = starpu_perfmodel_load_file(path, &lmodel);
+	if (ret == 1)
+	{
+		FPRINTF(stderr, "The performance model could not be loaded\n");
+		goto fail;
+	}
+	nsamples = count_nsamples(&lmodel);
+	if (nsamples != old_nsamples + NROUNDS * NLOOPS * NSIZES)
+	{
+		FPRINTF(stderr, "Sampling failed %u + %u != %u\n", old_nsamples, NROUNDS * NLOOPS * NSIZES, nsamples);
+		goto fail_unload;
+	}
+
+	/* Convert it to the text format, and check that we read the same */
+	snprintf(textpath, sizeof(textpath), "%s.text", path);
+	ret = _starpu_perfmodel_save_file(&lmodel, textpath, 0);
+	STARPU_ASSERT(ret == 0);
+
+	struct starpu_perfmodel tmodel;
+	memset(&tmodel, 0, sizeof(tmodel));
+	ret = starpu_perfmodel_load_file(textpath, &tmodel);
+	unlink(textpath);
+	if (ret == 1)
+	{
+		FPRINTF(stderr, "The converted performance model could not be loaded\n");
+		goto fail_unload;
+	}
+	ret = compare_models(&lmodel, &tmodel);
+	starpu_perfmodel_unload_model(&tmodel);
+	if (ret)
+	{
+		FPRINTF(stderr, "The converted performance model is different\n");
+		goto fail_unload;
+	}
+
+	starpu_perfmodel_unload_model(&lmodel);
+	starpu_shutdown();
+	return EXIT_SUCCESS;
+
+enodev:
+	for (i = 0; i < NSIZES; i++)
+		starpu_data_unregister(handles[i]);
+	starpu_shutdown();
+	return STARPU_TEST_SKIPPED;
+fail_unload:
+	starpu_perfmodel_unload_model(&lmodel);
+fail:
+	starpu_shutdown();
+	return EXIT_FAILURE;
+}
+#endif
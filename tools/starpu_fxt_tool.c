@@ -36,6 +36,11 @@ static void usage()
 	fprintf(stderr, "			case\n");
 	fprintf(stderr, "   -o <output file>	specify the paje output filename\n");
 	fprintf(stderr, "   -d <directory>	specify the directory in which to save files\n");
+	fprintf(stderr, "   -only <outputs>	only generate the given comma-separated outputs among paje,\n");
+	fprintf(stderr, "			dag, tasks, comms, data, papi, anim, states, distrib,\n");
+	fprintf(stderr, "			activity, sched-tasks and number-events\n");
+	fprintf(stderr, "   -j <threads>		number of threads used to scan the input files (default:\n");
+	fprintf(stderr, "			one per CPU)\n");
 	fprintf(stderr, "   -c			use a different colour for every type of task\n");
 	fprintf(stderr, "   -no-events		do not show events\n");
 	fprintf(stderr, "   -no-counter		do not show scheduler counters\n");
@@ -83,6 +88,20 @@ static int parse_args(int argc, char **argv)
 			options.dir = argv[++i];
 			reading_input_filenames = 0;
 		}
+		else if (strcmp(argv[i], "-only") == 0)
+		{
+			if (_starpu_fxt_options_select_outputs(&options, argv[++i]))
+			{
+				usage();
+				return 7;
+			}
+			reading_input_filenames = 0;
+		}
+		else if (strcmp(argv[i], "-j") == 0)
+		{
+			options.nthreads = atoi(argv[++i]);
+			reading_input_filenames = 0;
+		}
 		else if (strcmp(argv[i], "-i") == 0)
 		{
 			if (options.ninputfiles >= STARPU_FXT_MAX_FILES)
@@ -0,0 +1,165 @@
+/* StarPU --- Runtime system for heterogeneous multicore architectures.
+ *
+ * Copyright (C) 2024-2024  University of Bordeaux, CNRS (LaBRI UMR 5800), Inria
+ *
+ * StarPU is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; either version 2.1 of the License, or (at
+ * your option) any later version.
+ *
+ * StarPU is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU Lesser General Public License in COPYING.LGPL for more details.
+ */
+
+#include <getopt.h>
+#include <unistd.h>
+#include <stdio.h>
+
+#include <common/config.h>
+#include <starpu.h>
+#include <core/perfmodel/perfmodel.h>
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+#include <windows.h>
+#endif
+
+#define PROGNAME "starpu_perfmodel_convert"
+
+/* convert to the binary format, or to the text format ? */
+static int binary = -1;
+/* what kernel ? */
+static char *psymbol = NULL;
+/* what file ? */
+static char *pinput = NULL;
+/* where to write the result ? (NULL = in place) */
+static char *poutput = NULL;
+
+static void usage()
+{
+	fprintf(stderr, "Convert a perfmodel between the text and the binary formats\n\n");
+	fprintf(stderr, "Usage: %s [ options ]\n", PROGNAME);
+	fprintf(stderr, "\n");
+	fprintf(stderr, "One must specify either -b or -t, and either -s or -i\n");
+	fprintf(stderr, "Options:\n");
+	fprintf(stderr, "   -b			convert to the binary format\n");
+	fprintf(stderr, "   -t			convert to the text format\n");
+	fprintf(stderr, "   -s <symbol>		specify the symbol\n");
+	fprintf(stderr, "   -i <file>		specify the perfmodel file\n");
+	fprintf(stderr, "   -o <file>		write the result to this file instead of converting in place\n");
+	fprintf(stderr, "   -h, --help		display this help and exit\n");
+	fprintf(stderr, "   -v, --version	output version information and exit\n\n");
+	fprintf(stderr, "Report bugs to <%s>.", PACKAGE_BUGREPORT);
+	fprintf(stderr, "\n");
+}
+
+static void parse_args(int argc, char **argv)
+{
+	int c;
+
+	static struct option long_options[] =
+	{
+		{"binary",  no_argument,       NULL, 'b'},
+		{"text",    no_argument,       NULL, 't'},
+		{"symbol",  required_argument, NULL, 's'},
+		{"input",   required_argument, NULL, 'i'},
+		{"output",  required_argument, NULL, 'o'},
+		{"help",    no_argument,       NULL, 'h'},
+		{"version", no_argument,       NULL, 'v'},
+		{0, 0, 0, 0}
+	};
+
+	int option_index;
+	while ((c = getopt_long(argc, argv, "bts:i:o:hv", long_options, &option_index)) != -1)
+	{
+		switch (c)
+		{
+		case 'b':
+			binary = 1;
+			break;
+
+		case 't':
+			binary = 0;
+			break;
+
+		case 's':
+			/* symbol */
+			psymbol = optarg;
+			break;
+
+		case 'i':
+			/* input file */
+			pinput = optarg;
+			break;
+
+		case 'o':
+			/* output file */
+			poutput = optarg;
+			break;
+
+		case 'h':
+			usage();
+			exit(EXIT_SUCCESS);
+
+		case 'v':
+			fputs(PROGNAME " (" PACKAGE_NAME ") " PACKAGE_VERSION "\n", stderr);
+			exit(EXIT_SUCCESS);
+
+		case '?':
+		default:
+			fprintf(stderr, "Unrecognized option: -%c\n", optopt);
+		}
+	}
+
+	if (binary == -1 || (!psymbol == !pinput))
+	{
+		fprintf(stderr, "Incorrect usage, aborting\n");
+		usage();
+		exit(-1);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	struct starpu_perfmodel model = { .type = STARPU_PERFMODEL_INVALID };
+	int ret;
+
+#if defined(_WIN32) && !defined(__CYGWIN__)
+	WSADATA wsadata;
+	WSAStartup(MAKEWORD(1,0), &wsadata);
+#endif
+
+	parse_args(argc, argv);
+	starpu_drivers_preinit();
+	starpu_perfmodel_initialize();
+
+	if (psymbol)
+		ret = starpu_perfmodel_load_symbol(psymbol, &model);
+	else
+	{
+		if (access(pinput, R_OK))
+		{
+			fprintf(stderr, "Cannot read the performance model file <%s>\n", pinput);
+			return 1;
+		}
+		ret = starpu_perfmodel_load_file(pinput, &model);
+	}
+	if (ret == 1)
+	{
+		fprintf(stderr, "The performance model <%s> could not be loaded\n", psymbol ? psymbol : pinput);
+		return 1;
+	}
+
+	if (!poutput)
+		poutput = model.path;
+
+	ret = _starpu_perfmodel_save_file(&model, poutput, binary);
+	if (ret)
+		fprintf(stderr, "The performance model could not be written to <%s>\n", poutput);
+
+	starpu_perfmodel_unload_model(&model);
+	starpu_perfmodel_free_sampling();
+	return ret;
+}